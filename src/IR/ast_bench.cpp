@@ -0,0 +1,454 @@
+#include "compact-ast.h"
+#include <parser/parser.h>
+
+#include <chrono>
+#include <string>
+#include <fstream>
+
+
+/*
+    AST encoding benchmark: memory taken by the nodes of the pointer AST and of its compact encoding (see compact-ast.h),
+    and the time to walk every node of each, on a large synthetic program.
+    Usage: ast_bench.exe [c file to parse]
+    Both walks visit the same nodes in the same order and fold them into a checksum, which must match.
+*/
+
+
+static const int N_RUNS = 10;
+
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/*
+    Generate functions mixing declarations, expressions and control flow, of about given size.
+*/
+static std::string generateProgram(size_t size){
+    static const char *statements[] = {
+        "    a = (a + b * 3) << 2 | (b - a) / 7;\n",
+        "    if (a < b){ a = a + 1; } else if (a == b){ b = helper(a, b); } else { b--; }\n",
+        "    while (a > 0){ a = a - 1; if (a == 5){ break; } }\n",
+        "    for (i = 0; i < 16; i++){ arr[i] = arr[(i + 1) & 15] * i; }\n",
+        "    { long t = a ^ b; a = t & 255; b = (long)(int)t; }\n",
+        "    p->x = (long)a * p->y + (int)(b % 5) - point.x;\n",
+    };
+
+    std::string src = "struct Point{ long x; long y; };\nlong helper(long u, long v){ return u * v; }\n";
+    src.reserve(size + 1024);
+
+    int function = 0;
+    while (src.size() < size){
+        src += "long function" + std::to_string(function++) + "(long a, long b){\n"
+               "    long arr[16];\n    long i;\n    struct Point point;\n    struct Point *p = &point;\n";
+        for (int i=0; i<24; i++){
+            src += statements[i % ARRAY_COUNT(statements)];
+        }
+        src += "    return a + b;\n}\n\n";
+    }
+    return src;
+}
+
+
+
+/*
+    Pointer AST: bytes taken by the nodes and their children lists, the symbol tables are left out
+    as the compact encoding does not have them.
+*/
+static size_t footprint(Subexpr *expr){
+    if (!expr){
+        return 0;
+    }
+
+    size_t size = sizeof(Subexpr);
+    switch (expr->subtag){
+    case Subexpr::SUBEXPR_BINARY_OP:
+        return size + footprint(expr->binary.left) + footprint(expr->binary.right);
+    case Subexpr::SUBEXPR_RECURSE_PARENTHESIS:
+        return size + footprint(expr->inside);
+    case Subexpr::SUBEXPR_UNARY:
+        return size + footprint(expr->unary.expr);
+    case Subexpr::SUBEXPR_CAST:
+        return size + footprint(expr->cast.expr);
+    case Subexpr::SUBEXPR_FUNCTION_CALL:
+        size += sizeof(FunctionCall) + expr->functionCall->arguments.capacity() * sizeof(Subexpr*);
+        for (Subexpr *arg : expr->functionCall->arguments){
+            size += footprint(arg);
+        }
+        return size;
+    case Subexpr::SUBEXPR_INITIALIZER_LIST:
+        size += sizeof(InitializerList) + expr->initList->values.capacity() * sizeof(Subexpr*);
+        for (Subexpr *value : expr->initList->values){
+            size += footprint(value);
+        }
+        return size;
+    default:
+        return size;
+    }
+}
+
+static size_t footprint(StatementBlock *block);
+
+static size_t footprint(Node *node){
+    switch (node->tag){
+    case Node::NODE_SUBEXPR:
+        return footprint((Subexpr *)node);
+    case Node::NODE_DECLARATION:{
+        Declaration *d = (Declaration *)node;
+        size_t size = sizeof(Declaration) + d->decln.capacity() * sizeof(Declaration::DeclInfo);
+        for (auto &decl : d->decln){
+            size += footprint(decl.initValue);
+        }
+        return size;
+    }
+    case Node::NODE_IF_BLOCK:{
+        size_t size = 0;
+        for (IfNode *i = (IfNode *)node; i; i = i->nextIf){
+            size += sizeof(IfNode) + footprint(i->condition) + footprint(i->block);
+        }
+        return size;
+    }
+    case Node::NODE_WHILE:{
+        WhileNode *w = (WhileNode *)node;
+        return sizeof(WhileNode) + footprint(w->condition) + footprint(w->block);
+    }
+    case Node::NODE_FOR:{
+        ForNode *f = (ForNode *)node;
+        return sizeof(ForNode) + footprint(f->init) + footprint(f->exitCondition) + footprint(f->update) + footprint(f->block);
+    }
+    case Node::NODE_STMT_BLOCK:
+        return footprint((StatementBlock *)node);
+    case Node::NODE_RETURN:
+        return sizeof(ReturnNode) + footprint(((ReturnNode *)node)->returnVal);
+    case Node::NODE_BREAK:
+        return sizeof(BreakNode);
+    case Node::NODE_CONTINUE:
+        return sizeof(ContinueNode);
+    default:
+        return 0;
+    }
+}
+
+static size_t footprint(StatementBlock *block){
+    if (!block){
+        return 0;
+    }
+    size_t size = sizeof(StatementBlock) + block->statements.capacity() * sizeof(Node*);
+    for (Node *stmt : block->statements){
+        size += footprint(stmt);
+    }
+    return size;
+}
+
+static size_t footprint(AST *ast){
+    size_t size = footprint(&ast->global);
+    for (auto &entry : ast->functions.entries){
+        Function &foo = entry.second.info;
+        size += sizeof(Function) + foo.parameters.capacity() * sizeof(Function::Parameter) + footprint(foo.block);
+    }
+    return size;
+}
+
+
+
+/*
+    Walks over the pointer AST, folding the kind and token of each node into the checksum.
+*/
+static uint64_t mix(uint64_t sum, uint64_t value){
+    return (sum ^ value) * 0x100000001B3ull;
+}
+
+static uint64_t walk(Subexpr *expr, uint64_t sum){
+    if (!expr){
+        return mix(sum, 0);
+    }
+
+    sum = mix(sum, expr->subtag);
+    switch (expr->subtag){
+    case Subexpr::SUBEXPR_BINARY_OP:
+        sum = mix(sum, expr->binary.op.index);
+        sum = walk(expr->binary.left, sum);
+        return walk(expr->binary.right, sum);
+    case Subexpr::SUBEXPR_LEAF:
+        return mix(sum, expr->leaf.index);
+    case Subexpr::SUBEXPR_RECURSE_PARENTHESIS:
+        return walk(expr->inside, sum);
+    case Subexpr::SUBEXPR_UNARY:
+        sum = mix(sum, expr->unary.op.index);
+        return walk(expr->unary.expr, sum);
+    case Subexpr::SUBEXPR_CAST:
+        return walk(expr->cast.expr, sum);
+    case Subexpr::SUBEXPR_FUNCTION_CALL:
+        sum = mix(sum, expr->functionCall->funcName.index);
+        for (Subexpr *arg : expr->functionCall->arguments){
+            sum = walk(arg, sum);
+        }
+        return sum;
+    case Subexpr::SUBEXPR_INITIALIZER_LIST:
+        for (Subexpr *value : expr->initList->values){
+            sum = walk(value, sum);
+        }
+        return sum;
+    default:
+        return sum;
+    }
+}
+
+static uint64_t walk(StatementBlock *block, uint64_t sum);
+
+static uint64_t walk(Node *node, uint64_t sum){
+    sum = mix(sum, node->tag);
+    switch (node->tag){
+    case Node::NODE_SUBEXPR:
+        return walk((Subexpr *)node, sum);
+    case Node::NODE_DECLARATION:
+        for (auto &decl : ((Declaration *)node)->decln){
+            sum = mix(sum, decl.identifier.index);
+            sum = walk(decl.initValue, sum);
+        }
+        return sum;
+    case Node::NODE_IF_BLOCK:
+        for (IfNode *i = (IfNode *)node; i; i = i->nextIf){
+            sum = walk((i->subtag == IfNode::IF_NODE)? i->condition : NULL, sum);
+            sum = walk(i->block, sum);
+        }
+        return sum;
+    case Node::NODE_WHILE:
+        sum = walk(((WhileNode *)node)->condition, sum);
+        return walk(((WhileNode *)node)->block, sum);
+    case Node::NODE_FOR:{
+        ForNode *f = (ForNode *)node;
+        sum = walk(f->init, sum);
+        sum = walk(f->exitCondition, sum);
+        sum = walk(f->update, sum);
+        return walk(f->block, sum);
+    }
+    case Node::NODE_STMT_BLOCK:
+        return walk((StatementBlock *)node, sum);
+    case Node::NODE_RETURN:
+        sum = mix(sum, ((ReturnNode *)node)->returnToken.index);
+        return walk(((ReturnNode *)node)->returnVal, sum);
+    case Node::NODE_BREAK:
+        return mix(sum, ((BreakNode *)node)->breakToken.index);
+    case Node::NODE_CONTINUE:
+        return mix(sum, ((ContinueNode *)node)->continueToken.index);
+    default:
+        return sum;
+    }
+}
+
+static uint64_t walk(StatementBlock *block, uint64_t sum){
+    if (!block){
+        return mix(sum, 0);
+    }
+    for (Node *stmt : block->statements){
+        if (stmt->tag != Node::NODE_ERROR){
+            sum = walk(stmt, sum);
+        }
+    }
+    return sum;
+}
+
+static uint64_t walk(AST *ast){
+    uint64_t sum = walk(&ast->global, 0);
+    for (auto &entry : ast->functions.entries){
+        sum = mix(sum, entry.second.info.funcName.index);
+        sum = walk(entry.second.info.block, sum);
+    }
+    return sum;
+}
+
+
+
+/*
+    The same walk over the compact encoding.
+*/
+static uint64_t walkExpr(const CompactAST &c, NodeIndex index, uint64_t sum){
+    if (index == NO_NODE){
+        return mix(sum, 0);
+    }
+
+    const CompactExpr &e = c.exprs[index];
+    sum = mix(sum, e.subtag);
+    switch (e.subtag){
+    case Subexpr::SUBEXPR_BINARY_OP:
+        sum = mix(sum, e.token);
+        sum = walkExpr(c, e.lhs, sum);
+        return walkExpr(c, e.rhs, sum);
+    case Subexpr::SUBEXPR_LEAF:
+        return mix(sum, e.token);
+    case Subexpr::SUBEXPR_RECURSE_PARENTHESIS:
+    case Subexpr::SUBEXPR_CAST:
+        return walkExpr(c, e.lhs, sum);
+    case Subexpr::SUBEXPR_UNARY:
+        sum = mix(sum, e.token);
+        return walkExpr(c, e.lhs, sum);
+    case Subexpr::SUBEXPR_FUNCTION_CALL:
+        sum = mix(sum, e.token);
+        for (uint32_t i=0; i<e.rhs; i++){
+            sum = walkExpr(c, c.exprLists[e.lhs + i], sum);
+        }
+        return sum;
+    case Subexpr::SUBEXPR_INITIALIZER_LIST:
+        for (uint32_t i=0; i<e.rhs; i++){
+            sum = walkExpr(c, c.exprLists[e.lhs + i], sum);
+        }
+        return sum;
+    default:
+        return sum;
+    }
+}
+
+static uint64_t walkBlock(const CompactAST &c, NodeIndex index, uint64_t sum);
+
+static uint64_t walkStatements(const CompactAST &c, IndexRange statements, uint64_t sum){
+    // statement kinds are in the order of the node tags
+    static const int NODE_TAGS[] = {
+        Node::NODE_SUBEXPR, Node::NODE_DECLARATION, Node::NODE_IF_BLOCK, Node::NODE_WHILE, Node::NODE_FOR,
+        Node::NODE_STMT_BLOCK, Node::NODE_RETURN, Node::NODE_BREAK, Node::NODE_CONTINUE,
+    };
+
+    for (uint32_t s=0; s<statements.count; s++){
+        StmtRef ref = c.stmtLists[statements.start + s];
+        sum = mix(sum, NODE_TAGS[ref.kind]);
+
+        switch (ref.kind){
+        case StmtRef::STMT_EXPR:
+            sum = walkExpr(c, ref.index, sum);
+            break;
+        case StmtRef::STMT_DECLARATION:{
+            IndexRange vars = c.declarations[ref.index];
+            for (uint32_t i=0; i<vars.count; i++){
+                const CompactVariable &v = c.variables[vars.start + i];
+                sum = mix(sum, v.identifier);
+                sum = walkExpr(c, v.initValue, sum);
+            }
+            break;
+        }
+        case StmtRef::STMT_IF:
+            for (NodeIndex i = ref.index; i != NO_NODE; i = c.ifs[i].nextIf){
+                sum = walkExpr(c, c.ifs[i].condition, sum);
+                sum = walkBlock(c, c.ifs[i].block, sum);
+            }
+            break;
+        case StmtRef::STMT_WHILE:
+            sum = walkExpr(c, c.whiles[ref.index].condition, sum);
+            sum = walkBlock(c, c.whiles[ref.index].block, sum);
+            break;
+        case StmtRef::STMT_FOR:{
+            const CompactFor &f = c.fors[ref.index];
+            sum = walkExpr(c, f.init, sum);
+            sum = walkExpr(c, f.exitCondition, sum);
+            sum = walkExpr(c, f.update, sum);
+            sum = walkBlock(c, f.block, sum);
+            break;
+        }
+        case StmtRef::STMT_BLOCK:
+            sum = walkBlock(c, ref.index, sum);
+            break;
+        case StmtRef::STMT_RETURN:
+            sum = mix(sum, c.jumps[ref.index].token);
+            sum = walkExpr(c, c.jumps[ref.index].value, sum);
+            break;
+        case StmtRef::STMT_BREAK:
+        case StmtRef::STMT_CONTINUE:
+            sum = mix(sum, c.jumps[ref.index].token);
+            break;
+        }
+    }
+    return sum;
+}
+
+static uint64_t walkBlock(const CompactAST &c, NodeIndex index, uint64_t sum){
+    if (index == NO_NODE){
+        return mix(sum, 0);
+    }
+    return walkStatements(c, c.blocks[index].statements, sum);
+}
+
+static uint64_t walk(const CompactAST &c){
+    uint64_t sum = walkStatements(c, c.global, 0);
+    for (const CompactFunction &foo : c.functions){
+        sum = mix(sum, foo.funcName);
+        sum = walkBlock(c, foo.block, sum);
+    }
+    return sum;
+}
+
+
+
+template <typename F>
+static double best(F f){
+    double best = 1e30;
+    for (int i=0; i<N_RUNS; i++){
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double elapsed = secondsSince(start);
+        best = (elapsed < best)? elapsed : best;
+    }
+    return best;
+}
+
+
+static int benchSource(const char *name, const std::string &src){
+    Tokenizer t;
+    t.init();
+    t.loadStringToBuffer(src.data(), src.size(), name);
+    t.preLex();
+
+    Arena a;
+    a.init(PAGE_SIZE * 2);
+    a.createFrame();
+
+    Parser p;
+    p.init(&t, &a);
+    AST *ast = p.parseProgram();
+    if (!ast){
+        fprintf(stderr, "Failed to parse %s.\n", name);
+        return EXIT_FAILURE;
+    }
+
+    CompactAST c = compactAST(ast, &t);
+
+    size_t pointerBytes = footprint(ast);
+    size_t compactBytes = c.footprint();
+    size_t nodes = c.exprs.size() + c.declarations.size() + c.blocks.size() + c.ifs.size() + c.whiles.size() + c.fors.size() + c.jumps.size();
+    fprintf(stderr, "[AST] %s: %.2f MB source, %zu nodes (%zu expressions)\n", name, src.size() / (1024.0 * 1024.0), nodes, c.exprs.size());
+    fprintf(stderr, "[Memory] pointer AST %.2f MB, compact AST %.2f MB, x%.2f smaller\n",
+            pointerBytes / (1024.0 * 1024.0), compactBytes / (1024.0 * 1024.0), (double)pointerBytes / compactBytes);
+
+    uint64_t pointerSum = 0, compactSum = 0;
+    double pointerTime = best([&]{ pointerSum = walk(ast); });
+    double compactTime = best([&]{ compactSum = walk(c); });
+    fprintf(stderr, "[Walk] pointer AST %.3f ms, compact AST %.3f ms, x%.2f faster, checksums %s\n",
+            pointerTime * 1e3, compactTime * 1e3, pointerTime / compactTime, (pointerSum == compactSum)? "match" : "DIFFER");
+
+    p.destroy();
+    a.destroyFrame();
+    a.destroy();
+    t.destroy();
+    return (pointerSum == compactSum)? 0 : EXIT_FAILURE;
+}
+
+
+int main(int argc, char **argv){
+    // the parser reports its error count on stdout
+#if defined(_WIN32)
+    freopen("NUL", "w", stdout);
+#else
+    freopen("/dev/null", "w", stdout);
+#endif
+
+    if (argc >= 2){
+        std::ifstream f(argv[1], std::ios::binary);
+        if (!f.is_open()){
+            fprintf(stderr, "Failed to open file: %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        std::string src((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        return benchSource(argv[1], src);
+    }
+
+    return benchSource("synthetic", generateProgram(256 * 1024));
+}
@@ -0,0 +1,305 @@
+#include "compact-ast.h"
+
+
+
+struct CompactBuilder {
+    CompactAST *c;
+
+    TypeId typeOf(const DataType &d);
+    NodeIndex buildExpr(Subexpr *expr);
+    IndexRange buildExprList(const ArenaVector<Subexpr*> &list);
+    StmtRef buildStatement(Node *node);
+    NodeIndex buildBlock(StatementBlock *block);
+    NodeIndex buildIf(IfNode *ifNode);
+};
+
+
+TypeId CompactBuilder :: typeOf(const DataType &d){
+    return typeTable.intern(d);
+}
+
+
+/*
+    Add an expression and its operands, the expression before its operands.
+*/
+NodeIndex CompactBuilder :: buildExpr(Subexpr *expr){
+    if (!expr || expr->tag == Node::NODE_ERROR){
+        return NO_NODE;
+    }
+
+    NodeIndex index = c->exprs.size();
+    c->exprs.push_back(CompactExpr{
+        .subtag = (uint8_t)expr->subtag,
+        .op = 0,
+        .token = 0,
+        .lhs = NO_NODE,
+        .rhs = NO_NODE,
+        .type = expr->isTypeChecked? typeOf(expr->type) : NO_TYPE,
+    });
+
+    CompactExpr e = c->exprs[index];
+    switch (expr->subtag){
+    case Subexpr::SUBEXPR_BINARY_OP:
+        e.op = expr->binary.op.type;
+        e.token = expr->binary.op.index;
+        e.lhs = buildExpr(expr->binary.left);
+        e.rhs = buildExpr(expr->binary.right);
+        break;
+
+    case Subexpr::SUBEXPR_LEAF:
+        e.token = expr->leaf.index;
+        break;
+
+    case Subexpr::SUBEXPR_RECURSE_PARENTHESIS:
+        e.lhs = buildExpr(expr->inside);
+        break;
+
+    case Subexpr::SUBEXPR_UNARY:
+        e.op = expr->unary.op.type;
+        e.token = expr->unary.op.index;
+        e.lhs = buildExpr(expr->unary.expr);
+        break;
+
+    case Subexpr::SUBEXPR_CAST:
+        e.lhs = buildExpr(expr->cast.expr);
+        e.rhs = typeOf(expr->cast.to);
+        break;
+
+    case Subexpr::SUBEXPR_FUNCTION_CALL:{
+        e.token = expr->functionCall->funcName.index;
+        IndexRange args = buildExprList(expr->functionCall->arguments);
+        e.lhs = args.start;
+        e.rhs = args.count;
+        break;
+    }
+
+    case Subexpr::SUBEXPR_INITIALIZER_LIST:{
+        IndexRange values = buildExprList(expr->initList->values);
+        e.lhs = values.start;
+        e.rhs = values.count;
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    c->exprs[index] = e;
+    return index;
+}
+
+
+/*
+    Add the expressions of a list, then the run of their indices.
+*/
+IndexRange CompactBuilder :: buildExprList(const ArenaVector<Subexpr*> &list){
+    std::vector<NodeIndex> indices;
+    indices.reserve(list.size());
+    for (Subexpr *expr : list){
+        indices.push_back(buildExpr(expr));
+    }
+
+    IndexRange range = {(uint32_t)c->exprLists.size(), (uint32_t)indices.size()};
+    c->exprLists.insert(c->exprLists.end(), indices.begin(), indices.end());
+    return range;
+}
+
+
+NodeIndex CompactBuilder :: buildIf(IfNode *ifNode){
+    NodeIndex index = c->ifs.size();
+    c->ifs.push_back(CompactIf{NO_NODE, NO_NODE, NO_NODE});
+
+    CompactIf i;
+    i.condition = (ifNode->subtag == IfNode::IF_NODE)? buildExpr(ifNode->condition) : NO_NODE;
+    i.block = buildBlock(ifNode->block);
+    i.nextIf = ifNode->nextIf? buildIf(ifNode->nextIf) : NO_NODE;
+
+    c->ifs[index] = i;
+    return index;
+}
+
+
+/*
+    Add a statement to the pool of its kind.
+*/
+StmtRef CompactBuilder :: buildStatement(Node *node){
+    switch (node->tag){
+    case Node::NODE_SUBEXPR:{
+        return StmtRef{StmtRef::STMT_EXPR, buildExpr((Subexpr *)node)};
+    }
+
+    case Node::NODE_DECLARATION:{
+        Declaration *d = (Declaration *)node;
+
+        NodeIndex index = c->declarations.size();
+        c->declarations.push_back(IndexRange{});
+
+        // the initial values are added first, so that the variables of the declaration stay contiguous
+        std::vector<NodeIndex> initValues;
+        initValues.reserve(d->decln.size());
+        for (auto &decl : d->decln){
+            initValues.push_back(buildExpr(decl.initValue));
+        }
+
+        IndexRange range = {(uint32_t)c->variables.size(), (uint32_t)d->decln.size()};
+        for (size_t i=0; i<d->decln.size(); i++){
+            c->variables.push_back(CompactVariable{
+                .type = typeOf(d->decln[i].type),
+                .identifier = (TokenIndex)d->decln[i].identifier.index,
+                .initValue = initValues[i],
+            });
+        }
+
+        c->declarations[index] = range;
+        return StmtRef{StmtRef::STMT_DECLARATION, index};
+    }
+
+    case Node::NODE_IF_BLOCK:{
+        return StmtRef{StmtRef::STMT_IF, buildIf((IfNode *)node)};
+    }
+
+    case Node::NODE_WHILE:{
+        WhileNode *w = (WhileNode *)node;
+
+        NodeIndex index = c->whiles.size();
+        c->whiles.push_back(CompactWhile{});
+
+        CompactWhile cw;
+        cw.condition = buildExpr(w->condition);
+        cw.block = buildBlock(w->block);
+
+        c->whiles[index] = cw;
+        return StmtRef{StmtRef::STMT_WHILE, index};
+    }
+
+    case Node::NODE_FOR:{
+        ForNode *f = (ForNode *)node;
+
+        NodeIndex index = c->fors.size();
+        c->fors.push_back(CompactFor{});
+
+        CompactFor cf;
+        cf.init = buildExpr(f->init);
+        cf.exitCondition = buildExpr(f->exitCondition);
+        cf.update = buildExpr(f->update);
+        cf.block = buildBlock(f->block);
+
+        c->fors[index] = cf;
+        return StmtRef{StmtRef::STMT_FOR, index};
+    }
+
+    case Node::NODE_STMT_BLOCK:{
+        return StmtRef{StmtRef::STMT_BLOCK, buildBlock((StatementBlock *)node)};
+    }
+
+    case Node::NODE_RETURN:{
+        ReturnNode *r = (ReturnNode *)node;
+
+        NodeIndex index = c->jumps.size();
+        c->jumps.push_back(CompactJump{});
+
+        CompactJump j;
+        j.token = r->returnToken.index;
+        j.value = buildExpr(r->returnVal);
+
+        c->jumps[index] = j;
+        return StmtRef{StmtRef::STMT_RETURN, index};
+    }
+
+    case Node::NODE_BREAK:{
+        c->jumps.push_back(CompactJump{(TokenIndex)((BreakNode *)node)->breakToken.index, NO_NODE});
+        return StmtRef{StmtRef::STMT_BREAK, (uint32_t)c->jumps.size() - 1};
+    }
+
+    case Node::NODE_CONTINUE:{
+        c->jumps.push_back(CompactJump{(TokenIndex)((ContinueNode *)node)->continueToken.index, NO_NODE});
+        return StmtRef{StmtRef::STMT_CONTINUE, (uint32_t)c->jumps.size() - 1};
+    }
+
+    default:
+        break;
+    }
+
+    assert(false && "Not a statement node.");
+    return StmtRef{};
+}
+
+
+/*
+    Add a block and its statements, the statements of the block are added as one run once they are all built.
+*/
+NodeIndex CompactBuilder :: buildBlock(StatementBlock *block){
+    if (!block){
+        return NO_NODE;
+    }
+
+    NodeIndex index = c->blocks.size();
+    c->blocks.push_back(CompactBlock{(uint32_t)block->subtag, {}});
+
+    std::vector<StmtRef> statements;
+    statements.reserve(block->statements.size());
+    for (Node *stmt : block->statements){
+        // error nodes are left out
+        if (stmt->tag != Node::NODE_ERROR){
+            statements.push_back(buildStatement(stmt));
+        }
+    }
+
+    c->blocks[index].statements = {(uint32_t)c->stmtLists.size(), (uint32_t)statements.size()};
+    c->stmtLists.insert(c->stmtLists.end(), statements.begin(), statements.end());
+    return index;
+}
+
+
+/*
+    Encode a parsed and checked AST.
+*/
+CompactAST compactAST(AST *ast, const Tokenizer *tokenizer){
+    assert(tokenizer->isPreLexed);
+
+    CompactAST c;
+    c.tokens = &tokenizer->tokens;
+
+    CompactBuilder builder;
+    builder.c = &c;
+
+    NodeIndex global = builder.buildBlock(&ast->global);
+    c.global = c.blocks[global].statements;
+
+    for (auto &entry : ast->functions.entries){
+        Function &foo = entry.second.info;
+
+        IndexRange params = {(uint32_t)c.parameters.size(), (uint32_t)foo.parameters.size()};
+        for (auto &param : foo.parameters){
+            c.parameters.push_back(CompactVariable{builder.typeOf(param.type), (TokenIndex)param.identifier.index, NO_NODE});
+        }
+
+        NodeIndex index = c.functions.size();
+        c.functions.push_back(CompactFunction{
+            .returnType = builder.typeOf(foo.returnType),
+            .funcName = (TokenIndex)foo.funcName.index,
+            .parameters = params,
+            .isVariadic = foo.isVariadic,
+            .block = NO_NODE,
+        });
+        c.functions[index].block = builder.buildBlock(foo.block);
+    }
+
+    return c;
+}
+
+
+size_t CompactAST :: footprint() const{
+    return exprs.size() * sizeof(CompactExpr)
+         + declarations.size() * sizeof(IndexRange)
+         + variables.size() * sizeof(CompactVariable)
+         + blocks.size() * sizeof(CompactBlock)
+         + ifs.size() * sizeof(CompactIf)
+         + whiles.size() * sizeof(CompactWhile)
+         + fors.size() * sizeof(CompactFor)
+         + jumps.size() * sizeof(CompactJump)
+         + functions.size() * sizeof(CompactFunction)
+         + parameters.size() * sizeof(CompactVariable)
+         + exprLists.size() * sizeof(NodeIndex)
+         + stmtLists.size() * sizeof(StmtRef);
+}
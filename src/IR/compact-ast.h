@@ -0,0 +1,160 @@
+#pragma once
+
+#include "ir.h"
+#include <tokenizer/tokenizer.h>
+
+#include <vector>
+
+
+/*
+    Compact encoding of the AST, built from the pointer AST once it has been parsed and checked.
+
+    Nodes live in one pool per kind and refer to each other by 32-bit indices into the pools, tokens are 32-bit indices
+    into the token buffer of the pre-lexed tokenizer, and types are ids in the type table. The children of a node
+    (statements of a block, arguments of a call, variables of a declaration...) are contiguous ranges of a list pool,
+    and the nodes of a function are laid out in the order they are walked, so a walk over the tree reads the pools
+    mostly front to back.
+
+    The symbol tables of the blocks are not part of the encoding, names are resolved through the pointer AST.
+*/
+
+typedef uint32_t NodeIndex;
+typedef uint32_t TokenIndex;
+
+static const NodeIndex NO_NODE = UINT32_MAX;
+
+
+// a run of children in one of the list pools
+struct IndexRange{
+    uint32_t start;
+    uint32_t count;
+};
+
+
+// reference to a statement: the pool it lives in, and its index in the pool
+struct StmtRef{
+    enum Kind{
+        STMT_EXPR,
+        STMT_DECLARATION,
+        STMT_IF,
+        STMT_WHILE,
+        STMT_FOR,
+        STMT_BLOCK,
+        STMT_RETURN,
+        STMT_BREAK,
+        STMT_CONTINUE,
+    };
+    uint32_t kind : 4;
+    uint32_t index : 28;
+};
+
+
+struct CompactExpr{
+    // Subexpr::SubTag
+    uint8_t subtag;
+    // token type of the operator of unary and binary expressions, postfix operators have their own token types
+    uint16_t op;
+    // leaf, operator or called function
+    TokenIndex token;
+    // binary: left and right, parenthesis/unary/cast: lhs is the operand, and rhs the type cast to
+    // function call/initializer list: start and count of the arguments in exprLists
+    uint32_t lhs;
+    uint32_t rhs;
+    // type found by the checker
+    TypeId type;
+};
+
+
+struct CompactVariable{
+    TypeId type;
+    TokenIndex identifier;
+    // NO_NODE without an initializer
+    NodeIndex initValue;
+};
+
+
+struct CompactBlock{
+    // StatementBlock::BlockType
+    uint32_t subtag;
+    // range in stmtLists
+    IndexRange statements;
+};
+
+
+struct CompactIf{
+    // NO_NODE for an else block
+    NodeIndex condition;
+    NodeIndex block;
+    // the else if/else block that follows, NO_NODE for the last one
+    NodeIndex nextIf;
+};
+
+
+struct CompactWhile{
+    NodeIndex condition;
+    NodeIndex block;
+};
+
+
+struct CompactFor{
+    NodeIndex init;
+    NodeIndex exitCondition;
+    NodeIndex update;
+    NodeIndex block;
+};
+
+
+// return, break and continue
+struct CompactJump{
+    TokenIndex token;
+    // returned value, NO_NODE if there is none
+    NodeIndex value;
+};
+
+
+struct CompactFunction{
+    TypeId returnType;
+    TokenIndex funcName;
+    // range in parameters
+    IndexRange parameters;
+    bool isVariadic;
+    // NO_NODE for a declaration only
+    NodeIndex block;
+};
+
+
+struct CompactAST{
+    // the tokens the token indices refer to
+    const TokenBuffer *tokens;
+
+    std::vector<CompactExpr> exprs;
+    // the variables of each declaration, a range in variables
+    std::vector<IndexRange> declarations;
+    std::vector<CompactVariable> variables;
+    std::vector<CompactBlock> blocks;
+    std::vector<CompactIf> ifs;
+    std::vector<CompactWhile> whiles;
+    std::vector<CompactFor> fors;
+    std::vector<CompactJump> jumps;
+    std::vector<CompactFunction> functions;
+    std::vector<CompactVariable> parameters;
+
+    // children lists
+    std::vector<NodeIndex> exprLists;
+    std::vector<StmtRef> stmtLists;
+
+    // statements of the global scope, a range in stmtLists
+    IndexRange global;
+
+    // text of a token
+    Splice text(TokenIndex token) const{
+        return Splice{tokens->starts[token], tokens->lengths[token], tokens->atoms[token]};
+    }
+
+    // bytes taken by the nodes and lists
+    size_t footprint() const;
+};
+
+
+// the tokenizer must be pre-lexed (see Tokenizer::preLex), so that every token index has its token in the buffer
+CompactAST compactAST(AST *ast, const Tokenizer *tokenizer);
@@ -0,0 +1,324 @@
+#include "dataflow.h"
+#include <map>
+#include <tuple>
+
+
+DataflowResult solveGenKill(SSA_Function *f, const DataflowProblem &problem, const std::vector<BitVector> &gen, const std::vector<BitVector> &kill){
+    return solveDataflow(f, problem, [&](SSA_BlockId b, const BitVector &input, BitVector &output){
+        const uint64_t *g = gen[b].words.data();
+        const uint64_t *k = kill[b].words.data();
+        const uint64_t *in = input.words.data();
+        uint64_t *out = output.words.data();
+
+        uint64_t changed = 0;
+        for (size_t i = 0; i < output.words.size(); i++){
+            uint64_t w = g[i] | (in[i] & ~k[i]);
+            changed |= w ^ out[i];
+            out[i] = w;
+        }
+        return changed != 0;
+    });
+}
+
+
+
+DataflowResult computeLiveness(SSA_Function *f){
+    size_t nBlocks = f->blocks.size();
+    size_t nValues = f->nValues();
+
+    // gen: the values used in a block before being defined in it, kill: the values defined in it
+    std::vector<BitVector> gen(nBlocks), kill(nBlocks);
+    // the values flowing from each block into the phis of its successors
+    std::vector<BitVector> phiUses(nBlocks);
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        gen[b].init(nValues);
+        kill[b].init(nValues);
+        phiUses[b].init(nValues);
+    }
+
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        SSA_Block &block = f->blocks[b];
+        for (SSA_Instruction &ins : block.instructions){
+            if (ins.op == SSA_Instruction::SSA_PHI){
+                for (uint32_t i = 0; i < ins.nArgs; i++){
+                    phiUses[block.predecessors[i]].set(f->args[ins.firstArg + i]);
+                }
+                kill[b].set(ins.dest);
+                continue;
+            }
+
+            f->forEachOperand(ins, [&](SSA_Value &v){
+                if (!kill[b].test(v)){
+                    gen[b].set(v);
+                }
+            });
+            if (ins.dest != SSA_NO_VALUE){
+                kill[b].set(ins.dest);
+            }
+        }
+    }
+
+    // the phi operands are used after the whole block
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        BitVector exposed = phiUses[b];
+        exposed.subtract(kill[b]);
+        gen[b].unionWith(exposed);
+    }
+
+    DataflowProblem problem = {DataflowProblem::BACKWARD, DataflowProblem::UNION, nValues, {}};
+    problem.boundary.init(nValues);
+
+    DataflowResult result = solveGenKill(f, problem, gen, kill);
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        result.out[b].unionWith(phiUses[b]);
+    }
+    return result;
+}
+
+
+
+/*
+    The stack slot and offset each value addresses, for the slot addresses and the constant offsets from them.
+    The slot is -1 for the other values.
+*/
+static std::vector<std::pair<int64_t, int64_t>> findSlotAddresses(SSA_Function *f){
+    std::vector<std::pair<int64_t, int64_t>> slotOf(f->nValues(), {-1, 0});
+    std::vector<int64_t> constantOf(f->nValues(), 0);
+    std::vector<bool> isConstant(f->nValues(), false);
+
+    // the blocks are in reverse postorder, so the definitions of the operands (other than phis) are met before their uses
+    for (SSA_Block &block : f->blocks){
+        for (SSA_Instruction &ins : block.instructions){
+            switch (ins.op){
+            case SSA_Instruction::SSA_SLOT_ADDRESS:
+                slotOf[ins.dest] = {ins.imm, 0};
+                break;
+            case SSA_Instruction::SSA_CONST:
+                isConstant[ins.dest] = true;
+                constantOf[ins.dest] = ins.imm;
+                break;
+            case SSA_Instruction::SSA_BINARY:
+                if (ins.binary == MIR_Expr::BinaryOp::EXPR_IADD && slotOf[ins.a].first >= 0 && isConstant[ins.b]){
+                    slotOf[ins.dest] = {slotOf[ins.a].first, slotOf[ins.a].second + constantOf[ins.b]};
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return slotOf;
+}
+
+
+ReachingDefinitions computeReachingDefinitions(SSA_Function *f){
+    size_t nBlocks = f->blocks.size();
+    std::vector<std::pair<int64_t, int64_t>> slotOf = findSlotAddresses(f);
+
+    ReachingDefinitions rd;
+    // the definitions of each known location (slot, offset, size), and the location of each definition, or -1
+    std::map<std::tuple<int64_t, int64_t, size_t>, uint32_t> locations;
+    std::vector<std::vector<uint32_t>> definitionsOf;
+    std::vector<int64_t> locationOf;
+
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        ArenaVector<SSA_Instruction> &instructions = f->blocks[b].instructions;
+        for (uint32_t i = 0; i < instructions.size(); i++){
+            SSA_Instruction &ins = instructions[i];
+            ReachingDefinitions::Definition d = {.block = b, .index = i, .slot = -1, .offset = 0, .size = 0};
+
+            if (ins.op == SSA_Instruction::SSA_STORE || ins.op == SSA_Instruction::SSA_COPY_MEMORY){
+                d.slot = slotOf[ins.a].first;
+                d.offset = slotOf[ins.a].second + (ins.op == SSA_Instruction::SSA_STORE? ins.imm : 0);
+                d.size = ins.size;
+            }
+            else if (ins.op != SSA_Instruction::SSA_CALL){
+                continue;
+            }
+
+            int64_t location = -1;
+            if (d.slot >= 0){
+                auto [found, isNew] = locations.insert({{d.slot, d.offset, d.size}, (uint32_t) definitionsOf.size()});
+                if (isNew){
+                    definitionsOf.emplace_back();
+                }
+                location = found->second;
+                definitionsOf[location].push_back(rd.definitions.size());
+            }
+            locationOf.push_back(location);
+            rd.definitions.push_back(d);
+        }
+    }
+
+    // gen: the definitions not overwritten later in their block, kill: the definitions of the locations written by the block
+    size_t nDefinitions = rd.definitions.size();
+    std::vector<BitVector> gen(nBlocks), kill(nBlocks);
+    std::vector<int64_t> lastDefinition(definitionsOf.size(), -1);
+    size_t d = 0;
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        gen[b].init(nDefinitions);
+        kill[b].init(nDefinitions);
+
+        for (; d < nDefinitions && rd.definitions[d].block == b; d++){
+            int64_t location = locationOf[d];
+            if (location >= 0){
+                if (lastDefinition[location] >= 0){
+                    gen[b].reset(lastDefinition[location]);
+                }
+                else {
+                    for (uint32_t other : definitionsOf[location]){
+                        kill[b].set(other);
+                    }
+                }
+                lastDefinition[location] = d;
+            }
+            gen[b].set(d);
+        }
+
+        // only the locations written by this block are set
+        for (size_t i = d; i-- > 0 && rd.definitions[i].block == b;){
+            if (locationOf[i] >= 0){
+                lastDefinition[locationOf[i]] = -1;
+            }
+        }
+    }
+
+    DataflowProblem problem = {DataflowProblem::FORWARD, DataflowProblem::UNION, nDefinitions, {}};
+    problem.boundary.init(nDefinitions);
+    rd.result = solveGenKill(f, problem, gen, kill);
+    return rd;
+}
+
+
+
+AvailableExpressions computeAvailableExpressions(SSA_Function *f){
+    size_t nBlocks = f->blocks.size();
+    size_t nValues = f->nValues();
+    std::vector<std::pair<int64_t, int64_t>> slotOf = findSlotAddresses(f);
+
+    // the operands are compared by canonical value: the first value of each address in a slot and of each integer constant
+    std::vector<SSA_Value> canonical(nValues);
+    std::map<std::pair<int64_t, int64_t>, SSA_Value> slotValues;
+    std::map<std::tuple<int64_t, int, size_t>, SSA_Value> constantValues;
+    for (SSA_Value v = 0; v < nValues; v++){
+        canonical[v] = v;
+    }
+    for (SSA_Block &block : f->blocks){
+        for (SSA_Instruction &ins : block.instructions){
+            if (ins.dest != SSA_NO_VALUE && slotOf[ins.dest].first >= 0){
+                canonical[ins.dest] = slotValues.insert({slotOf[ins.dest], ins.dest}).first->second;
+            }
+            else if (ins.op == SSA_Instruction::SSA_CONST){
+                canonical[ins.dest] = constantValues.insert({{ins.imm, ins.type.tag, ins.type.size}, ins.dest}).first->second;
+            }
+        }
+    }
+
+    // number the expressions, and find the loads of each slot and the loads through computed addresses
+    typedef std::tuple<int, int, int, size_t, int, size_t, SSA_Value, SSA_Value, int64_t, size_t> ExpressionKey;
+    std::map<ExpressionKey, uint32_t> expressions;
+
+    AvailableExpressions ae;
+    ae.expressionOf.assign(nValues, AvailableExpressions::NO_EXPRESSION);
+    std::vector<bool> isLoad;
+    std::map<int64_t, std::vector<uint32_t>> slotLoads;
+    std::vector<uint32_t> unknownLoads;
+
+    for (SSA_Block &block : f->blocks){
+        for (SSA_Instruction &ins : block.instructions){
+            int subop = 0;
+            switch (ins.op){
+            case SSA_Instruction::SSA_BINARY:
+                subop = (int) ins.binary;
+                break;
+            case SSA_Instruction::SSA_UNARY:
+                subop = (int) ins.unary;
+                break;
+            case SSA_Instruction::SSA_CAST:
+            case SSA_Instruction::SSA_LOAD:
+                break;
+            default:
+                continue;
+            }
+
+            bool isBinary = ins.op == SSA_Instruction::SSA_BINARY;
+            ExpressionKey key = {ins.op, subop, ins.type.tag, ins.type.size, ins.from.tag, ins.from.size,
+                                 canonical[ins.a], isBinary? canonical[ins.b] : SSA_NO_VALUE, ins.imm, ins.size};
+            auto [found, isNew] = expressions.insert({key, (uint32_t) expressions.size()});
+            uint32_t e = found->second;
+            ae.expressionOf[ins.dest] = e;
+
+            if (isNew){
+                isLoad.push_back(ins.op == SSA_Instruction::SSA_LOAD);
+                if (ins.op == SSA_Instruction::SSA_LOAD){
+                    if (slotOf[ins.a].first >= 0){
+                        slotLoads[slotOf[ins.a].first].push_back(e);
+                    }
+                    else {
+                        unknownLoads.push_back(e);
+                    }
+                }
+            }
+        }
+    }
+
+    size_t nExpressions = expressions.size();
+    ae.nExpressions = nExpressions;
+    BitVector allLoads, unknownLoadSet;
+    allLoads.init(nExpressions);
+    unknownLoadSet.init(nExpressions);
+    for (uint32_t e = 0; e < nExpressions; e++){
+        if (isLoad[e]){
+            allLoads.set(e);
+        }
+    }
+    for (uint32_t e : unknownLoads){
+        unknownLoadSet.set(e);
+    }
+
+    // gen: the expressions computed in a block and not killed after, kill: the loads killed by the writes of the block
+    std::vector<BitVector> gen(nBlocks), kill(nBlocks);
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        gen[b].init(nExpressions);
+        kill[b].init(nExpressions);
+
+        for (SSA_Instruction &ins : f->blocks[b].instructions){
+            int64_t slot = -1;
+            switch (ins.op){
+            case SSA_Instruction::SSA_STORE:
+            case SSA_Instruction::SSA_COPY_MEMORY:
+                slot = slotOf[ins.a].first;
+                break;
+            case SSA_Instruction::SSA_CALL:
+                break;
+            default:
+                if (ins.dest != SSA_NO_VALUE && ae.expressionOf[ins.dest] != AvailableExpressions::NO_EXPRESSION){
+                    gen[b].set(ae.expressionOf[ins.dest]);
+                }
+                continue;
+            }
+
+            // a write to a slot only aliases the loads of that slot and the loads through computed addresses
+            if (slot >= 0){
+                gen[b].subtract(unknownLoadSet);
+                kill[b].unionWith(unknownLoadSet);
+                auto found = slotLoads.find(slot);
+                if (found != slotLoads.end()){
+                    for (uint32_t e : found->second){
+                        gen[b].reset(e);
+                        kill[b].set(e);
+                    }
+                }
+            }
+            else {
+                gen[b].subtract(allLoads);
+                kill[b].unionWith(allLoads);
+            }
+        }
+    }
+
+    DataflowProblem problem = {DataflowProblem::FORWARD, DataflowProblem::INTERSECTION, nExpressions, {}};
+    problem.boundary.init(nExpressions);
+    ae.result = solveGenKill(f, problem, gen, kill);
+    return ae;
+}
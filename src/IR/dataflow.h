@@ -0,0 +1,278 @@
+#pragma once
+
+#include "ssa.h"
+#include <vector>
+#include <deque>
+
+
+/*
+    Dense set of bits, stored 64 to a word. The set operations go a word at a time,
+    the bits past nBits in the last word are always zero.
+*/
+struct BitVector{
+    std::vector<uint64_t> words;
+    size_t nBits = 0;
+
+    void init(size_t nBits, bool value = false){
+        this->nBits = nBits;
+        this->words.assign((nBits + 63) / 64, value? ~0ull : 0);
+        this->clearPadding();
+    }
+
+    bool test(size_t i) const{
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+    void set(size_t i){
+        words[i / 64] |= 1ull << (i % 64);
+    }
+    void reset(size_t i){
+        words[i / 64] &= ~(1ull << (i % 64));
+    }
+
+    void setAll(){
+        for (uint64_t &w : words){
+            w = ~0ull;
+        }
+        this->clearPadding();
+    }
+    void clear(){
+        for (uint64_t &w : words){
+            w = 0;
+        }
+    }
+
+    // this |= other, returns whether a bit changed
+    bool unionWith(const BitVector &other){
+        uint64_t changed = 0;
+        for (size_t i = 0; i < words.size(); i++){
+            uint64_t w = words[i] | other.words[i];
+            changed |= w ^ words[i];
+            words[i] = w;
+        }
+        return changed != 0;
+    }
+
+    // this &= other, returns whether a bit changed
+    bool intersectWith(const BitVector &other){
+        uint64_t changed = 0;
+        for (size_t i = 0; i < words.size(); i++){
+            uint64_t w = words[i] & other.words[i];
+            changed |= w ^ words[i];
+            words[i] = w;
+        }
+        return changed != 0;
+    }
+
+    // this &= ~other
+    void subtract(const BitVector &other){
+        for (size_t i = 0; i < words.size(); i++){
+            words[i] &= ~other.words[i];
+        }
+    }
+
+    size_t count() const{
+        size_t n = 0;
+        for (uint64_t w : words){
+            n += __builtin_popcountll(w);
+        }
+        return n;
+    }
+
+    bool operator==(const BitVector &other) const{
+        return words == other.words;
+    }
+
+    /*
+        Call visit(size_t) on each set bit, in increasing order.
+    */
+    template <typename Visit>
+    void forEach(Visit visit) const{
+        for (size_t i = 0; i < words.size(); i++){
+            for (uint64_t w = words[i]; w; w &= w - 1){
+                visit(i * 64 + __builtin_ctzll(w));
+            }
+        }
+    }
+
+private:
+    void clearPadding(){
+        if (nBits % 64){
+            words.back() &= (1ull << (nBits % 64)) - 1;
+        }
+    }
+};
+
+
+
+/*
+    A dataflow problem over the blocks of a function in SSA form, on a lattice of sets of nBits facts.
+
+    A forward problem flows from the entry along the edges, the input of a block being the meet of the outputs of
+    its predecessors; a backward problem flows from the returns against the edges, the input of a block being the
+    meet of the outputs of its successors. The meet is the union (a fact holds if it holds on some path, starting
+    from no facts) or the intersection (a fact holds if it holds on all paths, starting from all facts). The input
+    of the entry block (forward) or of the returning blocks (backward) is the boundary.
+*/
+struct DataflowProblem{
+    enum Direction{
+        FORWARD,
+        BACKWARD,
+    }direction;
+
+    enum Meet{
+        UNION,
+        INTERSECTION,
+    }meet;
+
+    size_t nBits;
+    BitVector boundary;
+};
+
+
+/*
+    The solution of a dataflow problem: the facts at the start (in) and at the end (out) of each block,
+    in program order whatever the direction of the problem.
+*/
+struct DataflowResult{
+    std::vector<BitVector> in;
+    std::vector<BitVector> out;
+    // number of times a transfer function was applied
+    size_t visits = 0;
+};
+
+
+/*
+    Solve a dataflow problem to its maximal fixed point with a worklist of blocks, seeded in reverse postorder
+    (forward) or postorder (backward) so that most blocks see their inputs final on the first visit.
+    transfer(SSA_BlockId b, const BitVector &input, BitVector &output) computes the output of a block from its input
+    and returns whether the output changed; the blocks using that output are then queued again.
+*/
+template <typename Transfer>
+DataflowResult solveDataflow(SSA_Function *f, const DataflowProblem &problem, Transfer transfer){
+    size_t nBlocks = f->blocks.size();
+    bool isForward = problem.direction == DataflowProblem::FORWARD;
+
+    DataflowResult result;
+    result.in.resize(nBlocks);
+    result.out.resize(nBlocks);
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        result.in[b].init(problem.nBits, problem.meet == DataflowProblem::INTERSECTION);
+        result.out[b].init(problem.nBits, problem.meet == DataflowProblem::INTERSECTION);
+    }
+    std::vector<BitVector> &inputs = isForward? result.in : result.out;
+    std::vector<BitVector> &outputs = isForward? result.out : result.in;
+
+    // the blocks the input of each block is met from, and the blocks its output flows to
+    std::vector<std::vector<SSA_BlockId>> sources(nBlocks);
+    std::vector<std::vector<SSA_BlockId>> users(nBlocks);
+    for (SSA_BlockId b = 0; b < nBlocks; b++){
+        SSA_Instruction &t = f->blocks[b].terminator();
+        for (int i = 0; i < t.nSuccessors(); i++){
+            SSA_BlockId from = isForward? b : t.target[i];
+            SSA_BlockId to = isForward? t.target[i] : b;
+            sources[to].push_back(from);
+            users[from].push_back(to);
+        }
+    }
+
+    // the blocks are numbered in reverse postorder
+    std::deque<SSA_BlockId> worklist;
+    std::vector<bool> isQueued(nBlocks, true);
+    for (SSA_BlockId i = 0; i < nBlocks; i++){
+        worklist.push_back(isForward? i : nBlocks - 1 - i);
+    }
+
+    while (!worklist.empty()){
+        SSA_BlockId b = worklist.front();
+        worklist.pop_front();
+        isQueued[b] = false;
+
+        // meet of the outputs flowing into the block
+        BitVector &input = inputs[b];
+        bool isBoundary = isForward? b == 0 : sources[b].empty();
+        if (isBoundary){
+            input = problem.boundary;
+        }
+        else {
+            input = outputs[sources[b][0]];
+            for (size_t i = 1; i < sources[b].size(); i++){
+                if (problem.meet == DataflowProblem::UNION){
+                    input.unionWith(outputs[sources[b][i]]);
+                }
+                else {
+                    input.intersectWith(outputs[sources[b][i]]);
+                }
+            }
+        }
+
+        result.visits++;
+        if (!transfer(b, input, outputs[b])){
+            continue;
+        }
+        for (SSA_BlockId user : users[b]){
+            if (!isQueued[user]){
+                isQueued[user] = true;
+                worklist.push_back(user);
+            }
+        }
+    }
+    return result;
+}
+
+
+/*
+    Solve a problem whose transfer functions are output = gen | (input & ~kill), gen and kill by block.
+*/
+DataflowResult solveGenKill(SSA_Function *f, const DataflowProblem &problem, const std::vector<BitVector> &gen, const std::vector<BitVector> &kill);
+
+
+
+/*
+    Liveness of the values of a function (backward, union): a value is live at a point if a path from it reaches a use.
+    The values of the phis of a block are defined at its start, so are not live into it, and the values flowing
+    into them are used at the end of the predecessors they come from, so are live out of them.
+    Facts are value numbers.
+*/
+DataflowResult computeLiveness(SSA_Function *f);
+
+
+/*
+    Reaching definitions of memory (forward, union): the instructions writing memory (stores, memory copies and calls)
+    whose writes may be the last on some path to a point. The promoted variables need none, each of their values
+    having a single definition. A store or copy to a whole known location of a stack slot (the slot, offset and size)
+    kills the earlier definitions of that location; writes through computed addresses and calls kill nothing.
+    Facts are indexes in definitions.
+*/
+struct ReachingDefinitions{
+    struct Definition{
+        SSA_BlockId block;
+        uint32_t index;
+        // the stack slot written, -1 for writes through computed addresses and calls
+        int64_t slot;
+        int64_t offset;
+        size_t size;
+    };
+    std::vector<Definition> definitions;
+    DataflowResult result;
+};
+
+ReachingDefinitions computeReachingDefinitions(SSA_Function *f);
+
+
+/*
+    Available expressions (forward, intersection): the computations (binary, unary, casts and loads) done on every
+    path to a point with the same operands. The addresses in stack slots and the integer constants are compared
+    by what they are, not by value number. Loads are killed by the writes to memory that may alias them: a store or copy
+    to a slot kills the loads of that slot and the loads through computed addresses, and the other writes and
+    calls kill all loads.
+    Facts are expression numbers, expressionOf gives the expression computed by each value, or NO_EXPRESSION.
+*/
+struct AvailableExpressions{
+    static const uint32_t NO_EXPRESSION = UINT32_MAX;
+
+    std::vector<uint32_t> expressionOf;
+    size_t nExpressions;
+    DataflowResult result;
+};
+
+AvailableExpressions computeAvailableExpressions(SSA_Function *f);
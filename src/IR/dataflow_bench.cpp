@@ -0,0 +1,246 @@
+#include "dataflow.h"
+#include <parser/parser.h>
+
+#include <chrono>
+#include <string>
+#include <fstream>
+
+
+/*
+    Dataflow benchmark: time to solve liveness, reaching definitions and available expressions (see dataflow.h)
+    on functions in SSA form, by default synthetic functions with thousands of locals.
+    Usage: dataflow_bench.exe [c file to analyse]
+    The liveness is checked against a solver going over the blocks in rounds, with a byte per value.
+*/
+
+
+static const int N_RUNS = 5;
+
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/*
+    Generate a function of nLocals long locals, each used by a few statements mixing arithmetic, control flow,
+    calls, and locals left in memory (an array, and one local out of 6 whose address is taken).
+*/
+static std::string generateFunction(const std::string &name, int nLocals){
+    std::string src = "long " + name + "(long a, long b){\n    long arr[16];\n    long *p;\n";
+    for (int i=0; i<nLocals; i++){
+        src += "    long v" + std::to_string(i) + " = a + " + std::to_string(i) + ";\n";
+    }
+
+    auto v = [](int i){ return "v" + std::to_string(i); };
+    for (int i=0; i<nLocals; i++){
+        std::string x = v(i), y = v((i * 7 + 3) % nLocals), z = v((i * 13 + 5) % nLocals);
+        switch (i % 6){
+        case 0:
+            src += "    " + x + " = " + y + " + " + z + " * 3;\n";
+            break;
+        case 1:
+            src += "    if (" + x + " < " + y + "){ " + z + " = " + z + " - 1; } else { " + y + " = " + x + " ^ " + z + "; }\n";
+            break;
+        case 2:
+            src += "    while (" + x + " > " + y + "){ " + x + " = " + x + " - (" + y + " + " + z + "); }\n";
+            break;
+        case 3:
+            src += "    arr[" + x + " & 15] = " + y + " + arr[" + z + " & 15];\n";
+            break;
+        case 4:
+            src += "    " + x + " = helper(" + y + ", " + z + ") + (" + y + " + " + z + " * 3);\n";
+            break;
+        case 5:
+            src += "    p = &" + x + ";\n    *p = *p + " + y + ";\n";
+            break;
+        }
+    }
+
+    src += "    return ";
+    for (int i=0; i<nLocals; i += nLocals / 8){
+        src += v(i) + " + ";
+    }
+    src += "arr[0];\n}\n\n";
+    return src;
+}
+
+static std::string generateProgram(){
+    std::string src = "long helper(long u, long v){ return u * v; }\n";
+    for (int nLocals : {250, 1000, 4000}){
+        src += generateFunction("locals" + std::to_string(nLocals), nLocals);
+    }
+    return src;
+}
+
+
+
+/*
+    Liveness solved over the blocks in rounds until nothing changes, with a byte per value.
+*/
+static std::vector<std::vector<char>> referenceLiveIn(SSA_Function *f){
+    size_t nBlocks = f->blocks.size();
+    std::vector<std::vector<char>> liveIn(nBlocks, std::vector<char>(f->nValues(), 0));
+
+    bool changed = true;
+    while (changed){
+        changed = false;
+        for (size_t b = nBlocks; b-- > 0;){
+            SSA_Block &block = f->blocks[b];
+            std::vector<char> live(f->nValues(), 0);
+
+            SSA_Instruction &t = block.terminator();
+            for (int i = 0; i < t.nSuccessors(); i++){
+                SSA_Block &successor = f->blocks[t.target[i]];
+                for (size_t v = 0; v < live.size(); v++){
+                    live[v] |= liveIn[t.target[i]][v];
+                }
+                // the phis of the successor use the value coming from this block
+                size_t predecessorNo = 0;
+                while (successor.predecessors[predecessorNo] != b){
+                    predecessorNo++;
+                }
+                for (SSA_Instruction &phi : successor.instructions){
+                    if (phi.op == SSA_Instruction::SSA_PHI){
+                        live[f->args[phi.firstArg + predecessorNo]] = 1;
+                    }
+                }
+            }
+
+            for (size_t i = block.instructions.size(); i-- > 0;){
+                SSA_Instruction &ins = block.instructions[i];
+                if (ins.dest != SSA_NO_VALUE){
+                    live[ins.dest] = 0;
+                }
+                if (ins.op != SSA_Instruction::SSA_PHI){
+                    f->forEachOperand(ins, [&](SSA_Value &v){ live[v] = 1; });
+                }
+            }
+
+            if (live != liveIn[b]){
+                liveIn[b] = live;
+                changed = true;
+            }
+        }
+    }
+    return liveIn;
+}
+
+
+template <typename F>
+static double best(F f){
+    double best = 1e30;
+    for (int i=0; i<N_RUNS; i++){
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double elapsed = secondsSince(start);
+        best = (elapsed < best)? elapsed : best;
+    }
+    return best;
+}
+
+
+static bool benchFunction(MIR *mir, MIR_Function *foo, Arena *arena){
+    SSA_Function *f = lowerToSSA(mir, foo, arena);
+    if (!f){
+        return true;
+    }
+    if (!verifySSA(f)){
+        fprintf(stderr, "The SSA form of %.*s is malformed.\n", (int) foo->funcName.len, foo->funcName.data);
+        return false;
+    }
+
+    size_t nInstructions = 0;
+    for (SSA_Block &block : f->blocks){
+        nInstructions += block.instructions.size();
+    }
+    fprintf(stderr, "[Function] %.*s: %zu locals, %zu blocks, %zu instructions, %zu values\n", (int) foo->funcName.len, foo->funcName.data,
+            foo->symbols.entries.size(), f->blocks.size(), nInstructions, f->nValues());
+
+    DataflowResult liveness;
+    ReachingDefinitions rd;
+    AvailableExpressions ae;
+    double livenessTime = best([&]{ liveness = computeLiveness(f); });
+    double rdTime = best([&]{ rd = computeReachingDefinitions(f); });
+    double aeTime = best([&]{ ae = computeAvailableExpressions(f); });
+
+    fprintf(stderr, "    liveness               %8.3f ms, %6zu facts, %6zu block visits\n", livenessTime * 1e3, f->nValues(), liveness.visits);
+    fprintf(stderr, "    reaching definitions   %8.3f ms, %6zu facts, %6zu block visits\n", rdTime * 1e3, rd.definitions.size(), rd.result.visits);
+    fprintf(stderr, "    available expressions  %8.3f ms, %6zu facts, %6zu block visits\n", aeTime * 1e3, ae.nExpressions, ae.result.visits);
+
+    std::vector<std::vector<char>> reference;
+    double referenceTime = best([&]{ reference = referenceLiveIn(f); });
+    bool isSame = true;
+    for (size_t b = 0; b < f->blocks.size(); b++){
+        for (size_t v = 0; v < f->nValues(); v++){
+            isSame = isSame && (bool) reference[b][v] == liveness.in[b].test(v);
+        }
+    }
+    fprintf(stderr, "    round-robin liveness   %8.3f ms, %s\n", referenceTime * 1e3, isSame? "same" : "DIFFERENT");
+    return isSame;
+}
+
+
+static int benchSource(const char *name, const std::string &src){
+    Tokenizer t;
+    t.init();
+    t.loadStringToBuffer(src.data(), src.size(), name);
+    t.preLex();
+
+    // the arenas are given larger maps than the compiler's, as the functions are big
+    Arena a;
+    a.init(PAGE_SIZE * 128);
+    a.createFrame();
+
+    Parser p;
+    p.init(&t, &a);
+    AST *ast = p.parseProgram();
+    if (!ast){
+        fprintf(stderr, "Failed to parse %s.\n", name);
+        return EXIT_FAILURE;
+    }
+
+    Arena b;
+    b.init(PAGE_SIZE * 128);
+    b.createFrame();
+    MIR *mir = transform(ast, &b);
+    if (!mir){
+        fprintf(stderr, "Failed to transform %s.\n", name);
+        return EXIT_FAILURE;
+    }
+
+    bool isSame = true;
+    for (auto &entry : mir->functions.entries){
+        isSame = benchFunction(mir, &entry.second.info, &b) && isSame;
+    }
+
+    b.destroyFrame();
+    b.destroy();
+    p.destroy();
+    a.destroyFrame();
+    a.destroy();
+    t.destroy();
+    return isSame? 0 : EXIT_FAILURE;
+}
+
+
+int main(int argc, char **argv){
+    // the parser reports its error count on stdout
+#if defined(_WIN32)
+    freopen("NUL", "w", stdout);
+#else
+    freopen("/dev/null", "w", stdout);
+#endif
+
+    if (argc >= 2){
+        std::ifstream f(argv[1], std::ios::binary);
+        if (!f.is_open()){
+            fprintf(stderr, "Failed to open file: %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        std::string src((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        return benchSource(argv[1], src);
+    }
+
+    return benchSource("synthetic", generateProgram());
+}
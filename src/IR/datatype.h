@@ -4,7 +4,16 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <utils/utils.h>
+#include <arena/arena-allocator.h>
+#include <tokenizer/atoms.h>
 
+#include <atomic>
+#include <mutex>
+
+
+// id of an interned data type, see TypeTable
+typedef uint32_t TypeId;
+static const TypeId NO_TYPE = 0;
 
 
 struct DataType{
@@ -23,7 +32,7 @@ struct DataType{
     }tag;
 
     struct CompositeType{
-        std::vector<DataType> types;
+        ArenaVector<DataType> types;
     };
 
     union{
@@ -70,6 +79,9 @@ struct DataType{
         REGISTER = (0x1 << 10), 
     };
     int flags = 0;
+
+    // id of the type when it was interned, only trusted while the type still matches the interned one
+    TypeId id = NO_TYPE;
     
     int indirectionLevel(){
         int level = 0;
@@ -104,21 +116,315 @@ struct DataType{
 };
 
 namespace DataTypes{
-    inline DataType Char  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_CHAR, {"char", sizeof("char") - 1}, 0, 0}};
-    inline DataType Int  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, {"int", sizeof("int") - 1}, 0, 0}};
-    inline DataType Short  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, {"int", sizeof("int") - 1}, 0, 0}, .flags = DataType::Specifiers::SHORT};
-    inline DataType Long  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, {"int", sizeof("int") - 1}, 0, 0}, .flags = DataType::Specifiers::LONG};
-    inline DataType Long_Long  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, {"int", sizeof("int") - 1}, 0, 0}, .flags = DataType::Specifiers::LONG_LONG};
-    inline DataType Float  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_FLOAT, {"float", sizeof("float") - 1}, 0, 0}};
-    inline DataType Double = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_DOUBLE, {"double", sizeof("double") - 1}, 0, 0}};
+    inline DataType Char  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_CHAR, 0, {"char", sizeof("char") - 1}}};
+    inline DataType Int  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, 0, {"int", sizeof("int") - 1}}};
+    inline DataType Short  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, 0, {"int", sizeof("int") - 1}}, .flags = DataType::Specifiers::SHORT};
+    inline DataType Long  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, 0, {"int", sizeof("int") - 1}}, .flags = DataType::Specifiers::LONG};
+    inline DataType Long_Long  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_INT, 0, {"int", sizeof("int") - 1}}, .flags = DataType::Specifiers::LONG_LONG};
+    inline DataType Float  = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_FLOAT, 0, {"float", sizeof("float") - 1}}};
+    inline DataType Double = {.tag = DataType::TAG_PRIMARY, .type = {TOKEN_DOUBLE, 0, {"double", sizeof("double") - 1}}};
     inline DataType String = {.tag = DataType::TAG_ARRAY, .ptrTo = &Char};
-    inline DataType Void = {.tag = DataType::TAG_VOID, .type = {TOKEN_VOID, {"void", sizeof("void") - 1}, 0, 0}};
-    inline DataType Error = {.tag = DataType::TAG_ERROR, .type = {TOKEN_ERROR, {"error", sizeof("error") - 1}, 0, 0}};
+    inline DataType Void = {.tag = DataType::TAG_VOID, .type = {TOKEN_VOID, 0, {"void", sizeof("void") - 1}}};
+    inline DataType Error = {.tag = DataType::TAG_ERROR, .type = {TOKEN_ERROR, 0, {"error", sizeof("error") - 1}}};
     inline DataType Struct = {.tag = DataType::TAG_STRUCT};
     inline DataType Union = {.tag = DataType::TAG_UNION};
     inline DataType MemBlock = {.tag = DataType::TAG_COMPOSITE_UNSPECIFIED};
 };
 
+
+/*
+    Table of the distinct data types, giving each a small id.
+    The interned copy of a type is kept for the life of the program, and the ptrTo of an interned type points to
+    the interned copy of its pointee, so pointer, array and address types can share their pointee instead of
+    allocating a copy of it.
+
+    DataType keeps the id it was interned with. As types are freely copied and changed, the id is only used
+    when the key fields of the type still match the interned type (an O(1) check), else the type is interned again.
+
+    Each type also has the id of its unqualified form (qualifiers, storage class and array size dropped), 
+    so comparing two types is comparing two ids.
+
+    Types may be interned from several threads (see Parser::checkThreads): a type that is already interned is found
+    without locking, and only adding a type takes the lock.
+*/
+struct TypeTable{
+private:
+    static const size_t INITIAL_CAPACITY = 256;
+    // the types are kept in chunks that never move, so that interned types can be read while others are interned
+    static const size_t CHUNK_BITS = 10;
+    static const size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+    static const size_t MAX_CHUNKS = 4096;
+
+    struct TypeInfo{
+        // the interned copy of the type
+        DataType type;
+        TypeId unqualified;
+        // index of a primary type in the arithmetic conversion matrix, -1 for the other types
+        int primary;
+        // the type is, or is an array of, a struct or union, so its layout depends on the scope the name is resolved in
+        bool dependsOnScope;
+    };
+
+    // result of the usual arithmetic conversions for each pair of primary types, NO_TYPE until it is first needed.
+    // A full matrix is replaced by a larger copy, and stays readable for the threads still reading it.
+    struct ConversionMatrix{
+        size_t stride;
+        std::atomic<TypeId> *results;
+    };
+
+    // the table lives for the whole program, so it grows in an arena of its own
+    Arena arena;
+    bool isInitialized = false;
+
+    // interning is locked, reading the interned types and the conversions is not
+    std::mutex lock;
+
+    // types[0] is NO_TYPE, a type can be read once the count has been published past its id
+    TypeInfo **chunks[MAX_CHUNKS];
+    std::atomic<size_t> typeCount = 0;
+    ArenaVector<TypeId> slots;
+
+    std::atomic<ConversionMatrix *> conversions = NULL;
+    size_t primaryCount;
+
+
+    static bool isIndirect(const DataType &d){
+        return d.tag == DataType::TAG_PTR || d.tag == DataType::TAG_ADDRESS || d.tag == DataType::TAG_ARRAY;
+    }
+
+    // the name of a primary, struct or union type
+    static Atom nameOf(const DataType &d){
+        if (isIndirect(d) || d.tag == DataType::TAG_COMPOSITE_UNSPECIFIED || d.type.string.len == 0){
+            return NO_ATOM;
+        }
+        return atomOf(d.type.string);
+    }
+
+    // compares the fields that make up the identity of a type, both types must point to interned pointees
+    static bool isSameKey(const DataType &a, const DataType &b){
+        if (a.tag != b.tag || a.flags != b.flags){
+            return false;
+        }
+        if (isIndirect(a)){
+            return a.ptrTo == b.ptrTo && (a.tag != DataType::TAG_ARRAY || a.arrayCount == b.arrayCount);
+        }
+        if (a.tag == DataType::TAG_COMPOSITE_UNSPECIFIED){
+            return a.composite == b.composite;
+        }
+        return nameOf(a) == nameOf(b);
+    }
+
+    static uint64_t hashKey(const DataType &d){
+        uint64_t h = (uint64_t)d.tag << 32 | (uint32_t)d.flags;
+        if (isIndirect(d)){
+            h ^= (uint64_t)(d.ptrTo? d.ptrTo->id : NO_TYPE) * 0xFF51AFD7ED558CCDull;
+            if (d.tag == DataType::TAG_ARRAY){
+                h ^= d.arrayCount * 0xC4CEB9FE1A85EC53ull;
+            }
+        }
+        else if (d.tag == DataType::TAG_COMPOSITE_UNSPECIFIED){
+            h ^= (uint64_t)d.composite;
+        }
+        else {
+            h ^= (uint64_t)nameOf(d) * 0xFF51AFD7ED558CCDull;
+        }
+        return h * 0x9E3779B97F4A7C15ull;
+    }
+
+    TypeInfo *info(TypeId id){
+        return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+    }
+
+    // add a type, making it readable by the other threads
+    void publish(TypeInfo *type){
+        size_t id = typeCount.load(std::memory_order_relaxed);
+        assert((id >> CHUNK_BITS) < MAX_CHUNKS);
+        if ((id & (CHUNK_SIZE - 1)) == 0){
+            chunks[id >> CHUNK_BITS] = (TypeInfo **)arena.alloc(CHUNK_SIZE * sizeof(TypeInfo *));
+        }
+        chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)] = type;
+        typeCount.store(id + 1, std::memory_order_release);
+    }
+
+    size_t probe(const DataType &d){
+        size_t mask = slots.size() - 1;
+        size_t i = (hashKey(d) >> 32) & mask;
+        while (slots[i] != NO_TYPE && !isSameKey(info(slots[i])->type, d)){
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void grow(){
+        slots = ArenaVector<TypeId>(slots.size() * 2, NO_TYPE, &arena);
+        for (TypeId id = 1; id < typeCount; id++){
+            slots[probe(info(id)->type)] = id;
+        }
+    }
+
+    ConversionMatrix *newConversions(size_t stride){
+        ConversionMatrix *m = (ConversionMatrix *)arena.alloc(sizeof(ConversionMatrix));
+        m->stride = stride;
+        m->results = (std::atomic<TypeId> *)arena.alloc(stride * stride * sizeof(std::atomic<TypeId>));
+        for (size_t i = 0; i < stride * stride; i++){
+            new (&m->results[i]) std::atomic<TypeId>(NO_TYPE);
+        }
+        return m;
+    }
+
+    void growConversions(){
+        ConversionMatrix *old = conversions.load(std::memory_order_relaxed);
+        ConversionMatrix *grown = newConversions(old->stride * 2);
+        for (size_t i = 0; i < old->stride; i++){
+            for (size_t j = 0; j < old->stride; j++){
+                grown->results[i * grown->stride + j].store(old->results[i * old->stride + j].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+        conversions.store(grown, std::memory_order_release);
+    }
+
+    void init();
+
+    TypeId internLocked(const DataType &d){
+        if (!isInitialized){
+            init();
+        }
+
+        // the type is a copy of an interned type that has not been changed since
+        if (d.id != NO_TYPE && d.id < typeCount && isSameKey(info(d.id)->type, d)){
+            return d.id;
+        }
+
+        DataType key = d;
+        // a bare address has no pointee
+        if (isIndirect(d) && d.ptrTo){
+            key.ptrTo = &info(internLocked(*d.ptrTo))->type;
+        }
+        
+        size_t slot = probe(key);
+        if (slots[slot] != NO_TYPE){
+            return slots[slot];
+        }
+
+        // the unqualified form of the type, which may be a different type, is interned first, 
+        // so that the type is complete once it is published
+        DataType unqualified = key;
+        unqualified.flags &= (DataType::Specifiers::SHORT | DataType::Specifiers::UNSIGNED 
+                            | DataType::Specifiers::LONG | DataType::Specifiers::LONG_LONG);
+        if (isIndirect(key) && key.ptrTo){
+            unqualified.ptrTo = &info(info(key.ptrTo->id)->unqualified)->type;
+            unqualified.arrayCount = 0;
+        }
+        TypeId unqualifiedId = NO_TYPE;
+        if (!isSameKey(unqualified, key)){
+            unqualified.id = NO_TYPE;
+            unqualifiedId = internLocked(unqualified);
+        }
+
+        // keep the load under a half
+        if ((typeCount + 1) * 2 > slots.size()){
+            grow();
+        }
+        slot = probe(key);
+
+        TypeId id = typeCount;
+        key.id = id;
+
+        TypeInfo *type = (TypeInfo *)arena.alloc(sizeof(TypeInfo));
+        type->type = key;
+        type->unqualified = (unqualifiedId != NO_TYPE)? unqualifiedId : id;
+        type->primary = -1;
+        type->dependsOnScope = key.tag == DataType::TAG_STRUCT || key.tag == DataType::TAG_UNION
+                            || key.tag == DataType::TAG_COMPOSITE_UNSPECIFIED
+                            || (key.tag == DataType::TAG_ARRAY && key.ptrTo && info(key.ptrTo->id)->dependsOnScope);
+        
+        if (key.tag == DataType::TAG_PRIMARY){
+            type->primary = primaryCount++;
+            if (primaryCount > conversions.load(std::memory_order_relaxed)->stride){
+                growConversions();
+            }
+        }
+        
+        slots[slot] = id;
+        publish(type);
+        return id;
+    }
+
+public:
+    TypeId intern(const DataType &d){
+        // the type is a copy of an interned type that has not been changed since
+        if (d.id != NO_TYPE && d.id < typeCount.load(std::memory_order_acquire) && isSameKey(info(d.id)->type, d)){
+            return d.id;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        return internLocked(d);
+    }
+
+    // the interned copy of the type, for pointer types to point to
+    DataType *canonical(const DataType &d){
+        return &info(intern(d))->type;
+    }
+
+    const DataType &type(TypeId id){
+        return info(id)->type;
+    }
+
+    bool dependsOnScope(TypeId id){
+        return info(id)->dependsOnScope;
+    }
+
+    size_t count(){
+        return typeCount.load(std::memory_order_acquire);
+    }
+
+    // types are equal if they only differ in qualifiers, storage class or array size
+    bool isEqual(const DataType &a, const DataType &b){
+        TypeId idA = intern(a);
+        TypeId idB = intern(b);
+        return info(idA)->unqualified == info(idB)->unqualified;
+    }
+
+    // cached result of the usual arithmetic conversions between two primary types, NO_TYPE if it has not been set
+    TypeId getConversion(TypeId a, TypeId b){
+        assert(info(a)->primary >= 0 && info(b)->primary >= 0);
+        ConversionMatrix *m = conversions.load(std::memory_order_acquire);
+        return m->results[info(a)->primary * m->stride + info(b)->primary].load(std::memory_order_acquire);
+    }
+
+    void setConversion(TypeId a, TypeId b, TypeId result){
+        std::lock_guard<std::mutex> guard(lock);
+        ConversionMatrix *m = conversions.load(std::memory_order_relaxed);
+        m->results[info(a)->primary * m->stride + info(b)->primary].store(result, std::memory_order_release);
+    }
+};
+
+inline TypeTable typeTable;
+
+
+inline void TypeTable::init(){
+    this->isInitialized = true;
+    this->arena.init(PAGE_SIZE * 2);
+    this->arena.createFrame();
+
+    this->publish(NULL);
+    this->slots = ArenaVector<TypeId>(INITIAL_CAPACITY, NO_TYPE, &this->arena);
+    this->primaryCount = 0;
+    this->conversions.store(this->newConversions(16), std::memory_order_release);
+
+    // intern the builtin types up front, so their copies carry their ids
+    DataType *builtins[] = {
+        &DataTypes::Char, &DataTypes::Int, &DataTypes::Short, &DataTypes::Long, &DataTypes::Long_Long,
+        &DataTypes::Float, &DataTypes::Double, &DataTypes::Void, &DataTypes::Error,
+    };
+    for (DataType *d : builtins){
+        d->type.string = ::intern(d->type.string);
+        d->id = this->internLocked(*d);
+    }
+    DataTypes::String.ptrTo = &this->info(this->internLocked(DataTypes::Char))->type;
+    DataTypes::String.id = this->internLocked(DataTypes::String);
+}
+
 static void _recursePrintf(DataType d, char *scratchpad, int *sp){
     auto append = [&](const char *str){
         strncpy(&scratchpad[*sp], str, min(1024 - *sp, strlen(str)));
@@ -201,8 +507,9 @@ static void _recursePrintf(DataType d, char *scratchpad, int *sp){
 }
 
 static const char* dataTypePrintf(DataType d){
-    static char scratchpad[1024];
-    static int sp = 0;
+    // per thread, as function bodies may be checked on several threads
+    static thread_local char scratchpad[1024];
+    static thread_local int sp = 0;
 
     if (sp > 512){
         sp = 0;
@@ -219,29 +526,7 @@ static const char* dataTypePrintf(DataType d){
 
 
 static bool operator==(DataType a, DataType b){
-    if (a.indirectionLevel() != b.indirectionLevel()){
-        return false;
-    }
-    
-    int mask = (DataType::Specifiers::SHORT | DataType::Specifiers::UNSIGNED 
-              | DataType::Specifiers::LONG | DataType::Specifiers::LONG_LONG);
-    a.flags &= mask;
-    b.flags &= mask;
-
-
-    if (a.flags != b.flags){
-        return false;
-    }
-    if (a.tag != b.tag){
-        return false;
-    }
-
-    if (a.indirectionLevel() > 0 && b.indirectionLevel() > 0){
-        return *a.ptrTo == *b.ptrTo;
-    }
-    
-
-    return compare(a.type.string, b.type.string);
+    return typeTable.isEqual(a, b);
 }
 
 
@@ -268,6 +553,95 @@ static int getIntegerConversionRank(DataType d){
 };
 
 
+/*
+    Type of a binary operation between two different primary types, by the usual arithmetic conversions.
+*/
+static DataType usualArithmeticConversion(DataType left, DataType right){
+    // if any is double or float, convert to that
+    if (_match(left.type, TOKEN_DOUBLE) || _match(right.type, TOKEN_DOUBLE)){
+        return DataTypes::Double;
+    }   
+    else if (_match(left.type, TOKEN_FLOAT) || _match(right.type, TOKEN_FLOAT)){
+        return DataTypes::Float;
+    }   
+
+    // same signedness, conversion to greater conversion rank
+    else if ((left.isSet(DataType::Specifiers::SIGNED) && right.isSet(DataType::Specifiers::SIGNED))
+            || (left.isSet(DataType::Specifiers::UNSIGNED) && right.isSet(DataType::Specifiers::UNSIGNED))){
+        
+        if (getIntegerConversionRank(left) > getIntegerConversionRank(right)){
+            return left;
+        }
+        
+        return right;
+        
+    }   
+    
+    // different signedness
+    else {
+        // if unsigned has higher or equal rank, then unsigned
+        // else, if signed can accomodate full range of unsigned then convert to signed, 
+        // else convert to unsigned counterpart of the signed types
+        
+        auto signedUnsignedConversion = [&](DataType unsignedType, DataType signedType){
+            if (getIntegerConversionRank(unsignedType) >= getIntegerConversionRank(signedType)){
+                return unsignedType;
+            }
+            else if (signedType.isSet(DataType::Specifiers::LONG_LONG)){
+                return signedType;
+            }
+            else if (signedType.isSet(DataType::Specifiers::LONG)){
+                // signed long cannot accomodate unsigned int
+                if (!unsignedType.isSet(DataType::Specifiers::LONG)){
+                    return signedType;
+                }
+            }
+            else if (!signedType.isSet(DataType::Specifiers::SHORT)){
+                // signed int can accomodate unsigned short and char
+                if (unsignedType.isSet(DataType::Specifiers::SHORT) || _match(unsignedType.type, TOKEN_CHAR)){
+                    return signedType;
+                }
+            }
+            else if (signedType.isSet(DataType::Specifiers::SHORT)){
+                // signed short can accomodate unsigneds char
+                if (_match(unsignedType.type, TOKEN_CHAR)){
+                    return signedType;
+                }
+            }
+            // unsigned counterpart of the signed types
+            signedType.flags |= DataType::Specifiers::UNSIGNED;
+            signedType.flags ^= DataType::Specifiers::SIGNED;
+            return signedType;
+        };
+        
+        
+        if (left.isSet(DataType::Specifiers::UNSIGNED)){
+            return signedUnsignedConversion(left, right);
+        }
+        else {
+            return signedUnsignedConversion(right, left);
+        }
+    }
+}
+
+
+/*
+    The usual arithmetic conversions only depend on the two types, so they are worked out once for each pair of types
+    and then read from the conversion matrix of the type table.
+*/
+static DataType getArithmeticConversion(DataType left, DataType right){
+    TypeId leftId = typeTable.intern(left);
+    TypeId rightId = typeTable.intern(right);
+
+    TypeId result = typeTable.getConversion(leftId, rightId);
+    if (result == NO_TYPE){
+        result = typeTable.intern(usualArithmeticConversion(left, right));
+        typeTable.setConversion(leftId, rightId, result);
+    }
+    return typeTable.type(result);
+}
+
+
 static DataType getResultantType(DataType left, DataType right, Token op){
     
     // diff level of indirection
@@ -346,71 +720,7 @@ static DataType getResultantType(DataType left, DataType right, Token op){
                 return left;
             }
 
-            // if any is double or float, convert to that
-            if (_match(left.type, TOKEN_DOUBLE) || _match(right.type, TOKEN_DOUBLE)){
-                return DataTypes::Double;
-            }   
-            else if (_match(left.type, TOKEN_FLOAT) || _match(right.type, TOKEN_FLOAT)){
-                return DataTypes::Float;
-            }   
-
-            // same signedness, conversion to greater conversion rank
-            else if ((left.isSet(DataType::Specifiers::SIGNED) && right.isSet(DataType::Specifiers::SIGNED))
-                    || (left.isSet(DataType::Specifiers::UNSIGNED) && right.isSet(DataType::Specifiers::UNSIGNED))){
-                
-                if (getIntegerConversionRank(left) > getIntegerConversionRank(right)){
-                    return left;
-                }
-                
-                return right;
-                
-            }   
-            
-            // different signedness
-            else {
-                // if unsigned has higher or equal rank, then unsigned
-                // else, if signed can accomodate full range of unsigned then convert to signed, 
-                // else convert to unsigned counterpart of the signed types
-                
-                auto signedUnsignedConversion = [&](DataType unsignedType, DataType signedType){
-                    if (getIntegerConversionRank(unsignedType) >= getIntegerConversionRank(signedType)){
-                        return unsignedType;
-                    }
-                    else if (signedType.isSet(DataType::Specifiers::LONG_LONG)){
-                        return signedType;
-                    }
-                    else if (signedType.isSet(DataType::Specifiers::LONG)){
-                        // signed long cannot accomodate unsigned int
-                        if (!unsignedType.isSet(DataType::Specifiers::LONG)){
-                            return signedType;
-                        }
-                    }
-                    else if (!signedType.isSet(DataType::Specifiers::SHORT)){
-                        // signed int can accomodate unsigned short and char
-                        if (unsignedType.isSet(DataType::Specifiers::SHORT) || _match(unsignedType.type, TOKEN_CHAR)){
-                            return signedType;
-                        }
-                    }
-                    else if (signedType.isSet(DataType::Specifiers::SHORT)){
-                        // signed short can accomodate unsigneds char
-                        if (_match(unsignedType.type, TOKEN_CHAR)){
-                            return signedType;
-                        }
-                    }
-                    // unsigned counterpart of the signed types
-                    signedType.flags |= DataType::Specifiers::UNSIGNED;
-                    signedType.flags ^= DataType::Specifiers::SIGNED;
-                    return signedType;
-                };
-                
-                
-                if (left.isSet(DataType::Specifiers::UNSIGNED)){
-                    return signedUnsignedConversion(left, right);
-                }
-                else {
-                    return signedUnsignedConversion(right, left);
-                }
-            }
+            return getArithmeticConversion(left, right);
             
         
         }
@@ -0,0 +1,123 @@
+#include "passes.h"
+
+
+/*
+    Whether evaluating an expression does more than compute its value: stores and calls.
+*/
+static bool hasSideEffects(MIR_Expr *e){
+    if (!e){
+        return false;
+    }
+
+    switch (e->tag){
+    case MIR_Expr::EXPR_STORE:
+    case MIR_Expr::EXPR_CALL:
+        return true;
+    case MIR_Expr::EXPR_LOAD:
+        return hasSideEffects(e->load.base);
+    case MIR_Expr::EXPR_INDEX:
+        return hasSideEffects(e->index.base) || hasSideEffects(e->index.index);
+    case MIR_Expr::EXPR_LOAD_ADDRESS:
+        return hasSideEffects(e->loadAddress.base);
+    case MIR_Expr::EXPR_CAST:
+        return hasSideEffects(e->cast.expr);
+    case MIR_Expr::EXPR_BINARY:
+        return hasSideEffects(e->binary.left) || hasSideEffects(e->binary.right);
+    case MIR_Expr::EXPR_UNARY:
+        return hasSideEffects(e->unary.expr);
+    default:
+        return false;
+    }
+}
+
+
+/*
+    Remove the statements following a return, break or continue in the same scope.
+*/
+static bool removeUnreachable(MIR_Primitive *p){
+    if (!p){
+        return false;
+    }
+
+    bool changed = false;
+    switch (p->ptag){
+    case MIR_Primitive::PRIM_SCOPE:{
+        MIR_Scope *scope = (MIR_Scope*) p;
+        for (size_t i = 0; i < scope->statements.size(); i++){
+            MIR_Primitive *statement = scope->statements[i];
+            changed = removeUnreachable(statement) || changed;
+
+            bool isJump = statement->ptag == MIR_Primitive::PRIM_RETURN || statement->ptag == MIR_Primitive::PRIM_JUMP;
+            if (isJump && i + 1 < scope->statements.size()){
+                scope->statements.resize(i + 1);
+                changed = true;
+            }
+        }
+        break;
+    }
+    case MIR_Primitive::PRIM_IF:{
+        for (MIR_If *inode = (MIR_If*) p; inode; inode = inode->next){
+            changed = removeUnreachable(inode->scope) || changed;
+        }
+        break;
+    }
+    case MIR_Primitive::PRIM_LOOP:{
+        changed = removeUnreachable(((MIR_Loop*) p)->scope);
+        break;
+    }
+    default:
+        break;
+    }
+    return changed;
+}
+
+
+/*
+    Remove the expression statements whose value is unused and that have no side effects, eg. "x;" or "a + b;".
+*/
+static bool removeDead(MIR_Primitive *p){
+    if (!p){
+        return false;
+    }
+
+    bool changed = false;
+    switch (p->ptag){
+    case MIR_Primitive::PRIM_SCOPE:{
+        MIR_Scope *scope = (MIR_Scope*) p;
+        size_t kept = 0;
+        for (size_t i = 0; i < scope->statements.size(); i++){
+            MIR_Primitive *statement = scope->statements[i];
+            if (statement->ptag == MIR_Primitive::PRIM_EXPR && !hasSideEffects((MIR_Expr*) statement)){
+                changed = true;
+                continue;
+            }
+            changed = removeDead(statement) || changed;
+            scope->statements[kept++] = statement;
+        }
+        scope->statements.resize(kept);
+        break;
+    }
+    case MIR_Primitive::PRIM_IF:{
+        for (MIR_If *inode = (MIR_If*) p; inode; inode = inode->next){
+            changed = removeDead(inode->scope) || changed;
+        }
+        break;
+    }
+    case MIR_Primitive::PRIM_LOOP:{
+        changed = removeDead(((MIR_Loop*) p)->scope);
+        break;
+    }
+    default:
+        break;
+    }
+    return changed;
+}
+
+
+bool removeUnreachableCode(MIR *mir, MIR_Function *foo, Arena *arena){
+    return removeUnreachable((MIR_Scope*) foo);
+}
+
+bool removeDeadExpressions(MIR *mir, MIR_Function *foo, Arena *arena){
+    return removeDead((MIR_Scope*) foo);
+}
@@ -1,117 +1,640 @@
-#include <optional>
-#include <cmath> // for std::floor, std::ceil, etc.
-#include "ir.h"
-#include "number.h"
-
-
-
-Number foldConstants(Subexpr* s) {
-    switch (s->subtag) {
-        case Subexpr::SUBEXPR_LEAF: {
-            // Convert numeric token to Number
-            TokenType VALID_LITERALS[] = {
-                TOKEN_NUMERIC_BIN, TOKEN_NUMERIC_DEC, TOKEN_NUMERIC_OCT,
-                TOKEN_NUMERIC_HEX, TOKEN_NUMERIC_FLOAT, TOKEN_NUMERIC_DOUBLE,
-                TOKEN_CHAR,
-            };
-
-            if (_matchv(s->leaf, VALID_LITERALS, ARRAY_COUNT(VALID_LITERALS))) {
-                if (s->leaf.type == TOKEN_NUMERIC_FLOAT) {
-                    return f32FromString(s->leaf.string);
-                } else if (s->leaf.type == TOKEN_NUMERIC_DOUBLE) {
-                    return f64FromString(s->leaf.string);
-                } else {
-                    return Number{.type = MIR_Datatypes::_i64, .i64 = {std::stoll(s->leaf.string)}};
-                }
+#include "passes.h"
+#include <tokenizer/atoms.h>
+#include <math.h>
+#include <map>
+#include <set>
+
+
+/*
+    Constant folding and propagation over the MIR.
+
+    The binary, unary and cast nodes whose operands are immediates are replaced by an immediate of their type,
+    computed with the semantics of the code the node would compile to: integers wrap around at the size of their
+    type, signed and unsigned operations are told apart by their opcode, and f32 operations are done in float.
+    The operations whose result is undefined (division by zero, overflowing signed division, shifts by the size of
+    the type or more, floats converted to integers that cannot hold them) and the ones giving NaN are left as they are.
+
+    The scalar locals that are only ever loaded and stored whole are propagated through straight-line code: after
+    a statement storing an immediate to one, the loads of it in the following statements of the scope are replaced
+    by the immediate, up to the next statement that stores to it or the next branch, loop, label or jump.
+*/
+
+
+// the types whose values are folded: integers (not addresses) and f32/f64
+static bool isFoldableType(MIR_Datatype type){
+    bool isInteger = isIntegerType(type) && type.tag != MIR_Datatype::TYPE_PTR && type.tag != MIR_Datatype::TYPE_ARRAY && type.size <= 8;
+    return isInteger || type.tag == MIR_Datatype::TYPE_F32 || type.tag == MIR_Datatype::TYPE_F64;
+}
+
+
+/*
+    The value of an immediate node as a number of the node type. The integer literals keep their 64 bit value
+    whatever their type (see numberFromLiteral), those that do not fit in it are not folded.
+*/
+static bool constantOf(MIR_Expr *e, Number *n){
+    if (e->tag != MIR_Expr::EXPR_LOAD_IMMEDIATE || !isFoldableType(e->_type)){
+        return false;
+    }
+
+    Number number = e->immediate.number;
+    if (isFloatType(e->_type)){
+        if (number.type.tag != e->_type.tag){
+            return false;
+        }
+    }
+    else if (isFloatType(number.type) || castNumber(number, e->_type).u64[0] != number.u64[0]){
+        return false;
+    }
+    number.type = e->_type;
+    *n = number;
+    return true;
+}
+
+
+/*
+    Replace a node by an immediate of its type.
+    A folded immediate has no text, the code generators only read its number.
+*/
+static void makeImmediate(MIR_Expr *e, Number n){
+    n.type = e->_type;
+    e->tag = MIR_Expr::EXPR_LOAD_IMMEDIATE;
+    e->ptag = MIR_Primitive::PRIM_EXPR;
+    e->immediate.val = Splice{.data = NULL, .len = 0};
+    e->immediate.number = n;
+}
+
+
+static Number integerNumber(uint64_t value, MIR_Datatype type){
+    Number n = {.type = MIR_Datatypes::_i64, .u64 = {value}};
+    return castNumber(n, type);
+}
+
+template <typename T>
+static Number floatNumber(T value, MIR_Datatype type){
+    Number n = {.type = type, .u64 = {0}};
+    if (type.tag == MIR_Datatype::TYPE_F32){
+        n.f32[0] = value;
+    }
+    else {
+        n.f64[0] = value;
+    }
+    return n;
+}
+
+
+template <typename T>
+static bool foldFloatBinary(MIR_Expr::BinaryOp op, T a, T b, MIR_Datatype type, Number *result){
+    using Op = MIR_Expr::BinaryOp;
+    if (isnan(a) || isnan(b)){
+        return false;
+    }
+
+    T value;
+    switch (op){
+    case Op::EXPR_FADD:         value = a + b; break;
+    case Op::EXPR_FSUB:         value = a - b; break;
+    case Op::EXPR_FMUL:         value = a * b; break;
+    case Op::EXPR_FDIV:         value = a / b; break;
+    case Op::EXPR_FCOMPARE_LT:  *result = integerNumber(a < b, type); return true;
+    case Op::EXPR_FCOMPARE_GT:  *result = integerNumber(a > b, type); return true;
+    case Op::EXPR_FCOMPARE_LE:  *result = integerNumber(a <= b, type); return true;
+    case Op::EXPR_FCOMPARE_GE:  *result = integerNumber(a >= b, type); return true;
+    case Op::EXPR_FCOMPARE_EQ:  *result = integerNumber(a == b, type); return true;
+    case Op::EXPR_FCOMPARE_NEQ: *result = integerNumber(a != b, type); return true;
+    default:
+        return false;
+    }
+
+    if (isnan(value)){
+        return false;
+    }
+    *result = floatNumber(value, type);
+    return true;
+}
+
+
+/*
+    Fold a binary operation on operands of a given type, to a result of the node type.
+*/
+static bool foldBinary(MIR_Expr::BinaryOp op, Number left, Number right, MIR_Datatype type, Number *result){
+    using Op = MIR_Expr::BinaryOp;
+
+    if (left.type.tag == MIR_Datatype::TYPE_F32){
+        return foldFloatBinary(op, left.f32[0], right.f32[0], type, result);
+    }
+    if (left.type.tag == MIR_Datatype::TYPE_F64){
+        return foldFloatBinary(op, left.f64[0], right.f64[0], type, result);
+    }
+
+    // the operands are sign or zero extended to 64 bits, the result is truncated to the size of its type
+    uint64_t a = left.u64[0], b = right.u64[0];
+    int64_t sa = left.i64[0], sb = right.i64[0];
+    size_t bits = left.type.size * 8;
+    uint64_t value;
+
+    switch (op){
+    case Op::EXPR_IADD:
+    case Op::EXPR_UADD:             value = a + b; break;
+    case Op::EXPR_ISUB:
+    case Op::EXPR_USUB:             value = a - b; break;
+    case Op::EXPR_IMUL:
+    case Op::EXPR_UMUL:             value = a * b; break;
+
+    case Op::EXPR_IDIV:
+    case Op::EXPR_IMOD:{
+        // the smallest value of the type divided by -1 overflows
+        bool isOverflow = sb == -1 && (sa == INT64_MIN || (!isUnsigned(left.type) && sa == -(int64_t)(1ull << (bits - 1))));
+        if (sb == 0 || isOverflow){
+            return false;
+        }
+        value = (op == Op::EXPR_IDIV)? sa / sb : sa % sb;
+        break;
+    }
+    case Op::EXPR_UDIV:
+    case Op::EXPR_UMOD:{
+        if (b == 0){
+            return false;
+        }
+        value = (op == Op::EXPR_UDIV)? a / b : a % b;
+        break;
+    }
+
+    case Op::EXPR_IBITWISE_AND:     value = a & b; break;
+    case Op::EXPR_IBITWISE_OR:      value = a | b; break;
+    case Op::EXPR_IBITWISE_XOR:     value = a ^ b; break;
+    case Op::EXPR_LOGICAL_AND:      value = a != 0 && b != 0; break;
+    case Op::EXPR_LOGICAL_OR:       value = a != 0 || b != 0; break;
+
+    case Op::EXPR_LOGICAL_LSHIFT:
+    case Op::EXPR_LOGICAL_RSHIFT:
+    case Op::EXPR_ARITHMETIC_RSHIFT:{
+        if (sb < 0 || (uint64_t) sb >= bits){
+            return false;
+        }
+        if (op == Op::EXPR_LOGICAL_LSHIFT)          value = a << b;
+        else if (op == Op::EXPR_LOGICAL_RSHIFT)     value = a >> b;
+        else                                        value = sa >> b;
+        break;
+    }
+
+    case Op::EXPR_ICOMPARE_LT:      value = sa < sb; break;
+    case Op::EXPR_ICOMPARE_GT:      value = sa > sb; break;
+    case Op::EXPR_ICOMPARE_LE:      value = sa <= sb; break;
+    case Op::EXPR_ICOMPARE_GE:      value = sa >= sb; break;
+    case Op::EXPR_ICOMPARE_EQ:
+    case Op::EXPR_UCOMPARE_EQ:      value = a == b; break;
+    case Op::EXPR_ICOMPARE_NEQ:
+    case Op::EXPR_UCOMPARE_NEQ:     value = a != b; break;
+    case Op::EXPR_UCOMPARE_LT:      value = a < b; break;
+    case Op::EXPR_UCOMPARE_GT:      value = a > b; break;
+    case Op::EXPR_UCOMPARE_LE:      value = a <= b; break;
+    case Op::EXPR_UCOMPARE_GE:      value = a >= b; break;
+
+    default:
+        return false;
+    }
+
+    *result = integerNumber(value, type);
+    return true;
+}
+
+
+static bool foldUnary(MIR_Expr::UnaryOp op, Number operand, MIR_Datatype type, Number *result){
+    using Op = MIR_Expr::UnaryOp;
+
+    if (isFloatType(operand.type)){
+        if (op != Op::EXPR_FNEGATE){
+            return false;
+        }
+        if (operand.type.tag == MIR_Datatype::TYPE_F32){
+            if (isnan(operand.f32[0])){
+                return false;
+            }
+            *result = floatNumber(-operand.f32[0], type);
+        }
+        else {
+            if (isnan(operand.f64[0])){
+                return false;
+            }
+            *result = floatNumber(-operand.f64[0], type);
+        }
+        return true;
+    }
+
+    switch (op){
+    case Op::EXPR_INEGATE:      *result = integerNumber(0 - operand.u64[0], type); return true;
+    case Op::EXPR_IBITWISE_NOT: *result = integerNumber(~operand.u64[0], type); return true;
+    case Op::EXPR_LOGICAL_NOT:  *result = integerNumber(operand.u64[0] == 0, type); return true;
+    default:
+        return false;
+    }
+}
+
+
+/*
+    Convert a number to a type as a cast does. Floats converted to integers are truncated toward zero,
+    and not folded if the integer type cannot hold the result.
+*/
+static bool foldCast(Number operand, MIR_Datatype to, Number *result){
+    if (!isFoldableType(to)){
+        return false;
+    }
+    if (!isFloatType(operand.type) || isFloatType(to)){
+        *result = castNumber(operand, to);
+        return true;
+    }
+
+    double value = (operand.type.tag == MIR_Datatype::TYPE_F32)? operand.f32[0] : operand.f64[0];
+    if (isnan(value)){
+        return false;
+    }
+    if (to.tag == MIR_Datatype::TYPE_BOOL){
+        *result = integerNumber(value != 0, to);
+        return true;
+    }
+
+    double truncated = trunc(value);
+    size_t bits = to.size * 8;
+    if (isUnsigned(to)){
+        if (truncated < 0 || truncated >= ldexp(1.0, bits)){
+            return false;
+        }
+        *result = integerNumber((uint64_t) truncated, to);
+    }
+    else {
+        if (truncated < -ldexp(1.0, bits - 1) || truncated >= ldexp(1.0, bits - 1)){
+            return false;
+        }
+        *result = integerNumber((uint64_t)(int64_t) truncated, to);
+    }
+    return true;
+}
+
+
+
+struct ConstantFolder{
+    typedef std::pair<MIR_Scope*, Atom> Variable;
+
+    // the scopes being visited, innermost last
+    std::vector<MIR_Scope*> scopes;
+    // the locals accessed other than by loading or storing them whole, never propagated
+    std::set<Variable> inMemory;
+    // the value of the locals known at the current statement
+    std::map<Variable, Number> known;
+    // the locals stored to by the current statement
+    std::set<Variable> stored;
+    bool changed = false;
+
+
+    /*
+        The local a name refers to in the scopes being visited, {NULL, 0} for global variables.
+    */
+    Variable resolve(Splice name){
+        for (size_t i = scopes.size(); i > 0; i--){
+            if (scopes[i - 1]->symbols.existKey(name)){
+                return Variable(scopes[i - 1], atomOf(name));
             }
-            return std::nullopt;
-        }
-
-        case Subexpr::SUBEXPR_BINARY_OP: {
-            auto leftVal = foldConstants(s->binary.left);
-            auto rightVal = foldConstants(s->binary.right);
-            
-            if (!leftVal || !rightVal) return std::nullopt; // Non-constant subexpr
-            
-            Number result;
-            switch (s->binary.op.type) {
-                case TOKEN_PLUS:
-                    result.i64[0] = leftVal->i64[0] + rightVal->i64[0];
-                    break;
-                case TOKEN_MINUS:
-                    result.i64[0] = leftVal->i64[0] - rightVal->i64[0];
-                    break;
-                case TOKEN_STAR:
-                    result.i64[0] = leftVal->i64[0] * rightVal->i64[0];
-                    break;
-                case TOKEN_SLASH:
-                    if (rightVal->i64[0] == 0) return std::nullopt; // Avoid division by zero
-                    result.i64[0] = leftVal->i64[0] / rightVal->i64[0];
-                    break;
-                default:
-                    return std::nullopt; // Non-foldable operator
-            }
-            
-            // Replace current subtree with constant value
-            s->subtag = Subexpr::SUBEXPR_LEAF;
-            s->leaf.type = TOKEN_NUMERIC_DEC;
-            s->leaf.string = std::to_string(result.i64[0]); // Convert back to string
-
-            return result;
-        }
-
-        case Subexpr::SUBEXPR_UNARY: {
-            auto val = foldConstants(s->unary.expr);
-            if (!val) return std::nullopt;
-
-            Number result;
-            switch (s->unary.op.type) {
-                case TOKEN_MINUS:
-                    result.i64[0] = -val->i64[0];
-                    break;
-                case TOKEN_PLUS:
-                    result.i64[0] = val->i64[0]; // No change
-                    break;
-                default:
-                    return std::nullopt; // Non-foldable unary op
-            }
-            
-            s->subtag = Subexpr::SUBEXPR_LEAF;
-            s->leaf.type = TOKEN_NUMERIC_DEC;
-            s->leaf.string = std::to_string(result.i64[0]);
-
-            return result;
-        }
-
-        case Subexpr::SUBEXPR_RECURSE_PARENTHESIS: {
-            return foldConstants(s->inside);
-        }
-
-        case Subexpr::SUBEXPR_CAST: {
-            auto val = foldConstants(s->cast.expr);
-            if (!val) return std::nullopt;
-
-            // Perform type casting
-            Number result = *val;
-            if (s->cast.to == MIR_Datatypes::_f32) {
-                result.type = MIR_Datatypes::_f32;
-                result.f32[0] = static_cast<float>(val->i64[0]);
-            } else if (s->cast.to == MIR_Datatypes::_f64) {
-                result.type = MIR_Datatypes::_f64;
-                result.f64[0] = static_cast<double>(val->i64[0]);
-            } else if (s->cast.to == MIR_Datatypes::_i64) {
-                result.type = MIR_Datatypes::_i64;
-                result.i64[0] = static_cast<int64_t>(val->f64[0]);
-            }
-
-            s->subtag = Subexpr::SUBEXPR_LEAF;
-            s->leaf.type = TOKEN_NUMERIC_DEC;
-            s->leaf.string = std::to_string(result.i64[0]);
-
-            return result;
         }
+        return Variable(NULL, 0);
+    }
+
+    MIR_Datatype typeOf(Variable var){
+        return var.first->symbols.getInfo(atomName(var.second)).info;
+    }
 
+    // a local whose value can be known
+    bool isPropagated(Variable var){
+        return var.first && isFoldableType(typeOf(var)) && !inMemory.count(var);
+    }
+
+    // the local whose whole value a store writes or a load reads, {NULL, 0} if none
+    Variable wholeVariable(MIR_Expr *address, int64_t offset, size_t size){
+        if (address->tag != MIR_Expr::EXPR_ADDRESSOF){
+            return Variable(NULL, 0);
+        }
+        Variable var = resolve(address->addressOf.symbol);
+        if (!var.first || offset != 0 || size != typeOf(var).size){
+            return Variable(NULL, 0);
+        }
+        return var;
+    }
+
+
+
+    /*
+        Find the locals left in memory: the ones whose address is used other than to load or store them whole.
+    */
+    void findMemoryVariables(MIR_Expr *e){
+        if (!e){
+            return;
+        }
+
+        switch (e->tag){
+        case MIR_Expr::EXPR_ADDRESSOF:{
+            Variable var = resolve(e->addressOf.symbol);
+            if (var.first){
+                inMemory.insert(var);
+            }
+            break;
+        }
+        case MIR_Expr::EXPR_LOAD:{
+            bool isWhole = e->load.type != MIR_Expr::LoadType::EXPR_MEMLOAD;
+            if (!isWhole || !wholeVariable(e->load.base, e->load.offset, e->load.size).first){
+                findMemoryVariables(e->load.base);
+            }
+            break;
+        }
+        case MIR_Expr::EXPR_STORE:{
+            if (!wholeVariable(e->store.left, e->store.offset, e->store.size).first){
+                findMemoryVariables(e->store.left);
+            }
+            findMemoryVariables(e->store.right);
+            break;
+        }
+        case MIR_Expr::EXPR_INDEX:{
+            findMemoryVariables(e->index.base);
+            findMemoryVariables(e->index.index);
+            break;
+        }
+        case MIR_Expr::EXPR_LOAD_ADDRESS:{
+            findMemoryVariables(e->loadAddress.base);
+            break;
+        }
+        case MIR_Expr::EXPR_CALL:{
+            for (MIR_Expr *arg : e->functionCall->arguments){
+                findMemoryVariables(arg);
+            }
+            break;
+        }
+        case MIR_Expr::EXPR_CAST:{
+            findMemoryVariables(e->cast.expr);
+            break;
+        }
+        case MIR_Expr::EXPR_BINARY:{
+            findMemoryVariables(e->binary.left);
+            findMemoryVariables(e->binary.right);
+            break;
+        }
+        case MIR_Expr::EXPR_UNARY:{
+            findMemoryVariables(e->unary.expr);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void findMemoryVariables(MIR_Primitive *p){
+        if (!p){
+            return;
+        }
+
+        switch (p->ptag){
+        case MIR_Primitive::PRIM_IF:{
+            for (MIR_If *inode = (MIR_If*) p; inode; inode = inode->next){
+                findMemoryVariables(inode->condition);
+                findMemoryVariables(inode->scope);
+            }
+            break;
+        }
+        case MIR_Primitive::PRIM_LOOP:{
+            MIR_Loop *lnode = (MIR_Loop*) p;
+            findMemoryVariables(lnode->condition);
+            findMemoryVariables(lnode->scope);
+            findMemoryVariables(lnode->update);
+            break;
+        }
+        case MIR_Primitive::PRIM_RETURN:{
+            findMemoryVariables(((MIR_Return*) p)->returnValue);
+            break;
+        }
+        case MIR_Primitive::PRIM_SCOPE:{
+            MIR_Scope *scope = (MIR_Scope*) p;
+            scopes.push_back(scope);
+            for (MIR_Primitive *statement : scope->statements){
+                findMemoryVariables(statement);
+            }
+            scopes.pop_back();
+            break;
+        }
+        case MIR_Primitive::PRIM_EXPR:{
+            findMemoryVariables((MIR_Expr*) p);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+
+
+    /*
+        The locals stored to anywhere in an expression.
+    */
+    void findStores(MIR_Expr *e){
+        if (!e){
+            return;
+        }
+
+        switch (e->tag){
+        case MIR_Expr::EXPR_STORE:{
+            Variable var = wholeVariable(e->store.left, e->store.offset, e->store.size);
+            if (var.first){
+                stored.insert(var);
+            }
+            else {
+                findStores(e->store.left);
+            }
+            findStores(e->store.right);
+            break;
+        }
+        case MIR_Expr::EXPR_LOAD:
+            findStores(e->load.base);
+            break;
+        case MIR_Expr::EXPR_INDEX:
+            findStores(e->index.base);
+            findStores(e->index.index);
+            break;
+        case MIR_Expr::EXPR_LOAD_ADDRESS:
+            findStores(e->loadAddress.base);
+            break;
+        case MIR_Expr::EXPR_CALL:
+            for (MIR_Expr *arg : e->functionCall->arguments){
+                findStores(arg);
+            }
+            break;
+        case MIR_Expr::EXPR_CAST:
+            findStores(e->cast.expr);
+            break;
+        case MIR_Expr::EXPR_BINARY:
+            findStores(e->binary.left);
+            findStores(e->binary.right);
+            break;
+        case MIR_Expr::EXPR_UNARY:
+            findStores(e->unary.expr);
+            break;
+        default:
+            break;
+        }
+    }
+
+
+
+    /*
+        Fold an expression bottom up, replacing the loads of the known locals by their value if propagate is set.
+    */
+    void fold(MIR_Expr *e, bool propagate){
+        if (!e){
+            return;
+        }
+
+        Number result;
+        switch (e->tag){
+        case MIR_Expr::EXPR_STORE:
+            fold(e->store.left, propagate);
+            fold(e->store.right, propagate);
+            return;
+        case MIR_Expr::EXPR_INDEX:
+            fold(e->index.base, propagate);
+            fold(e->index.index, propagate);
+            return;
+        case MIR_Expr::EXPR_LOAD_ADDRESS:
+            fold(e->loadAddress.base, propagate);
+            return;
+        case MIR_Expr::EXPR_CALL:
+            for (MIR_Expr *arg : e->functionCall->arguments){
+                fold(arg, propagate);
+            }
+            return;
+
+        case MIR_Expr::EXPR_LOAD:{
+            if (!propagate || e->load.type == MIR_Expr::LoadType::EXPR_MEMLOAD){
+                fold(e->load.base, propagate);
+                return;
+            }
+            Variable var = wholeVariable(e->load.base, e->load.offset, e->load.size);
+            auto found = known.find(var);
+            if (var.first && !stored.count(var) && found != known.end() && found->second.type.tag == e->_type.tag){
+                makeImmediate(e, found->second);
+                changed = true;
+                return;
+            }
+            fold(e->load.base, propagate);
+            return;
+        }
+
+        case MIR_Expr::EXPR_CAST:{
+            fold(e->cast.expr, propagate);
+            Number operand;
+            if (constantOf(e->cast.expr, &operand) && foldCast(operand, e->_type, &result)){
+                makeImmediate(e, result);
+                changed = true;
+            }
+            return;
+        }
+        case MIR_Expr::EXPR_BINARY:{
+            fold(e->binary.left, propagate);
+            fold(e->binary.right, propagate);
+            Number left, right;
+            bool isConstant = constantOf(e->binary.left, &left) && constantOf(e->binary.right, &right);
+            if (isConstant && left.type.tag == right.type.tag && isFoldableType(e->_type) && foldBinary(e->binary.op, left, right, e->_type, &result)){
+                makeImmediate(e, result);
+                changed = true;
+            }
+            return;
+        }
+        case MIR_Expr::EXPR_UNARY:{
+            fold(e->unary.expr, propagate);
+            Number operand;
+            if (constantOf(e->unary.expr, &operand) && isFoldableType(e->_type) && foldUnary(e->unary.op, operand, e->_type, &result)){
+                makeImmediate(e, result);
+                changed = true;
+            }
+            return;
+        }
         default:
-            return std::nullopt;
+            return;
+        }
+    }
+
+
+    /*
+        Fold an expression evaluated in straight-line code, then update what is known of the locals it stores to.
+    */
+    void foldStatement(MIR_Expr *e){
+        if (!e){
+            return;
+        }
+        stored.clear();
+        findStores(e);
+        fold(e, true);
+
+        for (const Variable &var : stored){
+            known.erase(var);
+        }
+        if (e->tag == MIR_Expr::EXPR_STORE){
+            Variable var = wholeVariable(e->store.left, e->store.offset, e->store.size);
+            Number value;
+            if (var.first && isPropagated(var) && constantOf(e->store.right, &value)){
+                known[var] = castNumber(value, typeOf(var));
+            }
+        }
+        stored.clear();
     }
+
+
+    void foldScope(MIR_Scope *scope){
+        scopes.push_back(scope);
+        for (MIR_Primitive *statement : scope->statements){
+            switch (statement->ptag){
+            case MIR_Primitive::PRIM_EXPR:
+                foldStatement((MIR_Expr*) statement);
+                break;
+            case MIR_Primitive::PRIM_SCOPE:
+                // a block is entered from the statement before it
+                foldScope((MIR_Scope*) statement);
+                break;
+            case MIR_Primitive::PRIM_RETURN:
+                foldStatement(((MIR_Return*) statement)->returnValue);
+                known.clear();
+                break;
+            case MIR_Primitive::PRIM_IF:{
+                // only the first condition is evaluated right after the statements before the if
+                MIR_If *inode = (MIR_If*) statement;
+                foldStatement(inode->condition);
+                for (; inode; inode = inode->next){
+                    if (inode != (MIR_If*) statement){
+                        fold(inode->condition, false);
+                    }
+                    known.clear();
+                    foldScope(inode->scope);
+                }
+                known.clear();
+                break;
+            }
+            case MIR_Primitive::PRIM_LOOP:{
+                MIR_Loop *lnode = (MIR_Loop*) statement;
+                known.clear();
+                fold(lnode->condition, false);
+                fold(lnode->update, false);
+                foldScope(lnode->scope);
+                known.clear();
+                break;
+            }
+            default:
+                known.clear();
+                break;
+            }
+        }
+        scopes.pop_back();
+    }
+};
+
+
+
+bool foldConstants(MIR *mir, MIR_Function *foo, Arena *arena){
+    ConstantFolder folder;
+    folder.findMemoryVariables((MIR_Scope*) foo);
+    folder.foldScope((MIR_Scope*) foo);
+    return folder.changed;
 }
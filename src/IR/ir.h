@@ -9,6 +9,11 @@
 struct AST{
     StatementBlock global;
     SymbolTable<Function> functions;
+
+    // set when function bodies are parsed lazily: parses and checks a deferred function body, 
+    // returns false if the body has errors
+    bool (*parseDeferredBody)(void *parser, Function *foo) = NULL;
+    void *parser = NULL;
 };
 
 // mid level IR
@@ -4,12 +4,45 @@
 
 
 
-void* scratchPad[1024];
-
-
+/*
+    The primitives a node is lowered to. Most nodes are lowered to one or two primitives, which are kept inline,
+    longer results (like the stores of an initializer list) grow in the spans arena of the MiddleEnd. 
+    The spans of a function are freed once it is lowered.
+*/
 struct MIR_Primitives {
-    MIR_Primitive** primitives;
+    static const int INLINE_CAPACITY = 2;
+
+    MIR_Primitive* inlined[INLINE_CAPACITY];
+    // NULL while the primitives fit inline
+    MIR_Primitive** spilled;
     int n;
+    int capacity;
+
+    MIR_Primitive* operator[](int i) const {
+        assert(i < n);
+        return spilled? spilled[i] : inlined[i];
+    }
+
+    void push(MIR_Primitive* p, Arena* spans){
+        if (!spilled && n < INLINE_CAPACITY){
+            inlined[n++] = p;
+            return;
+        }
+        if (!spilled || n == capacity){
+            int grownCapacity = spilled? capacity * 2 : INLINE_CAPACITY * 4;
+            MIR_Primitive** grown = (MIR_Primitive**)spans->alloc(grownCapacity * sizeof(MIR_Primitive*));
+            memcpy(grown, spilled? spilled : inlined, n * sizeof(MIR_Primitive*));
+            spilled = grown;
+            capacity = grownCapacity;
+        }
+        spilled[n++] = p;
+    }
+
+    void append(const MIR_Primitives &other, Arena* spans){
+        for (int i=0; i<other.n; i++){
+            push(other[i], spans);
+        }
+    }
 };
 
 
@@ -25,9 +58,14 @@ struct MiddleEnd {
     AST* ast;
     MIR* mir;
     Labeller labeller;
+    // the results of the lowering, see MIR_Primitives
+    Arena spans;
+    // lowered types indexed by type id, for the types whose layout does not depend on the scope
+    std::vector<MIR_Datatype> loweredTypes;
 
     MIR_Expr* typeCastTo(MIR_Expr* expr, MIR_Datatype to, Arena* arena);
     MIR_Datatype convertToLowerLevelType(DataType d, StatementBlock *scope);
+    MIR_Datatype lowerType(DataType d, StatementBlock *scope);
     void calcStructMemberOffsets(StatementBlock *scope);
     MIR_Primitives transformSubexpr(const Subexpr* expr, StatementBlock* scope, Arena* arena);
     MIR_Primitives transformNode(const Node* current, StatementBlock *scope, Arena* arena, MIR_Scope* mScope);  
@@ -44,7 +82,7 @@ Splice MiddleEnd :: copySplice(Splice s, Arena* arena){
     char* str = (char*) arena->alloc(s.len + 1);
     memcpy(str, s.data, s.len);
     str[s.len] = 0;
-    return Splice{.data = str, .len = s.len};
+    return Splice{.data = str, .len = s.len, .atom = s.atom};
 }
 
 
@@ -98,9 +136,29 @@ MIR_Expr* MiddleEnd :: typeCastTo(MIR_Expr* expr, MIR_Datatype to, Arena* arena)
 
 
 /*
-    RV-64 specific datatypes
+    Lowered type of a data type. Only structs and unions (and arrays of them) depend on the scope,
+    the other types are lowered once and then read from the cache by their id.
 */
 MIR_Datatype MiddleEnd :: convertToLowerLevelType(DataType d, StatementBlock *scope){
+    TypeId id = typeTable.intern(d);
+    if (typeTable.dependsOnScope(id)){
+        return lowerType(d, scope);
+    }
+
+    if (id >= loweredTypes.size()){
+        loweredTypes.resize(typeTable.count(), MIR_Datatype{.name = NULL});
+    }
+    if (loweredTypes[id].name == NULL){
+        loweredTypes[id] = lowerType(d, scope);
+    }
+    return loweredTypes[id];
+}
+
+
+/*
+    RV-64 specific datatypes
+*/
+MIR_Datatype MiddleEnd :: lowerType(DataType d, StatementBlock *scope){
     switch (d.tag){
     case DataType::TAG_ADDRESS:
     case DataType::TAG_PTR:
@@ -211,21 +269,11 @@ MIR_Primitives MiddleEnd :: resolveInitializerLists(const Subexpr* expr, DataTyp
     if (expr->subtag != Subexpr::SUBEXPR_INITIALIZER_LIST){
         MIR_Primitives exprsRight = transformSubexpr(expr, scope, arena);
         assert(exprsRight.n == 1);
-        MIR_Expr* right = (MIR_Expr*) exprsRight.primitives[0];
+        MIR_Expr* right = (MIR_Expr*) exprsRight[0];
         
         MIR_Datatype dt = convertToLowerLevelType(d, scope);
         
-        MIR_Primitives m = {
-            .primitives = (MIR_Primitive**)scratchPad,
-            .n = 0
-        };
-        
-
-
-        m.primitives[m.n] = getStoreNode(left, right, dt, offset, arena);
-        m.n++;
-
-        return m;
+        return MIR_Primitives{.inlined = {getStoreNode(left, right, dt, offset, arena)}, .n = 1};
     }
 
 
@@ -233,10 +281,9 @@ MIR_Primitives MiddleEnd :: resolveInitializerLists(const Subexpr* expr, DataTyp
     bool isStructType = d.tag == DataType::TAG_STRUCT;
     bool isArrayType = d.tag == DataType::TAG_ARRAY;
 
-    MIR_Primitives returnExprs = {.primitives = (MIR_Primitive**)scratchPad, .n = 0};
+    MIR_Primitives returnExprs = {};
 
     InitializerList* initlist = expr->initList;
-    std::vector <MIR_Primitive*> exprsCopy;
     if (isStructType){
         StatementBlock* declnScope = scope->findCompositeDeclaration(d.compositeName.string);
         Composite &structInfo = declnScope->composites.getInfo(d.compositeName.string).info;
@@ -248,20 +295,8 @@ MIR_Primitives MiddleEnd :: resolveInitializerLists(const Subexpr* expr, DataTyp
             Composite::MemberInfo &member = structInfo.members.getInfo(structMemberName).info;
 
             MIR_Primitives exprs = resolveInitializerLists(initlist->values[i], member.type, left, offset + member.offset, scope, arena);
-            
-            for (int j=0; j<exprs.n; j++){
-                exprsCopy.push_back(exprs.primitives[j]);
-            }
-
+            returnExprs.append(exprs, &spans);
         }
-        
-
-        for (auto &expr : exprsCopy){
-            returnExprs.primitives[returnExprs.n] = expr;
-            returnExprs.n++;
-        }
-
-        return returnExprs;
     }
     else if (isArrayType){
             
@@ -269,25 +304,13 @@ MIR_Primitives MiddleEnd :: resolveInitializerLists(const Subexpr* expr, DataTyp
             size_t sizeOfType = convertToLowerLevelType(*(d.ptrTo), scope).size;
 
             MIR_Primitives exprs = resolveInitializerLists(initlist->values[i], *(d.ptrTo), left, offset + sizeOfType * i, scope, arena);
-            
-            for (int j=0; j<exprs.n; j++){
-                exprsCopy.push_back(exprs.primitives[j]);
-            }
-
+            returnExprs.append(exprs, &spans);
         }
-
-        
-    
     }
     else {
         assert(false && "Initializer list/Expected datatype should either be a struct or array type.");
     }
 
-    for (auto &expr : exprsCopy){
-        returnExprs.primitives[returnExprs.n] = expr;
-        returnExprs.n++;
-    }
-
     return returnExprs;
 
 }
@@ -303,27 +326,16 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
         return MIR_Primitives{.n = 0};
     }
     
-    MIR_Primitives returnExprs = {.primitives = (MIR_Primitive**)scratchPad, .n = 0};
+    MIR_Primitives returnExprs = {};
     MIR_Expr *d = (MIR_Expr *)arena->alloc(sizeof(MIR_Expr));
     
     switch (expr->subtag){
     case Subexpr::SUBEXPR_INITIALIZER_LIST: {
-        std::vector <MIR_Primitive*> values;
-
         for (auto &value : expr->initList->values){
             MIR_Primitives exprs = transformSubexpr(value, scope, arena);
             assert(exprs.n == 1);
-            
-            for (int i=0; i<exprs.n; i++){
-                values.push_back(exprs.primitives[i]);
-            }
-        }
-        
-        for (auto &value : values){
-            returnExprs.primitives[returnExprs.n] = value;
-            returnExprs.n++;
+            returnExprs.append(exprs, &spans);
         }
-
         break;
     }
 
@@ -347,7 +359,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
 
             MIR_Primitives exprs = transformSubexpr(expr->binary.left, scope, arena);
             assert(exprs.n == 1);
-            d = (MIR_Expr*)exprs.primitives[0];
+            d = (MIR_Expr*)exprs[0];
 
             DataType compositeType = expr->binary.left->type;
             assert(isCompositeType(compositeType));
@@ -378,8 +390,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             d->tag = MIR_Expr::EXPR_LOAD;
             d->ptag = MIR_Primitive::PRIM_EXPR;
             
-            returnExprs.primitives[returnExprs.n] = d;
-            returnExprs.n++;
+            returnExprs.push(d, &spans);
             break;
         }
         
@@ -404,7 +415,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             
             MIR_Primitives exprs = transformSubexpr(expr->binary.left, scope, arena);
             assert(exprs.n == 1);
-            d->load.base = (MIR_Expr*)exprs.primitives[0];
+            d->load.base = (MIR_Expr*)exprs[0];
             
             DataType compositeType = expr->binary.left->type.getBaseType();
 
@@ -439,8 +450,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             d->tag = MIR_Expr::EXPR_LOAD;
             d->ptag = MIR_Primitive::PRIM_EXPR;
             
-            returnExprs.primitives[returnExprs.n] = d;
-            returnExprs.n++;
+            returnExprs.push(d, &spans);
             break;
         }
 
@@ -489,11 +499,11 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             
             MIR_Primitives exprLeft = transformSubexpr(expr->binary.left, scope, arena);
             assert(exprLeft.n == 1);
-            MIR_Expr *left = (MIR_Expr*) exprLeft.primitives[0];
+            MIR_Expr *left = (MIR_Expr*) exprLeft[0];
 
             MIR_Primitives exprRight = transformSubexpr(expr->binary.right, scope, arena);
             assert(exprRight.n == 1);
-            MIR_Expr *right = (MIR_Expr*) exprRight.primitives[0];
+            MIR_Expr *right = (MIR_Expr*) exprRight[0];
             
             assert(expr->binary.left->type.tag == DataType::TAG_PTR || 
                     expr->binary.left->type.tag == DataType::TAG_ARRAY ||
@@ -533,8 +543,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             d->load.size = convertToLowerLevelType(dt, scope).size;
             d->ptag = MIR_Primitive::PRIM_EXPR;
 
-            returnExprs.primitives[returnExprs.n] = d;
-            returnExprs.n++;
+            returnExprs.push(d, &spans);
             break;
         }
 
@@ -546,7 +555,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
         if (isAssignment){
             MIR_Primitives exprLeft = transformSubexpr(expr->binary.left, scope, arena);
             assert(exprLeft.n == 1);
-            MIR_Expr *left = (MIR_Expr*) exprLeft.primitives[0];
+            MIR_Expr *left = (MIR_Expr*) exprLeft[0];
 
 
             if (expr->binary.right->subtag == Subexpr::SUBEXPR_INITIALIZER_LIST){
@@ -626,10 +635,9 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             
             
             assert(exprRight.n == 1);
-            MIR_Expr* right = (MIR_Expr*) exprRight.primitives[0];
+            MIR_Expr* right = (MIR_Expr*) exprRight[0];
 
-            returnExprs.primitives[returnExprs.n] = getStoreNode(left, right, left->_type, 0, arena);
-            returnExprs.n++;
+            returnExprs.push(getStoreNode(left, right, left->_type, 0, arena), &spans);
             
 
             break;
@@ -649,11 +657,11 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
         // expand left and right 
         MIR_Primitives exprLeft = transformSubexpr(expr->binary.left, scope, arena);
         assert(exprLeft.n == 1);
-        MIR_Expr *left = (MIR_Expr*) exprLeft.primitives[0];
+        MIR_Expr *left = (MIR_Expr*) exprLeft[0];
 
         MIR_Primitives exprRight = transformSubexpr(expr->binary.right, scope, arena);
         assert(exprRight.n == 1);
-        MIR_Expr *right = (MIR_Expr*) exprRight.primitives[0];
+        MIR_Expr *right = (MIR_Expr*) exprRight[0];
         
         if ((expr->binary.op.type == TOKEN_LOGICAL_AND) || (expr->binary.op.type == TOKEN_LOGICAL_OR)){
             d->_type = MIR_Datatypes::_bool;
@@ -687,11 +695,16 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             break;
         } 
         case TOKEN_SLASH:{
-            d->binary.op = (isIntegerOperation)? MIR_Expr::BinaryOp::EXPR_IDIV : MIR_Expr::BinaryOp::EXPR_FDIV;
+            if (isIntegerOperation){
+                d->binary.op = isUnsigned(d->_type)? MIR_Expr::BinaryOp::EXPR_UDIV : MIR_Expr::BinaryOp::EXPR_IDIV;
+            }
+            else {
+                d->binary.op = MIR_Expr::BinaryOp::EXPR_FDIV;
+            }
             break;
         } 
         case TOKEN_MODULO:{
-            d->binary.op = MIR_Expr::BinaryOp::EXPR_IMOD;
+            d->binary.op = isUnsigned(d->_type)? MIR_Expr::BinaryOp::EXPR_UMOD : MIR_Expr::BinaryOp::EXPR_IMOD;
             break;
         } 
         case TOKEN_AMPERSAND:{
@@ -711,11 +724,12 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             break;
         } 
         case TOKEN_SHIFT_RIGHT:{
-            if (isUnsigned(left->_type)){
-                d->binary.op = MIR_Expr::BinaryOp::EXPR_ARITHMETIC_RSHIFT;
+            // unsigned values are shifted in zeros, signed ones copies of their sign bit
+            if (isUnsigned(d->_type)){
+                d->binary.op = MIR_Expr::BinaryOp::EXPR_LOGICAL_RSHIFT;
             }
             else {
-                d->binary.op = MIR_Expr::BinaryOp::EXPR_LOGICAL_RSHIFT;
+                d->binary.op = MIR_Expr::BinaryOp::EXPR_ARITHMETIC_RSHIFT;
             }
             break;
         }
@@ -791,8 +805,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
         }
 
 
-        returnExprs.primitives[returnExprs.n] = d;
-        returnExprs.n++;
+        returnExprs.push(d, &spans);
         break;
     }
     
@@ -853,13 +866,13 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
                 int enumVal = enumDeclScope->enumValues.getInfo(expr->leaf.string).info.value;
 
                 char buf[64];
-                size_t n = sprintf(buf, "%d", enumVal);
+                uint32_t n = sprintf(buf, "%d", enumVal);
                 d->immediate.val = copySplice(Splice{.data = buf, .len = n}, arena);
+                d->immediate.number = Number{.type = d->_type, .i64 = {enumVal}};
                 d->ptag = MIR_Primitive::PRIM_EXPR;
             }
                 
-            returnExprs.primitives[returnExprs.n] = d;
-            returnExprs.n++;
+            returnExprs.push(d, &spans);
             break;
         }
         
@@ -904,10 +917,12 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
 
         d->tag = MIR_Expr::EXPR_LOAD_IMMEDIATE;
         d->immediate.val = copySplice(expr->leaf.string, arena);
+        if (expr->leaf.type != TOKEN_STRING_LITERAL){
+            d->immediate.number = numberFromLiteral(expr->leaf, d->_type);
+        }
         d->ptag = MIR_Primitive::PRIM_EXPR;
         
-        returnExprs.primitives[returnExprs.n] = d;
-        returnExprs.n++;
+        returnExprs.push(d, &spans);
         break;
     }
 
@@ -920,7 +935,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             bool isInc = (_match(expr->unary.op, TOKEN_PLUS_PLUS_POSTFIX));
 
             Subexpr one = {0};
-            one.leaf = Token{ .type = TOKEN_NUMERIC_DEC, .string = {.data = "1", .len = 1}};
+            one.leaf = Token{ .type = TOKEN_NUMERIC_DEC, .string = {.data = "1", .len = 1}, .value = {.i64 = 1}};
             one.tag = Node::NODE_SUBEXPR;
             one.subtag = Subexpr::SUBEXPR_LEAF;
             one.type = DataTypes::Int;
@@ -965,7 +980,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             bool isInc = (_match(expr->unary.op, TOKEN_PLUS_PLUS));
 
             Subexpr one = {0};
-            one.leaf = Token{ .type = TOKEN_NUMERIC_DEC, .string = {.data = "1", .len = 1}};
+            one.leaf = Token{ .type = TOKEN_NUMERIC_DEC, .string = {.data = "1", .len = 1}, .value = {.i64 = 1}};
             one.tag = Node::NODE_SUBEXPR;
             one.subtag = Subexpr::SUBEXPR_LEAF;
             one.type = DataTypes::Int;
@@ -995,7 +1010,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
         
         MIR_Primitives exprs = transformSubexpr(expr->unary.expr, scope, arena);
         assert(exprs.n == 1);
-        MIR_Expr* operand = (MIR_Expr*)exprs.primitives[0];
+        MIR_Expr* operand = (MIR_Expr*)exprs[0];
         
         if (_match(expr->unary.op, TOKEN_STAR)){
             /*
@@ -1018,8 +1033,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             d->load.size = d->_type.size;
             d->ptag = MIR_Primitive::PRIM_EXPR;
 
-            returnExprs.primitives[returnExprs.n] = d;
-            returnExprs.n++;
+            returnExprs.push(d, &spans);
             break;
         }
 
@@ -1043,15 +1057,13 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             DataType dt;
             
             dt.tag = DataType::TAG_ADDRESS;
-            dt.ptrTo = (DataType*) arena->alloc(sizeof(DataType));
-            *(dt.ptrTo) = expr->unary.expr->type;
+            dt.ptrTo = typeTable.canonical(expr->unary.expr->type);
             d->type = dt;
             d->_type = convertToLowerLevelType(dt, scope);
 
             d->ptag = MIR_Primitive::PRIM_EXPR;
 
-            returnExprs.primitives[returnExprs.n] = d;
-            returnExprs.n++;
+            returnExprs.push(d, &spans);
             break;
         }
         
@@ -1099,8 +1111,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             break;
         }
 
-        returnExprs.primitives[returnExprs.n] = d;
-        returnExprs.n++;
+        returnExprs.push(d, &spans);
         break;
     }
 
@@ -1121,7 +1132,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
             // convert
             MIR_Primitives exprs = transformSubexpr(fooCall->arguments[i], scope, arena);
             assert(exprs.n == 1);
-            MIR_Expr* mArg = (MIR_Expr*)exprs.primitives[0];
+            MIR_Expr* mArg = (MIR_Expr*)exprs[0];
 
             if (!(foo.isVariadic && i >= foo.parameters.size())){
                 DataType reqType = foo.parameters[i].type;
@@ -1141,8 +1152,7 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
         d->_type = convertToLowerLevelType(foo.returnType, scope);
         d->functionCall = mfooCall;
 
-        returnExprs.primitives[returnExprs.n] = d;
-        returnExprs.n++;
+        returnExprs.push(d, &spans);
         break;
     }
     
@@ -1153,13 +1163,12 @@ MIR_Primitives MiddleEnd :: transformSubexpr(const Subexpr* expr, StatementBlock
         MIR_Primitives exprs = transformSubexpr(expr->cast.expr, scope, arena);
         assert(exprs.n == 1);
 
-        d->cast.expr = (MIR_Expr*)exprs.primitives[0];
+        d->cast.expr = (MIR_Expr*)exprs[0];
         d->ptag = MIR_Primitive::PRIM_EXPR;
         d->tag = MIR_Expr::EXPR_CAST;
         d->_type = d->cast._to;
 
-        returnExprs.primitives[returnExprs.n] = d;
-        returnExprs.n++;
+        returnExprs.push(d, &spans);
         break;
     }
         
@@ -1251,7 +1260,7 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
     
     // convert initialization to assignment
     case Node::NODE_DECLARATION:{
-        std::vector <MIR_Primitive*> prims;
+        MIR_Primitives prims = {};
         
         Declaration* d = (Declaration*) current;
         for (auto const &decln : d->decln){
@@ -1270,18 +1279,11 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
                 assignment.binary.right = decln.initValue;
                 assignment.type = decln.type;
 
-                MIR_Primitives convertedExprs = transformSubexpr(&assignment, scope, arena);
-                
-                for (int i=0; i<convertedExprs.n; i++){
-                    prims.push_back(convertedExprs.primitives[i]);
-                }
+                prims.append(transformSubexpr(&assignment, scope, arena), &spans);
             }
 
         }
-        for (int i=0; i<prims.size(); i++){
-            scratchPad[i] = prims[i];
-        }
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = int(prims.size())};
+        return prims;
         break;
     }
 
@@ -1306,12 +1308,11 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
         for (auto const &AST_stmt : block->statements){
             MIR_Primitives stmts = transformNode(AST_stmt, block, arena, mir);
             for (int i = 0; i < stmts.n; i++) {
-                mir->statements.push_back(stmts.primitives[i]);
+                mir->statements.push_back(stmts[i]);
             }
         }
 
-        scratchPad[0] = mir;
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = 1};
+        return MIR_Primitives{.inlined = {mir}, .n = 1};
         break;
     }
 
@@ -1325,15 +1326,14 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
         
         MIR_Primitives retVal = transformSubexpr(AST_rnode->returnVal, scope, arena);
         assert(retVal.n == 1);
-        rnode->returnValue = (MIR_Expr*)retVal.primitives[0];
+        rnode->returnValue = (MIR_Expr*)retVal[0];
         rnode->funcName = parentFunc->funcName.string;
 
         // type cast to the return type
         MIR_Datatype retType = convertToLowerLevelType(ast->functions.getInfo(parentFunc->funcName.string).info.returnType, scope);
         rnode->returnValue = typeCastTo(rnode->returnValue, retType, arena);
         
-        scratchPad[0] = rnode;
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = 1};
+        return MIR_Primitives{.inlined = {rnode}, .n = 1};
         break;
     }
     
@@ -1359,16 +1359,16 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
             if (AST_current->condition) {
                 MIR_Primitives exprs = transformSubexpr(AST_current->condition, scope, arena);
                 assert(exprs.n == 1);
-                condition = (MIR_Expr*) exprs.primitives[0];
+                condition = (MIR_Expr*) exprs[0];
             }
             
             MIR_Primitives stmts = transformNode(AST_current->block, scope, arena, mScope);
             assert(stmts.n == 1);
-            assert(stmts.primitives[0]->ptag == MIR_Primitive::PRIM_SCOPE);
+            assert(stmts[0]->ptag == MIR_Primitive::PRIM_SCOPE);
             
             (*inode)->ptag = MIR_Primitive::PRIM_IF;
             (*inode)->condition = typeCastTo(condition, MIR_Datatypes::_bool, arena);
-            (*inode)->scope = (MIR_Scope*) stmts.primitives[0]; 
+            (*inode)->scope = (MIR_Scope*) stmts[0]; 
             (*inode)->next = NULL;
             (*inode)->scope->extraInfo = *inode;
             
@@ -1379,8 +1379,7 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
             AST_current = AST_current->nextIf;
         }
         
-        scratchPad[0] = start;
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = 1};
+        return MIR_Primitives{.inlined = {start}, .n = 1};
         break;
     }
 
@@ -1392,17 +1391,17 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
 
         MIR_Primitives exprs = transformSubexpr(AST_wnode->condition, scope, arena);
         assert(exprs.n == 1);
-        MIR_Expr* condition = (MIR_Expr*) exprs.primitives[0];
+        MIR_Expr* condition = (MIR_Expr*) exprs[0];
         
         MIR_Primitives stmts = transformNode(AST_wnode->block, scope, arena, mScope);
         assert(stmts.n == 1);
-        assert(stmts.primitives[0]->ptag == MIR_Primitive::PRIM_SCOPE);
+        assert(stmts[0]->ptag == MIR_Primitive::PRIM_SCOPE);
         
         loop->ptag = MIR_Primitive::PRIM_LOOP;
         loop->condition = typeCastTo(condition, MIR_Datatypes::_bool, arena);
         loop->update = 0;
 
-        loop->scope = (MIR_Scope*) stmts.primitives[0];
+        loop->scope = (MIR_Scope*) stmts[0];
         loop->scope->extraInfo = loop;
 
         loop->startLabel = labeller.label(); 
@@ -1410,8 +1409,7 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
         loop->endLabel = labeller.label(); 
 
 
-        scratchPad[0] = loop;
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = 1};
+        return MIR_Primitives{.inlined = {loop}, .n = 1};
         break;
     }
     
@@ -1424,21 +1422,21 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
 
         MIR_Primitives exprs = transformSubexpr(AST_fnode->exitCondition, scope, arena);
         assert(exprs.n == 1);
-        MIR_Expr* condition = (MIR_Expr*) exprs.primitives[0];
+        MIR_Expr* condition = (MIR_Expr*) exprs[0];
         
         exprs = transformSubexpr(AST_fnode->update, scope, arena);
         assert(exprs.n == 1);
-        MIR_Expr* update = (MIR_Expr*) exprs.primitives[0];
+        MIR_Expr* update = (MIR_Expr*) exprs[0];
         
         MIR_Primitives stmts = transformNode(AST_fnode->block, scope, arena, mScope);
         assert(stmts.n == 1);
-        assert(stmts.primitives[0]->ptag == MIR_Primitive::PRIM_SCOPE);
+        assert(stmts[0]->ptag == MIR_Primitive::PRIM_SCOPE);
         
         loop->ptag = MIR_Primitive::PRIM_LOOP;
         loop->condition = typeCastTo(condition, MIR_Datatypes::_bool, arena);
         loop->update = update;
         
-        loop->scope = (MIR_Scope*) stmts.primitives[0];
+        loop->scope = (MIR_Scope*) stmts[0];
         loop->scope->extraInfo = loop;
         
         loop->startLabel = labeller.label(); 
@@ -1448,12 +1446,10 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
         // the init statement
         stmts = transformNode(AST_fnode->init, scope, arena, mScope);
         assert(stmts.n == 1);
-        MIR_Primitive* initStmt = stmts.primitives[0];
+        MIR_Primitive* initStmt = stmts[0];
 
 
-        scratchPad[0] = initStmt;
-        scratchPad[1] = loop;
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = 2};
+        return MIR_Primitives{.inlined = {initStmt, loop}, .n = 2};
         break;
     }
     
@@ -1462,8 +1458,7 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
         jmp->ptag = MIR_Primitive::PRIM_UNSPECIFIED;
         jmp->tag = MIR_Intermediate::PRIM_INTERMEDIATE_JUMP_BREAK;
         
-        scratchPad[0] = jmp;
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = 1};
+        return MIR_Primitives{.inlined = {jmp}, .n = 1};
         break;
     }
     case Node::NODE_CONTINUE:{
@@ -1471,8 +1466,7 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
         jmp->ptag = MIR_Primitive::PRIM_UNSPECIFIED;
         jmp->tag = MIR_Intermediate::PRIM_INTERMEDIATE_JUMP_CONTINUE;
         
-        scratchPad[0] = jmp;
-        return MIR_Primitives{.primitives = (MIR_Primitive**)&scratchPad[0], .n = 1};
+        return MIR_Primitives{.inlined = {jmp}, .n = 1};
         break;
     }
 
@@ -1484,9 +1478,6 @@ MIR_Primitives MiddleEnd :: transformNode(const Node* current, StatementBlock *s
     return MIR_Primitives{.n = 0};
 }
 
-int rbeaks = 0;
-int ocntinues = 0;
-
 MIR_Primitive* MiddleEnd :: resolveJumpLabels(MIR_Primitive* p, MIR_Scope* mScope, Arena *arena){
     if (!p){
         return p;
@@ -1518,11 +1509,9 @@ MIR_Primitive* MiddleEnd :: resolveJumpLabels(MIR_Primitive* p, MIR_Scope* mScop
         jmp->ptag = MIR_Primitive::PRIM_JUMP;
 
         if (unresolvedJmp->tag == MIR_Intermediate::PRIM_INTERMEDIATE_JUMP_CONTINUE){
-            ocntinues++;
             jmp->jumpLabel = loop->updateLabel;
         }
         else if (unresolvedJmp->tag == MIR_Intermediate::PRIM_INTERMEDIATE_JUMP_BREAK){
-            rbeaks++;
             jmp->jumpLabel = loop->endLabel;
         }
         
@@ -1586,17 +1575,30 @@ MIR* transform(AST *ast, Arena *arena){
     middleEnd.ast = ast;
     middleEnd.mir = new MIR;
     middleEnd.labeller = Labeller{0};
+    middleEnd.spans.init(PAGE_SIZE);
+    middleEnd.spans.createFrame();
     
     MIR_Primitives global = middleEnd.transformNode(&ast->global, NULL, arena, NULL);
-    assert(global.n == 1 && global.primitives[0]->ptag == MIR_Primitive::PRIM_SCOPE);
-    middleEnd.mir->global = (MIR_Scope*) global.primitives[0];
+    assert(global.n == 1 && global[0]->ptag == MIR_Primitive::PRIM_SCOPE);
+    middleEnd.mir->global = (MIR_Scope*) global[0];
 
 
     for (auto &func: ast->functions.entries){
+        DeferredBody *deferredBody = func.second.info.deferredBody;
+        bool isReused = deferredBody && deferredBody->isReused;
+
+        // a body skipped by the parser is parsed once it is reached, unless its code is reused as is
+        if (deferredBody && !isReused && !ast->parseDeferredBody(ast->parser, &func.second.info)){
+            middleEnd.spans.destroyFrame();
+            middleEnd.spans.destroy();
+            return NULL;
+        }
         Function foo = func.second.info;
         
         MIR_Function f;
         f.funcName = foo.funcName.string;
+        f.isReused = false;
+        f.firstLabel = middleEnd.labeller.number;
         f.returnType = middleEnd.convertToLowerLevelType(foo.returnType, &ast->global);
         for (auto &param: foo.parameters) {
             f.parameters.push_back(MIR_Function::Parameter{
@@ -1608,10 +1610,20 @@ MIR* transform(AST *ast, Arena *arena){
         // if function definition doesnt exist, then no need to generate
         f.isExtern = true;
 
-        if (foo.block){
+        // the reused code only needs the labels it was generated with to be given to it again
+        if (isReused){
+            middleEnd.labeller.number += deferredBody->reusedLabels;
+            f.ptag = MIR_Primitive::PRIM_SCOPE;
+            f.isReused = true;
+            f.isExtern = false;
+        }
+        else if (foo.block){
+            // the spans of the body are dropped once it is lowered, only the MIR it was lowered to is kept
+            middleEnd.spans.createFrame();
             MIR_Primitives scopeNode = middleEnd.transformNode(foo.block, &ast->global, arena, middleEnd.mir->global);
-            assert(scopeNode.n == 1 && scopeNode.primitives[0]->ptag == MIR_Primitive::PRIM_SCOPE);
-            MIR_Scope* scope = (MIR_Scope*) scopeNode.primitives[0];
+            assert(scopeNode.n == 1 && scopeNode[0]->ptag == MIR_Primitive::PRIM_SCOPE);
+            MIR_Scope* scope = (MIR_Scope*) scopeNode[0];
+            middleEnd.spans.destroyFrame();
             
             middleEnd.resolveJumps(scope, middleEnd.mir->global, arena);
 
@@ -1624,9 +1636,12 @@ MIR* transform(AST *ast, Arena *arena){
             f.ptag = MIR_Primitive::PRIM_SCOPE;
             f.isExtern = false;
         }
+        f.endLabel = middleEnd.labeller.number;
 
         middleEnd.mir->functions.add(f.funcName, f);
     }
 
+    middleEnd.spans.destroyFrame();
+    middleEnd.spans.destroy();
     return middleEnd.mir;
 }
@@ -3,6 +3,7 @@
 #include "node.h"
 #include "datatype.h"
 #include "mir-datatype.h"
+#include "number.h"
 #include <arena/arena.h>
 
 #include "label.h"
@@ -223,10 +224,14 @@ struct MIR_Expr : public MIR_Primitive{
 
         /*
             A leaf node with the immediate value token.
-            val    : The immediate value. 
+            val    : The text of the immediate value, the string itself for string literals. 
+                     Immediates made by constant folding have no text (NULL data).
+            number : The value decoded by the tokenizer (unused for string literals). Floating point values are converted
+                     to _type, integer literals keep their whole 64 bit value typed _i64 (see numberFromLiteral).
         */
         struct {
             Splice val;
+            Number number;
         }immediate;
         
 
@@ -314,6 +319,11 @@ struct MIR_Function : public MIR_Scope{
     MIR_Datatype returnType;
     Splice funcName; 
     bool isExtern;
+    // the code of the function is reused from the last build by the code generator, the function has no statements
+    bool isReused;
+    // the labels of the blocks of the function are [firstLabel, endLabel)
+    Label firstLabel;
+    Label endLabel;
 
     struct Parameter{
         MIR_Datatype type;
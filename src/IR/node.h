@@ -3,7 +3,7 @@
 #include <tokenizer/token.h>
 #include "symbol-table.h"
 #include "datatype.h"
-#include <vector>
+#include <arena/arena-allocator.h>
 
 
 
@@ -53,7 +53,9 @@ struct Subexpr: public Node{
         SUBEXPR_INITIALIZER_LIST,
     }subtag;
     
+    // type of the expression, set when the expression is first checked and reused by later checks
     DataType type;
+    bool isTypeChecked = false;
 
     union{
         // binary: left op right
@@ -90,7 +92,7 @@ struct Subexpr: public Node{
 
 
 struct InitializerList {
-    std::vector <Subexpr*> values;
+    ArenaVector<Subexpr*> values;
 };
 
 
@@ -102,7 +104,7 @@ struct Declaration: public Node{
         Token identifier;
         Subexpr *initValue;
     };
-    std::vector<DeclInfo> decln;
+    ArenaVector<DeclInfo> decln;
 };
 
 struct Composite: public Node{
@@ -119,6 +121,10 @@ struct Composite: public Node{
     };
 
     SymbolTableOrdered<MemberInfo> members;
+
+    void init(Arena *arena){
+        members.init(arena);
+    }
 };
 
 struct EnumValue{
@@ -147,7 +153,7 @@ struct StatementBlock: public Node{
     };
 
 
-    std::vector<Node *> statements;
+    ArenaVector<Node *> statements;
     SymbolTableOrdered<DataType> symbols;
     SymbolTableOrdered<Composite> composites;
     SymbolTable<TypedefInfo> typedefs;
@@ -156,6 +162,16 @@ struct StatementBlock: public Node{
     StatementBlock *parent;
     
 
+    // the statements and symbol tables of the block grow in the arena
+    void init(Arena *arena){
+        statements = decltype(statements)(arena);
+        symbols.init(arena);
+        composites.init(arena);
+        typedefs.init(arena);
+        enumValues.init(arena);
+        enumClasses.init(arena);
+    }
+
 
     StatementBlock* getParentFunction(){
         StatementBlock *currentScope = this;
@@ -229,6 +245,23 @@ struct StatementBlock: public Node{
 
 };
 
+/*
+    Body of a function definition that was skipped over by the parser, to be parsed when it is needed.
+*/
+struct DeferredBody{
+    // the opening brace of the body
+    Token start;
+    // the names bound in the global scope when the body was skipped, the ones bound later are not visible to it
+    uint32_t scopeMark;
+    // index of the token after the closing brace
+    uint32_t end;
+    // set by an incremental build when the code of the body is reused from the last build (see BuildCache),
+    // the body is then neither parsed nor transformed, and its blocks take reusedLabels labels
+    bool isReused;
+    uint64_t reusedLabels;
+};
+
+
 struct Function: public Node{
     DataType returnType;
     Token funcName;
@@ -237,16 +270,22 @@ struct Function: public Node{
         DataType type;
         Token identifier;
     };
-    std::vector<Parameter> parameters;
+    ArenaVector<Parameter> parameters;
     bool isVariadic;
 
     StatementBlock *block;
+    // set for a definition whose body has not been parsed yet, the block is NULL until then
+    DeferredBody *deferredBody;
+
+    bool isDefined(){
+        return block || deferredBody;
+    }
 };
 
 
 struct FunctionCall{
     Token funcName; 
-    std::vector<Subexpr*> arguments; 
+    ArenaVector<Subexpr*> arguments; 
 };
 
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mir-datatype.h"
+#include <tokenizer/token.h>
 #include <stdint.h>
 #include <cstdlib>
 
@@ -23,9 +24,65 @@ struct Number{
 };
 
 
-Number f32FromString(const char* value){
-    return Number{.type = MIR_Datatypes::_f32, .f32 = {strtof(value, NULL)}};
+/*
+    Convert a number to a given type.
+    Integers are kept in the whole 64 bits, sign or zero extended from the size of their type.
+*/
+static Number castNumber(Number n, MIR_Datatype to){
+    Number result = {.type = to, .u64 = {0}};
+
+    if (to.tag == MIR_Datatype::TYPE_F32){
+        if (n.type.tag == MIR_Datatype::TYPE_F32)       result.f32[0] = n.f32[0];
+        else if (n.type.tag == MIR_Datatype::TYPE_F64)  result.f32[0] = (float)n.f64[0];
+        else if (isUnsigned(n.type))                    result.f32[0] = (float)n.u64[0];
+        else                                            result.f32[0] = (float)n.i64[0];
+        return result;
+    }
+    if (to.tag == MIR_Datatype::TYPE_F64){
+        if (n.type.tag == MIR_Datatype::TYPE_F32)       result.f64[0] = n.f32[0];
+        else if (n.type.tag == MIR_Datatype::TYPE_F64)  result.f64[0] = n.f64[0];
+        else if (isUnsigned(n.type))                    result.f64[0] = (double)n.u64[0];
+        else                                            result.f64[0] = (double)n.i64[0];
+        return result;
+    }
+
+    // integer types
+    if (n.type.tag == MIR_Datatype::TYPE_F32)       result.i64[0] = (int64_t)n.f32[0];
+    else if (n.type.tag == MIR_Datatype::TYPE_F64)  result.i64[0] = (int64_t)n.f64[0];
+    else                                            result.i64[0] = n.i64[0];
+
+    if (to.tag == MIR_Datatype::TYPE_BOOL){
+        result.u64[0] = (result.u64[0] != 0);
+    }
+    else if (to.size > 0 && to.size < 8){
+        int shift = 64 - to.size * 8;
+        if (isUnsigned(to)){
+            result.u64[0] = (result.u64[0] << shift) >> shift;
+        }
+        else {
+            result.i64[0] = (int64_t)(result.u64[0] << shift) >> shift;
+        }
+    }
+    return result;
 }
-Number f64FromString(const char* value){
-    return Number{.type = MIR_Datatypes::_f64, .f64 = {strtod(value, NULL)}};
+
+
+/*
+    Number of given type, from the value of a numeric or character literal token decoded by the tokenizer.
+    Integer literals keep all 64 bits of their value, as the front end types every integer literal as int,
+    even the ones that need a wider type.
+*/
+static Number numberFromLiteral(const Token &literal, MIR_Datatype type){
+    Number n = {.type = MIR_Datatypes::_i64, .i64 = {literal.value.i64}};
+    if (isIntegerType(type) && literal.type != TOKEN_NUMERIC_FLOAT && literal.type != TOKEN_NUMERIC_DOUBLE){
+        return n;
+    }
+
+    if (literal.type == TOKEN_NUMERIC_FLOAT){
+        n = Number{.type = MIR_Datatypes::_f32, .f32 = {literal.value.f32, 0}};
+    }
+    else if (literal.type == TOKEN_NUMERIC_DOUBLE){
+        n = Number{.type = MIR_Datatypes::_f64, .f64 = {literal.value.f64}};
+    }
+    return castNumber(n, type);
 }
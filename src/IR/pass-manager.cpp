@@ -0,0 +1,225 @@
+#include "pass-manager.h"
+#include "passes.h"
+#include <chrono>
+#include <string.h>
+
+
+/*
+    All the passes, in the order they are run.
+    Every pass is cheap enough for -O1, so -O2 runs the same passes for now.
+*/
+static const Pass passTable[] = {
+    {"unreachable-code", "remove the statements after a return, break or continue", 1, removeUnreachableCode, NULL},
+    {"constant-folding", "fold the operations on constants and propagate the constant locals through straight-line code", 1, foldConstants, NULL},
+    {"dead-expressions", "remove the expression statements without side effects", 1, removeDeadExpressions, NULL},
+};
+
+static const size_t nPasses = sizeof(passTable) / sizeof(passTable[0]);
+
+
+
+static size_t countExprNodes(MIR_Expr *e){
+    if (!e){
+        return 0;
+    }
+
+    switch (e->tag){
+    case MIR_Expr::EXPR_STORE:
+        return 1 + countExprNodes(e->store.left) + countExprNodes(e->store.right);
+    case MIR_Expr::EXPR_LOAD:
+        return 1 + countExprNodes(e->load.base);
+    case MIR_Expr::EXPR_INDEX:
+        return 1 + countExprNodes(e->index.base) + countExprNodes(e->index.index);
+    case MIR_Expr::EXPR_LOAD_ADDRESS:
+        return 1 + countExprNodes(e->loadAddress.base);
+    case MIR_Expr::EXPR_CAST:
+        return 1 + countExprNodes(e->cast.expr);
+    case MIR_Expr::EXPR_BINARY:
+        return 1 + countExprNodes(e->binary.left) + countExprNodes(e->binary.right);
+    case MIR_Expr::EXPR_UNARY:
+        return 1 + countExprNodes(e->unary.expr);
+    case MIR_Expr::EXPR_CALL:{
+        size_t count = 1;
+        for (MIR_Expr *arg : e->functionCall->arguments){
+            count += countExprNodes(arg);
+        }
+        return count;
+    }
+    default:
+        return 1;
+    }
+}
+
+
+size_t countMIRNodes(MIR_Primitive *p){
+    if (!p){
+        return 0;
+    }
+
+    switch (p->ptag){
+    case MIR_Primitive::PRIM_SCOPE:{
+        size_t count = 1;
+        for (MIR_Primitive *statement : ((MIR_Scope*) p)->statements){
+            count += countMIRNodes(statement);
+        }
+        return count;
+    }
+    case MIR_Primitive::PRIM_IF:{
+        size_t count = 0;
+        for (MIR_If *inode = (MIR_If*) p; inode; inode = inode->next){
+            count += 1 + countExprNodes(inode->condition) + countMIRNodes(inode->scope);
+        }
+        return count;
+    }
+    case MIR_Primitive::PRIM_LOOP:{
+        MIR_Loop *lnode = (MIR_Loop*) p;
+        return 1 + countExprNodes(lnode->condition) + countExprNodes(lnode->update) + countMIRNodes(lnode->scope);
+    }
+    case MIR_Primitive::PRIM_RETURN:
+        return 1 + countExprNodes(((MIR_Return*) p)->returnValue);
+    case MIR_Primitive::PRIM_EXPR:
+        return countExprNodes((MIR_Expr*) p);
+    default:
+        return 1;
+    }
+}
+
+
+static size_t countModuleNodes(MIR *mir){
+    size_t count = countMIRNodes(mir->global);
+    for (auto &entry : mir->functions.entries){
+        MIR_Function &foo = entry.second.info;
+        if (!foo.isExtern && !foo.isReused){
+            count += countMIRNodes((MIR_Scope*) &foo);
+        }
+    }
+    return count;
+}
+
+
+
+void PassManager::init(int optLevel){
+    this->passes.clear();
+    this->enabled.clear();
+    for (size_t i = 0; i < nPasses; i++){
+        this->passes.push_back(&passTable[i]);
+        this->enabled.push_back(passTable[i].level <= optLevel);
+    }
+    this->statistics.assign(nPasses, Statistics{});
+}
+
+
+bool PassManager::setPasses(const char *list){
+    const char *cursor = list;
+
+    while (*cursor){
+        const char *end = strchr(cursor, ',');
+        size_t len = end? end - cursor : strlen(cursor);
+
+        bool enable = true;
+        if (len > 0 && cursor[0] == '-'){
+            enable = false;
+            cursor++;
+            len--;
+        }
+
+        if (enable && len == 4 && strncmp(cursor, "none", 4) == 0){
+            this->enabled.assign(this->passes.size(), false);
+        }
+        else if (len > 0){
+            bool found = false;
+            for (size_t i = 0; i < this->passes.size(); i++){
+                if (strlen(this->passes[i]->name) == len && strncmp(this->passes[i]->name, cursor, len) == 0){
+                    this->enabled[i] = enable;
+                    found = true;
+                }
+            }
+            if (!found){
+                fprintf(stderr, "Unknown pass \"%.*s\", the passes are:\n", (int) len, cursor);
+                this->printPasses(stderr);
+                return false;
+            }
+        }
+
+        cursor += len;
+        if (*cursor == ','){
+            cursor++;
+        }
+    }
+    return true;
+}
+
+
+void PassManager::run(MIR *mir, Arena *arena){
+    for (size_t i = 0; i < this->passes.size(); i++){
+        if (!this->enabled[i]){
+            continue;
+        }
+        const Pass *pass = this->passes[i];
+        Statistics &stats = this->statistics[i];
+
+        // counting the nodes is a walk of the whole MIR, only done when the statistics are printed
+        if (this->timePasses){
+            stats.nodesBefore = countModuleNodes(mir);
+        }
+        auto start = std::chrono::steady_clock::now();
+
+        bool changed = false;
+        if (pass->runOnModule){
+            changed = pass->runOnModule(mir, arena) || changed;
+        }
+        if (pass->runOnFunction){
+            for (auto &entry : mir->functions.entries){
+                MIR_Function &foo = entry.second.info;
+                if (foo.isExtern || foo.isReused){
+                    continue;
+                }
+                changed = pass->runOnFunction(mir, &foo, arena) || changed;
+            }
+        }
+
+        stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.runs++;
+        stats.changed += changed;
+        if (this->timePasses){
+            stats.nodesAfter = countModuleNodes(mir);
+        }
+    }
+}
+
+
+std::string PassManager::pipeline(){
+    std::string names;
+    for (size_t i = 0; i < this->passes.size(); i++){
+        if (this->enabled[i]){
+            if (!names.empty()){
+                names += ",";
+            }
+            names += this->passes[i]->name;
+        }
+    }
+    return names;
+}
+
+
+void PassManager::printStatistics(FILE *out){
+    double total = 0;
+    fprintf(out, "[Passes] %-20s %10s %12s %12s %8s\n", "pass", "time (ms)", "nodes before", "nodes after", "changed");
+    for (size_t i = 0; i < this->passes.size(); i++){
+        if (!this->enabled[i]){
+            continue;
+        }
+        Statistics &stats = this->statistics[i];
+        fprintf(out, "[Passes] %-20s %10.3f %12zu %12zu %8s\n", this->passes[i]->name, stats.milliseconds, 
+                stats.nodesBefore, stats.nodesAfter, stats.changed? "yes" : "no");
+        total += stats.milliseconds;
+    }
+    fprintf(out, "[Passes] %-20s %10.3f\n", "total", total);
+}
+
+
+void PassManager::printPasses(FILE *out){
+    for (size_t i = 0; i < this->passes.size(); i++){
+        fprintf(out, "    %-20s -O%d  %s\n", this->passes[i]->name, this->passes[i]->level, this->passes[i]->description);
+    }
+}
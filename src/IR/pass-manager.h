@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ir.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+/*
+    An optimization pass over the MIR. Function passes are run on each function with a body,
+    module passes once on the whole MIR. Both return whether they changed the MIR.
+*/
+struct Pass{
+    const char *name;
+    const char *description;
+    // the lowest -O level the pass is run at
+    int level;
+    bool (*runOnFunction)(MIR *mir, MIR_Function *foo, Arena *arena);
+    bool (*runOnModule)(MIR *mir, Arena *arena);
+};
+
+
+/*
+    Runs the passes enabled by the -O level and the -fpass overrides over the MIR, between transform() and
+    the code generator, in the order of the pass table (see pass-manager.cpp). With timePasses it keeps the
+    time taken by each pass, the number of MIR nodes before and after it, and how many runs changed the MIR.
+*/
+struct PassManager{
+    struct Statistics{
+        double milliseconds;
+        size_t nodesBefore;
+        size_t nodesAfter;
+        size_t runs;
+        size_t changed;
+    };
+
+    std::vector<const Pass *> passes;
+    std::vector<bool> enabled;
+    std::vector<Statistics> statistics;
+    bool timePasses = false;
+
+    void init(int optLevel);
+    // apply a -fpass list: "name" enables a pass, "-name" disables it, "none" disables all of them
+    bool setPasses(const char *list);
+    void run(MIR *mir, Arena *arena);
+
+    // the enabled passes, in the order they are run
+    std::string pipeline();
+    void printStatistics(FILE *out);
+    void printPasses(FILE *out);
+};
+
+
+// number of MIR nodes in a tree, the size of the MIR reported for the passes
+size_t countMIRNodes(MIR_Primitive *p);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ir.h"
+
+
+/*
+    The optimization passes over the MIR, run by the pass manager (see pass-manager.cpp for the order and levels).
+    Each returns whether it changed the MIR.
+*/
+
+// dead-code.cpp
+bool removeUnreachableCode(MIR *mir, MIR_Function *foo, Arena *arena);
+bool removeDeadExpressions(MIR *mir, MIR_Function *foo, Arena *arena);
+
+// fold-constants.cpp
+bool foldConstants(MIR *mir, MIR_Function *foo, Arena *arena);
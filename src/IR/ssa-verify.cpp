@@ -0,0 +1,259 @@
+#include "ssa.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+
+/*
+    Checks a function in SSA form:
+        - each block ends with its only terminator, jumping to blocks of the function, and the predecessors
+          of each block are the blocks jumping to it
+        - the phis are at the start of their block, with one value for each predecessor
+        - each value is defined once, with the type recorded for it, and each definition dominates its uses
+        - the operands are of the register file the instruction expects
+*/
+struct SSA_Verifier{
+    SSA_Function *f;
+    size_t errors = 0;
+
+    // where each value is defined
+    std::vector<int64_t> defBlock;
+    std::vector<size_t> defIndex;
+
+    void error(SSA_BlockId b, const char *format, ...){
+        va_list args;
+        va_start(args, format);
+        fprintf(stderr, "[SSA] %.*s: block %u: ", (int) f->funcName.len, f->funcName.data, b);
+        vfprintf(stderr, format, args);
+        fprintf(stderr, "\n");
+        va_end(args);
+        errors++;
+    }
+
+    bool dominates(SSA_BlockId a, SSA_BlockId b){
+        while (b != a && b != 0 && b < f->blocks.size()){
+            b = f->blocks[b].idom;
+        }
+        return b == a;
+    }
+
+    void checkBlocks(){
+        size_t nBlocks = f->blocks.size();
+        if (nBlocks == 0){
+            error(0, "the function has no blocks");
+            return;
+        }
+        if (!f->blocks[0].predecessors.empty()){
+            error(0, "the entry block has predecessors");
+        }
+
+        // the number of edges from each block to each of its successors
+        std::vector<std::vector<SSA_BlockId>> successorsOf(nBlocks);
+        for (SSA_BlockId b = 0; b < nBlocks; b++){
+            SSA_Block &block = f->blocks[b];
+            if (block.instructions.empty() || !block.terminator().isTerminator()){
+                error(b, "does not end with a terminator");
+                continue;
+            }
+            for (size_t i = 0; i + 1 < block.instructions.size(); i++){
+                if (block.instructions[i].isTerminator()){
+                    error(b, "terminator before the end of the block, instruction %zu", i);
+                }
+            }
+
+            SSA_Instruction &t = block.terminator();
+            for (int i = 0; i < t.nSuccessors(); i++){
+                if (t.target[i] >= nBlocks){
+                    error(b, "jumps to block %u out of the function", t.target[i]);
+                    continue;
+                }
+                successorsOf[b].push_back(t.target[i]);
+            }
+        }
+
+        for (SSA_BlockId b = 0; b < nBlocks; b++){
+            for (SSA_BlockId s : successorsOf[b]){
+                size_t edges = 0, listed = 0;
+                for (SSA_BlockId other : successorsOf[b]){
+                    edges += other == s;
+                }
+                for (SSA_BlockId p : f->blocks[s].predecessors){
+                    listed += p == b;
+                }
+                if (edges != listed){
+                    error(s, "block %u jumps to it %zu times but is listed %zu times as predecessor", b, edges, listed);
+                }
+            }
+            for (SSA_BlockId p : f->blocks[b].predecessors){
+                bool isEdge = false;
+                for (SSA_BlockId s : p < nBlocks? successorsOf[p] : std::vector<SSA_BlockId>()){
+                    isEdge = isEdge || s == b;
+                }
+                if (!isEdge){
+                    error(b, "predecessor %u does not jump to it", p);
+                }
+            }
+        }
+    }
+
+    void checkDefinitions(){
+        defBlock.assign(f->nValues(), -1);
+        defIndex.assign(f->nValues(), 0);
+
+        for (SSA_BlockId b = 0; b < f->blocks.size(); b++){
+            SSA_Block &block = f->blocks[b];
+            bool isPhiAllowed = true;
+
+            for (size_t i = 0; i < block.instructions.size(); i++){
+                SSA_Instruction &ins = block.instructions[i];
+
+                if (ins.op == SSA_Instruction::SSA_READ_VARIABLE || ins.op == SSA_Instruction::SSA_WRITE_VARIABLE){
+                    error(b, "variable access left in instruction %zu", i);
+                }
+                if (ins.op == SSA_Instruction::SSA_PHI){
+                    if (!isPhiAllowed){
+                        error(b, "phi after the start of the block, instruction %zu", i);
+                    }
+                    if (ins.nArgs != block.predecessors.size()){
+                        error(b, "phi %%%u has %u values for %zu predecessors", ins.dest, ins.nArgs, block.predecessors.size());
+                    }
+                }
+                else {
+                    isPhiAllowed = false;
+                }
+                if ((ins.op == SSA_Instruction::SSA_CALL || ins.op == SSA_Instruction::SSA_PHI) && ins.firstArg + ins.nArgs > f->args.size()){
+                    error(b, "operands of instruction %zu out of the function", i);
+                    ins.nArgs = 0;
+                }
+
+                if (ins.dest == SSA_NO_VALUE){
+                    continue;
+                }
+                if (ins.dest >= f->nValues()){
+                    error(b, "instruction %zu defines the unknown value %%%u", i, ins.dest);
+                    continue;
+                }
+                if (defBlock[ins.dest] >= 0){
+                    error(b, "value %%%u defined again, first defined in block %lld", ins.dest, (long long) defBlock[ins.dest]);
+                    continue;
+                }
+                if (f->valueTypes[ins.dest].tag != ins.type.tag){
+                    error(b, "value %%%u defined as %s, recorded as %s", ins.dest, ins.type.name, f->valueTypes[ins.dest].name);
+                }
+                defBlock[ins.dest] = b;
+                defIndex[ins.dest] = i;
+            }
+        }
+    }
+
+    void checkUses(){
+        computeDominators(f);
+
+        for (SSA_BlockId b = 0; b < f->blocks.size(); b++){
+            SSA_Block &block = f->blocks[b];
+            if (block.idom >= f->blocks.size()){
+                error(b, "can't be reached from the entry");
+                continue;
+            }
+
+            for (size_t i = 0; i < block.instructions.size(); i++){
+                SSA_Instruction &ins = block.instructions[i];
+                size_t operandNo = 0;
+
+                f->forEachOperand(ins, [&](SSA_Value &v){
+                    size_t n = operandNo++;
+                    if (v == SSA_NO_VALUE || v >= f->nValues() || defBlock[v] < 0){
+                        error(b, "instruction %zu uses the undefined value %%%u", i, v);
+                        return;
+                    }
+
+                    // the values of a phi are used at the end of the predecessor they come from
+                    if (ins.op == SSA_Instruction::SSA_PHI){
+                        if (n < block.predecessors.size() && !dominates(defBlock[v], block.predecessors[n])){
+                            error(b, "phi %%%u uses %%%u which does not dominate predecessor %u", ins.dest, v, block.predecessors[n]);
+                        }
+                    }
+                    else if (defBlock[v] == b? defIndex[v] >= i : !dominates(defBlock[v], b)){
+                        error(b, "instruction %zu uses %%%u before its definition", i, v);
+                    }
+                });
+            }
+        }
+    }
+
+    void checkRegisterFiles(){
+        for (SSA_BlockId b = 0; b < f->blocks.size(); b++){
+            for (size_t i = 0; i < f->blocks[b].instructions.size(); i++){
+                SSA_Instruction &ins = f->blocks[b].instructions[i];
+
+                auto isFloat = [&](SSA_Value v){
+                    return v < f->nValues() && isFloatType(f->valueTypes[v]);
+                };
+                auto expectInteger = [&](SSA_Value v, const char *what){
+                    if (v != SSA_NO_VALUE && isFloat(v)){
+                        error(b, "instruction %zu takes a floating point %s %%%u", i, what, v);
+                    }
+                };
+
+                switch (ins.op){
+                case SSA_Instruction::SSA_LOAD:
+                case SSA_Instruction::SSA_BRANCH:
+                    expectInteger(ins.a, "operand");
+                    break;
+                case SSA_Instruction::SSA_STORE:
+                    expectInteger(ins.a, "address");
+                    if (ins.b != SSA_NO_VALUE && isFloat(ins.b) != isFloatType(ins.type)){
+                        error(b, "instruction %zu stores %%%u as %s", i, ins.b, ins.type.name);
+                    }
+                    break;
+                case SSA_Instruction::SSA_COPY_MEMORY:
+                    expectInteger(ins.a, "address");
+                    expectInteger(ins.b, "address");
+                    break;
+                case SSA_Instruction::SSA_BINARY:
+                case SSA_Instruction::SSA_UNARY:
+                case SSA_Instruction::SSA_COPY:
+                    // the operands of comparisons are of the register file of their operation, not of the result
+                    if (ins.a != SSA_NO_VALUE && ins.b != SSA_NO_VALUE && ins.op == SSA_Instruction::SSA_BINARY && isFloat(ins.a) != isFloat(ins.b)){
+                        error(b, "instruction %zu mixes register files", i);
+                    }
+                    break;
+                case SSA_Instruction::SSA_CAST:
+                    if (ins.a != SSA_NO_VALUE && isFloat(ins.a) != isFloatType(ins.from)){
+                        error(b, "instruction %zu casts %%%u from %s", i, ins.a, ins.from.name);
+                    }
+                    break;
+                case SSA_Instruction::SSA_PHI:
+                    for (uint32_t arg = 0; arg < ins.nArgs; arg++){
+                        SSA_Value v = f->args[ins.firstArg + arg];
+                        if (v != SSA_NO_VALUE && isFloat(v) != isFloatType(ins.type)){
+                            error(b, "phi %%%u merges %%%u of another register file", ins.dest, v);
+                        }
+                    }
+                    break;
+                case SSA_Instruction::SSA_RETURN:
+                    if (ins.a != SSA_NO_VALUE && isFloat(ins.a) != isFloatType(f->mir->returnType)){
+                        error(b, "returns %%%u as %s", ins.a, f->mir->returnType.name);
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+};
+
+
+bool verifySSA(SSA_Function *f){
+    SSA_Verifier verifier;
+    verifier.f = f;
+
+    verifier.checkBlocks();
+    // the rest needs a well formed graph
+    if (verifier.errors == 0){
+        verifier.checkDefinitions();
+        verifier.checkUses();
+        verifier.checkRegisterFiles();
+    }
+    return verifier.errors == 0;
+}
@@ -0,0 +1,980 @@
+#include "ssa.h"
+#include <tokenizer/atoms.h>
+#include <map>
+#include <unordered_map>
+#include <functional>
+
+
+static bool isScalarType(MIR_Datatype type){
+    return type.tag != MIR_Datatype::TYPE_ARRAY && type.size <= 8 && (isIntegerType(type) || isFloatType(type));
+}
+
+static SSA_Instruction makeInstruction(SSA_Instruction::Opcode op, MIR_Datatype type){
+    SSA_Instruction ins = {};
+    ins.op = op;
+    ins.type = type;
+    return ins;
+}
+
+
+/*
+    Lowers one MIR function to SSA form in three steps:
+    the MIR is lowered into blocks where the promoted variables are read and written with pseudo instructions,
+    the blocks that can't be reached from the entry are removed, then phis are placed on the iterated dominance
+    frontiers of the blocks writing each variable and the variables are renamed into values over the dominator tree.
+*/
+struct SSA_Builder{
+    MIR *mir;
+    SSA_Function *f;
+    Arena *arena;
+
+    SSA_BlockId current;
+    // set on meeting something the SSA form doesn't cover
+    bool unsupported = false;
+
+    struct Variable{
+        MIR_Datatype type;
+        bool promoted;
+        // stack slot of the variables left in memory, -1 until its address is used
+        int64_t slot;
+    };
+    std::vector<Variable> variables;
+    // the variable of each declaration, by the scope declaring it and its name
+    std::map<std::pair<MIR_Scope*, Atom>, uint32_t> declarations;
+    // the scopes being lowered, innermost last
+    std::vector<MIR_Scope*> scopes;
+    // the blocks jumped to by the labels of the function
+    std::unordered_map<Label, SSA_BlockId> labelBlocks;
+
+
+    SSA_BlockId newBlock(){
+        f->blocks.push_back(SSA_Block{
+            .instructions = ArenaVector<SSA_Instruction>(arena),
+            .predecessors = ArenaVector<SSA_BlockId>(arena),
+            .idom = 0
+        });
+        return f->blocks.size() - 1;
+    }
+
+    SSA_Value newValue(MIR_Datatype type){
+        f->valueTypes.push_back(type);
+        return f->valueTypes.size() - 1;
+    }
+
+    // append an instruction defining a new value to the current block
+    SSA_Value define(SSA_Instruction ins){
+        ins.dest = newValue(ins.type);
+        f->blocks[current].instructions.push_back(ins);
+        return ins.dest;
+    }
+
+    void append(SSA_Instruction ins){
+        ins.dest = SSA_NO_VALUE;
+        f->blocks[current].instructions.push_back(ins);
+    }
+
+    // end the current block, the code following a terminator is unreachable and goes into a block of its own
+    void terminate(SSA_Instruction ins){
+        append(ins);
+        current = newBlock();
+    }
+
+    void jumpTo(SSA_BlockId target){
+        SSA_Instruction jump = makeInstruction(SSA_Instruction::SSA_JUMP, MIR_Datatypes::_void);
+        jump.target[0] = target;
+        terminate(jump);
+    }
+
+    void branchTo(SSA_Value condition, SSA_BlockId ifTrue, SSA_BlockId ifFalse){
+        SSA_Instruction branch = makeInstruction(SSA_Instruction::SSA_BRANCH, MIR_Datatypes::_void);
+        branch.a = condition;
+        branch.target[0] = ifTrue;
+        branch.target[1] = ifFalse;
+        terminate(branch);
+    }
+
+    SSA_Value constant(int64_t value, MIR_Datatype type){
+        SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_CONST, type);
+        ins.imm = value;
+        return define(ins);
+    }
+
+    SSA_Value binary(MIR_Expr::BinaryOp op, SSA_Value left, SSA_Value right, MIR_Datatype type){
+        SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_BINARY, type);
+        ins.binary = op;
+        ins.a = left;
+        ins.b = right;
+        ins.size = type.size;
+        return define(ins);
+    }
+
+
+
+    /*
+        The variable a name refers to in the scopes being lowered, -1 for global variables.
+    */
+    int64_t resolve(Splice name){
+        for (size_t i = scopes.size(); i > 0; i--){
+            MIR_Scope *scope = scopes[i - 1];
+            if (scope->symbols.existKey(name)){
+                auto key = std::make_pair(scope, atomOf(name));
+                auto found = declarations.find(key);
+                if (found != declarations.end()){
+                    return found->second;
+                }
+
+                MIR_Datatype type = scope->symbols.getInfo(name).info;
+                variables.push_back(Variable{.type = type, .promoted = isScalarType(type), .slot = -1});
+                declarations[key] = variables.size() - 1;
+                return variables.size() - 1;
+            }
+        }
+        return -1;
+    }
+
+    /*
+        Find the variables that have to stay in memory: the ones that are not scalars,
+        and the ones accessed other than by loading or storing the whole variable.
+    */
+    void findMemoryVariables(MIR_Primitive *p){
+        if (!p){
+            return;
+        }
+
+        auto wholeAccess = [&](MIR_Expr *address, int64_t offset, size_t size, bool isFloat){
+            int64_t var = resolve(address->addressOf.symbol);
+            if (var < 0){
+                return;
+            }
+            Variable &v = variables[var];
+            if (offset != 0 || size != v.type.size || isFloat != isFloatType(v.type)){
+                v.promoted = false;
+            }
+        };
+
+        switch (p->ptag){
+        case MIR_Primitive::PRIM_IF:{
+            for (MIR_If *inode = (MIR_If*) p; inode; inode = inode->next){
+                findMemoryVariables(inode->condition);
+                findMemoryVariables(inode->scope);
+            }
+            break;
+        }
+        case MIR_Primitive::PRIM_LOOP:{
+            MIR_Loop *lnode = (MIR_Loop*) p;
+            findMemoryVariables(lnode->condition);
+            findMemoryVariables(lnode->scope);
+            findMemoryVariables(lnode->update);
+            break;
+        }
+        case MIR_Primitive::PRIM_RETURN:{
+            findMemoryVariables(((MIR_Return*) p)->returnValue);
+            break;
+        }
+        case MIR_Primitive::PRIM_SCOPE:{
+            MIR_Scope *scope = (MIR_Scope*) p;
+            scopes.push_back(scope);
+            for (MIR_Primitive *statement : scope->statements){
+                findMemoryVariables(statement);
+            }
+            scopes.pop_back();
+            break;
+        }
+        case MIR_Primitive::PRIM_EXPR:{
+            MIR_Expr *e = (MIR_Expr*) p;
+
+            switch (e->tag){
+            case MIR_Expr::EXPR_ADDRESSOF:{
+                // any other use of the address
+                int64_t var = resolve(e->addressOf.symbol);
+                if (var >= 0){
+                    variables[var].promoted = false;
+                }
+                break;
+            }
+            case MIR_Expr::EXPR_LOAD:{
+                if (e->load.base->tag == MIR_Expr::EXPR_ADDRESSOF){
+                    bool isWhole = e->load.type != MIR_Expr::LoadType::EXPR_MEMLOAD;
+                    wholeAccess(e->load.base, isWhole? e->load.offset : -1, e->load.size, e->load.type == MIR_Expr::LoadType::EXPR_FLOAD);
+                }
+                else {
+                    findMemoryVariables(e->load.base);
+                }
+                break;
+            }
+            case MIR_Expr::EXPR_STORE:{
+                if (e->store.left->tag == MIR_Expr::EXPR_ADDRESSOF){
+                    wholeAccess(e->store.left, e->store.offset, e->store.size, isFloatType(e->_type));
+                }
+                else {
+                    findMemoryVariables(e->store.left);
+                }
+                findMemoryVariables(e->store.right);
+                break;
+            }
+            case MIR_Expr::EXPR_INDEX:{
+                findMemoryVariables(e->index.base);
+                findMemoryVariables(e->index.index);
+                break;
+            }
+            case MIR_Expr::EXPR_LOAD_ADDRESS:{
+                findMemoryVariables(e->loadAddress.base);
+                break;
+            }
+            case MIR_Expr::EXPR_CALL:{
+                for (MIR_Expr *arg : e->functionCall->arguments){
+                    findMemoryVariables(arg);
+                }
+                break;
+            }
+            case MIR_Expr::EXPR_CAST:{
+                findMemoryVariables(e->cast.expr);
+                break;
+            }
+            case MIR_Expr::EXPR_BINARY:{
+                findMemoryVariables(e->binary.left);
+                findMemoryVariables(e->binary.right);
+                break;
+            }
+            case MIR_Expr::EXPR_UNARY:{
+                findMemoryVariables(e->unary.expr);
+                break;
+            }
+            default:
+                break;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+
+
+    /*
+        The address of a variable left in memory.
+    */
+    SSA_Value variableAddress(Splice name){
+        int64_t var = resolve(name);
+        if (var < 0){
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_GLOBAL_ADDRESS, MIR_Datatypes::_ptr);
+            ins.symbol = name;
+            return define(ins);
+        }
+
+        Variable &v = variables[var];
+        assert(!v.promoted);
+        if (v.slot < 0){
+            v.slot = f->slots.size();
+            f->slots.push_back(SSA_Function::Slot{.size = v.type.size, .alignment = v.type.alignment});
+        }
+        SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_SLOT_ADDRESS, MIR_Datatypes::_ptr);
+        ins.imm = v.slot;
+        return define(ins);
+    }
+
+    // the address of an address expression: a variable or a computed address
+    SSA_Value address(MIR_Expr *e){
+        if (e->tag == MIR_Expr::EXPR_ADDRESSOF){
+            return variableAddress(e->addressOf.symbol);
+        }
+        return lowerExpr(e);
+    }
+
+    // a + offset
+    SSA_Value offsetAddress(SSA_Value base, int64_t offset){
+        if (offset == 0){
+            return base;
+        }
+        return binary(MIR_Expr::BinaryOp::EXPR_IADD, base, constant(offset, MIR_Datatypes::_i64), MIR_Datatypes::_ptr);
+    }
+
+    // the variable of a name if it is promoted, else -1
+    int64_t promotedVariable(Splice name){
+        int64_t var = resolve(name);
+        if (var >= 0 && variables[var].promoted){
+            return var;
+        }
+        return -1;
+    }
+
+    // the variable an access is to if it is promoted, else -1
+    int64_t promotedVariable(MIR_Expr *address){
+        if (address->tag != MIR_Expr::EXPR_ADDRESSOF){
+            return -1;
+        }
+        return promotedVariable(address->addressOf.symbol);
+    }
+
+
+    /*
+        Lower an expression, returns its value. Expressions of struct types have no value,
+        only copying them from one address to another is lowered.
+    */
+    SSA_Value lowerExpr(MIR_Expr *e){
+        if (unsupported){
+            return SSA_NO_VALUE;
+        }
+
+        switch (e->tag){
+        case MIR_Expr::EXPR_LOAD_IMMEDIATE:{
+            // string literals are addresses in .rodata
+            if (e->_type.tag == MIR_Datatype::TYPE_PTR || e->_type.tag == MIR_Datatype::TYPE_ARRAY){
+                SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_STRING, MIR_Datatypes::_ptr);
+                ins.symbol = e->immediate.val;
+                ins.from = e->_type;
+                return define(ins);
+            }
+            if (isFloatType(e->_type)){
+                SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_FCONST, e->_type);
+                ins.number = e->immediate.number;
+                return define(ins);
+            }
+            return constant(e->immediate.number.i64[0], e->_type);
+        }
+
+        case MIR_Expr::EXPR_LOAD:{
+            if (e->load.type == MIR_Expr::LoadType::EXPR_MEMLOAD || !isScalarType(e->_type)){
+                unsupported = true;
+                return SSA_NO_VALUE;
+            }
+
+            int64_t var = promotedVariable(e->load.base);
+            if (var >= 0){
+                SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_READ_VARIABLE, variables[var].type);
+                ins.imm = var;
+                return define(ins);
+            }
+
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_LOAD, e->_type);
+            ins.a = address(e->load.base);
+            ins.imm = e->load.offset;
+            ins.size = e->load.size;
+            return define(ins);
+        }
+
+        case MIR_Expr::EXPR_LOAD_ADDRESS:{
+            return offsetAddress(address(e->loadAddress.base), e->loadAddress.offset);
+        }
+
+        case MIR_Expr::EXPR_INDEX:{
+            SSA_Value base = address(e->index.base);
+            SSA_Value index = lowerExpr(e->index.index);
+            if (e->index.size > 1){
+                index = binary(MIR_Expr::BinaryOp::EXPR_IMUL, index, constant(e->index.size, MIR_Datatypes::_i64), MIR_Datatypes::_i64);
+            }
+            return binary(MIR_Expr::BinaryOp::EXPR_IADD, base, index, MIR_Datatypes::_ptr);
+        }
+
+        case MIR_Expr::EXPR_STORE:{
+            // struct assignment, copied from the address of the struct it is loaded from
+            if (e->store.size > 8 || !isScalarType(e->_type)){
+                MIR_Expr *right = e->store.right;
+                if (right->tag != MIR_Expr::EXPR_LOAD || right->load.type != MIR_Expr::LoadType::EXPR_MEMLOAD){
+                    unsupported = true;
+                    return SSA_NO_VALUE;
+                }
+
+                SSA_Instruction copy = makeInstruction(SSA_Instruction::SSA_COPY_MEMORY, MIR_Datatypes::_void);
+                copy.b = offsetAddress(address(right->load.base), right->load.offset);
+                copy.a = offsetAddress(address(e->store.left), e->store.offset);
+                copy.size = e->store.size;
+                append(copy);
+                return SSA_NO_VALUE;
+            }
+
+            // the value is computed before the address it is stored at
+            SSA_Value value = lowerExpr(e->store.right);
+
+            int64_t var = promotedVariable(e->store.left);
+            if (var >= 0){
+                SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_WRITE_VARIABLE, variables[var].type);
+                ins.imm = var;
+                ins.a = value;
+                append(ins);
+                return value;
+            }
+
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_STORE, e->_type);
+            ins.a = address(e->store.left);
+            ins.b = value;
+            ins.imm = e->store.offset;
+            ins.size = e->store.size;
+            append(ins);
+            return value;
+        }
+
+        case MIR_Expr::EXPR_BINARY:{
+            SSA_Value left = lowerExpr(e->binary.left);
+            SSA_Value right = lowerExpr(e->binary.right);
+
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_BINARY, e->_type);
+            ins.binary = e->binary.op;
+            ins.a = left;
+            ins.b = right;
+            ins.size = e->binary.size;
+            return define(ins);
+        }
+
+        case MIR_Expr::EXPR_UNARY:{
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_UNARY, e->_type);
+            ins.unary = e->unary.op;
+            ins.a = lowerExpr(e->unary.expr);
+            return define(ins);
+        }
+
+        case MIR_Expr::EXPR_CAST:{
+            SSA_Value value = lowerExpr(e->cast.expr);
+            // arrays decay to the address they are already lowered to
+            if (e->cast._from.tag == e->cast._to.tag || e->cast._from.tag == MIR_Datatype::TYPE_ARRAY){
+                return value;
+            }
+
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_CAST, e->cast._to);
+            ins.from = e->cast._from;
+            ins.a = value;
+            return define(ins);
+        }
+
+        case MIR_Expr::EXPR_CALL:{
+            MIR_Function &callee = mir->functions.getInfo(e->functionCall->funcName).info;
+            if (callee.returnType.tag != MIR_Datatype::TYPE_VOID && !isScalarType(callee.returnType)){
+                unsupported = true;
+                return SSA_NO_VALUE;
+            }
+
+            // the arguments are lowered first, as they can have calls of their own
+            std::vector<SSA_Value> args;
+            for (MIR_Expr *arg : e->functionCall->arguments){
+                if (!isScalarType(arg->_type)){
+                    unsupported = true;
+                    return SSA_NO_VALUE;
+                }
+                args.push_back(lowerExpr(arg));
+            }
+
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_CALL, callee.returnType);
+            ins.symbol = e->functionCall->funcName;
+            ins.firstArg = f->args.size();
+            ins.nArgs = args.size();
+            f->args.insert(f->args.end(), args.begin(), args.end());
+
+            if (callee.returnType.tag == MIR_Datatype::TYPE_VOID){
+                append(ins);
+                return SSA_NO_VALUE;
+            }
+            return define(ins);
+        }
+
+        default:
+            unsupported = true;
+            return SSA_NO_VALUE;
+        }
+    }
+
+
+    void lowerPrimitive(MIR_Primitive *p){
+        if (!p || unsupported){
+            return;
+        }
+
+        switch (p->ptag){
+        case MIR_Primitive::PRIM_IF:{
+            MIR_If *inode = (MIR_If*) p;
+            SSA_BlockId end = newBlock();
+            labelBlocks[inode->endLabel] = end;
+
+            while (inode){
+                if (inode->condition){
+                    SSA_BlockId then = newBlock();
+                    SSA_BlockId otherwise = inode->next? newBlock() : end;
+                    labelBlocks[inode->falseLabel] = otherwise;
+
+                    branchTo(lowerExpr(inode->condition), then, otherwise);
+
+                    current = then;
+                    lowerPrimitive(inode->scope);
+                    jumpTo(end);
+
+                    current = otherwise;
+                }
+                else {
+                    lowerPrimitive(inode->scope);
+                    jumpTo(end);
+                }
+                inode = inode->next;
+            }
+
+            current = end;
+            break;
+        }
+        case MIR_Primitive::PRIM_LOOP:{
+            MIR_Loop *lnode = (MIR_Loop*) p;
+            SSA_BlockId start = newBlock();
+            SSA_BlockId body = newBlock();
+            SSA_BlockId update = newBlock();
+            SSA_BlockId end = newBlock();
+            labelBlocks[lnode->startLabel] = start;
+            labelBlocks[lnode->updateLabel] = update;
+            labelBlocks[lnode->endLabel] = end;
+
+            jumpTo(start);
+
+            // a loop without condition runs until it is broken out of
+            current = start;
+            if (lnode->condition){
+                branchTo(lowerExpr(lnode->condition), body, end);
+            }
+            else {
+                jumpTo(body);
+            }
+
+            current = body;
+            lowerPrimitive(lnode->scope);
+            jumpTo(update);
+
+            current = update;
+            if (lnode->update){
+                lowerExpr(lnode->update);
+            }
+            jumpTo(start);
+
+            current = end;
+            break;
+        }
+        case MIR_Primitive::PRIM_RETURN:{
+            MIR_Return *rnode = (MIR_Return*) p;
+            SSA_Instruction ret = makeInstruction(SSA_Instruction::SSA_RETURN, f->mir->returnType);
+            if (rnode->returnValue && f->mir->returnType.tag != MIR_Datatype::TYPE_VOID){
+                ret.a = lowerExpr(rnode->returnValue);
+            }
+            terminate(ret);
+            break;
+        }
+        case MIR_Primitive::PRIM_JUMP:{
+            MIR_Jump *jnode = (MIR_Jump*) p;
+            auto target = labelBlocks.find(jnode->jumpLabel);
+            if (target == labelBlocks.end()){
+                unsupported = true;
+                return;
+            }
+            jumpTo(target->second);
+            break;
+        }
+        case MIR_Primitive::PRIM_EXPR:{
+            lowerExpr((MIR_Expr*) p);
+            break;
+        }
+        case MIR_Primitive::PRIM_SCOPE:{
+            MIR_Scope *scope = (MIR_Scope*) p;
+            scopes.push_back(scope);
+            for (MIR_Primitive *statement : scope->statements){
+                lowerPrimitive(statement);
+            }
+            scopes.pop_back();
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+
+    /*
+        Keep only the blocks reachable from the entry, numbered in reverse postorder,
+        and fill in the predecessors of each block.
+    */
+    void removeUnreachableBlocks(){
+        size_t n = f->blocks.size();
+        std::vector<SSA_BlockId> postorder;
+        std::vector<bool> visited(n, false);
+
+        // iterative depth first search, each entry is a block and the number of its successors visited
+        std::vector<std::pair<SSA_BlockId, int>> stack = {{0, 0}};
+        visited[0] = true;
+        while (!stack.empty()){
+            auto &[b, next] = stack.back();
+            SSA_Instruction &t = f->blocks[b].terminator();
+            if (next < t.nSuccessors()){
+                SSA_BlockId s = t.target[next++];
+                if (!visited[s]){
+                    visited[s] = true;
+                    stack.push_back({s, 0});
+                }
+            }
+            else {
+                postorder.push_back(b);
+                stack.pop_back();
+            }
+        }
+
+        std::vector<SSA_BlockId> number(n, 0);
+        for (size_t i = 0; i < postorder.size(); i++){
+            number[postorder[i]] = postorder.size() - 1 - i;
+        }
+
+        ArenaVector<SSA_Block> blocks(arena);
+        blocks.resize(postorder.size(), SSA_Block{
+            .instructions = ArenaVector<SSA_Instruction>(arena),
+            .predecessors = ArenaVector<SSA_BlockId>(arena),
+            .idom = 0
+        });
+        for (SSA_BlockId b : postorder){
+            SSA_Block &block = blocks[number[b]];
+            block.instructions = std::move(f->blocks[b].instructions);
+
+            SSA_Instruction &t = block.terminator();
+            for (int i = 0; i < t.nSuccessors(); i++){
+                t.target[i] = number[t.target[i]];
+            }
+        }
+        f->blocks = std::move(blocks);
+
+        for (SSA_BlockId b = 0; b < f->blocks.size(); b++){
+            SSA_Instruction &t = f->blocks[b].terminator();
+            for (int i = 0; i < t.nSuccessors(); i++){
+                f->blocks[t.target[i]].predecessors.push_back(b);
+            }
+        }
+    }
+
+
+    /*
+        Turn the promoted variables into values (Cytron et al.): a phi is placed for a variable at the
+        iterated dominance frontier of the blocks writing it, then each read is replaced by the value the
+        variable last had on the path through the dominator tree. Only the variables read before
+        being written in some block get phis (semi-pruned SSA).
+    */
+    void buildSSA(){
+        size_t nBlocks = f->blocks.size();
+        computeDominators(f);
+
+        std::vector<std::vector<SSA_BlockId>> children(nBlocks);
+        for (SSA_BlockId b = 1; b < nBlocks; b++){
+            children[f->blocks[b].idom].push_back(b);
+        }
+
+        // dominance frontiers
+        std::vector<std::vector<SSA_BlockId>> frontier(nBlocks);
+        for (SSA_BlockId b = 0; b < nBlocks; b++){
+            SSA_Block &block = f->blocks[b];
+            if (block.predecessors.size() < 2){
+                continue;
+            }
+            for (SSA_BlockId p : block.predecessors){
+                SSA_BlockId runner = p;
+                while (runner != block.idom){
+                    std::vector<SSA_BlockId> &df = frontier[runner];
+                    if (df.empty() || df.back() != b){
+                        df.push_back(b);
+                    }
+                    runner = f->blocks[runner].idom;
+                }
+            }
+        }
+
+        // the blocks writing each variable, and the variables read before written in a block
+        size_t nVariables = variables.size();
+        std::vector<std::vector<SSA_BlockId>> writes(nVariables);
+        std::vector<bool> isNonLocal(nVariables, false);
+        for (SSA_BlockId b = 0; b < nBlocks; b++){
+            std::vector<SSA_BlockId> written;
+            for (SSA_Instruction &ins : f->blocks[b].instructions){
+                if (ins.op == SSA_Instruction::SSA_READ_VARIABLE){
+                    bool isWritten = false;
+                    for (SSA_BlockId var : written){
+                        isWritten = isWritten || var == ins.imm;
+                    }
+                    isNonLocal[ins.imm] = isNonLocal[ins.imm] || !isWritten;
+                }
+                else if (ins.op == SSA_Instruction::SSA_WRITE_VARIABLE){
+                    written.push_back(ins.imm);
+                    if (writes[ins.imm].empty() || writes[ins.imm].back() != b){
+                        writes[ins.imm].push_back(b);
+                    }
+                }
+            }
+        }
+
+        // place the phis
+        std::vector<std::vector<SSA_Instruction>> phis(nBlocks);
+        std::vector<int64_t> hasPhi(nBlocks, -1);
+        std::vector<int64_t> isQueued(nBlocks, -1);
+        for (size_t var = 0; var < nVariables; var++){
+            if (!isNonLocal[var]){
+                continue;
+            }
+
+            std::vector<SSA_BlockId> worklist = writes[var];
+            for (SSA_BlockId b : worklist){
+                isQueued[b] = var;
+            }
+            while (!worklist.empty()){
+                SSA_BlockId b = worklist.back();
+                worklist.pop_back();
+
+                for (SSA_BlockId d : frontier[b]){
+                    if (hasPhi[d] == (int64_t) var){
+                        continue;
+                    }
+                    hasPhi[d] = var;
+
+                    SSA_Instruction phi = makeInstruction(SSA_Instruction::SSA_PHI, variables[var].type);
+                    phi.dest = newValue(phi.type);
+                    phi.imm = var;
+                    phi.firstArg = f->args.size();
+                    phi.nArgs = f->blocks[d].predecessors.size();
+                    f->args.resize(f->args.size() + phi.nArgs, SSA_NO_VALUE);
+                    phis[d].push_back(phi);
+
+                    if (isQueued[d] != (int64_t) var){
+                        isQueued[d] = var;
+                        worklist.push_back(d);
+                    }
+                }
+            }
+        }
+        for (SSA_BlockId b = 0; b < nBlocks; b++){
+            ArenaVector<SSA_Instruction> &instructions = f->blocks[b].instructions;
+            instructions.insert(instructions.begin(), phis[b].begin(), phis[b].end());
+        }
+
+        // rename
+        std::vector<std::vector<SSA_Value>> stacks(nVariables);
+        std::vector<SSA_Value> replacement(f->nValues(), SSA_NO_VALUE);
+        // the value of variables read before being written, defined in the entry block
+        std::vector<SSA_Instruction> undefined;
+        std::vector<SSA_Value> undefinedValue(nVariables, SSA_NO_VALUE);
+
+        auto valueOf = [&](int64_t var) -> SSA_Value{
+            if (!stacks[var].empty()){
+                return stacks[var].back();
+            }
+            if (undefinedValue[var] == SSA_NO_VALUE){
+                MIR_Datatype type = variables[var].type;
+                SSA_Instruction zero = makeInstruction(isFloatType(type)? SSA_Instruction::SSA_FCONST : SSA_Instruction::SSA_CONST, type);
+                zero.number = Number{.type = type, .u64 = {0}};
+                zero.dest = newValue(type);
+                undefined.push_back(zero);
+                undefinedValue[var] = zero.dest;
+            }
+            return undefinedValue[var];
+        };
+        auto replace = [&](SSA_Value &v){
+            if (v < replacement.size() && replacement[v] != SSA_NO_VALUE){
+                v = replacement[v];
+            }
+        };
+
+        std::function<void(SSA_BlockId)> rename = [&](SSA_BlockId b){
+            std::vector<int64_t> pushed;
+
+            for (SSA_Instruction &ins : f->blocks[b].instructions){
+                if (ins.op == SSA_Instruction::SSA_PHI){
+                    stacks[ins.imm].push_back(ins.dest);
+                    pushed.push_back(ins.imm);
+                    continue;
+                }
+
+                f->forEachOperand(ins, replace);
+
+                if (ins.op == SSA_Instruction::SSA_READ_VARIABLE){
+                    replacement[ins.dest] = valueOf(ins.imm);
+                }
+                else if (ins.op == SSA_Instruction::SSA_WRITE_VARIABLE){
+                    stacks[ins.imm].push_back(ins.a);
+                    pushed.push_back(ins.imm);
+                }
+            }
+
+            // the values flowing into the phis of the successors
+            SSA_Instruction &t = f->blocks[b].terminator();
+            for (int i = 0; i < t.nSuccessors(); i++){
+                SSA_Block &successor = f->blocks[t.target[i]];
+                size_t predecessorNo = 0;
+                while (successor.predecessors[predecessorNo] != b){
+                    predecessorNo++;
+                }
+                for (SSA_Instruction &phi : successor.instructions){
+                    if (phi.op != SSA_Instruction::SSA_PHI){
+                        break;
+                    }
+                    f->args[phi.firstArg + predecessorNo] = valueOf(phi.imm);
+                }
+            }
+
+            for (SSA_BlockId child : children[b]){
+                rename(child);
+            }
+            for (int64_t var : pushed){
+                stacks[var].pop_back();
+            }
+        };
+        rename(0);
+
+        // drop the variable accesses, the values of the variables read before written go first
+        for (SSA_BlockId b = 0; b < nBlocks; b++){
+            ArenaVector<SSA_Instruction> &instructions = f->blocks[b].instructions;
+            size_t kept = 0;
+            for (size_t i = 0; i < instructions.size(); i++){
+                SSA_Instruction::Opcode op = instructions[i].op;
+                if (op != SSA_Instruction::SSA_READ_VARIABLE && op != SSA_Instruction::SSA_WRITE_VARIABLE){
+                    instructions[kept++] = instructions[i];
+                }
+            }
+            instructions.resize(kept);
+        }
+        ArenaVector<SSA_Instruction> &entry = f->blocks[0].instructions;
+        entry.insert(entry.begin(), undefined.begin(), undefined.end());
+    }
+};
+
+
+
+void computeDominators(SSA_Function *f){
+    size_t n = f->blocks.size();
+    if (n == 0){
+        return;
+    }
+
+    // reverse postorder
+    std::vector<SSA_BlockId> postorder;
+    std::vector<int64_t> order(n, -1);
+    std::vector<std::pair<SSA_BlockId, int>> stack = {{0, 0}};
+    order[0] = 0;
+    while (!stack.empty()){
+        auto &[b, next] = stack.back();
+        SSA_Instruction &t = f->blocks[b].terminator();
+        if (next < t.nSuccessors()){
+            SSA_BlockId s = t.target[next++];
+            if (order[s] < 0){
+                order[s] = 0;
+                stack.push_back({s, 0});
+            }
+        }
+        else {
+            postorder.push_back(b);
+            stack.pop_back();
+        }
+    }
+    for (size_t i = 0; i < postorder.size(); i++){
+        order[postorder[i]] = postorder.size() - 1 - i;
+    }
+
+    /*
+        Cooper, Harvey and Kennedy: the dominator of a block is where the dominator tree paths of its
+        processed predecessors meet, iterated over the blocks in reverse postorder until nothing changes.
+    */
+    const SSA_BlockId UNDEFINED = UINT32_MAX;
+    for (SSA_Block &block : f->blocks){
+        block.idom = UNDEFINED;
+    }
+    f->blocks[0].idom = 0;
+
+    auto intersect = [&](SSA_BlockId a, SSA_BlockId b){
+        while (a != b){
+            while (order[a] > order[b]){
+                a = f->blocks[a].idom;
+            }
+            while (order[b] > order[a]){
+                b = f->blocks[b].idom;
+            }
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed){
+        changed = false;
+        for (size_t i = postorder.size() - 1; i-- > 0;){
+            SSA_BlockId b = postorder[i];
+            SSA_BlockId idom = UNDEFINED;
+            for (SSA_BlockId p : f->blocks[b].predecessors){
+                if (f->blocks[p].idom == UNDEFINED){
+                    continue;
+                }
+                idom = idom == UNDEFINED? p : intersect(p, idom);
+            }
+            if (f->blocks[b].idom != idom){
+                f->blocks[b].idom = idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+
+
+SSA_Function* lowerToSSA(MIR *mir, MIR_Function *foo, Arena *arena){
+    if (foo->isExtern || foo->isReused){
+        return NULL;
+    }
+    if (foo->returnType.tag != MIR_Datatype::TYPE_VOID && !isScalarType(foo->returnType)){
+        return NULL;
+    }
+    for (auto &param : foo->parameters){
+        if (!isScalarType(param.type)){
+            return NULL;
+        }
+    }
+
+    SSA_Function *f = new (arena->alloc(sizeof(SSA_Function))) SSA_Function{
+        .mir = foo,
+        .funcName = foo->funcName,
+        .blocks = ArenaVector<SSA_Block>(arena),
+        .args = ArenaVector<SSA_Value>(arena),
+        .valueTypes = ArenaVector<MIR_Datatype>(arena),
+        .slots = ArenaVector<SSA_Function::Slot>(arena),
+    };
+    // value 0 is no value
+    f->valueTypes.push_back(MIR_Datatypes::_void);
+
+    SSA_Builder builder;
+    builder.mir = mir;
+    builder.f = f;
+    builder.arena = arena;
+    builder.scopes.push_back(foo);
+    builder.findMemoryVariables(foo);
+
+    builder.current = builder.newBlock();
+
+    // the parameters are taken from where the caller put them first, then written to their variables
+    std::vector<SSA_Value> params;
+    for (size_t i = 0; i < foo->parameters.size(); i++){
+        SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_PARAM, foo->parameters[i].type);
+        ins.imm = i;
+        params.push_back(builder.define(ins));
+    }
+    for (size_t i = 0; i < foo->parameters.size(); i++){
+        int64_t var = builder.promotedVariable(foo->parameters[i].identifier);
+        if (var >= 0){
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_WRITE_VARIABLE, foo->parameters[i].type);
+            ins.imm = var;
+            ins.a = params[i];
+            builder.append(ins);
+        }
+        else {
+            SSA_Instruction ins = makeInstruction(SSA_Instruction::SSA_STORE, foo->parameters[i].type);
+            ins.a = builder.variableAddress(foo->parameters[i].identifier);
+            ins.b = params[i];
+            ins.size = foo->parameters[i].type.size;
+            builder.append(ins);
+        }
+    }
+
+    for (MIR_Primitive *statement : foo->statements){
+        builder.lowerPrimitive(statement);
+    }
+    if (builder.unsupported){
+        return NULL;
+    }
+
+    // falling off the end of the function
+    SSA_Instruction ret = makeInstruction(SSA_Instruction::SSA_RETURN, foo->returnType);
+    builder.append(ret);
+
+    builder.removeUnreachableBlocks();
+    builder.buildSSA();
+    return f;
+}
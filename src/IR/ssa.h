@@ -0,0 +1,182 @@
+#pragma once
+
+#include "ir.h"
+#include <arena/arena-allocator.h>
+
+
+/*
+    Low level IR between the MIR tree and the code generator, built for each function by lowerToSSA().
+
+    A function is a list of basic blocks, the first one being the entry. A block is a run of three-address
+    instructions over virtual registers: its phis, then its body, then a single terminator (jump, branch or return)
+    which names the successors of the block. The virtual registers are in SSA form: each value is defined by
+    exactly one instruction, which dominates all of its uses, the uses by a phi being at the end of the
+    predecessor the value comes from.
+
+    The scalar local variables whose address is never taken live in virtual registers, the other variables
+    (arrays, structs, variables whose address is taken) in stack slots, read and written with loads and stores.
+    Blocks, instructions and operand lists are contiguous arena-backed arrays, indexed with 32 bit numbers.
+*/
+
+typedef uint32_t SSA_Value;
+typedef uint32_t SSA_BlockId;
+
+// value 0 is never defined, it stands for no value
+static const SSA_Value SSA_NO_VALUE = 0;
+
+
+struct SSA_Instruction{
+    enum Opcode{
+        // values
+        SSA_CONST,          // integer constant imm
+        SSA_FCONST,         // floating point constant number
+        SSA_STRING,         // address of the string literal symbol
+        SSA_PARAM,          // the imm-th parameter of the function
+        SSA_SLOT_ADDRESS,   // address of the stack slot imm
+        SSA_GLOBAL_ADDRESS, // address of the global variable symbol
+
+        // memory
+        SSA_LOAD,           // load a value of type from the address a + imm
+        SSA_STORE,          // store b, of type, at the address a + imm
+        SSA_COPY_MEMORY,    // copy size bytes from the address b to the address a
+
+        // computation
+        SSA_BINARY,         // a binary b, size being the size of the operands
+        SSA_UNARY,          // unary a
+        SSA_CAST,           // a from the type from to type
+        SSA_CALL,           // call the function symbol with the args [firstArg, firstArg + nArgs)
+        SSA_COPY,           // a
+        SSA_PHI,            // one value for each predecessor of the block in args, in the order of the predecessors
+
+        // terminators
+        SSA_JUMP,           // to target[0]
+        SSA_BRANCH,         // to target[0] if a is not zero, else to target[1]
+        SSA_RETURN,         // a, no value for void functions
+
+        // the promoted variables before they are renamed into values, not left in a built function
+        SSA_READ_VARIABLE,  // value of the variable imm
+        SSA_WRITE_VARIABLE, // variable imm = a
+    }op;
+
+    SSA_Value dest;
+    SSA_Value a;
+    SSA_Value b;
+
+    // type of the result, or of the stored value
+    MIR_Datatype type;
+    MIR_Datatype from;
+
+    union{
+        MIR_Expr::BinaryOp binary;
+        MIR_Expr::UnaryOp unary;
+    };
+
+    int64_t imm;
+    size_t size;
+    Number number;
+    Splice symbol;
+
+    // operands kept in SSA_Function::args
+    uint32_t firstArg;
+    uint32_t nArgs;
+
+    SSA_BlockId target[2];
+
+
+    bool isTerminator() const{
+        return op == SSA_JUMP || op == SSA_BRANCH || op == SSA_RETURN;
+    }
+
+    int nSuccessors() const{
+        return op == SSA_JUMP? 1 : op == SSA_BRANCH? 2 : 0;
+    }
+};
+
+
+struct SSA_Block{
+    ArenaVector<SSA_Instruction> instructions;
+    ArenaVector<SSA_BlockId> predecessors;
+
+    // immediate dominator, the entry block is its own
+    SSA_BlockId idom;
+
+    SSA_Instruction &terminator(){
+        return instructions.back();
+    }
+};
+
+
+struct SSA_Function{
+    MIR_Function *mir;
+    Splice funcName;
+
+    ArenaVector<SSA_Block> blocks;
+    // operands of the phis and calls
+    ArenaVector<SSA_Value> args;
+    // type of each value, by value number
+    ArenaVector<MIR_Datatype> valueTypes;
+
+    // the stack slots of the variables left in memory
+    struct Slot{
+        size_t size;
+        size_t alignment;
+    };
+    ArenaVector<Slot> slots;
+
+    size_t nValues(){
+        return valueTypes.size();
+    }
+
+    /*
+        Call visit(SSA_Value &) on each value an instruction uses, the values of a phi included.
+    */
+    template <typename Visit>
+    void forEachOperand(SSA_Instruction &ins, Visit visit){
+        switch (ins.op){
+        case SSA_Instruction::SSA_LOAD:
+        case SSA_Instruction::SSA_UNARY:
+        case SSA_Instruction::SSA_CAST:
+        case SSA_Instruction::SSA_COPY:
+        case SSA_Instruction::SSA_BRANCH:
+        case SSA_Instruction::SSA_WRITE_VARIABLE:
+            visit(ins.a);
+            break;
+        case SSA_Instruction::SSA_STORE:
+        case SSA_Instruction::SSA_COPY_MEMORY:
+        case SSA_Instruction::SSA_BINARY:
+            visit(ins.a);
+            visit(ins.b);
+            break;
+        case SSA_Instruction::SSA_RETURN:
+            if (ins.a != SSA_NO_VALUE){
+                visit(ins.a);
+            }
+            break;
+        case SSA_Instruction::SSA_CALL:
+        case SSA_Instruction::SSA_PHI:
+            for (uint32_t i = 0; i < ins.nArgs; i++){
+                visit(args[ins.firstArg + i]);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+
+/*
+    Lower a function of the MIR to SSA form. Returns NULL for the functions the SSA form does not cover yet:
+    extern and reused functions, and functions passing or returning structs by value.
+*/
+SSA_Function* lowerToSSA(MIR *mir, MIR_Function *foo, Arena *arena);
+
+/*
+    Compute the immediate dominators of the blocks of a function, the blocks must all be reachable from the entry.
+*/
+void computeDominators(SSA_Function *f);
+
+/*
+    Check the structure of a function in SSA form, printing the problems found to stderr.
+*/
+bool verifySSA(SSA_Function *f);
@@ -1,20 +1,19 @@
 #pragma once
 
 #include <string.h>
-#include <unordered_map>
-#include <vector>
 #include <tokenizer/str.h>
+#include <tokenizer/atoms.h>
+#include <arena/arena-allocator.h>
 
 
+/*
+    Symbol tables are keyed on the atom of the name, which identifier tokens already carry from the tokenizer,
+    so lookups hash an integer instead of the string.
+    Entries are kept in insertion order, so iterating a table does not depend on the atom values.
+    Adding an entry can move the others, so references to entries are only valid until the next add.
 
-// Custom hash function using std::string_view
-struct SpliceHash {
-    std::size_t operator()(const Splice& s) const {
-        return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(s.data), s.len));
-    }
-};
-
-
+    The tables of the AST are given the parser's arena with init(), the others allocate from the heap.
+*/
 template <typename T>
 struct SymbolTable{
     struct SymbolTableEntry{
@@ -22,56 +21,59 @@ struct SymbolTable{
         T info;
     };
 
-    std::unordered_map<Splice, SymbolTableEntry, SpliceHash>entries;
+    ArenaVector<std::pair<Atom, SymbolTableEntry>> entries;
+    // index of the entry of each atom in entries
+    ArenaMap<Atom, uint32_t> index;
+
+    void init(Arena *arena){
+        entries = decltype(entries)(arena);
+        index = decltype(index)(arena);
+    }
 
     void add(Splice name, T info){
-        entries.insert({name, {name, info}});
+        Atom atom = atomOf(name);
+        if (!index.contains(atom)){
+            index[atom] = entries.size();
+            entries.push_back({atom, {name, info}});
+        }
     }
 
     bool existKey(Splice name){
-        return entries.contains(name);
+        return index.contains(atomOf(name));
     }
 
+    // the entry of given name, adding an empty entry if there is none
     SymbolTableEntry &getInfo(Splice name){
-        return entries[name];
+        Atom atom = atomOf(name);
+        auto found = index.find(atom);
+        if (found == index.end()){
+            index[atom] = entries.size();
+            entries.push_back({atom, {}});
+            return entries.back().second;
+        }
+        return entries[found->second].second;
     }
     size_t count(){
         return entries.size();
     }
     void update(Splice name, T info){
-        entries[name] = {name, info};
+        getInfo(name) = {name, info};
     }
 
 };
 
+// symbol table that also keeps the names in the order they were added
 template <typename T>
-struct SymbolTableOrdered{
+struct SymbolTableOrdered: public SymbolTable<T>{
+    ArenaVector<Splice> order;
 
-    struct SymbolTableEntry{
-        Splice identifier;
-        T info;
-    };
-
-    std::unordered_map<Splice, SymbolTableEntry, SpliceHash> entries;
-    std::vector<Splice> order;
+    void init(Arena *arena){
+        SymbolTable<T>::init(arena);
+        order = decltype(order)(arena);
+    }
 
     void add(Splice name, T info){
-        entries.insert({name, {name, info}});
+        SymbolTable<T>::add(name, info);
         order.push_back(name);
     }
-
-    bool existKey(Splice name){
-        return entries.contains(name);
-    }
-
-    SymbolTableEntry &getInfo(Splice name){
-        return entries[name];
-    }
-    size_t count(){
-        return entries.size();
-    }
-    void update(Splice name, T info){
-        entries[name] = {name, info};
-    }
-
 };
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "arena.h"
+#include <new>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+
+
+/*
+    Allocator for the standard containers that takes its memory from an arena.
+    Memory given back to the allocator is not reused, it is released with the frame it was allocated in,
+    so a container must not outlive the arena frame it grew in.
+
+    A default constructed allocator has no arena and uses the heap, so the containers that are not built by the parser
+    (MIR, code generation) behave like the plain standard containers.
+
+    Parsing a pre-lexed file makes no heap allocation, except for the line start index of the source built the first
+    time a diagnostic in it is located (see locateInSource): it belongs to the source rather than to a parse.
+*/
+template <typename T>
+struct ArenaAllocator{
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    Arena *arena = NULL;
+
+    ArenaAllocator() = default;
+    ArenaAllocator(Arena *arena): arena(arena){}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other): arena(other.arena){}
+
+    T* allocate(size_t n){
+        static_assert(alignof(T) <= 8, "Arena allocations are only 8 byte aligned.");
+        if (!arena){
+            return (T *)::operator new(n * sizeof(T));
+        }
+        return (T *)arena->alloc(n * sizeof(T));
+    }
+
+    void deallocate(T *p, size_t n){
+        if (!arena){
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const{
+        return arena == other.arena;
+    }
+};
+
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template <typename K, typename V>
+using ArenaMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, ArenaAllocator<std::pair<const K, V>>>;
@@ -34,6 +34,17 @@ bool Arena::allocFromOS(size_t capacity){
     return true;
 }
 
+void Arena::releaseToOS(int mapNo){
+#if defined(_WIN32)
+    VirtualFree(map[mapNo].mem, 0, MEM_RELEASE);
+#elif defined(__linux__)
+    munmap(map[mapNo].mem, map[mapNo].capacity);
+#endif
+    map[mapNo].mem = 0;
+    map[mapNo].capacity = 0;
+    map[mapNo].allocated = 0;
+}
+
 void  Arena::destroy(){
     // assert(this->mem && this->capacity > 0);
     
@@ -41,13 +52,7 @@ void  Arena::destroy(){
         if (map[i].capacity == 0){
             break;
         }
-#if defined(_WIN32)
-        VirtualFree(map[i].mem, map[i].capacity, MEM_RELEASE);
-#elif defined(__linux__)
-        munmap(map[i].mem, map[i].capacity);
-#endif
-
-
+        releaseToOS(i);
     }
 
 }
@@ -114,9 +119,17 @@ void* Arena::alloc(size_t size){
             return NULL;
         }
 
+        // an allocation bigger than a map (a large vector growing) gets a map of its own
+        size_t capacity = (size > mapAllocSize)? alignUpPowerOf2(size, PAGE_SIZE) : mapAllocSize;
+
         // if the next map hasn't been allocated from OS, then alloc
         if (map[currentMap].capacity == 0){
-            allocFromOS(mapAllocSize);
+            allocFromOS(capacity);
+        }
+        // maps are reused after a frame is destroyed, so the map may be too small for the allocation
+        else if (map[currentMap].capacity < size){
+            releaseToOS(currentMap);
+            allocFromOS(capacity);
         }
 
         map[currentMap].allocated = 0;
@@ -31,6 +31,7 @@ private:
     
 
     bool   allocFromOS(size_t capacity);
+    void   releaseToOS(int mapNo);
     size_t alignUpPowerOf2(size_t address, size_t align);
 
 public:
@@ -1,9 +1,23 @@
 #include "code-gen.h"
+#include "build-cache.h"
 #include <parser/parser.h>
+#include <preprocessor/preprocessor.h>
 #include <debug/debug-print.h>
+#include <IR/pass-manager.h>
 
 struct {
     bool print = true;
+    bool preLex = false;
+    int lexThreads = 0;
+    bool preprocess = false;
+    bool lazyBodies = false;
+    const char* cacheDir = NULL;
+    int checkThreads = 0;
+    bool ssa = false;
+    int optLevel = 0;
+    std::vector<const char*> passLists;
+    bool timePasses = false;
+    std::vector<const char*> includeDirs;
     const char* outputTo = "./codegen_output.s";
     const char* input;
 }config;
@@ -26,11 +40,88 @@ int main(int argc, char **argv){
         else if (strcmp(argv[i], "-no-print") == 0){
             config.print = false;
         }
+        
+        else if (strcmp(argv[i], "-prelex") == 0){
+            config.preLex = true;
+        }
+
+        else if (strcmp(argv[i], "-lex-threads") == 0 && i + 1 < argc){
+            config.lexThreads = atoi(argv[i+1]);
+            i++;
+        }
+
+        else if (strcmp(argv[i], "-preprocess") == 0){
+            config.preprocess = true;
+        }
+
+        else if (strcmp(argv[i], "-lazy-bodies") == 0){
+            config.lazyBodies = true;
+        }
+
+        else if (strcmp(argv[i], "-incremental") == 0 && i + 1 < argc){
+            config.cacheDir = argv[i+1];
+            config.lazyBodies = true;
+            config.preLex = true;
+            i++;
+        }
+
+        else if (strcmp(argv[i], "-check-threads") == 0 && i + 1 < argc){
+            config.checkThreads = atoi(argv[i+1]);
+            i++;
+        }
+
+        else if (strcmp(argv[i], "-ssa") == 0){
+            config.ssa = true;
+        }
+
+        else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0 || strcmp(argv[i], "-O2") == 0){
+            config.optLevel = argv[i][2] - '0';
+        }
+
+        else if (strncmp(argv[i], "-fpass=", 7) == 0){
+            config.passLists.push_back(argv[i] + 7);
+        }
+
+        else if (strcmp(argv[i], "-ftime-passes") == 0){
+            config.timePasses = true;
+        }
+
+        else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc){
+            config.includeDirs.push_back(argv[i+1]);
+            config.preprocess = true;
+            i++;
+        }
     }
 
     Tokenizer t;
     t.init();
-    t.loadFileToBuffer(argv[1]);
+    Preprocessor pp;
+    pp.init();
+
+    if (config.preprocess){
+        for (const char *dir : config.includeDirs){
+            pp.addIncludeDir(dir);
+        }
+        if (!pp.preprocess(argv[1], &t)){
+            return EXIT_FAILURE;
+        }
+        if (pp.errors > 0){
+            fprintf(stderr, "[Preprocessor] %zu errors generated.\n", pp.errors);
+            printf("Failed! \n");
+            return 1;
+        }
+    }
+    else {
+        if (!t.loadFileToBuffer(argv[1])){
+            return EXIT_FAILURE;
+        }
+        if (config.lexThreads > 0){
+            t.preLexParallel(config.lexThreads);
+        }
+        else if (config.preLex){
+            t.preLex();
+        }
+    }
     
     Arena a;
     a.init(PAGE_SIZE * 2);
@@ -39,14 +130,40 @@ int main(int argc, char **argv){
 
     Parser p;
     p.init(&t, &a);
+    p.lazyBodies = config.lazyBodies;
+    p.checkThreads = config.checkThreads;
 
     AST *ir = p.parseProgram();
+    // only the lazy tokenizer re-lexes, the pre-lexed buffer rewinds by index
+    fprintf(stderr, "[Tokenizer] %zu tokens re-lexed.\n", t.relexedTokens);
     
     if (!ir){
         printf("Failed! \n");
         return 1;
     }
 
+    PassManager passManager;
+    passManager.init(config.optLevel);
+    passManager.timePasses = config.timePasses;
+    for (const char *list : config.passLists){
+        if (!passManager.setPasses(list)){
+            printf("Failed! \n");
+            return 1;
+        }
+    }
+
+    // the functions unchanged since the last build are not parsed, transformed or generated again
+    BuildCache cache;
+    if (config.cacheDir){
+        if (!cache.init(config.cacheDir, argv[1])){
+            printf("Failed! \n");
+            return 1;
+        }
+        cache.options = passManager.pipeline() + (config.ssa? ";ssa" : "");
+        cache.load();
+        cache.markReusedFunctions(ir, t.tokens);
+    }
+
     
 
         Arena b;
@@ -55,17 +172,52 @@ int main(int argc, char **argv){
 
         CodeGenerator gen;
         gen.arena = &b;
+        gen.cache = config.cacheDir? &cache : NULL;
         
         MIR* mir = transform(ir, &b);
         
+        // errors in the function bodies parsed while transforming
+        if (!mir){
+            printf("Failed! \n");
+            return 1;
+        }
+
+        passManager.run(mir, &b);
+        if (config.timePasses){
+            passManager.printStatistics(stdout);
+        }
+
         if (config.print){
             printMIR(mir);    
         }
+
+        // the functions the SSA form covers are generated from it, the others from their MIR
+        if (config.ssa){
+            for (auto &entry : mir->functions.entries){
+                SSA_Function *f = lowerToSSA(mir, &entry.second.info, &b);
+                if (!f){
+                    continue;
+                }
+                if (!verifySSA(f)){
+                    fprintf(stderr, "[SSA] The SSA form of %.*s is malformed.\n", (int) f->funcName.len, f->funcName.data);
+                    printf("Failed! \n");
+                    return 1;
+                }
+                if (config.print){
+                    printSSA(f);
+                }
+                gen.ssaFunctions.add(f->funcName, f);
+            }
+        }
         
         gen.generateAssemblyFromMIR(mir);
 
         
         gen.writeAssemblyToFile(config.outputTo);
+
+        if (config.cacheDir && cache.save()){
+            fprintf(stdout, "[Codegen] %zu functions reused, %zu generated.\n", cache.reusedFunctions, cache.generatedFunctions);
+        }
         writeToDOTfile(mir);
 
         if (config.print){
@@ -75,8 +227,10 @@ int main(int argc, char **argv){
 
     
 
+    p.destroy();
     a.destroyFrame();
     a.destroy();
+    pp.destroy();
     
     printf("Successfully generated! \n");
 }
\ No newline at end of file
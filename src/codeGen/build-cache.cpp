@@ -0,0 +1,336 @@
+#include "build-cache.h"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+
+static const char CACHE_MAGIC[4] = {'K', 'I', 'N', 'C'};
+static const uint32_t CACHE_VERSION = 2;
+
+
+struct CacheFileHeader{
+    char magic[4];
+    uint32_t version;
+    uint64_t functions;
+    uint64_t payloadSize;
+    // hash of the payload, a cache file that does not match it is ignored
+    uint64_t payloadHash;
+};
+
+
+struct CacheWriter{
+    std::string bytes;
+
+    template <typename T>
+    void value(T v){
+        bytes.append((const char *)&v, sizeof(T));
+    }
+
+    void string(const std::string &s){
+        value<uint32_t>(s.size());
+        bytes.append(s);
+    }
+};
+
+
+// reads the payload of a cache file, a read past its end marks the whole file as invalid
+struct CacheReader{
+    const char *cursor;
+    const char *end;
+    bool isValid;
+
+    template <typename T>
+    T value(){
+        T v = {};
+        if (end - cursor < (ptrdiff_t)sizeof(T)){
+            isValid = false;
+            return v;
+        }
+        memcpy(&v, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return v;
+    }
+
+    std::string string(){
+        uint32_t len = value<uint32_t>();
+        if (end - cursor < (ptrdiff_t)len){
+            isValid = false;
+            return std::string();
+        }
+        cursor += len;
+        return std::string(cursor - len, len);
+    }
+};
+
+
+bool BuildCache :: init(const char *dir, const char *input){
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec){
+        fprintf(stderr, "Failed to create the build cache directory %s: %s\n", dir, ec.message().c_str());
+        return false;
+    }
+
+    // one cache file for each input file
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.kinc", (unsigned long long)hashBytes(HASH_SEED, input, strlen(input)));
+    this->path = (std::filesystem::path(dir) / name).string();
+    this->reusedFunctions = 0;
+    this->generatedFunctions = 0;
+    return true;
+}
+
+
+/*
+    Load the functions of the last build, returns false if there is no valid cache file.
+*/
+bool BuildCache :: load(){
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()){
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    CacheFileHeader header;
+    if (contents.size() < sizeof(header)){
+        return false;
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+
+    const char *payload = contents.data() + sizeof(header);
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION
+        || header.payloadSize != contents.size() - sizeof(header)
+        || header.payloadHash != hashBytes(HASH_SEED, payload, header.payloadSize)){
+        return false;
+    }
+
+    CacheReader r = {payload, payload + header.payloadSize, true};
+    for (uint64_t i=0; i<header.functions && r.isValid; i++){
+        std::string name = r.string();
+        CachedFunction &foo = last[name];
+        foo.key = r.value<uint64_t>();
+        foo.firstLabel = r.value<uint64_t>();
+        foo.labelCount = r.value<uint64_t>();
+
+        uint32_t rodataCount = r.value<uint32_t>();
+        for (uint32_t j=0; j<rodataCount && r.isValid; j++){
+            RodataUse use;
+            use.label = r.value<uint64_t>();
+            use.tag = (MIR_Datatype::Tag)r.value<uint32_t>();
+            use.size = r.value<uint64_t>();
+            use.number = r.value<uint64_t>();
+            use.value = r.string();
+            foo.rodata.push_back(use);
+        }
+        foo.code = r.string();
+    }
+
+    if (!r.isValid){
+        last.clear();
+        return false;
+    }
+    return true;
+}
+
+
+/*
+    Save the functions of this build, for the next one to reuse.
+*/
+bool BuildCache :: save(){
+    CacheWriter w;
+    for (auto &entry : next){
+        const CachedFunction &foo = entry.second;
+        w.string(entry.first);
+        w.value<uint64_t>(foo.key);
+        w.value<uint64_t>(foo.firstLabel);
+        w.value<uint64_t>(foo.labelCount);
+
+        w.value<uint32_t>(foo.rodata.size());
+        for (const RodataUse &use : foo.rodata){
+            w.value<uint64_t>(use.label);
+            w.value<uint32_t>(use.tag);
+            w.value<uint64_t>(use.size);
+            w.value<uint64_t>(use.number);
+            w.string(use.value);
+        }
+        w.string(foo.code);
+    }
+
+    CacheFileHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.functions = next.size();
+    header.payloadSize = w.bytes.size();
+    header.payloadHash = hashBytes(HASH_SEED, w.bytes.data(), w.bytes.size());
+
+    // written to a temporary file first, so that a build never reads a partly written cache
+    std::string tempPath = path + ".tmp";
+    std::ofstream f(tempPath, std::ios::binary);
+    if (!f.is_open()){
+        fprintf(stderr, "Failed to write build cache: %s\n", tempPath.c_str());
+        return false;
+    }
+    f.write((const char *)&header, sizeof(header));
+    f.write(w.bytes.data(), w.bytes.size());
+    f.close();
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec){
+        fprintf(stderr, "Failed to write build cache: %s\n", path.c_str());
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+
+/*
+    Key each function definition on its body, on the tokens outside of the bodies and on the options, and mark the bodies that
+    are keyed as in the last build to be reused. The bodies must have been skipped by the parser (see lazyBodies),
+    over a pre-lexed token stream.
+*/
+void BuildCache :: markReusedFunctions(AST *ast, const TokenBuffer &tokens){
+    std::vector<DeferredBody *> bodies;
+    for (auto &entry : ast->functions.entries){
+        if (entry.second.info.deferredBody){
+            bodies.push_back(entry.second.info.deferredBody);
+        }
+    }
+    std::sort(bodies.begin(), bodies.end(), [](DeferredBody *a, DeferredBody *b){ return a->start.index < b->start.index; });
+
+    // the tokens between the bodies
+    uint64_t declarations = hashBytes(HASH_SEED, &CACHE_VERSION, sizeof(CACHE_VERSION));
+    declarations = hashBytes(declarations, options.data(), options.size());
+    size_t from = 0;
+    for (DeferredBody *body : bodies){
+        declarations = tokens.hash(declarations, from, body->start.index);
+        from = body->end;
+    }
+    declarations = tokens.hash(declarations, from, tokens.types.size());
+
+    for (auto &entry : ast->functions.entries){
+        Function &foo = entry.second.info;
+        if (!foo.deferredBody){
+            continue;
+        }
+
+        std::string name(foo.funcName.string.data, foo.funcName.string.len);
+        uint64_t key = tokens.hash(declarations, foo.deferredBody->start.index, foo.deferredBody->end);
+        keys[name] = key;
+
+        auto found = last.find(name);
+        if (found != last.end() && found->second.key == key){
+            foo.deferredBody->isReused = true;
+            foo.deferredBody->reusedLabels = found->second.labelCount;
+        }
+    }
+}
+
+
+/*
+    Renumber the labels in the code of a function: the block labels (.L) are moved by labelOffset,
+    and the .rodata labels (.symbol) are mapped by rodataLabels, the labels of global variables are kept.
+*/
+static std::string relabel(const std::string &code, int64_t labelOffset, const std::unordered_map<Label, Label> &rodataLabels){
+    std::string out;
+    out.reserve(code.size() + code.size() / 16);
+
+    size_t i = 0;
+    while (i < code.size()){
+        size_t prefix = 0;
+        bool isBlockLabel = false;
+        if (code.compare(i, 2, ".L") == 0){
+            prefix = 2;
+            isBlockLabel = true;
+        }
+        else if (code.compare(i, 7, ".symbol") == 0){
+            prefix = 7;
+        }
+
+        size_t digits = i + prefix;
+        while (prefix > 0 && digits < code.size() && code[digits] >= '0' && code[digits] <= '9'){
+            digits++;
+        }
+        if (prefix == 0 || digits == i + prefix){
+            out.push_back(code[i]);
+            i++;
+            continue;
+        }
+
+        Label label = strtoull(code.c_str() + i + prefix, NULL, 10);
+        if (isBlockLabel){
+            label += labelOffset;
+        }
+        else {
+            auto mapped = rodataLabels.find(label);
+            if (mapped != rodataLabels.end()){
+                label = mapped->second;
+            }
+        }
+        out.append(code, i, prefix);
+        out.append(std::to_string(label));
+        i = digits;
+    }
+    return out;
+}
+
+
+/*
+    Save the code just generated for a function to the build cache.
+*/
+void CodeGenerator :: cacheFunctionCode(MIR_Function *foo, const std::string &code){
+    std::string name(foo->funcName.data, foo->funcName.len);
+
+    BuildCache::CachedFunction cached;
+    cached.key = cache->keys[name];
+    cached.firstLabel = foo->firstLabel;
+    cached.labelCount = foo->endLabel - foo->firstLabel;
+    for (RodataKey key : usedRodata){
+        GlobalSymbolInfo symbol = rodata[rodataIndex.at(key)];
+        cached.rodata.push_back(BuildCache::RodataUse{
+            .label = symbol.label,
+            .tag = symbol.type.tag,
+            .size = symbol.type.size,
+            .number = symbol.number.u64[0],
+            .value = symbol.value.data? std::string(symbol.value.data, symbol.value.len) : std::string(),
+        });
+    }
+    cached.code = code;
+
+    cache->next[name] = std::move(cached);
+    cache->generatedFunctions++;
+}
+
+
+/*
+    Emit the code of a function from the last build, giving it the labels it would have been generated with.
+*/
+void CodeGenerator :: reuseFunctionCode(MIR_Function *foo){
+    std::string name(foo->funcName.data, foo->funcName.len);
+    BuildCache::CachedFunction &cached = cache->last.at(name);
+
+    // the constants are added to .rodata in the order the function first used them, as when it is generated
+    std::unordered_map<Label, Label> rodataLabels;
+    for (const BuildCache::RodataUse &use : cached.rodata){
+        MIR_Datatype type = {.tag = use.tag, .size = use.size, .alignment = use.size, .name = ""};
+        Number number = {.type = type, .u64 = {use.number}};
+
+        GlobalSymbolInfo symbol;
+        if (use.tag == MIR_Datatype::TYPE_PTR || use.tag == MIR_Datatype::TYPE_ARRAY){
+            Splice value = atomName(internAtom(use.value.data(), use.value.size()));
+            symbol = rodataSymbol(stringLiteralKey(value), GlobalSymbolInfo{.value = value, .type = type});
+        }
+        else {
+            symbol = rodataSymbol(fpConstantKey(number), GlobalSymbolInfo{.number = number, .type = type});
+        }
+        rodataLabels[use.label] = symbol.label;
+    }
+
+    textSection << relabel(cached.code, (int64_t)(foo->firstLabel - cached.firstLabel), rodataLabels);
+
+    // kept as it was generated, the labels are renumbered again on each reuse
+    cache->next[name] = std::move(cached);
+    cache->reusedFunctions++;
+}
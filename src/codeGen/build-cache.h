@@ -0,0 +1,67 @@
+#pragma once
+
+#include "code-gen.h"
+#include <tokenizer/tokenizer.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+
+/*
+    Cache of the code generated for each function, for incremental builds (see the -incremental flag).
+
+    Each function definition is keyed by a hash of the tokens of its body, of all the tokens outside of the
+    function bodies (the global declarations, types and signatures it may depend on) and of the options the
+    generated code depends on. The bodies are skipped by the parser, and a function whose key is the same as in
+    the last build is neither parsed, transformed nor generated: its code from the last build is copied to the
+    output instead.
+
+    The code of a function depends on the rest of the file only through its labels: the labels of its blocks,
+    numbered in the order the middle end transforms the functions, and the labels of the .rodata constants it
+    uses, numbered in the order the code generator first meets them. Both are renumbered when the code is reused,
+    so that the output is the same as that of a clean build.
+*/
+struct BuildCache{
+    // a .rodata constant used by a function
+    struct RodataUse{
+        // label of the constant in the build the code was generated in
+        Label label;
+        MIR_Datatype::Tag tag;
+        size_t size;
+        uint64_t number;
+        // text of string literals, the key of the other constants is their number
+        std::string value;
+    };
+
+    struct CachedFunction{
+        uint64_t key;
+        // the labels of the blocks of the function when it was generated
+        Label firstLabel;
+        Label labelCount;
+        // in the order they were first used by the function
+        std::vector<RodataUse> rodata;
+        std::string code;
+    };
+
+    // cache file of the input
+    std::string path;
+    // the functions of the last build, and of this build, by name
+    std::unordered_map<std::string, CachedFunction> last;
+    std::unordered_map<std::string, CachedFunction> next;
+    // key of each function definition of this build
+    std::unordered_map<std::string, uint64_t> keys;
+    // the options the code depends on (the passes run, the SSA path), part of every key
+    std::string options;
+
+    size_t reusedFunctions;
+    size_t generatedFunctions;
+
+    // creates the cache directory if needed, returns false if it can't
+    bool init(const char *dir, const char *input);
+    bool load();
+    bool save();
+
+    // key the function definitions, and mark the ones whose code can be reused
+    void markReusedFunctions(AST *ast, const TokenBuffer &tokens);
+};
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <IR/ir.h>
+#include <IR/ssa.h>
 #include <sstream>
 #include <fstream>
+#include <vector>
+#include <map>
 
 
 #include "storage.h"
@@ -10,15 +13,45 @@
 
 struct GlobalSymbolInfo {
     size_t label;
+    // text of string literals
     Splice value;
+    // value of numeric constants
+    Number number;
     MIR_Datatype type;
     const char* symbolType;
 };
 
+/*
+    Key of a constant in .rodata: floating point constants by their type and bits, so that equal constants share
+    a symbol however they were written, and string literals by the atom of their text.
+*/
+struct RodataKey{
+    MIR_Datatype::Tag tag;
+    uint64_t bits;
+
+    bool operator<(const RodataKey &other) const{
+        return (tag != other.tag)? tag < other.tag : bits < other.bits;
+    }
+    bool operator==(const RodataKey &other) const{
+        return tag == other.tag && bits == other.bits;
+    }
+};
+
+struct BuildCache;
+
+// instruction helpers shared by the code generators (codegenMIR.cpp)
+RodataKey fpConstantKey(Number n);
+RodataKey stringLiteralKey(Splice literal);
+const char* iInsIntegerSuffix(size_t size);
+const char* fInsFloatSuffix(size_t size);
+const char* fInsIntegerSuffix(size_t size);
+
 struct CodeGenerator{
     
     SymbolTable<GlobalSymbolInfo> data;
-    SymbolTable<GlobalSymbolInfo> rodata;
+    // the .rodata constants in the order they were added, and the index of each by key
+    std::vector<GlobalSymbolInfo> rodata;
+    std::map<RodataKey, size_t> rodataIndex;
 
     std::stringstream rodataSection;
     std::stringstream dataSection;
@@ -34,6 +67,14 @@ struct CodeGenerator{
     MIR *mir;
     Arena *arena;
 
+    // set for incremental builds: the generated code is saved to it, and the code of the reused functions taken from it
+    BuildCache *cache = NULL;
+    // the .rodata symbols used by the function being generated, in the order they are first used
+    std::vector<RodataKey> usedRodata;
+
+    // the functions lowered to SSA form, generated from it instead of their MIR (see -ssa)
+    SymbolTable<SSA_Function*> ssaFunctions;
+
     
     
     // RV64D specific info
@@ -45,10 +86,16 @@ struct CodeGenerator{
     void generatePrimitiveMIR(MIR_Primitive* p, MIR_Scope* scope , ScopeInfo *storageScope);
     void generateExprMIR(MIR_Expr *current, RegisterPair dest, ScopeInfo *storageScope);
     size_t allocStackSpaceMIR(MIR_Scope* scope, ScopeInfo* storage);
+    void generateFunctionSSA(SSA_Function *foo, ScopeInfo *storageScope);
     void saveRegisters(RegisterState &rstate, std::stringstream &buffer);
     void restoreRegisters(RegisterState &rstate, std::stringstream &buffer);
     
     StorageInfo accessLocation(Splice symbolName, ScopeInfo* storageScope);
+    GlobalSymbolInfo rodataSymbol(RodataKey key, GlobalSymbolInfo info);
+
+    // incremental builds (see build-cache.h)
+    void cacheFunctionCode(MIR_Function *foo, const std::string &code);
+    void reuseFunctionCode(MIR_Function *foo);
     
     // output
     void writeAssemblyToFile(const char *filename);
@@ -1,11 +1,47 @@
 #include "code-gen.h"
 #include <utils/utils.h>
 #include <IR/number.h>
+#include <tokenizer/atoms.h>
+
+RodataKey fpConstantKey(Number n){
+    return RodataKey{.tag = n.type.tag, .bits = n.u64[0]};
+}
+
+// string literals typed as pointers or arrays share their symbol
+RodataKey stringLiteralKey(Splice literal){
+    return RodataKey{.tag = MIR_Datatype::TYPE_PTR, .bits = atomOf(literal)};
+}
+
+
+/*
+    The .rodata symbol of a constant, added with a new label the first time the constant is used.
+*/
+GlobalSymbolInfo CodeGenerator :: rodataSymbol(RodataKey key, GlobalSymbolInfo info){
+    auto found = rodataIndex.find(key);
+    if (found == rodataIndex.end()){
+        info.label = labeller.label();
+        found = rodataIndex.emplace(key, rodata.size()).first;
+        rodata.push_back(info);
+    }
+
+    // the build cache keeps the constants each function uses
+    if (cache){
+        bool isUsed = false;
+        for (RodataKey used : usedRodata){
+            isUsed = isUsed || used == key;
+        }
+        if (!isUsed){
+            usedRodata.push_back(key);
+        }
+    }
+    return rodata[found->second];
+}
+
 
 /*
     The instruction suffix for the size of integer load/store 
 */
-static const char* iInsIntegerSuffix(size_t size){
+const char* iInsIntegerSuffix(size_t size){
     /*
         8 bytes = "d"ouble word
         4 bytes = "w"ord
@@ -30,7 +66,7 @@ static const char* iInsIntegerSuffix(size_t size){
 /*
     The instruction suffix for the size of load/store of floats.
 */
-static const char* fInsFloatSuffix(size_t size){
+const char* fInsFloatSuffix(size_t size){
     /*
         8 bytes = "d"ouble precision
         4 bytes = "s"ingle precision
@@ -47,7 +83,7 @@ static const char* fInsFloatSuffix(size_t size){
 /*
     The instruction suffix for the size of integer in float conversion instructions. 
 */
-static const char* fInsIntegerSuffix(size_t size){
+const char* fInsIntegerSuffix(size_t size){
     /*
         8 bytes = "l"ong 
         4 bytes = "w"ord
@@ -730,6 +766,7 @@ void CodeGenerator :: generateAssemblyFromMIR(MIR *mir){
         gSymbol.label = label;
         gSymbol.type = type;
         gSymbol.value = Splice{.data = "0", .len = 1};
+        gSymbol.number = Number{.type = type, .u64 = {0}};
         data.add(symbolName, gSymbol);
         
     }
@@ -748,6 +785,7 @@ void CodeGenerator :: generateAssemblyFromMIR(MIR *mir){
         GlobalSymbolInfo symbol = data.getInfo(addressOf->addressOf.symbol).info;
         
         symbol.value = assignment->store.right->immediate.val;
+        symbol.number = castNumber(assignment->store.right->immediate.number, symbol.type);
         
 
         data.update(addressOf->addressOf.symbol, symbol);
@@ -769,8 +807,23 @@ void CodeGenerator :: generateAssemblyFromMIR(MIR *mir){
         regAlloc = RegisterAllocator{0};
         stackAlloc = StackAllocator{0};
 
-        generateFunctionMIR(&pair.second.info, mir->global, &s);
+        MIR_Function *foo = &pair.second.info;
+        if (foo->isReused){
+            reuseFunctionCode(foo);
+            continue;
+        }
+
+        usedRodata.clear();
+        if (ssaFunctions.existKey(foo->funcName)){
+            generateFunctionSSA(ssaFunctions.getInfo(foo->funcName).info, &s);
+        }
+        else {
+            generateFunctionMIR(foo, mir->global, &s);
+        }
 
+        if (cache && !foo->isExtern){
+            cacheFunctionCode(foo, buffer.str());
+        }
         textSection << buffer.str();
         buffer.str("");
         buffer.clear();
@@ -780,23 +833,18 @@ void CodeGenerator :: generateAssemblyFromMIR(MIR *mir){
     dataSection << "    .section     .data\n";
     
     // write out all the symbols in .rodata section
-    for (auto &rodataSymbol : rodata.entries){
-        GlobalSymbolInfo symbol = rodataSymbol.second.info;
+    for (GlobalSymbolInfo &symbol : rodata){
         
         rodataSection << ".symbol" << symbol.label << ":\n";
         
         switch (symbol.type.tag) {
         case MIR_Datatype::TYPE_F32:{
-            Number value = f32FromString(symbol.value.data);
-    
-            rodataSection << "    .word "  << value.u32[0] << "\n";
+            rodataSection << "    .word "  << symbol.number.u32[0] << "\n";
             break;
         }
         case MIR_Datatype::TYPE_F64:{
-            Number value = f64FromString(symbol.value.data);
-    
-            rodataSection << "    .word "  << value.u32[0] << "\n";
-            rodataSection << "    .word "  << value.u32[1] << "\n";
+            rodataSection << "    .word "  << symbol.number.u32[0] << "\n";
+            rodataSection << "    .word "  << symbol.number.u32[1] << "\n";
             break;
         }
         // string
@@ -819,35 +867,31 @@ void CodeGenerator :: generateAssemblyFromMIR(MIR *mir){
         switch (symbol.type.tag) {
         case MIR_Datatype::TYPE_U8:
         case MIR_Datatype::TYPE_I8:{
-            dataSection << "    .byte "  << symbol.value << "\n";
+            dataSection << "    .byte "  << symbol.number.i64[0] << "\n";
             break;
         }
         case MIR_Datatype::TYPE_U16:
         case MIR_Datatype::TYPE_I16:{
-            dataSection << "    .half "  << symbol.value << "\n";
+            dataSection << "    .half "  << symbol.number.i64[0] << "\n";
             break;
         }
         case MIR_Datatype::TYPE_U32:
         case MIR_Datatype::TYPE_I32:{
-            dataSection << "    .word "  << symbol.value << "\n";
+            dataSection << "    .word "  << symbol.number.i64[0] << "\n";
             break;
         }
         case MIR_Datatype::TYPE_U64:
         case MIR_Datatype::TYPE_I64:{
-            dataSection << "    .dword "  << symbol.value << "\n";
+            dataSection << "    .dword "  << symbol.number.i64[0] << "\n";
             break;
         }
         case MIR_Datatype::TYPE_F32:{
-            Number value = f32FromString(symbol.value.data);
-    
-            dataSection << "    .word "  << value.u32[0] << "\n";
+            dataSection << "    .word "  << symbol.number.u32[0] << "\n";
             break;
         }
         case MIR_Datatype::TYPE_F64:{
-            Number value = f64FromString(symbol.value.data);
-    
-            dataSection << "    .word "  << value.u32[0] << "\n";
-            dataSection << "    .word "  << value.u32[1] << "\n";
+            dataSection << "    .word "  << symbol.number.u32[0] << "\n";
+            dataSection << "    .word "  << symbol.number.u32[1] << "\n";
             break;
         }
         // string
@@ -915,26 +959,18 @@ void CodeGenerator::generateExprMIR(MIR_Expr *current, RegisterPair dest, ScopeI
         if (isIntegerType(current->_type)){
             // for string literal, load address
             if (current->_type.tag == MIR_Datatype::TYPE_PTR || current->_type.tag == MIR_Datatype::TYPE_ARRAY){
-                if (!rodata.existKey(current->immediate.val)){
-                    rodata.add(current->immediate.val, GlobalSymbolInfo{.label = labeller.label(), .value = current->immediate.val, .type = current->_type});
-                }
-                
-                GlobalSymbolInfo stringLiteralInfo = rodata.getInfo(current->immediate.val).info;
+                GlobalSymbolInfo stringLiteralInfo = rodataSymbol(stringLiteralKey(current->immediate.val), GlobalSymbolInfo{.value = current->immediate.val, .type = current->_type});
 
                 buffer << "    la " << destName << ", .symbol" << stringLiteralInfo.label << "\n";
             }
             else{
-                buffer << "    li " << destName << ", " << current->immediate.val << "\n";
+                buffer << "    li " << destName << ", " << current->immediate.number.i64[0] << "\n";
             }
         }
 
         // since there is no instruction in RV64 to load a immediate value into a floating point register
         else if (isFloatType(current->_type)){
-            if (!rodata.existKey(current->immediate.val)){
-                rodata.add(current->immediate.val, GlobalSymbolInfo{.label = labeller.label(), .value = current->immediate.val, .type = current->_type});
-            }
-            
-            GlobalSymbolInfo fpLiteralInfo = rodata.getInfo(current->immediate.val).info;
+            GlobalSymbolInfo fpLiteralInfo = rodataSymbol(fpConstantKey(current->immediate.number), GlobalSymbolInfo{.number = current->immediate.number, .type = current->_type});
 
             Register fpLiteralAddress = regAlloc.allocVRegister(RegisterType::REG_SAVED);
             const char* fpLiteralAddressName = RV64_RegisterName[regAlloc.resolveRegister(fpLiteralAddress)];
@@ -1352,6 +1388,17 @@ void CodeGenerator::generateExprMIR(MIR_Expr *current, RegisterPair dest, ScopeI
         const char *destName = RV64_RegisterName[regAlloc.resolveRegister(destReg)];
         const char *leftName = RV64_RegisterName[regAlloc.resolveRegister(left)];
         const char *rightName = RV64_RegisterName[regAlloc.resolveRegister(right)];
+
+        // the upper bits of a 32 bit value in a register are not always its extension (casts emit nothing),
+        // so 32 bit divisions and shifts use the word instructions, which only read the lower 32 bits
+        const char *word = (current->_type.size == 4)? "w" : "";
+        // the word instructions sign extend their result, unsigned values are kept zero extended as lwu loads them
+        auto zeroExtendWord = [&](){
+            if (current->_type.size == 4 && isUnsigned(current->_type)){
+                buffer << "    slli " << destName << ", " << destName << ", 32\n";
+                buffer << "    srli " << destName << ", " << destName << ", 32\n";
+            }
+        };
         
         switch (current->binary.op){
             case MIR_Expr::BinaryOp::EXPR_UADD:
@@ -1373,20 +1420,22 @@ void CodeGenerator::generateExprMIR(MIR_Expr *current, RegisterPair dest, ScopeI
                 break;
             }
             case MIR_Expr::BinaryOp::EXPR_UDIV:{
-                buffer << "    divu " << destName << ", " << leftName << ", " << rightName << "\n";
+                buffer << "    divu" << word << " " << destName << ", " << leftName << ", " << rightName << "\n";
+                zeroExtendWord();
                 break;
             }
             case MIR_Expr::BinaryOp::EXPR_IDIV:{
-                buffer << "    div " << destName << ", " << leftName << ", " << rightName << "\n";
+                buffer << "    div" << word << " " << destName << ", " << leftName << ", " << rightName << "\n";
                 break;
             }
             
             case MIR_Expr::BinaryOp::EXPR_UMOD:{
-                buffer << "    remu " << destName << ", " << leftName << ", " << rightName << "\n";
+                buffer << "    remu" << word << " " << destName << ", " << leftName << ", " << rightName << "\n";
+                zeroExtendWord();
                 break;
             }
             case MIR_Expr::BinaryOp::EXPR_IMOD:{
-                buffer << "    rem " << destName << ", " << leftName << ", " << rightName << "\n";
+                buffer << "    rem" << word << " " << destName << ", " << leftName << ", " << rightName << "\n";
                 break;
             }
 
@@ -1415,15 +1464,17 @@ void CodeGenerator::generateExprMIR(MIR_Expr *current, RegisterPair dest, ScopeI
             }
             
             case MIR_Expr::BinaryOp::EXPR_LOGICAL_LSHIFT:{
-                buffer << "    sll " << destName << ", " << leftName << ", " << rightName << "\n";
+                buffer << "    sll" << word << " " << destName << ", " << leftName << ", " << rightName << "\n";
+                zeroExtendWord();
                 break;
             }
             case MIR_Expr::BinaryOp::EXPR_LOGICAL_RSHIFT:{
-                buffer << "    srl " << destName << ", " << leftName << ", " << rightName << "\n";
+                buffer << "    srl" << word << " " << destName << ", " << leftName << ", " << rightName << "\n";
+                zeroExtendWord();
                 break;
             }
             case MIR_Expr::BinaryOp::EXPR_ARITHMETIC_RSHIFT:{
-                buffer << "    sra " << destName << ", " << leftName << ", " << rightName << "\n";
+                buffer << "    sra" << word << " " << destName << ", " << leftName << ", " << rightName << "\n";
                 break;
             }
             
@@ -1603,7 +1654,8 @@ void CodeGenerator::generateExprMIR(MIR_Expr *current, RegisterPair dest, ScopeI
                     
                     case MIR_Datatype::TYPE_F32 : 
                     case MIR_Datatype::TYPE_F64 :
-                    buffer  << "    fcvt." << fInsFloatSuffix(current->cast._to.size) << "." << iInsIntegerSuffix(current->cast._from.size) 
+                    // narrower integers are extended in their register, so they convert as words or longs
+                    buffer  << "    fcvt." << fInsFloatSuffix(current->cast._to.size) << "." << fInsIntegerSuffix(current->cast._from.size) 
                     << ((isUnsigned(current->cast._from))?"u":"") << " " << exprDestName << ", " << exprInName << "\n";
                     break;
                     
@@ -1633,8 +1685,9 @@ void CodeGenerator::generateExprMIR(MIR_Expr *current, RegisterPair dest, ScopeI
                     case MIR_Datatype::TYPE_U16:
                     case MIR_Datatype::TYPE_U32:
                     case MIR_Datatype::TYPE_U64:{
-                        buffer  << "    fcvt." << iInsIntegerSuffix(current->cast._to.size) << ((isUnsigned(current->cast._from))?"u":"") << "."
-                        << fInsFloatSuffix(current->cast._from.size)   << " " << exprDestName << ", " << exprInName << "\n";
+                        // C truncates towards zero, instead of the default rounding to nearest
+                        buffer  << "    fcvt." << fInsIntegerSuffix(current->cast._to.size) << ((isUnsigned(current->cast._to))?"u":"") << "."
+                        << fInsFloatSuffix(current->cast._from.size)   << " " << exprDestName << ", " << exprInName << ", rtz\n";
                         break;
                     }
                     
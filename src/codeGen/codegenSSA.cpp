@@ -0,0 +1,559 @@
+#include "code-gen.h"
+#include <utils/utils.h>
+
+
+/*
+    Code generation from the SSA form.
+
+    Each value has a home of 8 bytes in the frame, each phi also a second one it is copied to at the end
+    of the predecessors, so that the phis of a block all take the values of the same edge. The instructions
+    load their operands from the homes into t0, t1 (ft0, ft1), compute into t2 (ft2) and store it back.
+    t6 holds the addresses out of reach of the immediate offsets.
+
+    Frame, from fp down: the stack slots of the variables, the homes, then the stack arguments of calls at sp.
+    The prologue, epilogue and argument passing are the same as those of the code generated from the MIR.
+*/
+struct SSA_Frame{
+    std::vector<int64_t> slots;
+    std::vector<int64_t> homes;
+    std::vector<int64_t> phiHomes;
+    int64_t size;
+
+    // where the caller put each parameter
+    struct Location{
+        const char* reg;
+        int64_t stackOffset;
+    };
+    std::vector<Location> params;
+};
+
+
+static bool isFloatValue(SSA_Function *foo, SSA_Value v){
+    return isFloatType(foo->valueTypes[v]);
+}
+
+static bool isSmallerInteger(MIR_Datatype type){
+    return isIntegerType(type) && type.tag != MIR_Datatype::TYPE_BOOL && type.size < 8;
+}
+
+// stack space taken by the arguments of a call that don't fit in the argument registers
+static int64_t stackArgumentsSize(SSA_Function *foo, SSA_Instruction &call){
+    int occupiedXA = 0, occupiedFA = 0;
+    int64_t size = 0;
+    for (uint32_t i = 0; i < call.nArgs; i++){
+        MIR_Datatype type = foo->valueTypes[foo->args[call.firstArg + i]];
+        int &occupied = isFloatType(type)? occupiedFA : occupiedXA;
+        if (occupied < 8){
+            occupied++;
+        }
+        else {
+            size = alignUpPowerOf2(size, type.alignment) + type.size;
+        }
+    }
+    return alignUpPowerOf2(size, 16);
+}
+
+
+void CodeGenerator :: generateFunctionSSA(SSA_Function *foo, ScopeInfo *storageScope){
+    SSA_Frame frame;
+
+    // lay out the frame
+    int64_t top = 0;
+    for (SSA_Function::Slot &slot : foo->slots){
+        top = alignUpPowerOf2(top + slot.size, max(slot.alignment, 1));
+        frame.slots.push_back(-top);
+    }
+    frame.homes.assign(foo->nValues(), 0);
+    frame.phiHomes.assign(foo->nValues(), 0);
+    for (SSA_Value v = 1; v < foo->nValues(); v++){
+        top = alignUpPowerOf2(top, 8) + 8;
+        frame.homes[v] = -top;
+    }
+    int64_t outgoing = 0;
+    for (SSA_Block &block : foo->blocks){
+        for (SSA_Instruction &ins : block.instructions){
+            if (ins.op == SSA_Instruction::SSA_PHI){
+                top += 8;
+                frame.phiHomes[ins.dest] = -top;
+            }
+            else if (ins.op == SSA_Instruction::SSA_CALL){
+                outgoing = std::max(outgoing, stackArgumentsSize(foo, ins));
+            }
+        }
+    }
+    frame.size = alignUpPowerOf2(top, 16) + outgoing;
+
+    // follows the LP64D ABI, the same as generateFunctionMIR
+    {
+        const char* xa[] = {"a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7"};
+        const char* fa[] = {"fa0", "fa1", "fa2", "fa3", "fa4", "fa5", "fa6", "fa7"};
+        int occupiedXA = 0, occupiedFA = 0;
+        // no callee saved registers are saved, the stack arguments start right above the saved ra and fp
+        int64_t stackOffset = 16;
+
+        for (auto &param : foo->mir->parameters){
+            bool isFloat = isFloatType(param.type);
+            int &occupied = isFloat? occupiedFA : occupiedXA;
+            if (occupied < 8){
+                frame.params.push_back({isFloat? fa[occupied] : xa[occupied], 0});
+                occupied++;
+            }
+            else {
+                stackOffset = alignUpPowerOf2(stackOffset, param.type.alignment);
+                frame.params.push_back({NULL, stackOffset});
+                stackOffset += param.type.size;
+            }
+        }
+    }
+
+
+    // memory access at offset(base), through t6 if the offset is out of range of the immediate
+    auto memory = [&](const std::string &op, const char* reg, int64_t offset, const char* base){
+        if (!inRange(offset, -MAX_IMMEDIATE, MAX_IMMEDIATE)){
+            buffer << "    li t6, " << offset << "\n";
+            buffer << "    add t6, t6, " << base << "\n";
+            buffer << "    " << op << " " << reg << ", 0(t6)\n";
+        }
+        else {
+            buffer << "    " << op << " " << reg << ", " << offset << "(" << base << ")\n";
+        }
+    };
+    auto load = [&](SSA_Value v, const char* reg){
+        memory(isFloatValue(foo, v)? "fld" : "ld", reg, frame.homes[v], "fp");
+    };
+    auto store = [&](SSA_Value v, const char* reg){
+        memory(isFloatValue(foo, v)? "fsd" : "sd", reg, frame.homes[v], "fp");
+    };
+    auto operand = [&](SSA_Value v, int n){
+        const char* x[] = {"t0", "t1"};
+        const char* f[] = {"ft0", "ft1"};
+        const char* reg = isFloatValue(foo, v)? f[n] : x[n];
+        load(v, reg);
+        return reg;
+    };
+    // integers narrower than a register are kept sign or zero extended to 64 bits, as loaded from memory
+    auto normalize = [&](const char* reg, MIR_Datatype type){
+        if (!isSmallerInteger(type)){
+            return;
+        }
+        int shift = 64 - type.size * 8;
+        if (!isUnsigned(type) && type.size == 4){
+            buffer << "    sext.w " << reg << ", " << reg << "\n";
+            return;
+        }
+        buffer << "    slli " << reg << ", " << reg << ", " << shift << "\n";
+        buffer << "    " << (isUnsigned(type)? "srli " : "srai ") << reg << ", " << reg << ", " << shift << "\n";
+    };
+    auto label = [&](SSA_BlockId b){
+        return ".L" + std::string(foo->funcName.data, foo->funcName.len) + "_" + std::to_string(b);
+    };
+
+    // the values the phis of a successor take on the edge from block b, copied to the phi homes
+    auto phiCopies = [&](SSA_BlockId b, SSA_BlockId successor){
+        SSA_Block &block = foo->blocks[successor];
+        size_t predecessorNo = 0;
+        while (block.predecessors[predecessorNo] != b){
+            predecessorNo++;
+        }
+        for (SSA_Instruction &phi : block.instructions){
+            if (phi.op != SSA_Instruction::SSA_PHI){
+                break;
+            }
+            SSA_Value v = foo->args[phi.firstArg + predecessorNo];
+            const char* reg = isFloatValue(foo, v)? "ft2" : "t2";
+            load(v, reg);
+            memory(isFloatValue(foo, v)? "fsd" : "sd", reg, frame.phiHomes[phi.dest], "fp");
+        }
+    };
+
+
+    for (SSA_BlockId b = 0; b < foo->blocks.size(); b++){
+        SSA_Block &block = foo->blocks[b];
+        buffer << label(b) << ":\n";
+
+        for (SSA_Instruction &ins : block.instructions){
+            bool isFloatResult = isFloatType(ins.type);
+            const char* dest = isFloatResult? "ft2" : "t2";
+
+            switch (ins.op){
+            case SSA_Instruction::SSA_CONST:{
+                buffer << "    li t2, " << ins.imm << "\n";
+                break;
+            }
+            case SSA_Instruction::SSA_FCONST:{
+                // there is no instruction to load an immediate into a floating point register
+                GlobalSymbolInfo fpLiteralInfo = rodataSymbol(fpConstantKey(ins.number), GlobalSymbolInfo{.number = ins.number, .type = ins.type});
+                buffer << "    lui t0, \%hi(.symbol" << fpLiteralInfo.label << ")\n";
+                buffer << "    fl" << iInsIntegerSuffix(ins.type.size) << " ft2, \%lo(.symbol" << fpLiteralInfo.label << ")(t0)\n";
+                break;
+            }
+            case SSA_Instruction::SSA_STRING:{
+                GlobalSymbolInfo stringLiteralInfo = rodataSymbol(stringLiteralKey(ins.symbol), GlobalSymbolInfo{.value = ins.symbol, .type = ins.from});
+                buffer << "    la t2, .symbol" << stringLiteralInfo.label << "\n";
+                break;
+            }
+            case SSA_Instruction::SSA_PARAM:{
+                SSA_Frame::Location location = frame.params[ins.imm];
+                if (location.reg){
+                    buffer << "    " << (isFloatResult? "fmv.d " : "mv ") << dest << ", " << location.reg << "\n";
+                    normalize(dest, ins.type);
+                }
+                else {
+                    const char* suffix = isUnsigned(ins.type) && ins.type.size != XLEN? "u" : "";
+                    memory(std::string(isFloatResult? "f" : "") + "l" + iInsIntegerSuffix(ins.type.size) + (isFloatResult? "" : suffix), dest, location.stackOffset, "fp");
+                }
+                break;
+            }
+            case SSA_Instruction::SSA_SLOT_ADDRESS:{
+                int64_t offset = frame.slots[ins.imm];
+                if (!inRange(offset, -MAX_IMMEDIATE, MAX_IMMEDIATE)){
+                    buffer << "    li t2, " << offset << "\n";
+                    buffer << "    add t2, fp, t2\n";
+                }
+                else {
+                    buffer << "    addi t2, fp, " << offset << "\n";
+                }
+                break;
+            }
+            case SSA_Instruction::SSA_GLOBAL_ADDRESS:{
+                StorageInfo location = accessLocation(ins.symbol, storageScope);
+                assert(location.tag == StorageInfo::STORAGE_LABEL);
+                buffer << "    la t2, .symbol" << location.label << "\n";
+                break;
+            }
+
+            case SSA_Instruction::SSA_LOAD:{
+                const char* address = operand(ins.a, 0);
+                const char* suffix = isUnsigned(ins.type) && ins.size != XLEN? "u" : "";
+                std::string op = std::string(isFloatResult? "f" : "") + "l" + iInsIntegerSuffix(min(ins.size, XLEN)) + (isFloatResult? "" : suffix);
+                memory(op, dest, ins.imm, address);
+                break;
+            }
+            case SSA_Instruction::SSA_STORE:{
+                const char* address = operand(ins.a, 0);
+                const char* value = operand(ins.b, 1);
+                std::string op = std::string(isFloatResult? "f" : "") + "s" + iInsIntegerSuffix(min(ins.size, XLEN));
+                memory(op, value, ins.imm, address);
+                break;
+            }
+            case SSA_Instruction::SSA_COPY_MEMORY:{
+                operand(ins.a, 0);
+                operand(ins.b, 1);
+
+                // the largest pieces first, moving the addresses along before the offsets get out of range
+                int64_t offset = 0;
+                for (size_t remaining = ins.size; remaining > 0;){
+                    size_t piece = remaining >= 8? 8 : remaining >= 4? 4 : remaining >= 2? 2 : 1;
+                    if (offset + 8 > MAX_IMMEDIATE){
+                        buffer << "    addi t0, t0, " << offset << "\n";
+                        buffer << "    addi t1, t1, " << offset << "\n";
+                        offset = 0;
+                    }
+                    buffer << "    l" << iInsIntegerSuffix(piece) << " t2, " << offset << "(t1)\n";
+                    buffer << "    s" << iInsIntegerSuffix(piece) << " t2, " << offset << "(t0)\n";
+                    offset += piece;
+                    remaining -= piece;
+                }
+                break;
+            }
+
+            case SSA_Instruction::SSA_BINARY:{
+                const char* left = operand(ins.a, 0);
+                const char* right = operand(ins.b, 1);
+                const char* fs = fInsFloatSuffix(ins.size);
+
+                switch (ins.binary){
+                    case MIR_Expr::BinaryOp::EXPR_UADD:
+                    case MIR_Expr::BinaryOp::EXPR_IADD:
+                        buffer << "    add t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_USUB:
+                    case MIR_Expr::BinaryOp::EXPR_ISUB:
+                        buffer << "    sub t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UMUL:
+                    case MIR_Expr::BinaryOp::EXPR_IMUL:
+                        buffer << "    mul t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UDIV:
+                        buffer << "    divu t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_IDIV:
+                        buffer << "    div t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UMOD:
+                        buffer << "    remu t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_IMOD:
+                        buffer << "    rem t2, " << left << ", " << right << "\n";
+                        break;
+
+                    case MIR_Expr::BinaryOp::EXPR_LOGICAL_AND:
+                    case MIR_Expr::BinaryOp::EXPR_IBITWISE_AND:
+                        buffer << "    and t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_LOGICAL_OR:
+                    case MIR_Expr::BinaryOp::EXPR_IBITWISE_OR:
+                        buffer << "    or t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_IBITWISE_XOR:
+                        buffer << "    xor t2, " << left << ", " << right << "\n";
+                        break;
+
+                    case MIR_Expr::BinaryOp::EXPR_LOGICAL_LSHIFT:
+                        buffer << "    sll t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_LOGICAL_RSHIFT:
+                        buffer << "    srl t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_ARITHMETIC_RSHIFT:
+                        buffer << "    sra t2, " << left << ", " << right << "\n";
+                        break;
+
+                    case MIR_Expr::BinaryOp::EXPR_UCOMPARE_LT:
+                        buffer << "    sltu t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UCOMPARE_GT:
+                        buffer << "    sltu t2, " << right << ", " << left << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UCOMPARE_LE:
+                        buffer << "    sltu t2, " << right << ", " << left << "\n";
+                        buffer << "    xori t2, t2, 1\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UCOMPARE_GE:
+                        buffer << "    sltu t2, " << left << ", " << right << "\n";
+                        buffer << "    xori t2, t2, 1\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_ICOMPARE_LT:
+                        buffer << "    slt t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_ICOMPARE_GT:
+                        buffer << "    slt t2, " << right << ", " << left << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_ICOMPARE_LE:
+                        buffer << "    slt t2, " << right << ", " << left << "\n";
+                        buffer << "    xori t2, t2, 1\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_ICOMPARE_GE:
+                        buffer << "    slt t2, " << left << ", " << right << "\n";
+                        buffer << "    xori t2, t2, 1\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UCOMPARE_EQ:
+                    case MIR_Expr::BinaryOp::EXPR_ICOMPARE_EQ:
+                        buffer << "    sub t2, " << left << ", " << right << "\n";
+                        buffer << "    seqz t2, t2\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_UCOMPARE_NEQ:
+                    case MIR_Expr::BinaryOp::EXPR_ICOMPARE_NEQ:
+                        buffer << "    sub t2, " << left << ", " << right << "\n";
+                        buffer << "    snez t2, t2\n";
+                        break;
+
+                    case MIR_Expr::BinaryOp::EXPR_FADD:
+                        buffer << "    fadd." << fs << " ft2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FSUB:
+                        buffer << "    fsub." << fs << " ft2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FMUL:
+                        buffer << "    fmul." << fs << " ft2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FDIV:
+                        buffer << "    fdiv." << fs << " ft2, " << left << ", " << right << "\n";
+                        break;
+
+                    case MIR_Expr::BinaryOp::EXPR_FCOMPARE_LT:
+                        buffer << "    flt." << fs << " t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FCOMPARE_GT:
+                        buffer << "    fle." << fs << " t2, " << left << ", " << right << "\n";
+                        buffer << "    xori t2, t2, 1\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FCOMPARE_LE:
+                        buffer << "    fle." << fs << " t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FCOMPARE_GE:
+                        buffer << "    flt." << fs << " t2, " << left << ", " << right << "\n";
+                        buffer << "    xori t2, t2, 1\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FCOMPARE_EQ:
+                        buffer << "    feq." << fs << " t2, " << left << ", " << right << "\n";
+                        break;
+                    case MIR_Expr::BinaryOp::EXPR_FCOMPARE_NEQ:
+                        buffer << "    feq." << fs << " t2, " << left << ", " << right << "\n";
+                        buffer << "    xori t2, t2, 1\n";
+                        break;
+                    default:
+                        assert(false && "Some operation hasn't been accounted for.");
+                        break;
+                }
+                normalize(dest, ins.type);
+                break;
+            }
+            case SSA_Instruction::SSA_UNARY:{
+                const char* value = operand(ins.a, 0);
+
+                switch (ins.unary){
+                    case MIR_Expr::UnaryOp::EXPR_INEGATE:
+                        buffer << "    neg t2, " << value << "\n";
+                        break;
+                    case MIR_Expr::UnaryOp::EXPR_FNEGATE:
+                        buffer << "    fneg." << fInsFloatSuffix(ins.type.size) << " ft2, " << value << "\n";
+                        break;
+                    case MIR_Expr::UnaryOp::EXPR_IBITWISE_NOT:
+                        buffer << "    not t2, " << value << "\n";
+                        break;
+                    case MIR_Expr::UnaryOp::EXPR_LOGICAL_NOT:
+                        buffer << "    seqz t2, " << value << "\n";
+                        break;
+                    default:
+                        buffer << "    " << (isFloatResult? "fmv.d " : "mv ") << dest << ", " << value << "\n";
+                        break;
+                }
+                normalize(dest, ins.type);
+                break;
+            }
+            case SSA_Instruction::SSA_CAST:{
+                const char* value = operand(ins.a, 0);
+                MIR_Datatype from = ins.from, to = ins.type;
+
+                if (to.tag == MIR_Datatype::TYPE_BOOL){
+                    if (isFloatType(from)){
+                        buffer << "    fcvt." << fInsFloatSuffix(from.size) << ".l ft1, zero\n";
+                        buffer << "    feq." << fInsFloatSuffix(from.size) << " t2, " << value << ", ft1\n";
+                        buffer << "    xori t2, t2, 1\n";
+                    }
+                    else {
+                        buffer << "    snez t2, " << value << "\n";
+                    }
+                }
+                else if (isFloatType(from) && isFloatType(to)){
+                    buffer << "    fcvt." << fInsFloatSuffix(to.size) << "." << fInsFloatSuffix(from.size) << " ft2, " << value << "\n";
+                }
+                else if (isFloatType(to)){
+                    buffer << "    fcvt." << fInsFloatSuffix(to.size) << "." << fInsIntegerSuffix(from.size == 8? 8 : 4)
+                           << (isUnsigned(from)? "u" : "") << " ft2, " << value << "\n";
+                }
+                else if (isFloatType(from)){
+                    // C truncates towards zero
+                    buffer << "    fcvt." << fInsIntegerSuffix(to.size == 8? 8 : 4) << (isUnsigned(to)? "u" : "") << "."
+                           << fInsFloatSuffix(from.size) << " t2, " << value << ", rtz\n";
+                    normalize(dest, to);
+                }
+                else {
+                    buffer << "    mv t2, " << value << "\n";
+                    normalize(dest, to);
+                }
+                break;
+            }
+            case SSA_Instruction::SSA_CALL:{
+                const char* xa[] = {"a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7"};
+                const char* fa[] = {"fa0", "fa1", "fa2", "fa3", "fa4", "fa5", "fa6", "fa7"};
+                int occupiedXA = 0, occupiedFA = 0;
+                int64_t stackOffset = 0;
+
+                for (uint32_t i = 0; i < ins.nArgs; i++){
+                    SSA_Value arg = foo->args[ins.firstArg + i];
+                    MIR_Datatype type = foo->valueTypes[arg];
+                    bool isFloat = isFloatType(type);
+                    int &occupied = isFloat? occupiedFA : occupiedXA;
+
+                    if (occupied < 8){
+                        load(arg, isFloat? fa[occupied] : xa[occupied]);
+                        occupied++;
+                    }
+                    else {
+                        const char* reg = operand(arg, 0);
+                        stackOffset = alignUpPowerOf2(stackOffset, type.alignment);
+                        memory(std::string(isFloat? "f" : "") + "s" + iInsIntegerSuffix(type.size), reg, stackOffset, "sp");
+                        stackOffset += type.size;
+                    }
+                }
+
+                buffer << "    call " << ins.symbol << "\n";
+
+                if (ins.dest != SSA_NO_VALUE){
+                    if (isFloatResult){
+                        buffer << "    fmv.d ft2, fa0\n";
+                    }
+                    else {
+                        buffer << "    mv t2, a0\n";
+                        normalize(dest, ins.type);
+                    }
+                }
+                break;
+            }
+            case SSA_Instruction::SSA_COPY:{
+                load(ins.a, dest);
+                break;
+            }
+            case SSA_Instruction::SSA_PHI:{
+                memory(isFloatResult? "fld" : "ld", dest, frame.phiHomes[ins.dest], "fp");
+                break;
+            }
+
+            case SSA_Instruction::SSA_JUMP:{
+                phiCopies(b, ins.target[0]);
+                if (ins.target[0] != b + 1){
+                    buffer << "    j " << label(ins.target[0]) << "\n";
+                }
+                break;
+            }
+            case SSA_Instruction::SSA_BRANCH:{
+                operand(ins.a, 0);
+                phiCopies(b, ins.target[0]);
+                phiCopies(b, ins.target[1]);
+                buffer << "    bnez t0, " << label(ins.target[0]) << "\n";
+                if (ins.target[1] != b + 1){
+                    buffer << "    j " << label(ins.target[1]) << "\n";
+                }
+                break;
+            }
+            case SSA_Instruction::SSA_RETURN:{
+                if (ins.a != SSA_NO_VALUE){
+                    load(ins.a, isFloatValue(foo, ins.a)? "fa0" : "a0");
+                }
+                buffer << "    j ." << foo->funcName << "_ep\n";
+                break;
+            }
+            default:
+                assert(false && "Some instruction is not accounted for.");
+                break;
+            }
+
+            if (ins.dest != SSA_NO_VALUE){
+                store(ins.dest, dest);
+            }
+        }
+    }
+
+
+    // function prologue
+    std::stringstream prologue;
+    prologue << "    .globl " << foo->funcName << "\n";
+    prologue << foo->funcName << ":\n";
+    prologue << "    addi sp, sp, -16\n";
+    prologue << "    sd ra, 8(sp)\n";
+    prologue << "    sd fp, 0(sp)\n";
+    prologue << "    mv fp, sp\n";
+    if (frame.size > 0){
+        if (!inRange(frame.size, -MAX_IMMEDIATE, MAX_IMMEDIATE)){
+            prologue << "    li t0, " << -frame.size << "\n";
+            prologue << "    add sp, sp, t0\n";
+        }
+        else {
+            prologue << "    addi sp, sp, " << -frame.size << "\n";
+        }
+    }
+
+    // function epilogue
+    std::stringstream epilogue;
+    epilogue << "." << foo->funcName << "_ep:\n";
+    epilogue << "    mv sp, fp\n";
+    epilogue << "    ld fp, 0(sp)\n";
+    epilogue << "    ld ra, 8(sp)\n";
+    epilogue << "    addi sp, sp, 16\n";
+    epilogue << "    ret\n\n\n";
+
+    buffer.str(prologue.str() + buffer.str() + epilogue.str());
+}
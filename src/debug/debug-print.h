@@ -1,4 +1,19 @@
 #include <IR/ir.h>
+#include <IR/ssa.h>
+
+// text of an immediate, the ones made by constant folding have none and are printed from their value
+static std::string immediateText(MIR_Expr *e){
+    if (e->immediate.val.data){
+        return std::string(e->immediate.val.data, e->immediate.val.len);
+    }
+    if (isFloatType(e->_type)){
+        return std::to_string(e->_type.size == 4? e->immediate.number.f32[0] : e->immediate.number.f64[0]);
+    }
+    if (isUnsigned(e->_type)){
+        return std::to_string(e->immediate.number.u64[0]);
+    }
+    return std::to_string(e->immediate.number.i64[0]);
+}
 
 static int mirNodeCounter = 0; 
 static std::string generateMIRDotNode(MIR_Primitive* mirNode, std::ostringstream& dotStream) {
@@ -93,7 +108,7 @@ static std::string generateMIRDotNode(MIR_Primitive* mirNode, std::ostringstream
                     break;
                 }
                 case MIR_Expr::EXPR_LOAD_IMMEDIATE: {
-                    nodeLabel = "EXPR_LOAD_IMMEDIATE: " + std::string(exprNode->immediate.val.data, exprNode->immediate.val.len);
+                    nodeLabel = "EXPR_LOAD_IMMEDIATE: " + immediateText(exprNode);
                     break;
                 }
                 case MIR_Expr::EXPR_STORE: {
@@ -346,7 +361,7 @@ static void printMIRPrimitive(MIR_Primitive* p, int depth){
         }
         case MIR_Expr::EXPR_LOAD_IMMEDIATE:{
             printTabs(depth + 1);
-            std::cout << "immediate value: " << enode->immediate.val << "\n";
+            std::cout << "immediate value: " << immediateText(enode) << "\n";
             break;
         }
         
@@ -514,6 +529,106 @@ static void printMIR(MIR *mir){
     }
 }
 
+static void printSSA(SSA_Function *f){
+    static const char* OpcodeStrings[] = {
+        "const", "fconst", "string", "param", "slot_address", "global_address",
+        "load", "store", "copy_memory",
+        "binary", "unary", "cast", "call", "copy", "phi",
+        "jump", "branch", "return",
+        "read_variable", "write_variable",
+    };
+    static const char* BinaryOpStrings[] = {
+        "iadd", "isub", "imul", "idiv", "imod", "uadd", "usub", "umul", "udiv", "umod",
+        "fadd", "fsub", "fmul", "fdiv",
+        "ibitwise_and", "ibitwise_or", "ibitwise_xor", "logical_and", "logical_or",
+        "logical_lshift", "logical_rshift", "arithmetic_rshift",
+        "icompare_lt", "icompare_gt", "icompare_le", "icompare_ge", "icompare_eq", "icompare_neq",
+        "ucompare_lt", "ucompare_gt", "ucompare_le", "ucompare_ge", "ucompare_eq", "ucompare_neq",
+        "fcompare_lt", "fcompare_gt", "fcompare_le", "fcompare_ge", "fcompare_eq", "fcompare_neq",
+    };
+    static const char* UnaryOpStrings[] = {"inegate", "fnegate", "ibitwise_not", "logical_not"};
+
+    std::cout << "SSA Function: " << f->funcName << "\n";
+    for (SSA_BlockId b = 0; b < f->blocks.size(); b++){
+        SSA_Block &block = f->blocks[b];
+        std::cout << "block " << b << ": (idom " << block.idom << ", predecessors";
+        for (SSA_BlockId p : block.predecessors){
+            std::cout << " " << p;
+        }
+        std::cout << ")\n";
+
+        for (SSA_Instruction &ins : block.instructions){
+            std::cout << "    ";
+            if (ins.dest != SSA_NO_VALUE){
+                std::cout << "%" << ins.dest << " = ";
+            }
+            std::cout << OpcodeStrings[ins.op] << " " << ins.type.name;
+
+            switch (ins.op){
+            case SSA_Instruction::SSA_CONST:
+            case SSA_Instruction::SSA_PARAM:
+            case SSA_Instruction::SSA_SLOT_ADDRESS:
+                std::cout << " " << ins.imm;
+                break;
+            case SSA_Instruction::SSA_FCONST:
+                std::cout << " " << (ins.type.size == 4? ins.number.f32[0] : ins.number.f64[0]);
+                break;
+            case SSA_Instruction::SSA_STRING:
+            case SSA_Instruction::SSA_GLOBAL_ADDRESS:
+                std::cout << " " << ins.symbol;
+                break;
+            case SSA_Instruction::SSA_LOAD:
+                std::cout << " [%" << ins.a << " + " << ins.imm << "]";
+                break;
+            case SSA_Instruction::SSA_STORE:
+                std::cout << " [%" << ins.a << " + " << ins.imm << "], %" << ins.b;
+                break;
+            case SSA_Instruction::SSA_COPY_MEMORY:
+                std::cout << " [%" << ins.a << "], [%" << ins.b << "], " << ins.size;
+                break;
+            case SSA_Instruction::SSA_BINARY:
+                std::cout << " " << BinaryOpStrings[(int) ins.binary] << " %" << ins.a << ", %" << ins.b;
+                break;
+            case SSA_Instruction::SSA_UNARY:
+                std::cout << " " << UnaryOpStrings[(int) ins.unary] << " %" << ins.a;
+                break;
+            case SSA_Instruction::SSA_CAST:
+                std::cout << " from " << ins.from.name << " %" << ins.a;
+                break;
+            case SSA_Instruction::SSA_CALL:
+                std::cout << " " << ins.symbol << "(";
+                for (uint32_t i = 0; i < ins.nArgs; i++){
+                    std::cout << (i? ", %" : "%") << f->args[ins.firstArg + i];
+                }
+                std::cout << ")";
+                break;
+            case SSA_Instruction::SSA_PHI:
+                for (uint32_t i = 0; i < ins.nArgs; i++){
+                    std::cout << (i? ", [%" : " [%") << f->args[ins.firstArg + i] << ", block " << block.predecessors[i] << "]";
+                }
+                break;
+            case SSA_Instruction::SSA_COPY:
+                std::cout << " %" << ins.a;
+                break;
+            case SSA_Instruction::SSA_JUMP:
+                std::cout << " block " << ins.target[0];
+                break;
+            case SSA_Instruction::SSA_BRANCH:
+                std::cout << " %" << ins.a << ", block " << ins.target[0] << ", block " << ins.target[1];
+                break;
+            case SSA_Instruction::SSA_RETURN:
+                if (ins.a != SSA_NO_VALUE){
+                    std::cout << " %" << ins.a;
+                }
+                break;
+            default:
+                break;
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
 // FOR Parser output in tree structure
 static int nodeCounter = 0;
 static std::string generateDotNode(Node *node, std::ostringstream &dotStream) {
@@ -1,14 +1,56 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <tokenizer/source.h>
 
 #define splicePrintf(splice) (int)splice.len, splice.data 
 
 #define logErrorMessage(errorAtToken, message, ...)  \
-    fprintf(stderr, "[Error] %3d:%-3d " message "\n", errorAtToken.lineNo, errorAtToken.charNo, ##__VA_ARGS__);
+    logDiagnosticAt(errorAtToken, "[Error]", message "\n", ##__VA_ARGS__);
 
 #define logWarningMessage(warningAtToken, message, ...)  \
-    fprintf(stderr, "[Warning] %3d:%-3d " message "\n", warningAtToken.lineNo, warningAtToken.charNo, ##__VA_ARGS__);
+    logDiagnosticAt(warningAtToken, "[Warning]", message "\n", ##__VA_ARGS__);
+
+
+// set on a thread whose diagnostics are held back, to be printed in order with those of the other threads
+inline thread_local std::string *diagnosticBuffer = NULL;
+
+inline void logDiagnosticV(const char *format, va_list args){
+    if (!diagnosticBuffer){
+        vfprintf(stderr, format, args);
+        return;
+    }
+
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    size_t at = diagnosticBuffer->size();
+    diagnosticBuffer->resize(at + len + 1);
+    vsnprintf(diagnosticBuffer->data() + at, len + 1, format, args);
+    diagnosticBuffer->resize(at + len);
+}
+
+inline void logDiagnostic(const char *format, ...){
+    va_list args;
+    va_start(args, format);
+    logDiagnosticV(format, args);
+    va_end(args);
+}
+
+// the token is located once per message, a lookup takes the source registry lock and searches the sources
+inline void logDiagnosticAt(const Token &token, const char *kind, const char *format, ...){
+    SourceLocation location = locateToken(token);
+    logDiagnostic("%s %3d:%-3d ", kind, location.lineNo, location.charNo);
+
+    va_list args;
+    va_start(args, format);
+    logDiagnosticV(format, args);
+    va_end(args);
+}
 
 enum ErrorCode{
     ERROR_UNKNOWN,
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <tokenizer/token.h>
+#include <stdint.h>
+
+
+/*
+    Binding powers of the expression operators, looked up by token type while parsing an expression.
+    Precedences are referenced from https://en.cppreference.com/w/c/language/operator_precedence,
+    a lower value binds tighter, and LOWEST_PRECEDENCE is the precedence a whole expression is parsed at.
+*/
+static constexpr int LOWEST_PRECEDENCE = INT32_MAX;
+static constexpr int NOT_AN_OPERATOR = -1;
+
+
+struct BindingPower{
+    // precedence of the token as a binary or postfix operator, NOT_AN_OPERATOR if it cannot follow an operand
+    int infix = NOT_AN_OPERATOR;
+    // precedence the operand of the token is parsed at as a prefix operator, NOT_AN_OPERATOR if it cannot start one
+    int prefix = NOT_AN_OPERATOR;
+    bool isPostfix = false;
+    bool isRightAssociative = false;
+};
+
+
+struct BindingPowerTable{
+    BindingPower powers[TOKEN_COUNT] = {};
+
+    constexpr const BindingPower &operator[](int type) const{
+        return powers[type];
+    }
+};
+
+
+static constexpr BindingPowerTable buildBindingPowerTable(){
+    BindingPowerTable t;
+
+    auto infix = [&](TokenType type, int precedence){
+        t.powers[type].infix = precedence;
+    };
+    auto rightAssociative = [&](TokenType type, int precedence){
+        t.powers[type].infix = precedence;
+        t.powers[type].isRightAssociative = true;
+    };
+    auto prefix = [&](TokenType type, int precedence){
+        t.powers[type].prefix = precedence;
+    };
+
+    // postfix: a++ a-- a[i] a.b a->b
+    t.powers[TOKEN_PLUS_PLUS] = {.infix = 1, .isPostfix = true};
+    t.powers[TOKEN_MINUS_MINUS] = {.infix = 1, .isPostfix = true};
+    infix(TOKEN_SQUARE_OPEN, 1);
+    infix(TOKEN_DOT, 1);
+    infix(TOKEN_ARROW, 1);
+
+    // prefix: ++a --a +a -a !a ~a *a &a
+    prefix(TOKEN_PLUS_PLUS, 2);
+    prefix(TOKEN_MINUS_MINUS, 2);
+    prefix(TOKEN_PLUS, 2);
+    prefix(TOKEN_MINUS, 2);
+    prefix(TOKEN_LOGICAL_NOT, 2);
+    prefix(TOKEN_BITWISE_NOT, 2);
+    prefix(TOKEN_STAR, 2);
+    prefix(TOKEN_AMPERSAND, 2);
+
+    infix(TOKEN_STAR, 3);
+    infix(TOKEN_SLASH, 3);
+    infix(TOKEN_MODULO, 3);
+    infix(TOKEN_PLUS, 4);
+    infix(TOKEN_MINUS, 4);
+    infix(TOKEN_SHIFT_LEFT, 5);
+    infix(TOKEN_SHIFT_RIGHT, 5);
+    infix(TOKEN_GREATER_EQUALS, 6);
+    infix(TOKEN_GREATER_THAN, 6);
+    infix(TOKEN_LESS_EQUALS, 6);
+    infix(TOKEN_LESS_THAN, 6);
+    infix(TOKEN_EQUALITY_CHECK, 7);
+    infix(TOKEN_NOT_EQUALS, 7);
+    infix(TOKEN_AMPERSAND, 8);
+    infix(TOKEN_BITWISE_XOR, 9);
+    infix(TOKEN_BITWISE_OR, 10);
+    infix(TOKEN_LOGICAL_AND, 11);
+    infix(TOKEN_LOGICAL_OR, 12);
+
+    rightAssociative(TOKEN_ASSIGNMENT, 14);
+    rightAssociative(TOKEN_PLUS_ASSIGN, 14);
+    rightAssociative(TOKEN_MINUS_ASSIGN, 14);
+    rightAssociative(TOKEN_MUL_ASSIGN, 14);
+    rightAssociative(TOKEN_DIV_ASSIGN, 14);
+    // these only bind as the outermost operator of an expression
+    rightAssociative(TOKEN_LSHIFT_ASSIGN, LOWEST_PRECEDENCE);
+    rightAssociative(TOKEN_RSHIFT_ASSIGN, LOWEST_PRECEDENCE);
+    rightAssociative(TOKEN_BITWISE_AND_ASSIGN, LOWEST_PRECEDENCE);
+    rightAssociative(TOKEN_BITWISE_OR_ASSIGN, LOWEST_PRECEDENCE);
+    rightAssociative(TOKEN_BITWISE_XOR_ASSIGN, LOWEST_PRECEDENCE);
+
+    return t;
+}
+
+static constexpr BindingPowerTable BINDING_POWERS = buildBindingPowerTable();
@@ -5,83 +5,11 @@
 #include <logger/logger.h>
 
 #include "parser.h"
+#include "binding-power.h"
+#include <utils/work-stealing.h>
 
 
 
-/*
-    Get relative precedence of an operator.
-    Referenced from https://en.cppreference.com/w/c/language/operator_precedence
-*/
-int getPrecedence(Token opToken, bool isUnary = false){
-    if (isUnary){
-        switch (opToken.type)
-        {        
-        case TOKEN_PLUS_PLUS_POSTFIX:
-        case TOKEN_MINUS_MINUS_POSTFIX:
-            return 1;
-        case TOKEN_PLUS_PLUS:
-        case TOKEN_MINUS_MINUS:
-            return 2;
-        case TOKEN_PLUS:
-        case TOKEN_MINUS:
-        case TOKEN_LOGICAL_NOT:
-        case TOKEN_BITWISE_NOT:
-        case TOKEN_STAR:
-        case TOKEN_AMPERSAND:
-            return 2;
-
-        default:
-            return INT32_MAX;
-        }
-    }
-    
-    
-    switch (opToken.type){
-    
-    case TOKEN_SQUARE_OPEN:
-    case TOKEN_DOT:
-    case TOKEN_ARROW:
-        return 1;
-    case TOKEN_STAR:
-    case TOKEN_SLASH:
-    case TOKEN_MODULO:
-        return 3;
-    case TOKEN_PLUS:
-    case TOKEN_MINUS:
-        return 4;
-    case TOKEN_SHIFT_LEFT:
-    case TOKEN_SHIFT_RIGHT:
-        return 5;
-    case TOKEN_GREATER_EQUALS: 
-    case TOKEN_GREATER_THAN: 
-    case TOKEN_LESS_EQUALS: 
-    case TOKEN_LESS_THAN:
-        return 6;
-    case TOKEN_EQUALITY_CHECK: 
-    case TOKEN_NOT_EQUALS:
-        return 7;
-    case TOKEN_AMPERSAND:
-        return 8;
-    case TOKEN_BITWISE_XOR:
-        return 9;
-    case TOKEN_BITWISE_OR:
-        return 10;
-    case TOKEN_LOGICAL_AND: 
-        return 11;
-    case TOKEN_LOGICAL_OR: 
-        return 12;
-    case TOKEN_ASSIGNMENT: 
-    case TOKEN_PLUS_ASSIGN: 
-    case TOKEN_MINUS_ASSIGN: 
-    case TOKEN_MUL_ASSIGN: 
-    case TOKEN_DIV_ASSIGN: 
-        return 14;
-    default:
-        return INT32_MAX;
-    }
-}
-
-
 /*
     Recover from error: skip until the next semi colon, start/end of scope or EOF.
 */
@@ -189,15 +117,15 @@ Token Parser::consumeToken(){
 
 
 /*
-    Rewind the parser state (current token) and tokenizer state (cursor/lineNo/charNo) to given checkpoint.
+    Rewind the parser state (current token) and tokenizer state (cursor) to given checkpoint.
 */
 void Parser::rewindTo(Token checkpoint){
     currentToken = checkpoint;
 
     // also rewind the tokenizer to a point after the tokenization of given checkpoint token
+    // in pre-lexed mode, only the token index is used
     Token tokenizerCheckpoint;
-    tokenizerCheckpoint.charNo = checkpoint.charNo + checkpoint.string.len;
-    tokenizerCheckpoint.lineNo = checkpoint.lineNo;
+    tokenizerCheckpoint.index = checkpoint.index + 1;
     tokenizerCheckpoint.string.data = checkpoint.string.data + checkpoint.string.len;
     tokenizer->rewindTo(tokenizerCheckpoint);
 }
@@ -216,50 +144,46 @@ bool Parser::isExprStart(){
     Parses the array info for a variable declaration
 */
 DataType Parser::parseArrayType(StatementBlock *scope, DataType memberType){
-    DataType varType = memberType;
-    DataType *arrayChainEnd = &varType;
-
-
-    while (match(TOKEN_SQUARE_OPEN)){
-        consumeToken();
+    if (!match(TOKEN_SQUARE_OPEN)){
+        return memberType;
+    }
+    consumeToken();
 
-        size_t elementCount = 0;
+    size_t elementCount = 0;
 
+    
+    if (match(TOKEN_SQUARE_CLOSE)){
+        logErrorMessage(peekToken(), "Incomplete type: Missing array size.");
+        errors++;
+    }
+    else{
+        Subexpr * count = parseSubexpr(LOWEST_PRECEDENCE, scope);
         
-        if (match(TOKEN_SQUARE_CLOSE)){
-            logErrorMessage(peekToken(), "Incomplete type: Missing array size.");
-            errors++;
-        }
-        else{
-            Subexpr * count = parseSubexpr(INT32_MAX, scope);
-            
 
-            // TODO: implement this to evaluate constant operations at compile time
-            assert(count->subtag == Subexpr::SUBEXPR_LEAF);
+        // TODO: implement this to evaluate constant operations at compile time
+        assert(count->subtag == Subexpr::SUBEXPR_LEAF);
 
-            DataType d = checkSubexprType(count, scope);
-            assert(match(d.type, TOKEN_INT));
+        DataType d = checkSubexprType(count, scope);
+        assert(match(d.type, TOKEN_INT));
 
-            elementCount = strtoll(count->leaf.string.data, 0, 10);
-        }
-        
+        elementCount = count->leaf.value.i64;
+    }
 
-        // add array to type
-        DataType array = {};
-        array.tag = DataType::TAG_ARRAY;
-        array.ptrTo = (DataType *)arena->alloc(sizeof(DataType));
-        array.arrayCount = elementCount;
-        array.flags |= DataType::Specifiers::CONST;
-        
-        (*arrayChainEnd) = array;
-        arrayChainEnd = arrayChainEnd->ptrTo;
+    expect(TOKEN_SQUARE_CLOSE);
 
-        expect(TOKEN_SQUARE_CLOSE);
-    }
+    // the dimensions after this one make up the element type
+    DataType elementType = parseArrayType(scope, memberType);
+    
 
-    (*arrayChainEnd) = memberType;
+    // add array to type
+    DataType array = {};
+    array.tag = DataType::TAG_ARRAY;
+    array.ptrTo = typeTable.canonical(elementType);
+    array.arrayCount = elementCount;
+    array.flags |= DataType::Specifiers::CONST;
+    array.id = typeTable.intern(array);
 
-    return varType;
+    return array;
 }
 
 
@@ -275,14 +199,7 @@ bool Parser::isTypeDefined(DataType d,  StatementBlock* scope){
         return true;
     case DataType::TAG_UNION :
     case DataType::TAG_STRUCT :{
-        StatementBlock* structDefScope = scope->findCompositeDeclaration(d.compositeName.string);
-        if (!structDefScope)
-            return false;
-        
-        if (!structDefScope->composites.getInfo(d.compositeName.string).info.defined)
-            return false;
-        
-        return true;
+        return scopes.lookupDefinedComposite(d.compositeName.string) != NULL;
     }
     case DataType::TAG_VOID :
         return true;
@@ -311,6 +228,7 @@ Token Parser::parseStructDefinition(StatementBlock *scope){
     Token unionOrStruct = consumeToken();
 
     Composite s;
+    s.init(arena);
     s.defined = false;
     s.isUnion = match(unionOrStruct, TOKEN_UNION);
     
@@ -324,6 +242,7 @@ Token Parser::parseStructDefinition(StatementBlock *scope){
         s.compositeName = peekToken();
         s.compositeName.string.data = "unnamed-struct";
         s.compositeName.string.len = strlen("unnamed-struct");
+        s.compositeName.string.atom = NO_ATOM;
     }
     
 
@@ -399,8 +318,10 @@ Token Parser::parseStructDefinition(StatementBlock *scope){
         }
         else{
             // unnamed composites aren't supported
-            if (!compare(s.compositeName.string, "unnamed-struct"))
+            if (!compare(s.compositeName.string, "unnamed-struct")){
                 scope->composites.add(s.compositeName.string, s);
+                scopes.bind(ScopeTable::SCOPE_COMPOSITE, s.compositeName.string, scope);
+            }
         }
     }
 
@@ -419,8 +340,7 @@ DataType Parser::parsePointerType(StatementBlock *scope, DataType baseType){
         consumeToken();
         ptr.tag = DataType::TAG_PTR;
         ptr.flags = DataType::Specifiers::NONE;
-        ptr.ptrTo = (DataType *)arena->alloc(sizeof(DataType));
-        *(ptr.ptrTo) = baseType;
+        ptr.ptrTo = typeTable.canonical(baseType);
     
 
         while (matchv(TYPE_QUALIFIER_TOKENS, ARRAY_COUNT(TYPE_QUALIFIER_TOKENS))){
@@ -432,6 +352,7 @@ DataType Parser::parsePointerType(StatementBlock *scope, DataType baseType){
             }
             consumeToken();
         }
+        ptr.id = typeTable.intern(ptr);
     }
 
     return ptr;
@@ -515,8 +436,8 @@ DataType Parser::parseBaseDataType(StatementBlock *scope){
         return DataTypes::Int;
     }
     // if is a typedef alias
-    else if (scope->findTypedef(peekToken().string)){
-        StatementBlock* typedefScope = scope->findTypedef(peekToken().string);
+    else if (match(TOKEN_IDENTIFIER) && scopes.lookup(ScopeTable::SCOPE_TYPEDEF, peekToken().string)){
+        StatementBlock* typedefScope = scopes.lookup(ScopeTable::SCOPE_TYPEDEF, peekToken().string);
         d = typedefScope->typedefs.getInfo(peekToken().string).info.aliasFor;
         consumeToken();
     }
@@ -568,6 +489,7 @@ DataType Parser::parseBaseDataType(StatementBlock *scope){
         d.tag = DataType::TAG_VOID;
     }
 
+    d.id = typeTable.intern(d);
     return d;
 }
 
@@ -671,7 +593,7 @@ bool Parser::canBeConverted(Subexpr *from, DataType fromType, DataType toType, S
         }
         
         if (toType.tag == DataType::TAG_STRUCT){
-            StatementBlock* structDeclnScope = scope->findCompositeDeclaration(toType.compositeName.string);
+            StatementBlock* structDeclnScope = scopes.lookupDefinedComposite(toType.compositeName.string);
             assert(structDeclnScope != NULL);
 
             Composite &structInfo = structDeclnScope->composites.getInfo(toType.compositeName.string).info;
@@ -862,6 +784,7 @@ void Parser :: parseTypedef(StatementBlock *scope){
     alias.identifier = consumeToken().string;
 
     scope->typedefs.add(alias.identifier, alias);
+    scopes.bind(ScopeTable::SCOPE_TYPEDEF, alias.identifier, scope);
     expect(TOKEN_SEMI_COLON);
 }
 
@@ -879,6 +802,10 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
     if (!expr){
         return DataTypes::Void;
     }
+    // each expression is checked once, so its errors are logged once and checking an expression tree is linear
+    if (expr->isTypeChecked){
+        return expr->type;
+    }
         
 
     auto checkType = [&]() -> DataType{
@@ -904,6 +831,7 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
             
             void* mem = arena->alloc(sizeof(DataType::CompositeType));
             d.composite = new (mem) DataType::CompositeType;
+            d.composite->types = decltype(d.composite->types)(arena);
             for (auto &val : expr->initList->values){
                 DataType dt = checkSubexprType(val, scope);
                 d.composite->types.push_back(dt);
@@ -951,7 +879,7 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
                 }
                 
                 DataType baseStructType = left.getBaseType();
-                StatementBlock *structDeclScope = scope->findCompositeDeclaration(baseStructType.compositeName.string);
+                StatementBlock *structDeclScope = scopes.lookupDefinedComposite(baseStructType.compositeName.string);
 
                 if (!structDeclScope){
                     logErrorMessage(expr->binary.op, "Not a valid composite type.");
@@ -1151,71 +1079,7 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
                             return left;
                         }
 
-                        // if any is double or float, convert to that
-                        if (match(left.type, TOKEN_DOUBLE) || match(right.type, TOKEN_DOUBLE)){
-                            return DataTypes::Double;
-                        }   
-                        else if (match(left.type, TOKEN_FLOAT) || match(right.type, TOKEN_FLOAT)){
-                            return DataTypes::Float;
-                        }   
-
-                        // same signedness, conversion to greater conversion rank
-                        else if ((left.isSet(DataType::Specifiers::SIGNED) && right.isSet(DataType::Specifiers::SIGNED))
-                                || (left.isSet(DataType::Specifiers::UNSIGNED) && right.isSet(DataType::Specifiers::UNSIGNED))){
-                            
-                            if (getIntegerConversionRank(left) > getIntegerConversionRank(right)){
-                                return left;
-                            }
-                            
-                            return right;
-                            
-                        }   
-                        
-                        // different signedness
-                        else {
-                            // if unsigned has higher or equal rank, then unsigned
-                            // else, if signed can accomodate full range of unsigned then convert to signed, 
-                            // else convert to unsigned counterpart of the signed types
-                            
-                            auto signedUnsignedConversion = [&](DataType unsignedType, DataType signedType){
-                                if (getIntegerConversionRank(unsignedType) >= getIntegerConversionRank(signedType)){
-                                    return unsignedType;
-                                }
-                                else if (signedType.isSet(DataType::Specifiers::LONG_LONG)){
-                                    return signedType;
-                                }
-                                else if (signedType.isSet(DataType::Specifiers::LONG)){
-                                    // signed long cannot accomodate unsigned int
-                                    if (!unsignedType.isSet(DataType::Specifiers::LONG)){
-                                        return signedType;
-                                    }
-                                }
-                                else if (!signedType.isSet(DataType::Specifiers::SHORT)){
-                                    // signed int can accomodate unsigned short and char
-                                    if (unsignedType.isSet(DataType::Specifiers::SHORT) || match(unsignedType.type, TOKEN_CHAR)){
-                                        return signedType;
-                                    }
-                                }
-                                else if (signedType.isSet(DataType::Specifiers::SHORT)){
-                                    // signed short can accomodate unsigneds char
-                                    if (match(unsignedType.type, TOKEN_CHAR)){
-                                        return signedType;
-                                    }
-                                }
-                                // unsigned counterpart of the signed types
-                                signedType.flags |= DataType::Specifiers::UNSIGNED;
-                                signedType.flags ^= DataType::Specifiers::SIGNED;
-                                return signedType;
-                            };
-                            
-                            
-                            if (left.isSet(DataType::Specifiers::UNSIGNED)){
-                                return signedUnsignedConversion(left, right);
-                            }
-                            else {
-                                return signedUnsignedConversion(right, left);
-                            }
-                        }
+                        return getArithmeticConversion(left, right);
                         
                     
                     }
@@ -1294,8 +1158,7 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
                 if (isValid){
                     DataType d;
                     d.tag = DataType::TAG_ADDRESS;
-                    d.ptrTo =  (DataType*) arena->alloc(sizeof(DataType));
-                    *(d.ptrTo) = operand;
+                    d.ptrTo = typeTable.canonical(operand);
 
                     return d;
                 }
@@ -1335,14 +1198,14 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
         case Subexpr::SUBEXPR_LEAF:{
             // check if identifier has been declared
             if (match(expr->leaf, TOKEN_IDENTIFIER)){
-                StatementBlock *varDeclScope = scope->findVarDeclaration(expr->leaf.string);
+                StatementBlock *varDeclScope = scopes.lookup(ScopeTable::SCOPE_SYMBOL, expr->leaf.string);
                 
                 if (varDeclScope){
                     DataType type = varDeclScope->symbols.getInfo(expr->leaf.string).info;
                     return type;
                 }
                 
-                StatementBlock *enumDeclScope = scope->findEnumValue(expr->leaf.string);
+                StatementBlock *enumDeclScope = scopes.lookup(ScopeTable::SCOPE_ENUM_VALUE, expr->leaf.string);
                 if (enumDeclScope){
                     return DataTypes::Int;
                 }
@@ -1435,6 +1298,7 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
     
     DataType dt = checkType();
     expr->type = dt;
+    expr->isTypeChecked = true;
     
     return dt;
 }
@@ -1445,51 +1309,30 @@ DataType Parser::checkSubexprType(Subexpr *expr, StatementBlock *scope){
     Parses a general expression.
 */
 Subexpr* Parser::parseSubexpr(int precedence, StatementBlock *scope){
-    Subexpr *left = (Subexpr*)parsePrimary(scope);
-
+    Subexpr *left = parsePrimary(scope);
 
-    Subexpr *s = left;
-    
-    // while next token is an operator and its precedence is higher (value is lower) than current one, add to the tree 
-    while (matchv(BINARY_OP_TOKENS, ARRAY_COUNT(BINARY_OP_TOKENS)) 
-        || matchv(TYPE_PREFIX_OPERATORS, ARRAY_COUNT(TYPE_PREFIX_OPERATORS))){
-        bool isRtoLAssociative = matchv(ASSIGNMENT_OP, ARRAY_COUNT(ASSIGNMENT_OP));
-        bool isUnary = matchv(TYPE_PREFIX_OPERATORS, ARRAY_COUNT(TYPE_PREFIX_OPERATORS));
-        
-        // isRtoLAssociative = isRtoLAssociative || match(TOKEN_SQUARE_OPEN);
-        int currentOpPrecedence = isUnary? getPrecedence(Token{.type = TOKEN_PLUS_PLUS_POSTFIX}, isUnary) : getPrecedence(peekToken());
+    // while the next token is an operator binding tighter than the enclosing one, the expression so far is its left operand
+    while (true){
+        const BindingPower &power = BINDING_POWERS[peekToken().type];
+        if (power.infix == NOT_AN_OPERATOR){
+            break;
+        }
         
-        // for left to right associativity, break out when next op has a lower or equal precedence than current one
-        if (currentOpPrecedence >= precedence){
-            // right to left associativity for assignment operators, ie dont break out for same precedence
-            if (isRtoLAssociative){
-                if (currentOpPrecedence > precedence)
-                    break;
-            }
-            else{
-                break;
-            }
-
+        // left to right associative operators of the same precedence are left to the enclosing operator, 
+        // right to left associative ones (assignments) take the operand
+        if (power.infix > precedence || (power.infix == precedence && !power.isRightAssociative)){
+            break;
         }
         
-        s = (Subexpr*) arena->alloc(sizeof(Subexpr));
+        Subexpr *s = (Subexpr*) arena->alloc(sizeof(Subexpr));
         s->tag = Node::NODE_SUBEXPR;
+        s->isTypeChecked = false;
         
-        if (isUnary){
-            Subexpr* postfix = (Subexpr*) arena->alloc(sizeof(Subexpr));
-            postfix->subtag = Subexpr::SUBEXPR_UNARY;
-            postfix->tag = Node::NODE_SUBEXPR;
-    
-            if (match(TOKEN_PLUS_PLUS)){
-                postfix->unary.op = consumeToken();
-                postfix->unary.op.type = TOKEN_PLUS_PLUS_POSTFIX;
-            }
-            else if (match(TOKEN_MINUS_MINUS)){
-                postfix->unary.op = consumeToken();
-                postfix->unary.op.type = TOKEN_MINUS_MINUS_POSTFIX;
-            }
-            postfix->unary.expr = left;
-            s = postfix;
+        if (power.isPostfix){
+            s->subtag = Subexpr::SUBEXPR_UNARY;
+            s->unary.op = consumeToken();
+            s->unary.op.type = (s->unary.op.type == TOKEN_PLUS_PLUS)? TOKEN_PLUS_PLUS_POSTFIX : TOKEN_MINUS_MINUS_POSTFIX;
+            s->unary.expr = left;
         }
         else {
             s->binary.left = left;
@@ -1499,11 +1342,11 @@ Subexpr* Parser::parseSubexpr(int precedence, StatementBlock *scope){
             Subexpr *next;
             // for array indexing []
             if (match(s->binary.op,TOKEN_SQUARE_OPEN)){
-                next = parseSubexpr(INT32_MAX, scope);
+                next = parseSubexpr(LOWEST_PRECEDENCE, scope);
                 expect(TOKEN_SQUARE_CLOSE);
             }
             else{
-                next = parseSubexpr(getPrecedence(s->binary.op), scope);
+                next = parseSubexpr(power.infix, scope);
             }
             
             s->binary.right  = next;
@@ -1519,7 +1362,7 @@ Subexpr* Parser::parseSubexpr(int precedence, StatementBlock *scope){
     }     
 
 
-    return s;
+    return left;
 }
 
 
@@ -1530,6 +1373,7 @@ Subexpr* Parser::parseSubexpr(int precedence, StatementBlock *scope){
 Subexpr* Parser::parsePrimary(StatementBlock *scope){
     Subexpr *s = (Subexpr*) arena->alloc(sizeof(Subexpr));
     s->tag = Node::NODE_SUBEXPR;
+    s->isTypeChecked = false;
     // (subexpr)
     if (match(TOKEN_PARENTHESIS_OPEN)){
         consumeToken();
@@ -1542,7 +1386,7 @@ Subexpr* Parser::parsePrimary(StatementBlock *scope){
             s->cast.expr = parsePrimary(scope);
         }
         else {
-            s->inside = parseSubexpr(INT32_MAX, scope);
+            s->inside = parseSubexpr(LOWEST_PRECEDENCE, scope);
             s->subtag = Subexpr::SUBEXPR_RECURSE_PARENTHESIS;
             expect(TOKEN_PARENTHESIS_CLOSE);
 
@@ -1559,11 +1403,12 @@ Subexpr* Parser::parsePrimary(StatementBlock *scope){
         
         void *mem = arena->alloc(sizeof(InitializerList));
         s->initList = new (mem) InitializerList;
+        s->initList->values = decltype(s->initList->values)(arena);
         s->tag = Node::NODE_SUBEXPR;
         s->subtag = Subexpr::SUBEXPR_INITIALIZER_LIST;
         
         while (isExprStart() || match(TOKEN_CURLY_OPEN)){
-            Subexpr* expr = parseSubexpr(INT32_MAX, scope);
+            Subexpr* expr = parseSubexpr(LOWEST_PRECEDENCE, scope);
             s->initList->values.push_back(expr);
 
             if (!match(TOKEN_COMMA)){
@@ -1575,10 +1420,10 @@ Subexpr* Parser::parsePrimary(StatementBlock *scope){
         expect(TOKEN_CURLY_CLOSE);
     }
     // unary 
-    else if (matchv(UNARY_OP_TOKENS, ARRAY_COUNT(UNARY_OP_TOKENS))){
+    else if (BINDING_POWERS[peekToken().type].prefix != NOT_AN_OPERATOR){
         s->unary.op = consumeToken();
 
-        s->unary.expr = parseSubexpr(getPrecedence(s->unary.op, true), scope);
+        s->unary.expr = parseSubexpr(BINDING_POWERS[s->unary.op.type].prefix, scope);
         s->subtag = Subexpr::SUBEXPR_UNARY;
     }
     // identifiers
@@ -1588,14 +1433,16 @@ Subexpr* Parser::parsePrimary(StatementBlock *scope){
         if (match(TOKEN_PARENTHESIS_OPEN)){
             expect(TOKEN_PARENTHESIS_OPEN);
 
-            FunctionCall *fooCall = (FunctionCall*) arena->alloc(sizeof(FunctionCall));
+            void *mem = arena->alloc(sizeof(FunctionCall));
+            FunctionCall *fooCall = new (mem) FunctionCall;
+            fooCall->arguments = decltype(fooCall->arguments)(arena);
             fooCall->funcName = identifier;
             size_t nArgs = 0;
 
             
             if (!match(TOKEN_PARENTHESIS_CLOSE)){
                 while (true){
-                    Subexpr *arg = parseSubexpr(INT32_MAX, scope);
+                    Subexpr *arg = parseSubexpr(LOWEST_PRECEDENCE, scope);
                     fooCall->arguments.push_back(arg);
                     nArgs++;
 
@@ -1735,6 +1582,7 @@ void Parser :: parseEnum(StatementBlock* scope){
                 errors++;
             }
             scope->enumValues.update(v.name, v);
+            scopes.bind(ScopeTable::SCOPE_ENUM_VALUE, v.name, scope);
             
             if (match(TOKEN_COMMA)){
                 consumeToken();
@@ -1750,11 +1598,13 @@ void Parser :: parseEnum(StatementBlock* scope){
     
 
     if (isNamed){
-        if (scope->findVarDeclaration(e.name) || (scope->findEnumClass(e.name) && e.isDefined)|| scope->findCompositeDeclaration(e.name) || scope->findTypedef(e.name)){
+        if (scopes.lookup(ScopeTable::SCOPE_SYMBOL, e.name) || (scopes.lookup(ScopeTable::SCOPE_ENUM_CLASS, e.name) && e.isDefined)
+            || scopes.lookupDefinedComposite(e.name) || scopes.lookup(ScopeTable::SCOPE_TYPEDEF, e.name)){
             logErrorMessage(peekToken(), "Redefinition of type \"%.*s\".", splicePrintf(e.name));
             errors++;
         }
         scope->enumClasses.update(e.name, e);
+        scopes.bind(ScopeTable::SCOPE_ENUM_CLASS, e.name, scope);
     }
 }
     
@@ -1819,9 +1669,11 @@ Node* Parser::parseDeclaration(StatementBlock *scope){
         expect(TOKEN_PARENTHESIS_OPEN);
         
         Function foo;
+        foo.parameters = decltype(foo.parameters)(arena);
         foo.returnType = type;
         foo.funcName = identifier;
         foo.block = NULL;
+        foo.deferredBody = NULL;
         foo.isVariadic = false;
         
         bool isDeclOnly = false;
@@ -1864,16 +1716,13 @@ Node* Parser::parseDeclaration(StatementBlock *scope){
         
         // if definition exists
         if (!isDeclOnly && match(TOKEN_CURLY_OPEN)){
-            
-            // parse function body
-            foo.block = parseStatementBlock(scope, true);
-            foo.block->subtag = StatementBlock::BLOCK_FUNCTION_BODY;
-            foo.block->funcName = foo.funcName;
-
-            // add parameters to symbol table
-            for (auto &p : foo.parameters){
-                foo.block->symbols.add(p.identifier.string, p.type);
-            }            
+            // in lazy mode, the body is parsed when it is needed
+            if (lazyBodies && scope == &ir->global){
+                foo.deferredBody = deferFunctionBody();
+            }
+            else{
+                foo.block = parseFunctionBody(&foo, scope);
+            }
         }
         // declaration only
         else{
@@ -1889,7 +1738,7 @@ Node* Parser::parseDeclaration(StatementBlock *scope){
             else{
                 Function f = ir->functions.getInfo(foo.funcName.string).info;
                 // if func definition already exists, then it is redefinition
-                if (f.block){
+                if (f.isDefined()){
                     logErrorMessage(foo.funcName, "Redefinition of function \"%.*s\".", splicePrintf(foo.funcName.string));
                     errors++;
                 }
@@ -1951,6 +1800,7 @@ Node* Parser::parseDeclaration(StatementBlock *scope){
     else{        
         void *mem = arena->alloc(sizeof(Declaration));
         Declaration *d =  new (mem) Declaration;
+        d->decln = decltype(d->decln)(arena);
 
         d->tag = Node::NODE_DECLARATION;
         
@@ -1985,13 +1835,14 @@ Node* Parser::parseDeclaration(StatementBlock *scope){
             // if there is an initializer value
             if (match(TOKEN_ASSIGNMENT)){
                 consumeToken();
-                var.initValue = parseSubexpr(INT32_MAX, scope);
+                var.initValue = parseSubexpr(LOWEST_PRECEDENCE, scope);
             }
 
 
             if (!scope->symbols.existKey(var.identifier.string)){
                 d->decln.push_back(var);
                 scope->symbols.add(var.identifier.string, var.type);
+                scopes.bind(ScopeTable::SCOPE_SYMBOL, var.identifier.string, scope);
             }
             else{
                 DataType prevType = scope->symbols.getInfo(var.identifier.string).info;
@@ -2018,7 +1869,7 @@ bool Parser :: isStartOfType(StatementBlock* scope){
     return matchv(DATA_TYPE_TOKENS, ARRAY_COUNT(DATA_TYPE_TOKENS))
         || matchv(TYPE_MODIFIER_TOKENS, ARRAY_COUNT(TYPE_MODIFIER_TOKENS))
         || matchv(TYPE_QUALIFIER_TOKENS, ARRAY_COUNT(TYPE_QUALIFIER_TOKENS))
-        || scope->findTypedef(peekToken().string);
+        || (match(TOKEN_IDENTIFIER) && scopes.lookup(ScopeTable::SCOPE_TYPEDEF, peekToken().string));
 }
 
 
@@ -2064,7 +1915,7 @@ Node* Parser::parseStatement(StatementBlock *scope){
         consumeToken();
     }
     else if (isExprStart()){
-        statement = parseSubexpr(INT32_MAX, scope);
+        statement = parseSubexpr(LOWEST_PRECEDENCE, scope);
         expect(TOKEN_SEMI_COLON);
     }
     else {
@@ -2090,7 +1941,7 @@ ReturnNode* Parser::parseReturn(StatementBlock *scope){
     
     // parse the return value
     if (!match(TOKEN_SEMI_COLON)){
-        r->returnVal = parseSubexpr(INT32_MAX, scope);
+        r->returnVal = parseSubexpr(LOWEST_PRECEDENCE, scope);
     }
     
     expect(TOKEN_SEMI_COLON);
@@ -2122,14 +1973,111 @@ ContinueNode* Parser::parseContinue(StatementBlock *scope){
 
 
 
+/*
+    Parses the body of a function definition.
+*/
+StatementBlock* Parser::parseFunctionBody(Function *foo, StatementBlock *scope){
+    StatementBlock *block = parseStatementBlock(scope, true);
+    block->subtag = StatementBlock::BLOCK_FUNCTION_BODY;
+    block->funcName = foo->funcName;
+
+    // add parameters to symbol table
+    for (auto &p : foo->parameters){
+        block->symbols.add(p.identifier.string, p.type);
+    }
+    return block;
+}
+
+
+static bool parseDeferredBodyOf(void *parser, Function *foo){
+    return ((Parser *)parser)->parseDeferredBody(foo);
+}
+
+
+/*
+    Skips a function body by matching its braces, recording where it starts to be parsed later.
+    An unterminated body is reported when it is parsed.
+*/
+DeferredBody* Parser::deferFunctionBody(){
+    DeferredBody *body = (DeferredBody *)arena->alloc(sizeof(DeferredBody));
+    body->start = peekToken();
+    body->scopeMark = scopes.mark();
+    body->isReused = false;
+    body->reusedLabels = 0;
+
+    // so that the later stages can have the body parsed when they reach it
+    ir->parseDeferredBody = parseDeferredBodyOf;
+    ir->parser = this;
+
+    int depth = 0;
+    do {
+        if (match(TOKEN_CURLY_OPEN)){
+            depth++;
+        }
+        else if (match(TOKEN_CURLY_CLOSE)){
+            depth--;
+        }
+        consumeToken();
+    } while (depth > 0 && !match(TOKEN_EOF));
+
+    body->end = peekToken().index;
+    return body;
+}
+
+
+/*
+    Parses and checks the deferred body of a function. The body is parsed as it would have been in place, 
+    seeing only the global names declared before it, and checked like the other bodies, with all of them.
+    Returns false if the body has errors.
+*/
+bool Parser::parseDeferredBody(Function *foo){
+    if (!foo->deferredBody){
+        return true;
+    }
+
+    size_t errorsBefore = errors;
+    Token resumeAt = peekToken();
+
+    rewindTo(foo->deferredBody->start);
+    didError = false;
+    
+    scopes.hideFrom(foo->deferredBody->scopeMark);
+    foo->block = parseFunctionBody(foo, &ir->global);
+    scopes.showAll();
+    
+    foo->deferredBody = NULL;
+    checkContext(foo->block, &ir->global);
+
+    rewindTo(resumeAt);
+    return errors == errorsBefore;
+}
+
+
+/*
+    Parses and checks all the function bodies that have not been parsed yet.
+    Returns the AST on no errors.
+*/
+AST* Parser::parseDeferredBodies(){
+    size_t errorsBefore = errors;
+    for (auto &foo : ir->functions.entries){
+        parseDeferredBody(&foo.second.info);
+    }
+
+    fprintf(stdout, "[Parser] %" PRIu64 " errors generated in function bodies.\n", errors - errorsBefore);
+    return (errors == 0)? ir : NULL;
+}
+
+
 StatementBlock* Parser::parseStatementBlock(StatementBlock *scope, bool blockMode){
     void *mem = arena->alloc(sizeof(StatementBlock));
     StatementBlock *block =  new (mem) StatementBlock;
+    block->init(arena);
     
     block->tag = Node::NODE_STMT_BLOCK;
     block->parent = scope;
     block->subtag = StatementBlock::BLOCK_UNNAMED;
     
+    scopes.enterScope();
     
     if (blockMode){
         expect(TOKEN_CURLY_OPEN);
@@ -2150,6 +2098,7 @@ StatementBlock* Parser::parseStatementBlock(StatementBlock *scope, bool blockMod
         }
     }
 
+    scopes.leaveScope();
     return block;
 }
 
@@ -2169,7 +2118,7 @@ Node* Parser::parseIf(StatementBlock *scope){
         expect(TOKEN_PARENTHESIS_OPEN);
         
         if (isExprStart()){
-            ifNode->condition = parseSubexpr(INT32_MAX, scope);
+            ifNode->condition = parseSubexpr(LOWEST_PRECEDENCE, scope);
         }
         else{
             ifNode->condition = NULL;
@@ -2215,7 +2164,7 @@ Node* Parser::parseWhile(StatementBlock *scope){
     // parse condition
     expect(TOKEN_PARENTHESIS_OPEN);
     if (isExprStart()){
-        whileNode->condition = parseSubexpr(INT32_MAX, scope);
+        whileNode->condition = parseSubexpr(LOWEST_PRECEDENCE, scope);
     }
     else{
         whileNode->condition = NULL;
@@ -2249,19 +2198,19 @@ Node* Parser::parseFor(StatementBlock *scope){
     // parse init expr
     expect(TOKEN_PARENTHESIS_OPEN);
     if (isExprStart()){
-        forNode->init = parseSubexpr(INT32_MAX, scope);
+        forNode->init = parseSubexpr(LOWEST_PRECEDENCE, scope);
     }
     expect(TOKEN_SEMI_COLON);
     
     // parse condition expr
     if (isExprStart()){
-        forNode->exitCondition = parseSubexpr(INT32_MAX, scope);
+        forNode->exitCondition = parseSubexpr(LOWEST_PRECEDENCE, scope);
     }
     expect(TOKEN_SEMI_COLON);
 
     // porse update expr
     if (isExprStart()){
-        forNode->update = parseSubexpr(INT32_MAX, scope);
+        forNode->update = parseSubexpr(LOWEST_PRECEDENCE, scope);
     }
     expect(TOKEN_PARENTHESIS_CLOSE);
     
@@ -2306,10 +2255,7 @@ AST *Parser::parseProgram(){
 
     }
 
-    for (auto &fooInfo : ir->functions.entries){
-        Function &foo = fooInfo.second.info;
-        checkContext(foo.block, &ir->global);
-    }
+    checkFunctionBodies(checkThreads);
     
     fprintf(stdout, "[Parser] %" PRIu64 " errors generated.\n", errors);
     return (errors == 0)? ir : NULL;
@@ -2317,6 +2263,80 @@ AST *Parser::parseProgram(){
 }
 
 
+/*
+    Set up a parser that only checks the context of bodies parsed by the parent, on a thread of its own.
+    It shares the tokens and the AST of the parent, but has its own scopes and allocates in the given arena.
+*/
+void Parser::initChecker(Parser *parent, Arena *arena){
+    this->tokenizer = parent->tokenizer;
+    this->currentToken = parent->currentToken;
+    this->didError = false;
+    this->errors = 0;
+    this->lazyBodies = false;
+    this->checkThreads = 0;
+    this->arena = arena;
+    this->ir = parent->ir;
+
+    this->scopes.init();
+    this->scopes.enterScope(&ir->global);
+}
+
+
+/*
+    Check the function bodies once the whole file is parsed, split across nThreads threads when there are
+    at least minBodies of them. Each thread checks with a parser of its own, and the diagnostics of each body
+    are held back and printed in the order of the functions, so the output is the same as on a single thread.
+*/
+void Parser::checkFunctionBodies(int nThreads, size_t minBodies){
+    ArenaVector<Function *> bodies(arena);
+    bodies.reserve(ir->functions.entries.size());
+    for (auto &fooInfo : ir->functions.entries){
+        bodies.push_back(&fooInfo.second.info);
+    }
+
+    if (nThreads <= 1 || bodies.size() < minBodies){
+        for (Function *foo : bodies){
+            checkContext(foo->block, &ir->global);
+        }
+        return;
+    }
+    nThreads = min(nThreads, (int)bodies.size());
+
+    // the types made while checking are kept on the expressions, so the arenas live as long as the AST
+    assert(checkerArenas.empty());
+    checkerArenas.resize(nThreads);
+    std::vector<Parser> checkers(nThreads);
+    for (int i=0; i<nThreads; i++){
+        checkerArenas[i].init(PAGE_SIZE * 2);
+        checkerArenas[i].createFrame();
+        checkers[i].initChecker(this, &checkerArenas[i]);
+    }
+
+    std::vector<std::string> diagnostics(bodies.size());
+    std::atomic<size_t> bodyErrors = 0;
+    shareAtoms(true);
+    runWorkStealing(bodies.size(), nThreads, [&](size_t i, int worker){
+        Parser &checker = checkers[worker];
+        size_t errorsBefore = checker.errors;
+
+        diagnosticBuffer = &diagnostics[i];
+        checker.checkContext(bodies[i]->block, &ir->global);
+        diagnosticBuffer = NULL;
+
+        bodyErrors.fetch_add(checker.errors - errorsBefore, std::memory_order_relaxed);
+    });
+    shareAtoms(false);
+
+    for (Parser &checker : checkers){
+        checker.destroy();
+    }
+    for (const std::string &d : diagnostics){
+        fwrite(d.data(), 1, d.size(), stderr);
+    }
+    errors += bodyErrors.load();
+}
+
+
 /*
     Check overall context of the program.
 */
@@ -2395,9 +2415,12 @@ bool Parser::checkContext(Node *n, StatementBlock *scope){
     case Node::NODE_STMT_BLOCK:{
         StatementBlock *s = (StatementBlock *)n;
 
+        // the block was left when it was parsed, so its names are bound again while it is checked
+        scopes.enterScope(s);
         for (auto &stmt: s->statements){
             checkContext(stmt, s);
         }
+        scopes.leaveScope();
 
         break;
     }
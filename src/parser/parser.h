@@ -3,6 +3,13 @@
 #include <IR/ir.h>
 #include <tokenizer/tokenizer.h>
 #include <arena/arena.h>
+#include "scope-table.h"
+
+#include <vector>
+
+
+// fewest function bodies for the context checking to be split across threads
+static const size_t PARALLEL_CHECK_MIN_BODIES = 64;
 
 
 struct Parser{
@@ -15,6 +22,9 @@ struct Parser{
     bool didError;
 
     AST *ir;
+
+    // the names declared in the open scopes
+    ScopeTable scopes;
     
 
     // token/state management
@@ -63,26 +73,57 @@ struct Parser{
     ContinueNode* parseContinue(StatementBlock *scope);
     BreakNode* parseBreak(StatementBlock *scope);
     StatementBlock* parseStatementBlock(StatementBlock *scope, bool blockMode);
+    StatementBlock* parseFunctionBody(Function *foo, StatementBlock *scope);
+    DeferredBody* deferFunctionBody();
+
+    // parallel context checking
+    std::vector<Arena> checkerArenas;
+    void initChecker(Parser *parent, Arena *arena);
+    void checkFunctionBodies(int nThreads, size_t minBodies = PARALLEL_CHECK_MIN_BODIES);
 
 public:
         
     size_t errors;
 
+    // skip function bodies while parsing the file, they are parsed on demand (see AST::parseDeferredBody)
+    bool lazyBodies;
+
+    // threads the function bodies are checked on once the file is parsed, 0 or 1 to check them on this thread
+    int checkThreads;
+
     AST * parseProgram();
+    bool parseDeferredBody(Function *foo);
+    AST* parseDeferredBodies();
     
 
     void init(Tokenizer *t, Arena *arena){
         this->tokenizer = t;
         this->currentToken = t->nextToken();
         this->errors = 0;
+        this->lazyBodies = false;
+        this->checkThreads = 0;
+        this->arena = arena;
 
-        this->ir = new AST;
+        // the whole tree lives in the arena, so it is freed with the frame the parse ran in
+        this->ir = new (arena->alloc(sizeof(AST))) AST;
+        this->ir->global.init(arena);
+        this->ir->functions.init(arena);
 
         this->ir->global.parent = 0;
         this->ir->global.tag = Node::NODE_STMT_BLOCK;
         this->ir->global.subtag = StatementBlock::BLOCK_UNNAMED;
 
-        this->arena = arena;
+        this->scopes.init();
+        this->scopes.enterScope();
+    }
+
+    void destroy(){
+        this->scopes.destroy();
+        for (Arena &a : checkerArenas){
+            a.destroyFrame();
+            a.destroy();
+        }
+        checkerArenas.clear();
     }
     
     AST *parse(){
@@ -91,16 +132,13 @@ public:
             Node *stmt = this->parseStatement(&ir->global);
             if (stmt){
                 this->ir->global.statements.push_back(stmt);
-                arena->createFrame();
                 checkContext(stmt, &ir->global);
-                arena->destroyFrame();
             }
         }
         
+        // the types found while checking are kept on the expressions, so they are allocated with the AST
         for (auto &foo: ir->functions.entries){
-            arena->createFrame();
             checkContext(foo.second.info.block, &ir->global);
-            arena->destroyFrame();
         }
 
         
@@ -0,0 +1,275 @@
+#include "parser.h"
+
+#include <chrono>
+#include <string>
+#include <fstream>
+
+
+/*
+    Parser microbenchmarks: parsing and context checking of long and deeply nested expressions,
+    and of a source made mostly of expression statements.
+    Usage: parser_bench.exe [c file to parse]
+    Each expression shape is generated with a growing number of terms, the time per term should stay flat
+    as the checking cost of an expression is linear in its size.
+    The rewind benchmarks compare the lazy tokenizer, which lexes the tokens after a rewind again, against the
+    pre-lexed token buffer on sources where the parser backtracks a lot.
+*/
+
+
+static const int N_RUNS = 5;
+
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/*
+    Wrap an expression statement of given number of terms in a function.
+*/
+static std::string generateSource(const char *shape, int terms){
+    std::string expr;
+    expr.reserve(terms * 8);
+
+    if (strcmp(shape, "flat") == 0){
+        // a + b * a + b * ...
+        for (int i=0; i<terms; i++){
+            expr += (i % 2)? "b" : "a";
+            expr += (i == terms - 1)? "" : ((i % 3)? " + " : " * ");
+        }
+    }
+    else if (strcmp(shape, "nested") == 0){
+        // (a + (b - (a + ...)))
+        for (int i=0; i<terms - 1; i++){
+            expr += (i % 2)? "(b - " : "(a + ";
+        }
+        expr += "a";
+        expr += std::string(terms - 1, ')');
+    }
+    else if (strcmp(shape, "casts") == 0){
+        // (long)(a + (long)(b + ...))
+        for (int i=0; i<terms - 1; i++){
+            expr += (i % 2)? "(long)(b + " : "(int)(a + ";
+        }
+        expr += "a";
+        expr += std::string(terms - 1, ')');
+    }
+    else if (strcmp(shape, "assign") == 0){
+        // a = b = a = ... = 1
+        for (int i=0; i<terms - 1; i++){
+            expr += (i % 2)? "b = " : "a = ";
+        }
+        expr += "1";
+    }
+
+    return "int main(){\n    long a;\n    long b;\n    a = " + expr + ";\n    return 0;\n}\n";
+}
+
+
+/*
+    Generate functions made of expression statements mixing all kinds of operators, of about given size.
+*/
+static std::string generateExpressionSource(size_t size){
+    static const char *statements[] = {
+        "    a = (a + b * 3) << 2 | (b - a) / 7;\n",
+        "    b += arr[a & 15] * -arr[(b + 1) & 15];\n",
+        "    a = !(a == b) && (a < 10 || b >= 20) && ~a != b;\n",
+        "    p->x = (long)a * p->y + (int)(b % 5) - point.x;\n",
+        "    b = helper(a + 1, b * 2) ^ helper(p->x, arr[3]);\n",
+        "    a++; --b; a = b-- + ++a * *ptr;\n",
+    };
+
+    std::string src = "struct Point{ long x; long y; };\nlong helper(long u, long v){ return u * v; }\n";
+    src.reserve(size + 1024);
+
+    int function = 0;
+    while (src.size() < size){
+        src += "long function" + std::to_string(function++) + "(long a, long b){\n"
+               "    long arr[16];\n    struct Point point;\n    struct Point *p = &point;\n    long *ptr = &a;\n";
+        for (int i=0; i<32; i++){
+            src += statements[i % ARRAY_COUNT(statements)];
+        }
+        src += "    return a + b;\n}\n\n";
+    }
+    return src;
+}
+
+
+/*
+    Generate functions made of local declarations, of about given size.
+    The parser reads the type and the name of each declaration, and rewinds to the name to parse its declarators.
+*/
+static std::string generateDeclarationSource(size_t size){
+    static const char *declarations[] = {
+        "    long a%d = %d, *p%d = &a%d;\n",
+        "    unsigned int u%d = %d;\n",
+        "    const char *s%d = \"decl\", c%d = 'a' + %d;\n",
+        "    struct Point q%d; q%d.x = %d;\n",
+    };
+
+    std::string src = "struct Point{ long x; long y; };\n";
+    src.reserve(size + 1024);
+
+    char line[128];
+    int function = 0;
+    while (src.size() < size){
+        src += "long function" + std::to_string(function++) + "(long a, long b){\n";
+        for (int i=0; i<64; i++){
+            snprintf(line, sizeof(line), declarations[i % ARRAY_COUNT(declarations)], i, i, i, i);
+            src += line;
+        }
+        src += "    return a + b;\n}\n\n";
+    }
+    return src;
+}
+
+
+/*
+    Parse and check the source, returning the number of errors.
+*/
+static size_t parseAndCheck(const std::string &src){
+    Tokenizer t;
+    t.init();
+    t.loadStringToBuffer(src.data(), src.size(), "bench");
+
+    Arena a;
+    a.init(PAGE_SIZE * 2);
+    a.createFrame();
+
+    Parser p;
+    p.init(&t, &a);
+    p.parseProgram();
+    size_t errors = p.errors;
+
+    p.destroy();
+    a.destroyFrame();
+    a.destroy();
+    t.destroy();
+    return errors;
+}
+
+
+/*
+    Parse and check the source with the lazy tokenizer or the pre-lexed token buffer, lexing included.
+    With lazyBodies, the parser skips every function body and rewinds to it later, so each body is read twice.
+    Returns the number of tokens lexed again after rewinds.
+*/
+static size_t parseWithRewinds(const std::string &src, bool preLex, bool lazyBodies){
+    Tokenizer t;
+    t.init();
+    t.loadStringToBuffer(src.data(), src.size(), "bench");
+    if (preLex){
+        t.preLex();
+    }
+
+    Arena a;
+    a.init(PAGE_SIZE * 2);
+    a.createFrame();
+
+    Parser p;
+    p.init(&t, &a);
+    p.lazyBodies = lazyBodies;
+    p.parseProgram();
+    if (lazyBodies){
+        p.parseDeferredBodies();
+    }
+    size_t relexed = t.relexedTokens;
+
+    p.destroy();
+    a.destroyFrame();
+    a.destroy();
+    t.destroy();
+    return relexed;
+}
+
+
+static void benchRewinds(const char *name, const std::string &src, bool lazyBodies){
+    double lazyTime = 0;
+    for (bool preLex : {false, true}){
+        double best = 1e30;
+        size_t relexed = 0;
+        for (int i=0; i<N_RUNS; i++){
+            auto start = std::chrono::steady_clock::now();
+            relexed = parseWithRewinds(src, preLex, lazyBodies);
+            double elapsed = secondsSince(start);
+            best = (elapsed < best)? elapsed : best;
+        }
+        lazyTime = preLex? lazyTime : best;
+
+        fprintf(stderr, "[Rewinds] %-12s %-12s %-7s %9zu tokens re-lexed: %.3f ms, x%.2f\n", name,
+                lazyBodies? "lazy-bodies" : "eager", preLex? "prelex" : "lazy", relexed, best * 1e3, best / lazyTime);
+    }
+}
+
+
+static void benchExpressions(const char *shape){
+    double previous = 0;
+    for (int terms : {2500, 5000, 10000}){
+        std::string src = generateSource(shape, terms);
+
+        double best = 1e30;
+        size_t errors = 0;
+        for (int i=0; i<N_RUNS; i++){
+            auto start = std::chrono::steady_clock::now();
+            errors = parseAndCheck(src);
+            double elapsed = secondsSince(start);
+            best = (elapsed < best)? elapsed : best;
+        }
+
+        fprintf(stderr, "[Expressions] %-7s %5d terms, %zu errors: %.3f ms, %.1f ns/term, x%.2f\n",
+                shape, terms, errors, best * 1e3, best * 1e9 / terms, (previous > 0)? best / previous : 1.0);
+        previous = best;
+    }
+}
+
+
+static void benchSource(const char *name, const std::string &src){
+    double best = 1e30;
+    size_t errors = 0;
+    for (int i=0; i<N_RUNS; i++){
+        auto start = std::chrono::steady_clock::now();
+        errors = parseAndCheck(src);
+        double elapsed = secondsSince(start);
+        best = (elapsed < best)? elapsed : best;
+    }
+
+    double mb = src.size() / (1024.0 * 1024.0);
+    fprintf(stderr, "[Parsing] %-12s %.2f MB, %zu errors: %.3f s, %.2f MB/s\n", name, mb, errors, best, mb / best);
+}
+
+
+int main(int argc, char **argv){
+    // the parser reports its error count on stdout
+#if defined(_WIN32)
+    freopen("NUL", "w", stdout);
+#else
+    freopen("/dev/null", "w", stdout);
+#endif
+
+    if (argc >= 2){
+        std::ifstream f(argv[1], std::ios::binary);
+        if (!f.is_open()){
+            fprintf(stderr, "Failed to open file: %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        std::string src((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        benchSource(argv[1], src);
+        benchRewinds(argv[1], src, false);
+        benchRewinds(argv[1], src, true);
+        return 0;
+    }
+
+    benchSource("expressions", generateExpressionSource(256 * 1024));
+
+    std::string declarations = generateDeclarationSource(256 * 1024);
+    std::string expressions = generateExpressionSource(256 * 1024);
+    for (bool lazyBodies : {false, true}){
+        benchRewinds("declarations", declarations, lazyBodies);
+        benchRewinds("expressions", expressions, lazyBodies);
+    }
+
+    for (const char *shape : {"flat", "nested", "casts", "assign"}){
+        benchExpressions(shape);
+    }
+    return 0;
+}
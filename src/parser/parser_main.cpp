@@ -1,15 +1,73 @@
 #include "parser.h"
+#include <preprocessor/preprocessor.h>
 #include <debug/debug-print.h>
 
 int main(int argc, char **argv) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <c file to parse> [p]\n \t p: for parse program proper", argv[0]);
+        fprintf(stderr, "Usage: %s <c file to parse> [p] [-prelex] [-lex-threads <n>] [-preprocess] [-I <dir>] [-lazy-bodies] [-check-threads <n>]\n \t p: for parse program proper\n \t -prelex: lex the whole file before parsing\n \t -lex-threads <n>: lex the whole file on n threads before parsing\n \t -preprocess: run the preprocessor before parsing\n \t -I <dir>: add an include directory, implies -preprocess\n \t -lazy-bodies: skip function bodies and parse them after the whole file\n \t -check-threads <n>: check the function bodies on n threads", argv[0]);
         return EXIT_FAILURE;
     }
 
+    bool parseProgram = false;
+    bool preLex = false;
+    int lexThreads = 0;
+    bool preprocess = false;
+    bool lazyBodies = false;
+    int checkThreads = 0;
+    std::vector<const char*> includeDirs;
+    for (int i = 2; i<argc; i++){
+        if (strcmp(argv[i], "p") == 0){
+            parseProgram = true;
+        }
+        else if (strcmp(argv[i], "-prelex") == 0){
+            preLex = true;
+        }
+        else if (strcmp(argv[i], "-lex-threads") == 0 && i + 1 < argc){
+            lexThreads = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "-preprocess") == 0){
+            preprocess = true;
+        }
+        else if (strcmp(argv[i], "-lazy-bodies") == 0){
+            lazyBodies = true;
+        }
+        else if (strcmp(argv[i], "-check-threads") == 0 && i + 1 < argc){
+            checkThreads = atoi(argv[i+1]);
+            i++;
+        }
+        else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc){
+            includeDirs.push_back(argv[i+1]);
+            preprocess = true;
+            i++;
+        }
+    }
+
     Tokenizer t;
     t.init();
-    t.loadFileToBuffer(argv[1]);
+    Preprocessor pp;
+    pp.init();
+
+    if (preprocess){
+        for (const char *dir : includeDirs){
+            pp.addIncludeDir(dir);
+        }
+        if (!pp.preprocess(argv[1], &t)){
+            return EXIT_FAILURE;
+        }
+        fprintf(stdout, "[Preprocessor] %zu errors generated, %zu includes skipped.\n", pp.errors, pp.skippedIncludes);
+    }
+    else {
+        if (!t.loadFileToBuffer(argv[1])){
+            return EXIT_FAILURE;
+        }
+        if (lexThreads > 0){
+            t.preLexParallel(lexThreads);
+        }
+        else if (preLex){
+            t.preLex();
+        }
+    }
 
     Arena a;
     a.init(PAGE_SIZE * 2);
@@ -17,13 +75,21 @@ int main(int argc, char **argv) {
 
     Parser p;
     p.init(&t, &a);
+    p.lazyBodies = lazyBodies;
+    p.checkThreads = checkThreads;
 
     AST *ir = NULL;
-    if (argc == 3 && strcmp(argv[2], "p") == 0) {
+    if (parseProgram) {
         ir = p.parseProgram();
     } else {
         ir = p.parse();
     }
+    // report the errors in all the bodies, as when parsed in place
+    if (lazyBodies) {
+        ir = p.parseDeferredBodies();
+    }
+    // only the lazy tokenizer re-lexes, the pre-lexed buffer rewinds by index
+    fprintf(stderr, "[Tokenizer] %zu tokens re-lexed.\n", t.relexedTokens);
 
     if (ir) {
         fprintf(stdout, "Parse succeeded :)\n");
@@ -104,8 +170,10 @@ int main(int argc, char **argv) {
         dotFile.close();
     }
 
+    p.destroy();
     a.destroyFrame();
     a.destroy();
+    pp.destroy();
 
-    return p.errors;
+    return p.errors + pp.errors;
 }
\ No newline at end of file
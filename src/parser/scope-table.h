@@ -0,0 +1,200 @@
+#pragma once
+
+#include <IR/node.h>
+#include <arena/arena-allocator.h>
+
+
+/*
+    Flat symbol table of the scopes open while parsing, so that resolving a name is a single probe however deep the nesting is.
+
+    Each (namespace, name) slot of an open addressed table holds the innermost binding of the name, and each binding
+    links to the binding it shadows. Bindings are pushed onto a stack that doubles as the undo log of the open scopes:
+    leaving a scope pops the bindings made since it was entered and restores the ones they shadowed, so entering
+    and leaving a block costs as much as the names it declares.
+
+    The tables of each StatementBlock still hold the declarations of the block, in order, for the later stages.
+*/
+struct ScopeTable{
+    // the kinds of names, one for each of the tables of a StatementBlock
+    enum Namespace{
+        SCOPE_SYMBOL,
+        SCOPE_COMPOSITE,
+        SCOPE_TYPEDEF,
+        SCOPE_ENUM_VALUE,
+        SCOPE_ENUM_CLASS,
+    };
+
+private:
+    static const int NO_BINDING = -1;
+    static const size_t INITIAL_CAPACITY = 256;
+
+    struct Slot{
+        // NO_ATOM for an empty slot
+        Atom atom;
+        Namespace ns;
+        // innermost binding of the name, NO_BINDING once every scope that declared it has been left
+        int head;
+    };
+
+    struct Binding{
+        Atom atom;
+        Namespace ns;
+        StatementBlock *scope;
+        int shadowed;
+    };
+
+    // the table grows in its own arena, as the parser's arena frames may be dropped while scopes are open
+    Arena arena;
+    ArenaVector<Slot> slots;
+    size_t occupied;
+    ArenaVector<Binding> bindings;
+    // size of the bindings stack when each open scope was entered
+    ArenaVector<uint32_t> scopeStarts;
+    // the bindings in [hiddenStart, hiddenEnd) are skipped by lookups, see hideFrom
+    uint32_t hiddenStart;
+    uint32_t hiddenEnd;
+
+
+    // the binding, or the innermost one it shadows, that is not hidden
+    int visible(int b){
+        while (b != NO_BINDING && (uint32_t)b >= hiddenStart && (uint32_t)b < hiddenEnd){
+            b = bindings[b].shadowed;
+        }
+        return b;
+    }
+
+    size_t probe(Atom atom, Namespace ns){
+        size_t mask = slots.size() - 1;
+        size_t i = (((uint64_t)atom << 3 | ns) * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+        while (slots[i].atom != NO_ATOM && (slots[i].atom != atom || slots[i].ns != ns)){
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void grow(){
+        ArenaVector<Slot> old = std::move(slots);
+        slots = ArenaVector<Slot>(old.size() * 2, Slot{NO_ATOM, SCOPE_SYMBOL, NO_BINDING}, &arena);
+        for (Slot &s : old){
+            if (s.atom != NO_ATOM){
+                slots[probe(s.atom, s.ns)] = s;
+            }
+        }
+    }
+
+public:
+    void init(){
+        this->arena.init(PAGE_SIZE * 2);
+        this->arena.createFrame();
+
+        this->slots = ArenaVector<Slot>(INITIAL_CAPACITY, Slot{NO_ATOM, SCOPE_SYMBOL, NO_BINDING}, &this->arena);
+        this->occupied = 0;
+        this->bindings = ArenaVector<Binding>(&this->arena);
+        this->scopeStarts = ArenaVector<uint32_t>(&this->arena);
+        this->hiddenStart = 0;
+        this->hiddenEnd = 0;
+    }
+
+    void destroy(){
+        this->arena.destroyFrame();
+        this->arena.destroy();
+    }
+
+
+    void enterScope(){
+        scopeStarts.push_back(bindings.size());
+    }
+
+    // enter a block that has already been parsed, binding everything it declares
+    void enterScope(StatementBlock *block){
+        enterScope();
+        for (auto &entry : block->symbols.entries)      bind(SCOPE_SYMBOL, entry.second.identifier, block);
+        for (auto &entry : block->composites.entries)   bind(SCOPE_COMPOSITE, entry.second.identifier, block);
+        for (auto &entry : block->typedefs.entries)     bind(SCOPE_TYPEDEF, entry.second.identifier, block);
+        for (auto &entry : block->enumValues.entries)   bind(SCOPE_ENUM_VALUE, entry.second.identifier, block);
+        for (auto &entry : block->enumClasses.entries)  bind(SCOPE_ENUM_CLASS, entry.second.identifier, block);
+    }
+
+    void leaveScope(){
+        assert(!scopeStarts.empty());
+
+        uint32_t start = scopeStarts.back();
+        scopeStarts.pop_back();
+
+        while (bindings.size() > start){
+            Binding &b = bindings.back();
+            slots[probe(b.atom, b.ns)].head = b.shadowed;
+            bindings.pop_back();
+        }
+    }
+
+
+    // bind a name declared in the innermost open scope, a name already bound in the scope is left as is
+    void bind(Namespace ns, Splice name, StatementBlock *scope){
+        Atom atom = atomOf(name);
+        size_t i = probe(atom, ns);
+
+        if (slots[i].atom == NO_ATOM){
+            // keep the load under a half
+            if ((occupied + 1) * 2 > slots.size()){
+                grow();
+                i = probe(atom, ns);
+            }
+            slots[i] = {atom, ns, NO_BINDING};
+            occupied++;
+        }
+        else if (slots[i].head != NO_BINDING && bindings[slots[i].head].scope == scope){
+            return;
+        }
+
+        bindings.push_back({atom, ns, scope, slots[i].head});
+        slots[i].head = bindings.size() - 1;
+    }
+
+    // the innermost open scope that declares the name, NULL if none does
+    StatementBlock *lookup(Namespace ns, Splice name){
+        Slot &s = slots[probe(atomOf(name), ns)];
+        if (s.atom == NO_ATOM){
+            return NULL;
+        }
+        int b = visible(s.head);
+        return (b == NO_BINDING)? NULL : bindings[b].scope;
+    }
+
+    // the innermost open scope with a definition of the composite, skipping the scopes that only declare it
+    StatementBlock *lookupDefinedComposite(Splice name){
+        Slot &s = slots[probe(atomOf(name), SCOPE_COMPOSITE)];
+        if (s.atom == NO_ATOM){
+            return NULL;
+        }
+
+        for (int b = visible(s.head); b != NO_BINDING; b = visible(bindings[b].shadowed)){
+            StatementBlock *scope = bindings[b].scope;
+            if (scope->composites.getInfo(name).info.defined){
+                return scope;
+            }
+        }
+        return NULL;
+    }
+
+
+    // position in the bindings, for the names bound after it to be hidden later
+    uint32_t mark(){
+        return bindings.size();
+    }
+
+    /*
+        Hide the names bound since the mark until they are shown again, so that a function body parsed after the 
+        whole file only sees the names declared before it. Only the global scope may be open.
+    */
+    void hideFrom(uint32_t mark){
+        assert(scopeStarts.size() == 1);
+        hiddenStart = mark;
+        hiddenEnd = bindings.size();
+    }
+
+    void showAll(){
+        hiddenStart = 0;
+        hiddenEnd = 0;
+    }
+};
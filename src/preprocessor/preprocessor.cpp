@@ -0,0 +1,932 @@
+#include "preprocessor.h"
+#include <logger/logger.h>
+
+#include <filesystem>
+#include <algorithm>
+
+
+// includes nested deeper than this are assumed to be recursive
+static const int MAX_INCLUDE_DEPTH = 200;
+
+
+// identifiers and keywords can both be macro names
+static bool isName(Token t){
+    return t.type == TOKEN_IDENTIFIER || (t.type > TOKEN_KEYWORDS_START && t.type <= TOKEN_WHILE);
+}
+
+// b follows a with no whitespace in between
+static bool isAdjacent(Token a, Token b){
+    return a.string.data + a.string.len == b.string.data;
+}
+
+static Atom atomOfName(const char *str){
+    return internAtom(str, strlen(str));
+}
+
+// a newline in the text between two tokens, other than one escaped by a backslash (a line continuation)
+static bool hasNewline(const char *start, const char *end){
+    for (const char *p = start; (p = (const char*) memchr(p, '\n', end - p)); p++){
+        const char *lineEnd = (p > start && p[-1] == '\r')? p - 1 : p;
+        if (lineEnd == start || lineEnd[-1] != '\\'){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+void Preprocessor::init(){
+    this->errors = 0;
+    this->skippedIncludes = 0;
+    this->includeDepth = 0;
+    this->output = 0;
+
+    this->atomInclude = atomOfName("include");
+    this->atomDefine = atomOfName("define");
+    this->atomUndef = atomOfName("undef");
+    this->atomIfdef = atomOfName("ifdef");
+    this->atomIfndef = atomOfName("ifndef");
+    this->atomElif = atomOfName("elif");
+    this->atomEndif = atomOfName("endif");
+    this->atomPragma = atomOfName("pragma");
+    this->atomOnce = atomOfName("once");
+    this->atomError = atomOfName("error");
+    this->atomWarning = atomOfName("warning");
+    this->atomLine = atomOfName("line");
+    this->atomDefined = atomOfName("defined");
+    this->atomVaArgs = atomOfName("__VA_ARGS__");
+}
+
+
+/*
+    Free the cached files. Tokens given out by the preprocessor point into their buffers,
+    so this must only be called once the token streams are no longer used.
+*/
+void Preprocessor::destroy(){
+    for (auto &pair : this->files){
+        pair.second->tokenizer.destroy();
+        delete pair.second;
+    }
+    for (Tokenizer *t : this->scratch){
+        t->destroy();
+        delete t;
+    }
+    this->files.clear();
+    this->scratch.clear();
+}
+
+
+void Preprocessor::addIncludeDir(const char *dir){
+    this->includeDirs.push_back(dir);
+}
+
+
+/*
+    Preprocess the file into the token stream of the given tokenizer.
+    Macros start out undefined for each file preprocessed, but the lexed files are reused.
+*/
+bool Preprocessor::preprocess(const char *filepath, Tokenizer *out){
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::weakly_canonical(filepath, ec);
+
+    SourceFile *file = this->loadFile(ec? std::string(filepath) : path.string());
+    if (!file){
+        return false;
+    }
+
+    this->macros.clear();
+    this->conditionals.clear();
+    this->includedOnce.clear();
+    this->includeDepth = 0;
+
+    TokenBuffer tokens;
+    tokens.reserve(file->tokenizer.tokens.count());
+    this->output = &tokens;
+
+    this->processFile(file);
+
+    // the EOF of the file ends the stream
+    tokens.push(file->tokenizer.bufferedToken(file->tokenizer.tokens.count() - 1));
+    this->output = 0;
+
+    out->loadTokens(std::move(tokens), filepath);
+    return true;
+}
+
+
+
+/*
+    Lex a file, or get it from the cache if it has already been lexed.
+*/
+SourceFile *Preprocessor::loadFile(const std::string &path){
+    auto found = this->files.find(path);
+    if (found != this->files.end()){
+        return found->second;
+    }
+
+    SourceFile *file = new SourceFile;
+    file->path = path;
+    file->guard = NO_ATOM;
+    file->isOnce = false;
+
+    file->tokenizer.init();
+    if (!file->tokenizer.loadFileToBuffer(path.c_str())){
+        delete file;
+        return 0;
+    }
+    // text that does not lex is only an error in the groups that are kept, see processFile
+    file->tokenizer.reportsErrors = false;
+    file->tokenizer.preLex();
+    if (file->tokenizer.hasOpenComment){
+        logErrorMessage(file->tokenizer.bufferedToken(file->tokenizer.tokens.count() - 1), "Unterminated comment.");
+        this->errors++;
+    }
+
+    // a token starts a line if there is a newline between it and the previous token
+    TokenBuffer &tokens = file->tokenizer.tokens;
+    file->startsLine.resize(tokens.count());
+    for (size_t i=0; i<tokens.count(); i++){
+        if (i == 0){
+            file->startsLine[i] = true;
+            continue;
+        }
+        file->startsLine[i] = hasNewline(tokens.starts[i - 1] + tokens.lengths[i - 1], tokens.starts[i]);
+    }
+
+    this->detectIncludeGuard(file);
+
+    this->files[path] = file;
+    return file;
+}
+
+
+/*
+    Find the file named in an #include. Quoted names are first looked up relative to the including file,
+    then both forms are looked up in the include directories in order.
+*/
+SourceFile *Preprocessor::findInclude(const std::string &name, bool isQuoted, SourceFile *includer){
+    std::vector<std::filesystem::path> candidates;
+    if (isQuoted){
+        candidates.push_back(std::filesystem::path(includer->path).parent_path() / name);
+    }
+    for (std::string &dir : this->includeDirs){
+        candidates.push_back(std::filesystem::path(dir) / name);
+    }
+
+    for (std::filesystem::path &candidate : candidates){
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(candidate, ec)){
+            continue;
+        }
+        // the cache is keyed on the canonical path, so a file reached through different paths is lexed once
+        std::filesystem::path path = std::filesystem::weakly_canonical(candidate, ec);
+        return this->loadFile(ec? candidate.string() : path.string());
+    }
+    return 0;
+}
+
+
+/*
+    Check if the whole file is wrapped in an include guard:
+        #ifndef X
+        #define X
+        ...
+        #endif
+    with no tokens outside of it. Later includes of the file are skipped while X is defined, without reading it again.
+*/
+void Preprocessor::detectIncludeGuard(SourceFile *file){
+    TokenBuffer &tokens = file->tokenizer.tokens;
+    // without the EOF
+    size_t n = tokens.count() - 1;
+
+    if (n < 6 || tokens.types[0] != TOKEN_HASH || tokens.atoms[1] != this->atomIfndef || tokens.types[2] != TOKEN_IDENTIFIER
+        || !file->startsLine[3] || tokens.types[3] != TOKEN_HASH || tokens.atoms[4] != this->atomDefine
+        || tokens.atoms[5] != tokens.atoms[2] || (n > 6 && !file->startsLine[6])){
+        return;
+    }
+
+    int depth = 1;
+    for (size_t i=6; i + 1 < n; i++){
+        if (!file->startsLine[i] || tokens.types[i] != TOKEN_HASH || file->startsLine[i + 1]){
+            continue;
+        }
+
+        Atom directive = tokens.atoms[i + 1];
+        if (tokens.types[i + 1] == TOKEN_IF || directive == this->atomIfdef || directive == this->atomIfndef){
+            depth++;
+        }
+        else if (depth == 1 && (tokens.types[i + 1] == TOKEN_ELSE || directive == this->atomElif)){
+            return;
+        }
+        else if (directive == this->atomEndif){
+            depth--;
+            if (depth == 0){
+                // the #endif must be the last line of the file
+                size_t end = i + 2;
+                while (end < n && !file->startsLine[end]){
+                    end++;
+                }
+                if (end == n){
+                    file->guard = tokens.atoms[2];
+                }
+                return;
+            }
+        }
+    }
+}
+
+
+
+bool Preprocessor::isSkipping(){
+    return !this->conditionals.empty() && !this->conditionals.back().isActive;
+}
+
+
+/*
+    Expand the text of the file into the output, running the directives as they are found.
+*/
+void Preprocessor::processFile(SourceFile *file){
+    TokenBuffer &tokens = file->tokenizer.tokens;
+    // without the EOF
+    size_t n = tokens.count() - 1;
+    size_t depth = this->conditionals.size();
+
+    std::vector<Token> text;
+    std::vector<Token> expanded;
+    std::vector<Token> directive;
+    std::vector<Atom> disabled;
+
+    // the tokens that did not lex are reported if they are in a group that is kept
+    auto checkToken = [&](Token t){
+        if (t.type == TOKEN_ERROR){
+            file->tokenizer.logLexError(t);
+            this->errors++;
+        }
+    };
+
+    // expand the text lines read so far into the output
+    auto flushText = [&](){
+        if (text.empty()){
+            return;
+        }
+        expanded.clear();
+        this->expand(text, expanded, disabled);
+        for (Token &t : expanded){
+            this->output->push(t);
+        }
+        text.clear();
+    };
+
+    size_t i = 0;
+    while (i < n){
+        if (file->startsLine[i] && tokens.types[i] == TOKEN_HASH){
+            // the directive can change the macros used by the text before it
+            flushText();
+
+            directive.clear();
+            bool isSkipping = this->isSkipping();
+            for (i++; i < n && !file->startsLine[i]; i++){
+                directive.push_back(file->tokenizer.bufferedToken(i));
+                if (!isSkipping){
+                    checkToken(directive.back());
+                }
+            }
+            this->processDirective(file, directive);
+            continue;
+        }
+
+        if (!this->isSkipping()){
+            text.push_back(file->tokenizer.bufferedToken(i));
+            checkToken(text.back());
+        }
+        i++;
+    }
+    flushText();
+
+    if (this->conditionals.size() > depth){
+        logErrorMessage(file->tokenizer.bufferedToken(n), "Unterminated conditional directive.");
+        this->errors++;
+        this->conditionals.resize(depth);
+    }
+}
+
+
+void Preprocessor::pushConditional(bool condition){
+    bool isParentActive = !this->isSkipping();
+    this->conditionals.push_back(Conditional{
+        .isActive = isParentActive && condition,
+        .isTaken = condition,
+        .isParentActive = isParentActive,
+        .hasElse = false,
+    });
+}
+
+
+/*
+    Run a directive, given the tokens on its line after the #.
+*/
+void Preprocessor::processDirective(SourceFile *file, std::vector<Token> &directive){
+    // null directive
+    if (directive.empty()){
+        return;
+    }
+
+    Token name = directive[0];
+    Atom atom = name.string.atom;
+    bool isSkipping = this->isSkipping();
+
+    // conditionals are tracked even in skipped regions, to find their matching #endif
+    if (name.type == TOKEN_IF){
+        this->pushConditional(!isSkipping && this->evaluateCondition(directive));
+        return;
+    }
+    if (atom == this->atomIfdef || atom == this->atomIfndef){
+        if (directive.size() < 2 || !isName(directive[1])){
+            logErrorMessage(name, "Expected a macro name after #%.*s.", splicePrintf(name.string));
+            this->errors++;
+        }
+        bool isDefined = directive.size() >= 2 && this->macros.count(directive[1].string.atom);
+        this->pushConditional((atom == this->atomIfdef)? isDefined : !isDefined);
+        return;
+    }
+    if (name.type == TOKEN_ELSE || atom == this->atomElif || atom == this->atomEndif){
+        if (this->conditionals.empty()){
+            logErrorMessage(name, "#%.*s without #if.", splicePrintf(name.string));
+            this->errors++;
+            return;
+        }
+
+        Conditional &top = this->conditionals.back();
+        if (atom == this->atomEndif){
+            this->conditionals.pop_back();
+            return;
+        }
+        if (top.hasElse){
+            logErrorMessage(name, "#%.*s after #else.", splicePrintf(name.string));
+            this->errors++;
+        }
+
+        if (name.type == TOKEN_ELSE){
+            top.isActive = top.isParentActive && !top.isTaken;
+            top.isTaken = true;
+            top.hasElse = true;
+        }
+        else if (!top.isParentActive || top.isTaken){
+            top.isActive = false;
+        }
+        else {
+            top.isActive = this->evaluateCondition(directive);
+            top.isTaken = top.isActive;
+        }
+        return;
+    }
+
+    if (isSkipping){
+        return;
+    }
+
+    if (atom == this->atomInclude){
+        this->processInclude(file, directive);
+    }
+    else if (atom == this->atomDefine){
+        this->processDefine(directive);
+    }
+    else if (atom == this->atomUndef){
+        if (directive.size() < 2 || !isName(directive[1])){
+            logErrorMessage(name, "Expected a macro name after #undef.");
+            this->errors++;
+            return;
+        }
+        this->macros.erase(directive[1].string.atom);
+    }
+    else if (atom == this->atomPragma){
+        // other pragmas are ignored
+        if (directive.size() >= 2 && directive[1].string.atom == this->atomOnce){
+            file->isOnce = true;
+            this->includedOnce.insert(file);
+        }
+    }
+    else if (atom == this->atomError || atom == this->atomWarning){
+        // the message is the rest of the line as written
+        Token last = directive.back();
+        int len = (directive.size() > 1)? (last.string.data + last.string.len) - directive[1].string.data : 0;
+        const char *message = (directive.size() > 1)? directive[1].string.data : "";
+
+        if (atom == this->atomError){
+            logErrorMessage(name, "#error %.*s", len, message);
+            this->errors++;
+        }
+        else {
+            logWarningMessage(name, "#warning %.*s", len, message);
+        }
+    }
+    else if (atom != this->atomLine){
+        logErrorMessage(name, "Unknown preprocessor directive \"%.*s\".", splicePrintf(name.string));
+        this->errors++;
+    }
+}
+
+
+void Preprocessor::processInclude(SourceFile *file, std::vector<Token> &directive){
+    Token name = (directive.size() >= 2)? directive[1] : directive[0];
+
+    std::string path;
+    bool isQuoted = false;
+    if (name.type == TOKEN_STRING_LITERAL){
+        path.assign(name.string.data + 1, name.string.len - 2);
+        isQuoted = true;
+    }
+    else if (name.type == TOKEN_LESS_THAN && directive.size() >= 2){
+        // the name is the text between the < and >, which is lexed as several tokens
+        size_t close = 2;
+        while (close < directive.size() && directive[close].type != TOKEN_GREATER_THAN){
+            close++;
+        }
+        if (close == directive.size()){
+            logErrorMessage(name, "Missing > after the #include file name.");
+            this->errors++;
+            return;
+        }
+        path.assign(name.string.data + 1, directive[close].string.data - name.string.data - 1);
+    }
+    else {
+        logErrorMessage(name, "Expected a file name after #include.");
+        this->errors++;
+        return;
+    }
+
+    SourceFile *included = this->findInclude(path, isQuoted, file);
+    if (!included){
+        logErrorMessage(name, "Cannot open include file \"%s\".", path.c_str());
+        this->errors++;
+        return;
+    }
+
+    if ((included->guard != NO_ATOM && this->macros.count(included->guard))
+        || (included->isOnce && this->includedOnce.count(included))){
+        this->skippedIncludes++;
+        return;
+    }
+
+    if (this->includeDepth >= MAX_INCLUDE_DEPTH){
+        logErrorMessage(name, "#include nested too deeply.");
+        this->errors++;
+        return;
+    }
+
+    this->includeDepth++;
+    this->processFile(included);
+    this->includeDepth--;
+}
+
+
+void Preprocessor::processDefine(std::vector<Token> &directive){
+    if (directive.size() < 2 || !isName(directive[1])){
+        logErrorMessage(directive[0], "Expected a macro name after #define.");
+        this->errors++;
+        return;
+    }
+    Token name = directive[1];
+
+    Macro macro = {};
+    size_t i = 2;
+
+    // a ( right after the name starts the parameter list, else it is part of the replacement
+    if (i < directive.size() && directive[i].type == TOKEN_PARENTHESIS_OPEN && isAdjacent(name, directive[i])){
+        macro.isFunctionLike = true;
+        i++;
+
+        while (i < directive.size() && directive[i].type != TOKEN_PARENTHESIS_CLOSE){
+            Token parameter = directive[i];
+            if (macro.isVariadic){
+                logErrorMessage(parameter, "Expected ) after ... in the parameters of macro \"%.*s\".", splicePrintf(name.string));
+                this->errors++;
+                return;
+            }
+
+            if (parameter.type == TOKEN_DOT_DOT_DOT){
+                macro.isVariadic = true;
+                macro.parameters.push_back(this->atomVaArgs);
+            }
+            else if (isName(parameter)){
+                macro.parameters.push_back(parameter.string.atom);
+            }
+            else {
+                logErrorMessage(parameter, "Invalid parameter \"%.*s\" of macro \"%.*s\".", splicePrintf(parameter.string), splicePrintf(name.string));
+                this->errors++;
+                return;
+            }
+            i++;
+
+            if (i < directive.size() && directive[i].type == TOKEN_COMMA){
+                i++;
+            }
+        }
+
+        if (i == directive.size()){
+            logErrorMessage(name, "Missing ) in the parameters of macro \"%.*s\".", splicePrintf(name.string));
+            this->errors++;
+            return;
+        }
+        i++;
+    }
+
+    macro.replacement.assign(directive.begin() + i, directive.end());
+    this->macros[name.string.atom] = std::move(macro);
+}
+
+
+
+int Preprocessor::parameterIndex(const Macro &macro, Token t){
+    if (!macro.isFunctionLike || !isName(t)){
+        return -1;
+    }
+    for (size_t i=0; i<macro.parameters.size(); i++){
+        if (macro.parameters[i] == t.string.atom){
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/*
+    Expand the macros in tokens into out. Macros in disabled are being expanded, so they are not expanded again.
+*/
+void Preprocessor::expand(const std::vector<Token> &tokens, std::vector<Token> &out, std::vector<Atom> &disabled){
+    for (size_t i=0; i<tokens.size(); i++){
+        Token t = tokens[i];
+
+        auto found = (t.string.atom != NO_ATOM)? this->macros.find(t.string.atom) : this->macros.end();
+        if (found == this->macros.end() || !isName(t) || std::find(disabled.begin(), disabled.end(), t.string.atom) != disabled.end()){
+            out.push_back(t);
+            continue;
+        }
+        const Macro &macro = found->second;
+
+        std::vector<std::vector<Token>> arguments;
+        if (macro.isFunctionLike){
+            // the name of a function-like macro not followed by ( is not an invocation
+            if (i + 1 >= tokens.size() || tokens[i + 1].type != TOKEN_PARENTHESIS_OPEN){
+                out.push_back(t);
+                continue;
+            }
+
+            // split the arguments on the commas outside of parentheses
+            arguments.emplace_back();
+            int depth = 0;
+            size_t close = i + 2;
+            for (; close < tokens.size(); close++){
+                Token a = tokens[close];
+                if (a.type == TOKEN_PARENTHESIS_CLOSE && depth == 0){
+                    break;
+                }
+
+                if (a.type == TOKEN_PARENTHESIS_OPEN){
+                    depth++;
+                }
+                else if (a.type == TOKEN_PARENTHESIS_CLOSE){
+                    depth--;
+                }
+                // the variadic argument takes the rest of the commas
+                else if (a.type == TOKEN_COMMA && depth == 0 && !(macro.isVariadic && arguments.size() == macro.parameters.size())){
+                    arguments.emplace_back();
+                    continue;
+                }
+                arguments.back().push_back(a);
+            }
+
+            if (close == tokens.size()){
+                logErrorMessage(t, "Unterminated invocation of macro \"%.*s\".", splicePrintf(t.string));
+                this->errors++;
+                out.push_back(t);
+                continue;
+            }
+            i = close;
+
+            // f() passes no arguments to a macro without parameters, and an empty variadic argument can be left out
+            if (macro.parameters.empty() && arguments.size() == 1 && arguments[0].empty()){
+                arguments.clear();
+            }
+            if (macro.isVariadic && arguments.size() + 1 == macro.parameters.size()){
+                arguments.emplace_back();
+            }
+
+            if (arguments.size() != macro.parameters.size()){
+                logErrorMessage(t, "Macro \"%.*s\" takes %zu arguments, but %zu were given.",
+                                splicePrintf(t.string), macro.parameters.size(), arguments.size());
+                this->errors++;
+                continue;
+            }
+        }
+
+        // the arguments are expanded before the macro is disabled, the result is rescanned after
+        std::vector<Token> replaced;
+        this->substitute(macro, arguments, replaced, disabled);
+
+        disabled.push_back(t.string.atom);
+        this->expand(replaced, out, disabled);
+        disabled.pop_back();
+    }
+}
+
+
+/*
+    Replace the parameters in the replacement list of a macro with the arguments, and apply the # and ## operators.
+    Operands of # and ## are the arguments as written, other parameters are replaced by the expanded arguments.
+*/
+void Preprocessor::substitute(const Macro &macro, std::vector<std::vector<Token>> &arguments, std::vector<Token> &out, std::vector<Atom> &disabled){
+    const std::vector<Token> &replacement = macro.replacement;
+
+    std::vector<std::vector<Token>> expanded(arguments.size());
+    std::vector<bool> isExpanded(arguments.size(), false);
+
+    // the left operand of the next ## was an empty argument, so there is nothing to paste onto
+    bool isEmptyOperand = false;
+
+    for (size_t i=0; i<replacement.size(); i++){
+        Token t = replacement[i];
+        bool isPastedOnto = i + 1 < replacement.size() && replacement[i + 1].type == TOKEN_HASH_HASH;
+
+        // # parameter
+        if (t.type == TOKEN_HASH && i + 1 < replacement.size() && this->parameterIndex(macro, replacement[i + 1]) >= 0){
+            out.push_back(this->stringize(arguments[this->parameterIndex(macro, replacement[i + 1])]));
+            isEmptyOperand = false;
+            i++;
+            continue;
+        }
+
+        // left ## right
+        if (t.type == TOKEN_HASH_HASH && i + 1 < replacement.size()){
+            Token right = replacement[i + 1];
+            i++;
+
+            std::vector<Token> operand = {right};
+            int p = this->parameterIndex(macro, right);
+            if (p >= 0){
+                operand = arguments[p];
+            }
+            if (operand.empty()){
+                continue;
+            }
+
+            size_t start = 0;
+            if (!isEmptyOperand && !out.empty()){
+                out.back() = this->paste(out.back(), operand[0]);
+                start = 1;
+            }
+            out.insert(out.end(), operand.begin() + start, operand.end());
+            isEmptyOperand = false;
+            continue;
+        }
+
+        int p = this->parameterIndex(macro, t);
+        if (p >= 0){
+            if (isPastedOnto){
+                out.insert(out.end(), arguments[p].begin(), arguments[p].end());
+                isEmptyOperand = arguments[p].empty();
+                continue;
+            }
+
+            if (!isExpanded[p]){
+                this->expand(arguments[p], expanded[p], disabled);
+                isExpanded[p] = true;
+            }
+            out.insert(out.end(), expanded[p].begin(), expanded[p].end());
+            isEmptyOperand = false;
+            continue;
+        }
+
+        out.push_back(t);
+        isEmptyOperand = false;
+    }
+}
+
+
+/*
+    The argument as a string literal, with a space wherever its tokens were separated by whitespace.
+*/
+Token Preprocessor::stringize(const std::vector<Token> &argument){
+    std::string text = "\"";
+    for (size_t i=0; i<argument.size(); i++){
+        Token t = argument[i];
+        if (i > 0 && !isAdjacent(argument[i - 1], t)){
+            text += ' ';
+        }
+
+        bool isLiteral = t.type == TOKEN_STRING_LITERAL || t.type == TOKEN_CHARACTER_LITERAL;
+        for (uint32_t c=0; c<t.string.len; c++){
+            if (isLiteral && (t.string.data[c] == '"' || t.string.data[c] == '\\')){
+                text += '\\';
+            }
+            text += t.string.data[c];
+        }
+    }
+    text += "\"";
+    return this->lexScratch(text);
+}
+
+
+Token Preprocessor::paste(Token left, Token right){
+    std::string text(left.string.data, left.string.len);
+    text.append(right.string.data, right.string.len);
+
+    Token t = this->lexScratch(text);
+    if (t.type == TOKEN_ERROR){
+        logErrorMessage(left, "Pasting \"%.*s\" and \"%.*s\" does not give a valid token.", splicePrintf(left.string), splicePrintf(right.string));
+        this->errors++;
+        return left;
+    }
+    return t;
+}
+
+
+/*
+    Lex text made up by the preprocessor, which should be a single token. Gives an error token if it is not.
+*/
+Token Preprocessor::lexScratch(const std::string &text){
+    Tokenizer *t = new Tokenizer;
+    t->init();
+    t->loadStringToBuffer(text.data(), text.size(), "<macro expansion>");
+    t->preLex();
+    this->scratch.push_back(t);
+
+    Token token = t->bufferedToken(0);
+    if (t->tokens.count() != 2 || t->errors > 0){
+        token.type = TOKEN_ERROR;
+    }
+    return token;
+}
+
+
+
+/*
+    Evaluates the integer constant expression of an #if or #elif, after macro expansion.
+    Identifiers left after expansion are 0.
+*/
+struct ConditionEvaluator{
+    const std::vector<Token> &tokens;
+    size_t pos;
+    bool isValid;
+
+    int type(){
+        return (this->pos < this->tokens.size())? this->tokens[this->pos].type : TOKEN_EOF;
+    }
+
+    bool match(int type){
+        if (this->type() == type){
+            this->pos++;
+            return true;
+        }
+        return false;
+    }
+
+    static int precedence(int type){
+        switch (type){
+            case TOKEN_LOGICAL_OR:      return 1;
+            case TOKEN_LOGICAL_AND:     return 2;
+            case TOKEN_BITWISE_OR:      return 3;
+            case TOKEN_BITWISE_XOR:     return 4;
+            case TOKEN_AMPERSAND:       return 5;
+            case TOKEN_EQUALITY_CHECK:
+            case TOKEN_NOT_EQUALS:      return 6;
+            case TOKEN_LESS_THAN:
+            case TOKEN_GREATER_THAN:
+            case TOKEN_LESS_EQUALS:
+            case TOKEN_GREATER_EQUALS:  return 7;
+            case TOKEN_SHIFT_LEFT:
+            case TOKEN_SHIFT_RIGHT:     return 8;
+            case TOKEN_PLUS:
+            case TOKEN_MINUS:           return 9;
+            case TOKEN_STAR:
+            case TOKEN_SLASH:
+            case TOKEN_MODULO:          return 10;
+            default:                    return 0;
+        }
+    }
+
+    int64_t unary(){
+        if (this->pos >= this->tokens.size()){
+            this->isValid = false;
+            return 0;
+        }
+        Token t = this->tokens[this->pos++];
+
+        switch (t.type){
+            case TOKEN_NUMERIC_DEC:
+            case TOKEN_NUMERIC_HEX:
+            case TOKEN_NUMERIC_OCT:
+            case TOKEN_NUMERIC_BIN:
+            case TOKEN_CHARACTER_LITERAL:
+                return t.value.i64;
+            case TOKEN_PARENTHESIS_OPEN:{
+                int64_t value = this->conditional();
+                this->isValid &= this->match(TOKEN_PARENTHESIS_CLOSE);
+                return value;
+            }
+            case TOKEN_MINUS:           return -this->unary();
+            case TOKEN_PLUS:            return this->unary();
+            case TOKEN_LOGICAL_NOT:     return !this->unary();
+            case TOKEN_BITWISE_NOT:     return ~this->unary();
+            default:
+                if (isName(t)){
+                    return 0;
+                }
+                this->isValid = false;
+                return 0;
+        }
+    }
+
+    // precedence climbing over the binary operators
+    int64_t binary(int minPrecedence){
+        int64_t left = this->unary();
+
+        while (precedence(this->type()) >= minPrecedence && precedence(this->type()) > 0){
+            int op = this->type();
+            this->pos++;
+            int64_t right = this->binary(precedence(op) + 1);
+
+            switch (op){
+                case TOKEN_LOGICAL_OR:      left = left || right; break;
+                case TOKEN_LOGICAL_AND:     left = left && right; break;
+                case TOKEN_BITWISE_OR:      left = left | right; break;
+                case TOKEN_BITWISE_XOR:     left = left ^ right; break;
+                case TOKEN_AMPERSAND:       left = left & right; break;
+                case TOKEN_EQUALITY_CHECK:  left = left == right; break;
+                case TOKEN_NOT_EQUALS:      left = left != right; break;
+                case TOKEN_LESS_THAN:       left = left < right; break;
+                case TOKEN_GREATER_THAN:    left = left > right; break;
+                case TOKEN_LESS_EQUALS:     left = left <= right; break;
+                case TOKEN_GREATER_EQUALS:  left = left >= right; break;
+                case TOKEN_SHIFT_LEFT:      left = (uint64_t)left << (right & 63); break;
+                case TOKEN_SHIFT_RIGHT:     left = left >> (right & 63); break;
+                case TOKEN_PLUS:            left = (uint64_t)left + (uint64_t)right; break;
+                case TOKEN_MINUS:           left = (uint64_t)left - (uint64_t)right; break;
+                case TOKEN_STAR:            left = (uint64_t)left * (uint64_t)right; break;
+                case TOKEN_SLASH:
+                case TOKEN_MODULO:
+                    if (right == 0){
+                        this->isValid = false;
+                        return 0;
+                    }
+                    left = (op == TOKEN_SLASH)? left / right : left % right;
+                    break;
+            }
+        }
+        return left;
+    }
+
+    int64_t conditional(){
+        int64_t condition = this->binary(1);
+        if (!this->match(TOKEN_QUESTION_MARK)){
+            return condition;
+        }
+        int64_t a = this->conditional();
+        this->isValid &= this->match(TOKEN_COLON);
+        int64_t b = this->conditional();
+        return condition? a : b;
+    }
+};
+
+
+bool Preprocessor::evaluateCondition(std::vector<Token> &directive){
+    // defined X and defined(X) are replaced before the macros are expanded
+    std::vector<Token> line;
+    for (size_t i=1; i<directive.size(); i++){
+        Token t = directive[i];
+        if (t.string.atom != this->atomDefined){
+            line.push_back(t);
+            continue;
+        }
+
+        bool hasParenthesis = i + 1 < directive.size() && directive[i + 1].type == TOKEN_PARENTHESIS_OPEN;
+        size_t nameIndex = i + (hasParenthesis? 2 : 1);
+        if (nameIndex >= directive.size() || !isName(directive[nameIndex])
+            || (hasParenthesis && (nameIndex + 1 >= directive.size() || directive[nameIndex + 1].type != TOKEN_PARENTHESIS_CLOSE))){
+            logErrorMessage(t, "Expected a macro name after defined.");
+            this->errors++;
+            return false;
+        }
+
+        Token value = t;
+        value.type = TOKEN_NUMERIC_DEC;
+        value.value.i64 = this->macros.count(directive[nameIndex].string.atom)? 1 : 0;
+        line.push_back(value);
+        i = nameIndex + (hasParenthesis? 1 : 0);
+    }
+
+    std::vector<Token> expanded;
+    std::vector<Atom> disabled;
+    this->expand(line, expanded, disabled);
+
+    ConditionEvaluator evaluator = {.tokens = expanded, .pos = 0, .isValid = true};
+    int64_t value = evaluator.conditional();
+
+    if (!evaluator.isValid || evaluator.pos != expanded.size()){
+        logErrorMessage(directive[0], "Invalid expression in #%.*s.", splicePrintf(directive[0].string));
+        this->errors++;
+        return false;
+    }
+    return value != 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <tokenizer/tokenizer.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+
+/*
+    A source file lexed by the preprocessor. Files are cached by path for the life of the preprocessor,
+    so a header is read and lexed once however many times (and by however many translation units) it is included.
+*/
+struct SourceFile{
+    std::string path;
+    // owns the source buffer, its token buffer holds the lexed tokens of the file
+    Tokenizer tokenizer;
+    // set for the tokens that are the first on their line, a # starting a line starts a directive
+    std::vector<bool> startsLine;
+
+    // macro of the include guard around the whole file (#ifndef X #define X ... #endif), NO_ATOM if there is none
+    Atom guard;
+    // the file has a #pragma once
+    bool isOnce;
+};
+
+
+struct Macro{
+    bool isFunctionLike;
+    bool isVariadic;
+    // the variadic arguments are the last parameter, __VA_ARGS__
+    std::vector<Atom> parameters;
+    std::vector<Token> replacement;
+};
+
+
+struct Conditional{
+    // the tokens of the current branch are kept
+    bool isActive;
+    // a branch of the #if has been taken, so the later ones are skipped
+    bool isTaken;
+    // the enclosing conditional is active, else every branch is skipped
+    bool isParentActive;
+    bool hasElse;
+};
+
+
+/*
+    Preprocessor run in front of the parser. Supports #include, object-like and function-like #define (with # and ##),
+    #undef, #if/#ifdef/#ifndef/#elif/#else/#endif, #pragma once and #error.
+    Directives are read from the token stream of each file, and the expanded tokens are emitted into a token buffer
+    that the tokenizer then serves (see Tokenizer::loadTokens), so the source is never written back out as text.
+
+    Macro arguments and replacement lists are rescanned with the macro disabled, but a function-like macro
+    whose name ends a replacement list does not take its arguments from the tokens after the invocation.
+*/
+struct Preprocessor{
+private:
+    std::unordered_map<std::string, SourceFile *> files;
+    std::unordered_map<Atom, Macro> macros;
+    std::vector<Conditional> conditionals;
+    // files with a #pragma once that have already been included in this translation unit
+    std::unordered_set<SourceFile *> includedOnce;
+    // tokenizers over the text made by # and ##, kept alive as tokens point into their buffers
+    std::vector<Tokenizer *> scratch;
+
+    TokenBuffer *output;
+    int includeDepth;
+
+    // atoms of the directive names and the identifiers the preprocessor handles
+    Atom atomInclude, atomDefine, atomUndef, atomIfdef, atomIfndef, atomElif, atomEndif;
+    Atom atomPragma, atomOnce, atomError, atomWarning, atomLine, atomDefined, atomVaArgs;
+
+    SourceFile *loadFile(const std::string &path);
+    SourceFile *findInclude(const std::string &name, bool isQuoted, SourceFile *includer);
+    void detectIncludeGuard(SourceFile *file);
+
+    void processFile(SourceFile *file);
+    void processDirective(SourceFile *file, std::vector<Token> &directive);
+    void processInclude(SourceFile *file, std::vector<Token> &directive);
+    void processDefine(std::vector<Token> &directive);
+    void pushConditional(bool condition);
+    bool isSkipping();
+
+    void expand(const std::vector<Token> &tokens, std::vector<Token> &out, std::vector<Atom> &disabled);
+    void substitute(const Macro &macro, std::vector<std::vector<Token>> &arguments, std::vector<Token> &out, std::vector<Atom> &disabled);
+    int parameterIndex(const Macro &macro, Token t);
+    Token stringize(const std::vector<Token> &argument);
+    Token paste(Token left, Token right);
+    Token lexScratch(const std::string &text);
+
+    bool evaluateCondition(std::vector<Token> &directive);
+
+public:
+    std::vector<std::string> includeDirs;
+    size_t errors;
+
+    // number of #includes skipped through include guards or #pragma once
+    size_t skippedIncludes;
+
+    void init();
+    void destroy();
+    void addIncludeDir(const char *dir);
+    bool preprocess(const char *filepath, Tokenizer *out);
+};
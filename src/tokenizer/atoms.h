@@ -0,0 +1,43 @@
+#pragma once
+
+#include "str.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*
+    Global table of interned strings (atoms), giving each distinct identifier a dense 32 bit id.
+    Identifiers are interned as they are lexed, and the id is carried in Splice::atom, so that symbol tables
+    can key on it and resolving a name after lexing is integer hashing, with no string work.
+
+    The keywords are interned first, so the atom of keyword i (see keywords.h) is i + 1.
+    Atom 0 is never given out, it marks a splice that has not been interned.
+    
+    The table is only locked while it is shared (see shareAtoms), so that later stages may intern from several
+    threads (see Parser::checkThreads), and the lookups of the single threaded paths take no lock.
+    Lexing still interns on the thread that lexes (or stitches) the token stream, so that atoms are given out in order.
+*/
+typedef uint32_t Atom;
+static const Atom NO_ATOM = 0;
+
+
+Atom internAtom(const char *data, size_t len);
+
+// the interned string of an atom, owned by the table
+Splice atomName(Atom atom);
+size_t atomCount();
+
+// set before starting the threads that intern, and cleared once they are joined
+void shareAtoms(bool isShared);
+
+
+// atom of a splice, interning it if it was not interned by the tokenizer (eg: names made up by later stages)
+static Atom atomOf(Splice s){
+    return (s.atom != NO_ATOM)? s.atom : internAtom(s.data, s.len);
+}
+
+static Splice intern(Splice s){
+    s.atom = atomOf(s);
+    return s;
+}
@@ -1,63 +1,70 @@
 #pragma once
 
-#include <unordered_map>
-#include <assert.h>
+#include <stdint.h>
 
 #include "token.h"
 
 
-struct TransitionTableEntry{
-    int transitions[256] = {0};
-};
+/*
+    Dense state x byte transition table for a DFA, along with the token type of each state.
+    The tables are built at compile time, so no setup is needed when the tokenizer starts.
+    0 is the error state, and TOKEN_ERROR (0) is the token type of non accepting states.
+*/
+template <int N_STATES>
+struct DFATable{
+    static_assert(N_STATES <= 256, "States must fit in a byte.");
 
-struct DFA{
-    std::unordered_map<int, TransitionTableEntry> transitionTable;
-    int currentState;
-    int startState;
-    
-    void setStartState(int s){
-        assert(transitionTable.contains(s));
-        this->startState = s;
-        this->currentState = s;
+    uint8_t transitions[N_STATES][256] = {};
+    int tokenTypes[N_STATES] = {};
+
+    constexpr void addTransition(int s, const char *a, int sNext){
+        for (; *a; a++){
+            transitions[s][(uint8_t)*a] = sNext;
+        }
     }
     
-    void restart(){
-        this->currentState = this->startState;
+    constexpr void addTransitionRange(int s, char start, char end, int sNext){
+        for (int i=(uint8_t)start; i<=(uint8_t)end; i++){
+            transitions[s][i] = sNext;
+        }
     }
 
-    void addState(int s){
-        transitionTable.insert({s, TransitionTableEntry{0}});
+    constexpr void setAccepting(int s, int tokenType){
+        tokenTypes[s] = tokenType;
     }
+};
 
-    void addTransition(int s, const char *a, int sNext){
-        assert(transitionTable.contains(s) && transitionTable.contains(sNext));
-        
-        for (int i=0; i<strlen(a); i++){
-            transitionTable[s].transitions[a[i]] = sNext;
-        }
-    }
+
+/*
+    Runs a DFA over the table T::table, starting from T::STATE_START.
+*/
+template <typename T>
+struct DFA{
+    int currentState;
     
-    void addTransitionRange(int s, char start, char end, int sNext){
-        assert(transitionTable.contains(s) && transitionTable.contains(sNext));
-        
-        for (int i=start; i<=end; i++){
-            transitionTable[s].transitions[i] = sNext;
-        }
+    void restart(){
+        this->currentState = T::STATE_START;
     }
 
     void transition(char a){
-        currentState = transitionTable[currentState].transitions[a];
+        this->currentState = T::table.transitions[this->currentState][(uint8_t)a];
     }
     
     // assumes 0 as error state, ie, if input will cause transition to an error state '0'
     bool willErrorTransition(char a){
-        return transitionTable[currentState].transitions[a] == 0; 
+        return T::table.transitions[this->currentState][(uint8_t)a] == 0; 
+    }
+
+    Token getToken(){
+        Token t = {};
+        t.type = T::table.tokenTypes[this->currentState];
+        return t;
     }
 };
 
 
 
-struct NumConstDFA: public DFA{
+struct NumConstDFA: public DFA<NumConstDFA>{
     enum NumConstDFA_States{
         // start and error states (non accepting) 
         STATE_ERROR = 0,
@@ -98,117 +105,93 @@ struct NumConstDFA: public DFA{
         STATE_COUNT,
     };
 
-    void init(){        
+    static constexpr DFATable<STATE_COUNT> buildTable(){
+        DFATable<STATE_COUNT> t;
 
-        for (int i=0; i<STATE_COUNT; i++){
-            this->addState(i);
-        }
-
-        // NOTE: STATE_ERROR is set to 0, which is the default transition value on adding a new state
-        this->addTransition(STATE_START, "0", STATE_ZERO);
-        this->addTransition(STATE_START, "123456789", STATE_DECIMAL);
+        // NOTE: STATE_ERROR is set to 0, which is the default transition value in the table
+        t.addTransition(STATE_START, "0", STATE_ZERO);
+        t.addTransition(STATE_START, "123456789", STATE_DECIMAL);
 
-        this->addTransition(STATE_ZERO, "xX", STATE_X);
-        this->addTransition(STATE_ZERO, "bB", STATE_B);
-        this->addTransition(STATE_ZERO, "01234567", STATE_OCTAL);
-        this->addTransition(STATE_ZERO, "89", STATE_INVALID_OCTAL);
-        this->addTransition(STATE_ZERO, ".", STATE_DOUBLE);
-        this->addTransition(STATE_ZERO, "U", STATE_U);
-        this->addTransition(STATE_ZERO, "L", STATE_L);
+        t.addTransition(STATE_ZERO, "xX", STATE_X);
+        t.addTransition(STATE_ZERO, "bB", STATE_B);
+        t.addTransition(STATE_ZERO, "01234567", STATE_OCTAL);
+        t.addTransition(STATE_ZERO, "89", STATE_INVALID_OCTAL);
+        t.addTransition(STATE_ZERO, ".", STATE_DOUBLE);
+        t.addTransition(STATE_ZERO, "U", STATE_U);
+        t.addTransition(STATE_ZERO, "L", STATE_L);
 
         
-        this->addTransition(STATE_X, "0123456789abcdefABCDEF", STATE_HEX);
-        this->addTransition(STATE_HEX, "0123456789abcdefABCDEF", STATE_HEX);
-        this->addTransition(STATE_HEX, "U", STATE_U);
-        this->addTransition(STATE_HEX, "L", STATE_L);
-        this->addTransition(STATE_HEX, ".", STATE_HEXDOUBLE_DEC);
+        t.addTransition(STATE_X, "0123456789abcdefABCDEF", STATE_HEX);
+        t.addTransition(STATE_HEX, "0123456789abcdefABCDEF", STATE_HEX);
+        t.addTransition(STATE_HEX, "U", STATE_U);
+        t.addTransition(STATE_HEX, "L", STATE_L);
+        t.addTransition(STATE_HEX, ".", STATE_HEXDOUBLE_DEC);
         
-        this->addTransition(STATE_HEXDOUBLE_DEC, "0123456789abcdefABCDEF", STATE_HEXDOUBLE_AFTER_DEC);
-        this->addTransition(STATE_HEXDOUBLE_AFTER_DEC, "0123456789abcdefABCDEF", STATE_HEXDOUBLE_AFTER_DEC);
+        t.addTransition(STATE_HEXDOUBLE_DEC, "0123456789abcdefABCDEF", STATE_HEXDOUBLE_AFTER_DEC);
+        t.addTransition(STATE_HEXDOUBLE_AFTER_DEC, "0123456789abcdefABCDEF", STATE_HEXDOUBLE_AFTER_DEC);
         
-        this->addTransition(STATE_HEXDOUBLE_AFTER_DEC, "p", STATE_HEXDOUBLE_P);
+        t.addTransition(STATE_HEXDOUBLE_AFTER_DEC, "p", STATE_HEXDOUBLE_P);
         
-        this->addTransition(STATE_HEXDOUBLE_P, "0123456789", STATE_HEXFLOAT);
-        this->addTransition(STATE_HEXDOUBLE_P, "+-", STATE_HEXDOUBLE_SIGN);
+        t.addTransition(STATE_HEXDOUBLE_P, "0123456789", STATE_HEXFLOAT);
+        t.addTransition(STATE_HEXDOUBLE_P, "+-", STATE_HEXDOUBLE_SIGN);
 
-        this->addTransition(STATE_HEXDOUBLE_SIGN, "0123456789", STATE_HEXDOUBLE);
+        t.addTransition(STATE_HEXDOUBLE_SIGN, "0123456789", STATE_HEXDOUBLE);
 
-        this->addTransition(STATE_HEXDOUBLE, "0123456789", STATE_HEXDOUBLE);
-        this->addTransition(STATE_HEXDOUBLE, "f", STATE_HEXFLOAT);
+        t.addTransition(STATE_HEXDOUBLE, "0123456789", STATE_HEXDOUBLE);
+        t.addTransition(STATE_HEXDOUBLE, "f", STATE_HEXFLOAT);
         
-        this->addTransition(STATE_B, "01", STATE_BINARY);
-        this->addTransition(STATE_BINARY, "01", STATE_BINARY);
+        t.addTransition(STATE_B, "01", STATE_BINARY);
+        t.addTransition(STATE_BINARY, "01", STATE_BINARY);
         
-        this->addTransition(STATE_INVALID_OCTAL, "0123456789", STATE_INVALID_OCTAL);
-        this->addTransition(STATE_INVALID_OCTAL, ".", STATE_DOUBLE);
+        t.addTransition(STATE_INVALID_OCTAL, "0123456789", STATE_INVALID_OCTAL);
+        t.addTransition(STATE_INVALID_OCTAL, ".", STATE_DOUBLE);
         
         
-        this->addTransition(STATE_OCTAL, "01234567", STATE_OCTAL);
-        this->addTransition(STATE_OCTAL, "89", STATE_INVALID_OCTAL);
-        this->addTransition(STATE_OCTAL, ".", STATE_DOUBLE);
-        this->addTransition(STATE_OCTAL, "U", STATE_U);
-        this->addTransition(STATE_OCTAL, "L", STATE_L);
+        t.addTransition(STATE_OCTAL, "01234567", STATE_OCTAL);
+        t.addTransition(STATE_OCTAL, "89", STATE_INVALID_OCTAL);
+        t.addTransition(STATE_OCTAL, ".", STATE_DOUBLE);
+        t.addTransition(STATE_OCTAL, "U", STATE_U);
+        t.addTransition(STATE_OCTAL, "L", STATE_L);
         
-        this->addTransition(STATE_DECIMAL, "0123456789", STATE_DECIMAL);
-        this->addTransition(STATE_DECIMAL, ".", STATE_DOUBLE);
-        this->addTransition(STATE_DECIMAL, "U", STATE_U);
-        this->addTransition(STATE_DECIMAL, "L", STATE_L);
+        t.addTransition(STATE_DECIMAL, "0123456789", STATE_DECIMAL);
+        t.addTransition(STATE_DECIMAL, ".", STATE_DOUBLE);
+        t.addTransition(STATE_DECIMAL, "U", STATE_U);
+        t.addTransition(STATE_DECIMAL, "L", STATE_L);
         
         
-        this->addTransition(STATE_DOUBLE, "0123456789", STATE_DOUBLE);
-        this->addTransition(STATE_DOUBLE, "f", STATE_FLOAT);
+        t.addTransition(STATE_DOUBLE, "0123456789", STATE_DOUBLE);
+        t.addTransition(STATE_DOUBLE, "f", STATE_FLOAT);
         
-        this->addTransition(STATE_U, "L", STATE_UL);
-        this->addTransition(STATE_L, "L", STATE_LL);
+        t.addTransition(STATE_U, "L", STATE_UL);
+        t.addTransition(STATE_L, "L", STATE_LL);
         
-        this->addTransition(STATE_UL, "L", STATE_ULL);
+        t.addTransition(STATE_UL, "L", STATE_ULL);
         
-        this->setStartState(STATE_START);
-        this->restart();
-
-    }
-
-    Token getToken(){
-        Token t;
-        switch (this->currentState){
-        case STATE_BINARY:  
-            t.type = TokenType::TOKEN_NUMERIC_BIN; break;
-        
-        case STATE_ZERO:  
-        case STATE_DECIMAL:  
-            t.type = TokenType::TOKEN_NUMERIC_DEC; break;
-            
-        case STATE_OCTAL:  
-            t.type = TokenType::TOKEN_NUMERIC_OCT; break;
-        
-        case STATE_DOUBLE:  
-        case STATE_HEXDOUBLE:  
-            t.type = TokenType::TOKEN_NUMERIC_DOUBLE; break;
-        case STATE_HEXFLOAT:  
-        case STATE_FLOAT:  
-            t.type = TokenType::TOKEN_NUMERIC_FLOAT; break;
-        
-        case STATE_HEX:  
-            t.type = TokenType::TOKEN_NUMERIC_HEX; break;
-        case STATE_U:
-        case STATE_UL:
-        case STATE_ULL:
-        case STATE_L:
-        case STATE_LL:
-            t.type = TokenType::TOKEN_NUMERIC_DEC; break;
-        default:
-            t.type = TokenType::TOKEN_ERROR;
-            break;
-        }
+        // accepting states and the token they produce
+        t.setAccepting(STATE_BINARY, TOKEN_NUMERIC_BIN);
+        t.setAccepting(STATE_ZERO, TOKEN_NUMERIC_DEC);
+        t.setAccepting(STATE_DECIMAL, TOKEN_NUMERIC_DEC);
+        t.setAccepting(STATE_OCTAL, TOKEN_NUMERIC_OCT);
+        t.setAccepting(STATE_DOUBLE, TOKEN_NUMERIC_DOUBLE);
+        t.setAccepting(STATE_HEXDOUBLE, TOKEN_NUMERIC_DOUBLE);
+        t.setAccepting(STATE_FLOAT, TOKEN_NUMERIC_FLOAT);
+        t.setAccepting(STATE_HEXFLOAT, TOKEN_NUMERIC_FLOAT);
+        t.setAccepting(STATE_HEX, TOKEN_NUMERIC_HEX);
+        t.setAccepting(STATE_U, TOKEN_NUMERIC_DEC);
+        t.setAccepting(STATE_UL, TOKEN_NUMERIC_DEC);
+        t.setAccepting(STATE_ULL, TOKEN_NUMERIC_DEC);
+        t.setAccepting(STATE_L, TOKEN_NUMERIC_DEC);
+        t.setAccepting(STATE_LL, TOKEN_NUMERIC_DEC);
 
         return t;
     }
 
+    static const DFATable<STATE_COUNT> table;
 };
 
 
 
-struct PunctuatorDFA: public DFA{
+struct PunctuatorDFA: public DFA<PunctuatorDFA>{
     enum PunctuatorDFA_States{
         // start and error states (non accepting) 
         STATE_ERROR = 0,
@@ -283,112 +266,102 @@ struct PunctuatorDFA: public DFA{
         STATE_SEMI_COLON,
         STATE_COMMA,
         STATE_HASH,
+        STATE_HASH_HASH,
         
 
         // currently havent supported these
-        // ... # ##
         // <: :> <% %> %: %:%: digraphs and trigraphs
         STATE_DOT_DOT_DOT,
 
         STATE_COUNT,
     };
 
-    void init(){        
+    static constexpr DFATable<STATE_COUNT> buildTable(){
+        DFATable<STATE_COUNT> t;
 
-        for (int i=0; i<STATE_COUNT; i++){
-            this->addState(i);
-        }
-
-        // NOTE: STATE_ERROR is set to 0, which is the default transition value on adding a new state
-        this->addTransition(STATE_START, "[", STATE_SQUARE_OPEN);
-        this->addTransition(STATE_START, "]", STATE_SQUARE_CLOSE);
-        this->addTransition(STATE_START, "{", STATE_CURLY_OPEN);
-        this->addTransition(STATE_START, "}", STATE_CURLY_CLOSE);
-        this->addTransition(STATE_START, "(", STATE_PARENTHESIS_OPEN);
-        this->addTransition(STATE_START, ")", STATE_PARENTHESIS_CLOSE);
-        this->addTransition(STATE_START, ".", STATE_DOT);
+        // NOTE: STATE_ERROR is set to 0, which is the default transition value in the table
+        t.addTransition(STATE_START, "[", STATE_SQUARE_OPEN);
+        t.addTransition(STATE_START, "]", STATE_SQUARE_CLOSE);
+        t.addTransition(STATE_START, "{", STATE_CURLY_OPEN);
+        t.addTransition(STATE_START, "}", STATE_CURLY_CLOSE);
+        t.addTransition(STATE_START, "(", STATE_PARENTHESIS_OPEN);
+        t.addTransition(STATE_START, ")", STATE_PARENTHESIS_CLOSE);
+        t.addTransition(STATE_START, ".", STATE_DOT);
         
-        this->addTransition(STATE_DOT, ".", STATE_DOT_DOT);
-        this->addTransition(STATE_DOT_DOT, ".", STATE_DOT_DOT_DOT);
+        t.addTransition(STATE_DOT, ".", STATE_DOT_DOT);
+        t.addTransition(STATE_DOT_DOT, ".", STATE_DOT_DOT_DOT);
 
-        this->addTransition(STATE_START, "&", STATE_AMPERSAND);
-        this->addTransition(STATE_START, "|", STATE_BITWISE_OR);
-        this->addTransition(STATE_START, "~", STATE_BITWISE_NOT);
-        this->addTransition(STATE_START, "^", STATE_BITWISE_XOR);
+        t.addTransition(STATE_START, "&", STATE_AMPERSAND);
+        t.addTransition(STATE_START, "|", STATE_BITWISE_OR);
+        t.addTransition(STATE_START, "~", STATE_BITWISE_NOT);
+        t.addTransition(STATE_START, "^", STATE_BITWISE_XOR);
         
-        this->addTransition(STATE_START, "+", STATE_PLUS);
-        this->addTransition(STATE_START, "-", STATE_MINUS);
-        this->addTransition(STATE_START, "*", STATE_STAR);
-        this->addTransition(STATE_START, "/", STATE_SLASH);
-        this->addTransition(STATE_START, "%", STATE_MODULO);
+        t.addTransition(STATE_START, "+", STATE_PLUS);
+        t.addTransition(STATE_START, "-", STATE_MINUS);
+        t.addTransition(STATE_START, "*", STATE_STAR);
+        t.addTransition(STATE_START, "/", STATE_SLASH);
+        t.addTransition(STATE_START, "%", STATE_MODULO);
         
 
-        this->addTransition(STATE_START, ">", STATE_GREATER_THAN);
-        this->addTransition(STATE_START, "<", STATE_LESS_THAN);
-        this->addTransition(STATE_START, "=", STATE_ASSIGNMENT);
-        this->addTransition(STATE_START, "?", STATE_QUESTION_MARK);
-        this->addTransition(STATE_START, ":", STATE_COLON);
-        this->addTransition(STATE_START, ";", STATE_SEMI_COLON);
-        this->addTransition(STATE_START, ",", STATE_COMMA);
-        this->addTransition(STATE_START, "!", STATE_LOGICAL_NOT);
-        this->addTransition(STATE_START, "#", STATE_HASH);
+        t.addTransition(STATE_START, ">", STATE_GREATER_THAN);
+        t.addTransition(STATE_START, "<", STATE_LESS_THAN);
+        t.addTransition(STATE_START, "=", STATE_ASSIGNMENT);
+        t.addTransition(STATE_START, "?", STATE_QUESTION_MARK);
+        t.addTransition(STATE_START, ":", STATE_COLON);
+        t.addTransition(STATE_START, ";", STATE_SEMI_COLON);
+        t.addTransition(STATE_START, ",", STATE_COMMA);
+        t.addTransition(STATE_START, "!", STATE_LOGICAL_NOT);
+        t.addTransition(STATE_START, "#", STATE_HASH);
+        t.addTransition(STATE_HASH, "#", STATE_HASH_HASH);
         
-        this->addTransition(STATE_MINUS, ">", STATE_ARROW);
-        this->addTransition(STATE_MINUS, "-", STATE_DEC);
-        this->addTransition(STATE_MINUS, "=", STATE_MINUS_ASSIGN);
+        t.addTransition(STATE_MINUS, ">", STATE_ARROW);
+        t.addTransition(STATE_MINUS, "-", STATE_DEC);
+        t.addTransition(STATE_MINUS, "=", STATE_MINUS_ASSIGN);
 
-        this->addTransition(STATE_PLUS, "+", STATE_INC);
-        this->addTransition(STATE_PLUS, "=", STATE_PLUS_ASSIGN);
+        t.addTransition(STATE_PLUS, "+", STATE_INC);
+        t.addTransition(STATE_PLUS, "=", STATE_PLUS_ASSIGN);
 
         
-        this->addTransition(STATE_MODULO, "=", STATE_MODULO_ASSIGN);
-        this->addTransition(STATE_STAR, "=", STATE_MUL_ASSIGN);
-        this->addTransition(STATE_SLASH, "=", STATE_DIV_ASSIGN);
-        this->addTransition(STATE_SHIFT_LEFT, "=", STATE_LSHIFT_ASSIGN);
-        this->addTransition(STATE_SHIFT_RIGHT, "=", STATE_RSHIFT_ASSIGN);
+        t.addTransition(STATE_MODULO, "=", STATE_MODULO_ASSIGN);
+        t.addTransition(STATE_STAR, "=", STATE_MUL_ASSIGN);
+        t.addTransition(STATE_SLASH, "=", STATE_DIV_ASSIGN);
+        t.addTransition(STATE_SHIFT_LEFT, "=", STATE_LSHIFT_ASSIGN);
+        t.addTransition(STATE_SHIFT_RIGHT, "=", STATE_RSHIFT_ASSIGN);
         
-        this->addTransition(STATE_LESS_THAN, "<", STATE_SHIFT_LEFT);
-        this->addTransition(STATE_LESS_THAN, "=", STATE_LESS_EQUALS);
+        t.addTransition(STATE_LESS_THAN, "<", STATE_SHIFT_LEFT);
+        t.addTransition(STATE_LESS_THAN, "=", STATE_LESS_EQUALS);
 
-        this->addTransition(STATE_GREATER_THAN, ">", STATE_SHIFT_RIGHT);
-        this->addTransition(STATE_GREATER_THAN, "=", STATE_GREATER_EQUALS);
+        t.addTransition(STATE_GREATER_THAN, ">", STATE_SHIFT_RIGHT);
+        t.addTransition(STATE_GREATER_THAN, "=", STATE_GREATER_EQUALS);
         
-        this->addTransition(STATE_ASSIGNMENT, "=", STATE_EQUALITY_CHECK);
+        t.addTransition(STATE_ASSIGNMENT, "=", STATE_EQUALITY_CHECK);
 
-        this->addTransition(STATE_LOGICAL_NOT, "=", STATE_NOT_EQUALS);
+        t.addTransition(STATE_LOGICAL_NOT, "=", STATE_NOT_EQUALS);
         
-        this->addTransition(STATE_AMPERSAND, "&", STATE_LOGICAL_AND);
-        this->addTransition(STATE_AMPERSAND, "=", STATE_BITWISE_AND_ASSIGN);
+        t.addTransition(STATE_AMPERSAND, "&", STATE_LOGICAL_AND);
+        t.addTransition(STATE_AMPERSAND, "=", STATE_BITWISE_AND_ASSIGN);
 
-        this->addTransition(STATE_BITWISE_OR, "|", STATE_LOGICAL_OR);
-        this->addTransition(STATE_BITWISE_OR, "=", STATE_BITWISE_OR_ASSIGN);
+        t.addTransition(STATE_BITWISE_OR, "|", STATE_LOGICAL_OR);
+        t.addTransition(STATE_BITWISE_OR, "=", STATE_BITWISE_OR_ASSIGN);
         
-        this->addTransition(STATE_BITWISE_XOR, "=", STATE_BITWISE_XOR_ASSIGN);
+        t.addTransition(STATE_BITWISE_XOR, "=", STATE_BITWISE_XOR_ASSIGN);
 
         
-        this->setStartState(STATE_START);
-        this->restart();
-
-    }
-
-    Token getToken(){
-        Token t;
-        
-        if (this->currentState > ACCEPTING_STATES_START){
-            t.type = TokenType::TOKEN_PUNCTUATORS_START + (this->currentState - ACCEPTING_STATES_START); 
-        }
-        else{
-            t.type = TokenType::TOKEN_ERROR;
+        // accepting states map to the punctuator tokens in the same order
+        for (int i=ACCEPTING_STATES_START + 1; i<STATE_COUNT; i++){
+            t.setAccepting(i, TOKEN_PUNCTUATORS_START + (i - ACCEPTING_STATES_START));
         }
+
         return t;
     }
 
+    static const DFATable<STATE_COUNT> table;
 };
 
 
 
 
-struct StringLitDFA: public DFA{
+struct StringLitDFA: public DFA<StringLitDFA>{
     enum StringLitDFA_States{
         STATE_ERROR = 0,
         STATE_START,
@@ -402,43 +375,25 @@ struct StringLitDFA: public DFA{
 
     };
 
-    void init(){        
+    static constexpr DFATable<STATE_COUNT> buildTable(){
+        DFATable<STATE_COUNT> t;
 
-        for (int i=0; i<STATE_COUNT; i++){
-            this->addState(i);
+        // NOTE: STATE_ERROR is set to 0, which is the default transition value in the table
+        t.addTransition(STATE_START, "\"", STATE_START_QUOTE);
 
-        }
-
-        // NOTE: STATE_ERROR is set to 0, which is the default transition value on adding a new state
-        this->addTransition(STATE_START, "\"", STATE_START_QUOTE);
-
-        this->addTransitionRange(STATE_START_QUOTE, ' ', '~', STATE_START_QUOTE);
-        this->addTransition(STATE_START_QUOTE, "\\", STATE_BACKSLASH);
-        this->addTransition(STATE_START_QUOTE, "\"", STATE_END_QUOTE);
+        t.addTransitionRange(STATE_START_QUOTE, ' ', '~', STATE_START_QUOTE);
+        t.addTransition(STATE_START_QUOTE, "\\", STATE_BACKSLASH);
+        t.addTransition(STATE_START_QUOTE, "\"", STATE_END_QUOTE);
 
-        this->addTransition(STATE_BACKSLASH, "\\nrabftv0\"?", STATE_START_QUOTE);
+        t.addTransition(STATE_BACKSLASH, "\\nrabftv0\"?", STATE_START_QUOTE);
 
         
-        this->setStartState(STATE_START);
-        this->restart();
-
-    }
-
+        t.setAccepting(STATE_END_QUOTE, TOKEN_STRING_LITERAL);
 
-    Token getToken(){
-        Token t;
-        
-        if (this->currentState == STATE_END_QUOTE){
-            t.type = TokenType::TOKEN_STRING_LITERAL;
-        }
-        else{
-            t.type = TokenType::TOKEN_ERROR;
-        }
         return t;
-
     }
 
-
+    static const DFATable<STATE_COUNT> table;
 };
 
 
@@ -455,3 +410,7 @@ struct CommentDFA{
 
 
 
+// the tables are evaluated at compile time, after the DFAs are complete types
+inline constexpr DFATable<NumConstDFA::STATE_COUNT> NumConstDFA::table = NumConstDFA::buildTable();
+inline constexpr DFATable<PunctuatorDFA::STATE_COUNT> PunctuatorDFA::table = PunctuatorDFA::buildTable();
+inline constexpr DFATable<StringLitDFA::STATE_COUNT> StringLitDFA::table = StringLitDFA::buildTable();
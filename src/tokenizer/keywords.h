@@ -1,6 +1,9 @@
 #pragma once
 
-static const char *KEYWORDS[] = {
+#include <stdint.h>
+#include <string.h>
+
+static constexpr const char *KEYWORDS[] = {
     "auto",
     "break",
     "case",
@@ -51,4 +54,70 @@ static const char *KEYWORDS[] = {
     "_Thread_local",
 };
 
-static const int N_KEYWORDS = sizeof(KEYWORDS)/sizeof(*KEYWORDS);
\ No newline at end of file
+static constexpr int N_KEYWORDS = sizeof(KEYWORDS)/sizeof(*KEYWORDS);
+
+
+
+/*
+    Perfect hash over the keywords, using the length and the first and last characters.
+    The multipliers were picked so that no two keywords share a slot in a table of KEYWORD_HASH_SIZE, 
+    which is checked when the table is built at compile time. 
+*/
+static constexpr int KEYWORD_HASH_SIZE = 128;
+
+static constexpr uint32_t keywordHash(const char *s, size_t len){
+    return (len * 34 + (uint8_t)s[0] * 33 + (uint8_t)s[len - 1]) & (KEYWORD_HASH_SIZE - 1);
+}
+
+
+struct KeywordHashTable{
+    // index + 1 of the keyword in KEYWORDS, 0 for empty slots
+    uint8_t slots[KEYWORD_HASH_SIZE] = {};
+    uint8_t lengths[N_KEYWORDS] = {};
+    uint8_t minLength = 0xff;
+    uint8_t maxLength = 0;
+    bool hasCollisions = false;
+};
+
+static constexpr KeywordHashTable buildKeywordHashTable(){
+    KeywordHashTable t;
+    for (int i=0; i<N_KEYWORDS; i++){
+        uint8_t len = 0;
+        while (KEYWORDS[i][len]){
+            len++;
+        }
+
+        uint32_t slot = keywordHash(KEYWORDS[i], len);
+        t.hasCollisions = t.hasCollisions || (t.slots[slot] != 0);
+        t.slots[slot] = i + 1;
+        t.lengths[i] = len;
+        t.minLength = (len < t.minLength)? len : t.minLength;
+        t.maxLength = (len > t.maxLength)? len : t.maxLength;
+    }
+    return t;
+}
+
+static constexpr KeywordHashTable KEYWORD_TABLE = buildKeywordHashTable();
+static_assert(!KEYWORD_TABLE.hasCollisions, "Keyword hash has collisions, pick other multipliers in keywordHash.");
+
+
+/*
+    Returns the index of the keyword in KEYWORDS, or -1 if the string is not a keyword.
+    Takes a single probe in the hash table and one compare.
+*/
+static int findKeyword(const char *s, size_t len){
+    if (len < KEYWORD_TABLE.minLength || len > KEYWORD_TABLE.maxLength){
+        return -1;
+    }
+
+    int slot = KEYWORD_TABLE.slots[keywordHash(s, len)];
+    if (slot == 0){
+        return -1;
+    }
+    
+    int i = slot - 1;
+    if (KEYWORD_TABLE.lengths[i] != len || memcmp(KEYWORDS[i], s, len) != 0){
+        return -1;
+    }
+    return i;
+}
\ No newline at end of file
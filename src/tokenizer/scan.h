@@ -0,0 +1,198 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/*
+    Scanning kernels used by the tokenizer to skip over runs of characters a block at a time.
+    Uses AVX2 (32 byte blocks) if compiled with it enabled, else SSE2 (16 byte blocks), else the scalar versions.
+
+    NOTE: The kernels read whole blocks past the end of a run, so the input must be followed by at least
+    SCAN_BLOCK_SIZE readable bytes after a byte that stops the scan. The tokenizer's zero sentinel padding guarantees this,
+    since 0 stops every scan.
+*/
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCAN_SIMD_SSE2
+#endif
+
+
+static bool isScanIdentifierChar(char c){
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// characters in a string literal body that keep the string dfa in the same state
+static bool isScanStringBodyChar(char c){
+    return c >= ' ' && c <= '~' && c != '"' && c != '\\';
+}
+
+
+/*
+    Scalar kernels, each returns the length of the run.
+*/
+static size_t scanWhitespaceScalar(const char *p){
+    size_t n = 0;
+    while (p[n] == ' ' || p[n] == '\n' || p[n] == '\r' || p[n] == '\t'){
+        n++;
+    }
+    return n;
+}
+
+static size_t scanUntilScalar(const char *p, char c){
+    size_t n = 0;
+    while (p[n] != c && p[n] != 0){
+        n++;
+    }
+    return n;
+}
+
+static size_t scanUntilAnyScalar(const char *p, char a, char b, char c, char d){
+    size_t n = 0;
+    while (p[n] != a && p[n] != b && p[n] != c && p[n] != d && p[n] != 0){
+        n++;
+    }
+    return n;
+}
+
+static size_t scanIdentifierScalar(const char *p){
+    size_t n = 0;
+    while (isScanIdentifierChar(p[n])){
+        n++;
+    }
+    return n;
+}
+
+static size_t scanStringBodyScalar(const char *p){
+    size_t n = 0;
+    while (isScanStringBodyChar(p[n])){
+        n++;
+    }
+    return n;
+}
+
+// appends the offset after each newline in p[start, end)
+static void scanLineStartsScalar(const char *p, size_t start, size_t end, std::vector<uint32_t> &lineStarts){
+    for (size_t i=start; i<end; i++){
+        if (p[i] == '\n'){
+            lineStarts.push_back(i + 1);
+        }
+    }
+}
+
+
+
+#if defined(SCAN_SIMD_AVX2) || defined(SCAN_SIMD_SSE2)
+
+#if defined(SCAN_SIMD_AVX2)
+typedef __m256i ScanBlock;
+static const int SCAN_BLOCK_SIZE = 32;
+static const uint32_t SCAN_FULL_MASK = 0xffffffff;
+
+static inline ScanBlock scanLoad(const char *p){ return _mm256_loadu_si256((const __m256i *)p); }
+static inline ScanBlock scanEq(ScanBlock b, char c){ return _mm256_cmpeq_epi8(b, _mm256_set1_epi8(c)); }
+static inline ScanBlock scanOr(ScanBlock a, ScanBlock b){ return _mm256_or_si256(a, b); }
+// signed compare, so bytes >= 0x80 are never in an ascii range
+static inline ScanBlock scanInRange(ScanBlock b, char lo, char hi){
+    return _mm256_and_si256(_mm256_cmpgt_epi8(b, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), b));
+}
+static inline uint32_t scanMask(ScanBlock b){ return (uint32_t)_mm256_movemask_epi8(b); }
+
+#else
+typedef __m128i ScanBlock;
+static const int SCAN_BLOCK_SIZE = 16;
+static const uint32_t SCAN_FULL_MASK = 0xffff;
+
+static inline ScanBlock scanLoad(const char *p){ return _mm_loadu_si128((const __m128i *)p); }
+static inline ScanBlock scanEq(ScanBlock b, char c){ return _mm_cmpeq_epi8(b, _mm_set1_epi8(c)); }
+static inline ScanBlock scanOr(ScanBlock a, ScanBlock b){ return _mm_or_si128(a, b); }
+// signed compare, so bytes >= 0x80 are never in an ascii range
+static inline ScanBlock scanInRange(ScanBlock b, char lo, char hi){
+    return _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8(hi + 1)));
+}
+static inline uint32_t scanMask(ScanBlock b){ return (uint32_t)_mm_movemask_epi8(b); }
+
+#endif
+
+
+/*
+    Scans blocks until a byte in the stop mask is found, returning the length of the run.
+    stopMask(block) returns the mask of bytes that end the run.
+*/
+template <typename F>
+static inline size_t scanBlocks(const char *p, F stopMask){
+    size_t n = 0;
+    while (true){
+        uint32_t stop = stopMask(scanLoad(p + n)) & SCAN_FULL_MASK;
+        if (stop){
+            return n + __builtin_ctz(stop);
+        }
+        n += SCAN_BLOCK_SIZE;
+    }
+}
+
+
+static size_t scanWhitespaceSIMD(const char *p){
+    return scanBlocks(p, [](ScanBlock b){
+        ScanBlock ws = scanOr(scanOr(scanEq(b, '\n'), scanEq(b, ' ')), scanOr(scanEq(b, '\t'), scanEq(b, '\r')));
+        return ~scanMask(ws);
+    });
+}
+
+static size_t scanUntilSIMD(const char *p, char c){
+    return scanBlocks(p, [c](ScanBlock b){
+        return scanMask(scanOr(scanEq(b, c), scanEq(b, 0)));
+    });
+}
+
+static size_t scanUntilAnySIMD(const char *p, char a, char b, char c, char d){
+    return scanBlocks(p, [a, b, c, d](ScanBlock block){
+        ScanBlock stop = scanOr(scanOr(scanEq(block, a), scanEq(block, b)), scanOr(scanEq(block, c), scanEq(block, d)));
+        return scanMask(scanOr(stop, scanEq(block, 0)));
+    });
+}
+
+static size_t scanIdentifierSIMD(const char *p){
+    return scanBlocks(p, [](ScanBlock b){
+        ScanBlock letters = scanOr(scanInRange(b, 'a', 'z'), scanInRange(b, 'A', 'Z'));
+        ScanBlock ident = scanOr(scanOr(letters, scanInRange(b, '0', '9')), scanEq(b, '_'));
+        return ~scanMask(ident);
+    });
+}
+
+static size_t scanStringBodySIMD(const char *p){
+    return scanBlocks(p, [](ScanBlock b){
+        ScanBlock printable = scanInRange(b, ' ', '~');
+        ScanBlock special = scanOr(scanEq(b, '"'), scanEq(b, '\\'));
+        return ~scanMask(printable) | scanMask(special);
+    });
+}
+
+// appends the offset after each newline in p[start, end), a block at a time
+static void scanLineStartsSIMD(const char *p, size_t start, size_t end, std::vector<uint32_t> &lineStarts){
+    size_t i = start;
+    for (; i + SCAN_BLOCK_SIZE <= end; i += SCAN_BLOCK_SIZE){
+        uint32_t newlines = scanMask(scanEq(scanLoad(p + i), '\n'));
+        while (newlines){
+            lineStarts.push_back(i + __builtin_ctz(newlines) + 1);
+            // clear the lowest set bit
+            newlines &= newlines - 1;
+        }
+    }
+    scanLineStartsScalar(p, i, end, lineStarts);
+}
+
+#else
+
+static size_t scanWhitespaceSIMD(const char *p){ return scanWhitespaceScalar(p); }
+static size_t scanUntilSIMD(const char *p, char c){ return scanUntilScalar(p, c); }
+static size_t scanUntilAnySIMD(const char *p, char a, char b, char c, char d){ return scanUntilAnyScalar(p, a, b, c, d); }
+static size_t scanIdentifierSIMD(const char *p){ return scanIdentifierScalar(p); }
+static size_t scanStringBodySIMD(const char *p){ return scanStringBodyScalar(p); }
+static void scanLineStartsSIMD(const char *p, size_t start, size_t end, std::vector<uint32_t> &lineStarts){ scanLineStartsScalar(p, start, end, lineStarts); }
+
+#endif
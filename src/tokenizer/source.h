@@ -0,0 +1,31 @@
+#pragma once
+
+#include "token.h"
+
+#include <stddef.h>
+
+
+/*
+    Line and column of a position in a source buffer, both starting at 1.
+    Positions that are not in any loaded source (eg: tokens made up by later stages) are at 0:0.
+*/
+struct SourceLocation{
+    int lineNo;
+    int charNo;
+};
+
+
+/*
+    Tokens only store their position in the source buffer, through Token::string.
+    Every loaded buffer is registered here, and the line starts of a buffer are found on the first lookup into it,
+    so line and column numbers are only computed when a diagnostic needs them.
+*/
+void registerSource(const char *buffer, size_t size);
+void unregisterSource(const char *buffer);
+
+SourceLocation locateInSource(const char *position);
+
+
+static SourceLocation locateToken(const Token &token){
+    return locateInSource(token.string.data);
+}
@@ -8,10 +8,15 @@
 
 struct Splice{
     const char *data;
-    size_t len;
+    uint32_t len;
+    // interned id of the string, 0 if it has not been interned (see atoms.h)
+    uint32_t atom;
 
     // Define equality operator so unordered_map can check for collisions
     bool operator==(const Splice& other) const{
+        if (atom && other.atom){
+            return atom == other.atom;
+        }
         return len == other.len && strncmp(data, other.data, len) == 0;
     }
 };
@@ -31,6 +36,9 @@ static bool compare(Splice s, const char* str){
 
 
 static bool compare(Splice a, Splice b){
+    // interned strings are equal only if their atoms are
+    if (a.atom && b.atom)
+        return a.atom == b.atom;
     if (a.len != b.len) 
         return false; 
     return strncmp(a.data, b.data, a.len) == 0;
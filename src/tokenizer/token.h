@@ -2,11 +2,25 @@
 
 #include "str.h"
 
+/*
+    Value of a numeric or character literal, decoded once by the tokenizer.
+    Integer literals (and character literals) are in i64/u64, float literals in f32 and double literals in f64.
+*/
+union LiteralValue{
+    int64_t i64;
+    uint64_t u64;
+    float f32;
+    double f64;
+};
+
 struct Token{
     int type;
+    // position of the token in the token stream, fits in the padding before string
+    int index;
+    // points into the source buffer, line and column are found from it when needed (see source.h)
     Splice string;
-    int charNo;
-    int lineNo;
+    // only set for numeric and character literals
+    LiteralValue value;
 };
 
 enum TokenType{
@@ -133,6 +147,7 @@ enum TokenType{
     TOKEN_SEMI_COLON,
     TOKEN_COMMA,
     TOKEN_HASH,
+    TOKEN_HASH_HASH, // ##, only used in macro definitions
     
     TOKEN_DOT_DOT_DOT, // ...
     
@@ -273,6 +288,7 @@ static const char *TOKEN_TYPE_STRING[] = {
     "TOKEN_SEMI_COLON",
     "TOKEN_COMMA",
     "TOKEN_HASH",
+    "TOKEN_HASH_HASH",
     
     "TOKEN_DOT_DOT_DOT",
     
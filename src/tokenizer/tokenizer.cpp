@@ -6,6 +6,16 @@
 
 #include <ctype.h>
 #include <fstream>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 /*
@@ -68,10 +78,6 @@ static bool isWhitespace(char c){
     return c == ' ' || c == '\n' || c == '\r' || c == '\t';
 }
 
-static bool isIdentifierChar(char c){
-    return isNonNumeric(c) || isdigit(c);
-}
-
 static bool isNumberChar(char c){
     return isNumeric(c) || c == '.' || c == 'x' || isBetween(c, 'a', 'f') || isBetween(c, 'A', 'F') || c == 'U' || c == 'L' || c == '+' || c == '-';
 }
@@ -83,33 +89,46 @@ static bool isStringLiteralChar(char c){
 
 
 
+/*
+    NOTE: The buffer is always followed by SENTINEL_PADDING zero bytes, so the scanners stop on the 0
+    sentinel instead of checking for the end of the buffer on every character. 
+    A 0 byte is only checked against the buffer size where it could also be part of the source.
+*/
+
 void Tokenizer::skipNonWhitespaces(){
-    while (!this->isEOF() && !isWhitespace(this->buffer[this->cursor])){
+    while (!isWhitespace(this->buffer[this->cursor]) && !this->isSentinel()){
         this->consumeChar();
     }
 }
 
 void Tokenizer::skipWhitespaces(){
-    while (!this->isEOF() && isWhitespace(this->buffer[this->cursor])){
-        this->consumeChar();
-    }
+    const char *p = &this->buffer[this->cursor];
+    this->cursor += this->useSIMD? scanWhitespaceSIMD(p) : scanWhitespaceScalar(p);
 }
 
 void Tokenizer::skipUntil(char c){
-    while (!this->isEOF() && this->buffer[this->cursor] != c){
+    while (true){
+        const char *p = &this->buffer[this->cursor];
+        this->cursor += this->useSIMD? scanUntilSIMD(p, c) : scanUntilScalar(p, c);
+        
+        // the scan also stops on a 0 byte, which is skipped over if it is part of the source 
+        if (this->buffer[this->cursor] == c || this->isSentinel()){
+            break;
+        }
         this->consumeChar();
     }
 }
 
+
 void Tokenizer::skipComments(){
-    if (!this->isEOF() && this->buffer[this->cursor] == '/'){
+    if (this->buffer[this->cursor] == '/'){
         // if single line comment, skip until a newline
-        if ((this->cursor + 1) < this->bufferSize && this->buffer[this->cursor + 1] == '/'){
+        if (this->buffer[this->cursor + 1] == '/'){
             this->skipUntil('\n');
             this->consumeChar();
         }
         // if multi line comment, skip until */ is found
-        else if ((this->cursor + 1) < this->bufferSize && this->buffer[this->cursor + 1] == '*'){
+        else if (this->buffer[this->cursor + 1] == '*'){
             // skip until a *, then check if next char is a /
             while (true){
                 this->skipUntil('*');
@@ -117,7 +136,10 @@ void Tokenizer::skipComments(){
                 
                 // if eof is encountered before finding a */, return error
                 if (this->isEOF()){
-                    std::cout<<"ERROR: Multiline comment no end";
+                    if (this->reportsErrors){
+                        std::cout<<"ERROR: Multiline comment no end";
+                    }
+                    this->hasOpenComment = true;
                     return;
                 } 
                 if (this->buffer[this->cursor] == '/'){
@@ -133,14 +155,25 @@ void Tokenizer::skipComments(){
 
 
 void Tokenizer::init(){
-    // initialize the dfas 
-    this->numDFA.init();
-    this->puncDFA.init();
-    this->strDFA.init();
+    // the dfa tables are built at compile time, only the current states need resetting
+    this->numDFA.restart();
+    this->puncDFA.restart();
+    this->strDFA.restart();
 
-    lineNo = 1;
-    charNo = 1;
     errors = 0;
+    useSIMD = true;
+    reportsErrors = true;
+    hasOpenComment = false;
+    internsAtoms = true;
+
+    buffer = 0;
+    bufferSize = 0;
+    isMapped = false;
+
+    isPreLexed = false;
+    tokenIndex = 0;
+    lexedUntil = 0;
+    relexedTokens = 0;
 
 
 }
@@ -152,24 +185,26 @@ void Tokenizer::init(){
 
 Token Tokenizer::getIdentifierToken(){
     size_t tokenStart = this->cursor;
-    while (!this->isEOF() && isIdentifierChar(this->peekChar())){
-        this->consumeChar();
-    }
+    const char *p = &this->buffer[this->cursor];
+    this->cursor += this->useSIMD? scanIdentifierSIMD(p) : scanIdentifierScalar(p);
 
     Splice s;
     s.data = &this->buffer[tokenStart];
     s.len  = this->cursor - tokenStart;
+    s.atom = NO_ATOM;
 
-    Token t;
+    Token t = {};
     t.type = TokenType::TOKEN_IDENTIFIER;
     t.string = s;
     
-    // compare with keywords
-    for (int i=0; i<N_KEYWORDS; i++){
-        if (compare(s, KEYWORDS[i])){
-            t.type = TokenType::TOKEN_KEYWORDS_START + i + 1;
-            break;
-        }
+    // check if it is a keyword, keywords are interned first so their atoms need no lookup
+    int keyword = findKeyword(s.data, s.len);
+    if (keyword >= 0){
+        t.type = TokenType::TOKEN_KEYWORDS_START + keyword + 1;
+        t.string.atom = keyword + 1;
+    }
+    else if (this->internsAtoms){
+        t.string.atom = internAtom(s.data, s.len);
     }
     
     return t;
@@ -180,7 +215,17 @@ Token Tokenizer::getStringLiteralToken(){
     size_t tokenStart = this->cursor;
 
     this->strDFA.restart();
-    while (!this->isEOF() && isStringLiteralChar(this->buffer[this->cursor])){
+    while (isStringLiteralChar(this->buffer[this->cursor])){
+        // skip the run of plain characters in the string body, which keep the dfa in the same state
+        if (this->strDFA.currentState == StringLitDFA::STATE_START_QUOTE){
+            const char *p = &this->buffer[this->cursor];
+            this->cursor += this->useSIMD? scanStringBodySIMD(p) : scanStringBodyScalar(p);
+            
+            if (!isStringLiteralChar(this->buffer[this->cursor])){
+                break;
+            }
+        }
+
         if (this->strDFA.willErrorTransition(this->buffer[this->cursor])){
             break;
         }
@@ -191,21 +236,111 @@ Token Tokenizer::getStringLiteralToken(){
     Splice s;
     s.data = &this->buffer[tokenStart];
     s.len  = this->cursor - tokenStart;
+    s.atom = NO_ATOM;
 
-    Token t;
+    Token t = {};
     t.type = TokenType::TOKEN_STRING_LITERAL;
     t.string = s;
     
     return t;
 }
 
+/*
+    Decode the value of an integer literal, from its prefix: 0x hex, 0b binary, 0 octal, else decimal.
+    The digits end at the U/L suffixes. Values that do not fit in 64 bits wrap around.
+*/
+static uint64_t decodeInteger(Splice s){
+    const char *p = s.data;
+    const char *end = s.data + s.len;
+    
+    uint64_t base = 10;
+    if (s.len >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')){
+        base = 16;
+        p += 2;
+    }
+    else if (s.len >= 2 && p[0] == '0' && (p[1] == 'b' || p[1] == 'B')){
+        base = 2;
+        p += 2;
+    }
+    else if (s.len >= 2 && p[0] == '0'){
+        base = 8;
+        p += 1;
+    }
+
+    uint64_t value = 0;
+    for (; p < end; p++){
+        char c = *p;
+        uint64_t digit;
+        if (c >= '0' && c <= '9'){
+            digit = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f'){
+            digit = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F'){
+            digit = c - 'A' + 10;
+        }
+        else {
+            break;
+        }
+        value = value * base + digit;
+    }
+    return value;
+}
+
+
+/*
+    Decode the value of an accepted numeric literal token.
+*/
+static LiteralValue decodeNumber(int type, Splice s){
+    LiteralValue value = {0};
+
+    if (type == TOKEN_NUMERIC_FLOAT || type == TOKEN_NUMERIC_DOUBLE){
+        // strtod needs the literal null terminated, the f suffix ends the conversion
+        char buf[128];
+        std::string longLiteral;
+        const char *str = buf;
+        if (s.len < sizeof(buf)){
+            copyToArr(s, buf, sizeof(buf));
+        }
+        else {
+            longLiteral.assign(s.data, s.len);
+            str = longLiteral.c_str();
+        }
+
+        if (type == TOKEN_NUMERIC_FLOAT){
+            value.f32 = strtof(str, NULL);
+        }
+        else {
+            value.f64 = strtod(str, NULL);
+        }
+    }
+    else if (type == TOKEN_NUMERIC_DEC || type == TOKEN_NUMERIC_HEX || type == TOKEN_NUMERIC_OCT || type == TOKEN_NUMERIC_BIN){
+        value.u64 = decodeInteger(s);
+    }
+    return value;
+}
+
+
+// value of the escape sequence \c
+static char decodeEscape(char c){
+    switch (c){
+        case 'r': return '\r';
+        case 'n': return '\n';
+        case 't': return '\t';
+        case '0': return '\0';
+        default:  return c;
+    }
+}
+
+
 Token Tokenizer::getNumberToken(){
     size_t tokenStart = this->cursor;
     
     this->numDFA.restart();
     // isPunctuatorChar is used to consume chars even if it is error
     // eg: 0x123s is a whole error token instead of 0x123 and s as two separate tokens
-    while (!this->isEOF() && !isWhitespace(this->buffer[this->cursor])
+    while (this->buffer[this->cursor] != 0 && !isWhitespace(this->buffer[this->cursor])
             && (!isPunctuatorChar(this->buffer[this->cursor]) || isNumberChar(this->buffer[this->cursor]))){
         this->numDFA.transition(this->buffer[this->cursor]);
         this->consumeChar();
@@ -215,9 +350,11 @@ Token Tokenizer::getNumberToken(){
     Splice s;
     s.data = &this->buffer[tokenStart];
     s.len  = this->cursor - tokenStart;
+    s.atom = NO_ATOM;
     
     Token t = this->numDFA.getToken();
     t.string = s;
+    t.value = decodeNumber(t.type, s);
     return t;
 }
 
@@ -227,7 +364,7 @@ Token Tokenizer::getPunctuatorToken(){
     size_t tokenStart = this->cursor;
     
     this->puncDFA.restart();
-    while (!this->isEOF() && isPunctuatorChar(this->buffer[this->cursor])){
+    while (isPunctuatorChar(this->buffer[this->cursor])){
         if (this->puncDFA.willErrorTransition(this->buffer[this->cursor])){
             break;
         }
@@ -238,6 +375,7 @@ Token Tokenizer::getPunctuatorToken(){
     Splice s;
     s.data = &this->buffer[tokenStart];
     s.len  = this->cursor - tokenStart;
+    s.atom = NO_ATOM;
     
     Token t = this->puncDFA.getToken();
     t.string = s;
@@ -247,7 +385,7 @@ Token Tokenizer::getPunctuatorToken(){
 
 Token Tokenizer::getCharLiteralToken() {
     size_t tokenStart = this->cursor;
-    Token t;
+    Token t = {};
     t.type = TOKEN_CHARACTER_LITERAL;
     // consume start single quote
     this->consumeChar();
@@ -275,10 +413,10 @@ Token Tokenizer::getCharLiteralToken() {
         if (!isAllowed(this->peekChar())){
             t.type = TOKEN_ERROR;
         }
-        this->consumeChar();
+        t.value.i64 = decodeEscape(this->consumeChar());
     }
     else {
-        this->consumeChar();
+        t.value.i64 = this->consumeChar();
     }
 
 
@@ -293,6 +431,7 @@ Token Tokenizer::getCharLiteralToken() {
     Splice s;
     s.data = &this->buffer[tokenStart];
     s.len  = this->cursor - tokenStart;
+    s.atom = NO_ATOM;
     
     t.string = s;
 
@@ -306,14 +445,29 @@ bool Tokenizer::isEOF(){
     return this->cursor >= this->bufferSize;
 }
 
+// true if the cursor is at the 0 sentinel after the buffer, and not a 0 byte within the source
+bool Tokenizer::isSentinel(){
+    return this->buffer[this->cursor] == 0 && this->isEOF();
+}
 
 
 
-Token Tokenizer::nextToken(){
+
+/*
+    Move the cursor past any whitespace and comments, to the start of the next token.
+*/
+void Tokenizer::skipToNextToken(){
     // loop until a valid token is reached
     while(true){
         // get to next token
         this->skipWhitespaces();
+
+        // a backslash ending a line joins it with the next one (line continuation)
+        const char *p = &this->buffer[this->cursor];
+        if (p[0] == '\\' && (p[1] == '\n' || (p[1] == '\r' && p[2] == '\n'))){
+            this->cursor += (p[1] == '\n')? 2 : 3;
+            continue;
+        }
         
         // check if it is start of a comment and skip
         if (!this->checkForComments())
@@ -321,18 +475,24 @@ Token Tokenizer::nextToken(){
 
         this->skipComments();
     }
+}
+
+
+/*
+    Lex the next token from the source buffer, starting at the cursor.
+*/
+Token Tokenizer::lexToken(){
+    this->skipToNextToken();
 
     if (this->isEOF()){
+        // the EOF token points at the end of the buffer, so that it can be located
         return Token{
             .type = TOKEN_EOF,
-            .charNo = this->charNo,
-            .lineNo = this->lineNo,
+            .string = {&this->buffer[this->cursor], 0},
         };
     }
 
     Token t = {0};
-    int tokenCharNo = this->charNo;
-    int tokenLineNo = this->lineNo;
 
     
     // starts with an alphabet or _
@@ -357,6 +517,7 @@ Token Tokenizer::nextToken(){
     }
     else{
         t.type = TOKEN_ERROR;
+        t.string = {&this->buffer[this->cursor], 0};
     }
     
     
@@ -364,44 +525,495 @@ Token Tokenizer::nextToken(){
     if (t.type == TOKEN_ERROR){
         this->errors++;
         
-        logErrorCode(this->fileName, this->lineNo, this->charNo, ERROR_UNKNOWN);
+        if (this->reportsErrors){
+            this->logLexError(this->cursor);
+        }
         this->skipNonWhitespaces();
     }
-    t.lineNo = tokenLineNo;
-    t.charNo = tokenCharNo;
     return t;
 
 }
 
 
 
-void Tokenizer::loadFileToBuffer(const char *filepath){
+/*
+    Get the next token in the stream. 
+    In pre-lexed mode, the token is read from the token buffer, else it is lexed from the source.
+*/
+Token Tokenizer::nextToken(){
+    if (this->isPreLexed){
+        // the last token is the EOF, which is returned for any reads past the end
+        size_t index = this->tokenIndex;
+        if (index >= this->tokens.count()){
+            index = this->tokens.count() - 1;
+        }
+        this->tokenIndex = index + 1;
+        return this->bufferedToken(index);
+    }
+
+    // tokens before the furthest lexed token are being lexed again after a rewind
+    if (this->tokenIndex < this->lexedUntil){
+        this->relexedTokens++;
+    }
+
+    Token t = this->lexToken();
+    t.index = this->tokenIndex;
+    
+    this->tokenIndex++;
+    if (this->tokenIndex > this->lexedUntil){
+        this->lexedUntil = this->tokenIndex;
+    }
+    return t;
+}
+
+
+/*
+    Reconstruct a token from the token buffer.
+*/
+Token Tokenizer::bufferedToken(size_t index){
+    Token t;
+    t.type = this->tokens.types[index];
+    t.index = index;
+    t.string.data = this->tokens.starts[index];
+    t.string.len = this->tokens.lengths[index];
+    t.string.atom = this->tokens.atoms[index];
+    t.value = this->tokens.values[index];
+    return t;
+}
+
+
+/*
+    Lex the whole source buffer into the token buffer, up to and including the EOF token.
+    Further calls to nextToken are served from the token buffer, and rewinds only reset the token index.
+*/
+void Tokenizer::preLex(){
+    assert(!this->isPreLexed && this->tokenIndex == 0);
+
+    // rough estimate of the token count to avoid regrowing the arrays
+    size_t estimate = this->bufferSize / 4 + 1;
+    this->tokens.reserve(estimate);
+
+    while (true){
+        Token t = this->lexToken();
+        this->tokens.push(t);
+
+        if (t.type == TOKEN_EOF){
+            break;
+        }
+    }
+
+    this->isPreLexed = true;
+    this->tokenIndex = 0;
+    this->lexedUntil = this->tokens.count();
+}
+
+
+
+/*
+    Tokens lexed by a worker from the chunk [start, end) of the source.
+*/
+struct LexedChunk{
+    size_t start;
+    size_t end;
+    TokenBuffer tokens;
+    // start of the first token after the chunk, the end of the buffer if the chunk ended with the EOF
+    size_t nextStart;
+    bool hasOpenComment;
+};
+
+
+/*
+    Cheap pre-pass to split the source into about nChunks chunks, returning the chunk starts.
+    Chunks start after a newline that is outside strings, char literals and comments, tracked the way the lexer would,
+    so that lexing from a chunk start mostly gives the same tokens as lexing the whole source.
+*/
+std::vector<size_t> Tokenizer::findChunkStarts(size_t nChunks){
+    enum { CODE, STRING, CHARACTER, LINE_COMMENT, BLOCK_COMMENT } state = CODE;
+
+    std::vector<size_t> starts = {0};
+    size_t target = this->bufferSize / nChunks;
+
+    auto scan = [&](size_t i, char a, char b, char c, char d){
+        const char *p = &this->buffer[i];
+        return i + (this->useSIMD? scanUntilAnySIMD(p, a, b, c, d) : scanUntilAnyScalar(p, a, b, c, d));
+    };
+
+    for (size_t i=0; i<this->bufferSize && starts.size() < nChunks; i++){
+        // skip to the next character that can change the state
+        switch (state){
+            case CODE:
+                // newlines only matter from just before the next chunk start on
+                if (i + 1 >= target){
+                    i = scan(i, '"', '\'', '/', '\n');
+                }
+                else {
+                    i = std::min(scan(i, '"', '\'', '/', '"'), target - 1);
+                }
+                break;
+            case STRING:        i = scan(i, '"', '\\', '\n', '"'); break;
+            case CHARACTER:     i = scan(i, '\'', '\\', '\n', '\''); break;
+            case LINE_COMMENT:  i = scan(i, '\n', '\n', '\n', '\n'); break;
+            case BLOCK_COMMENT: i = scan(i, '*', '*', '*', '*'); break;
+        }
+        if (i >= this->bufferSize){
+            break;
+        }
+
+        char c = this->buffer[i];
+        switch (state){
+            case CODE:
+                if (c == '"'){
+                    state = STRING;
+                }
+                else if (c == '\''){
+                    state = CHARACTER;
+                }
+                // the lexer looks for the end of a block comment from its opening /, so /*/ is a whole comment
+                else if (c == '/' && (this->buffer[i + 1] == '/' || this->buffer[i + 1] == '*')){
+                    state = (this->buffer[i + 1] == '/')? LINE_COMMENT : BLOCK_COMMENT;
+                }
+                else if (c == '\n' && i + 1 >= target){
+                    starts.push_back(i + 1);
+                    target = this->bufferSize * starts.size() / nChunks;
+                }
+                break;
+
+            case STRING:
+            case CHARACTER:
+                if (c == '\\'){
+                    i++;
+                }
+                // literals are not allowed to span lines, the lexer ends them at the newline
+                else if (c == '\n' || c == ((state == STRING)? '"' : '\'')){
+                    state = CODE;
+                }
+                break;
+
+            case LINE_COMMENT:
+                if (c == '\n'){
+                    state = CODE;
+                }
+                break;
+
+            case BLOCK_COMMENT:
+                if (c == '*' && this->buffer[i + 1] == '/'){
+                    state = CODE;
+                    i++;
+                }
+                break;
+        }
+    }
+    return starts;
+}
+
+
+/*
+    Lex the tokens starting in the chunk, running on a worker tokenizer over the same buffer.
+    The last token may extend past the end of the chunk.
+*/
+void Tokenizer::lexChunk(LexedChunk *chunk){
+    this->cursor = chunk->start;
+    chunk->tokens.reserve((chunk->end - chunk->start) / 4 + 1);
+
+    while (true){
+        this->skipToNextToken();
+        if (!this->isEOF() && this->cursor >= chunk->end){
+            break;
+        }
+
+        Token t = this->lexToken();
+        chunk->tokens.push(t);
+
+        if (t.type == TOKEN_EOF){
+            break;
+        }
+    }
+    chunk->nextStart = this->cursor;
+    chunk->hasOpenComment = this->hasOpenComment;
+}
+
+
+/*
+    Pre-lex the source on nThreads threads, giving the same token buffer and diagnostics as preLex.
+    The source is split into chunks (see findChunkStarts) that are lexed independently, then stitched in order.
+    A chunk's tokens are only used from the first one that starts where the next token of the stream so far starts,
+    since lexing from there on is the same as lexing the whole source. Until then, the stream is lexed sequentially.
+*/
+void Tokenizer::preLexParallel(int nThreads, size_t minChunkSize){
+    assert(!this->isPreLexed && this->tokenIndex == 0);
+
+    size_t nChunks = std::min((size_t)std::max(nThreads, 1), this->bufferSize / std::max(minChunkSize, (size_t)1));
+    if (nChunks <= 1){
+        this->preLex();
+        return;
+    }
+
+    std::vector<size_t> starts = this->findChunkStarts(nChunks);
+    nChunks = starts.size();
+
+    std::vector<LexedChunk> chunks(nChunks);
+    std::vector<Tokenizer> workers(nChunks);
+    for (size_t i=0; i<nChunks; i++){
+        chunks[i].start = starts[i];
+        chunks[i].end = (i + 1 < nChunks)? starts[i + 1] : this->bufferSize;
+
+        workers[i].init();
+        workers[i].buffer = this->buffer;
+        workers[i].bufferSize = this->bufferSize;
+        workers[i].isMapped = false;
+        workers[i].useSIMD = this->useSIMD;
+        // errors are reported and identifiers interned once the tokens are stitched, since chunks can be lexed out of sync
+        workers[i].reportsErrors = false;
+        workers[i].internsAtoms = false;
+    }
+
+    // the first chunk is lexed on this thread
+    std::vector<std::thread> threads;
+    for (size_t i=1; i<nChunks; i++){
+        threads.emplace_back(&Tokenizer::lexChunk, &workers[i], &chunks[i]);
+    }
+    workers[0].lexChunk(&chunks[0]);
+    for (std::thread &thread : threads){
+        thread.join();
+    }
+
+
+    // stitch the chunks together, lexing on this tokenizer wherever a chunk is out of sync
+    bool reportsErrors = this->reportsErrors;
+    size_t errors = this->errors;
+    this->reportsErrors = false;
+    this->internsAtoms = false;
+    this->hasOpenComment = false;
+    this->tokens.reserve(this->bufferSize / 4 + 1);
+
+    // start of the next token in the stitched stream
+    this->cursor = 0;
+    this->skipToNextToken();
+    size_t next = this->cursor;
+    bool isDone = false;
+    for (size_t c=0; c<nChunks && !isDone; c++){
+        LexedChunk &chunk = chunks[c];
+        size_t i = 0;
+        this->cursor = next;
+        
+        while (true){
+            while (i < chunk.tokens.count() && chunk.tokens.starts[i] < &this->buffer[next]){
+                i++;
+            }
+            
+            // in sync, the rest of the chunk is the same as the stream
+            if (i < chunk.tokens.count() && chunk.tokens.starts[i] == &this->buffer[next]){
+                this->tokens.append(chunk.tokens, i);
+                next = chunk.nextStart;
+                isDone = chunk.tokens.types.back() == TOKEN_EOF;
+                this->hasOpenComment |= isDone && chunk.hasOpenComment;
+                break;
+            }
+            // the rest of the stream starts in a later chunk
+            if (next >= chunk.end && c + 1 < nChunks){
+                break;
+            }
+
+            Token t = this->lexToken();
+            this->tokens.push(t);
+            if (t.type == TOKEN_EOF){
+                isDone = true;
+                break;
+            }
+
+            this->skipToNextToken();
+            next = this->cursor;
+        }
+    }
+    assert(isDone);
+
+
+    // intern the identifiers and report the errors in order, as lexing sequentially would have
+    this->internsAtoms = true;
+    this->reportsErrors = reportsErrors;
+    this->errors = errors;
+    for (size_t i=0; i<this->tokens.count(); i++){
+        if (this->tokens.types[i] == TOKEN_IDENTIFIER){
+            this->tokens.atoms[i] = internAtom(this->tokens.starts[i], this->tokens.lengths[i]);
+        }
+        else if (this->tokens.types[i] == TOKEN_ERROR){
+            this->errors++;
+            if (this->reportsErrors){
+                this->logLexError(this->tokens.starts[i] - this->buffer + this->tokens.lengths[i]);
+            }
+        }
+    }
+    if (this->hasOpenComment && this->reportsErrors){
+        std::cout<<"ERROR: Multiline comment no end";
+    }
+
+    this->isPreLexed = true;
+    this->tokenIndex = 0;
+    this->lexedUntil = this->tokens.count();
+}
+
+
+/*
+    Serve the given token stream instead of lexing a source buffer, eg: the output of the preprocessor.
+    The stream must end with an EOF token, and the buffers its tokens point into must outlive the tokenizer.
+*/
+void Tokenizer::loadTokens(TokenBuffer &&tokens, const char *name){
+    assert(!this->isPreLexed && tokens.count() > 0 && tokens.types.back() == TOKEN_EOF);
+
+    strncpy(this->fileName, name, min(sizeof(this->fileName), strlen(name)));
+    this->tokens = std::move(tokens);
+
+    this->isPreLexed = true;
+    this->tokenIndex = 0;
+    this->lexedUntil = this->tokens.count();
+}
+
+
+/*
+    Log an unknown token error at the given offset in the buffer.
+*/
+void Tokenizer::logLexError(size_t offset){
+    SourceLocation location = locateInSource(&this->buffer[offset]);
+    logErrorCode(this->fileName, location.lineNo, location.charNo, ERROR_UNKNOWN);
+}
+
+// log the error of a token lexed without reporting errors
+void Tokenizer::logLexError(Token t){
+    this->logLexError(t.string.data - this->buffer + t.string.len);
+}
+
+
+
+/*
+    Load a source file into the buffer, followed by SENTINEL_PADDING zero bytes.
+    Small files are read with a single read. Larger files are memory mapped read only, so that the
+    source is not copied, with an anonymous zero page reserved right after the mapping as the sentinel.
+*/
+bool Tokenizer::loadFileToBuffer(const char *filepath){
+    this->cursor = 0;
+    this->isMapped = false;
+    strncpy(this->fileName, filepath, min(sizeof(this->fileName), strlen(filepath)));
+
+#if defined(__linux__)
+    int fd = open(filepath, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0){
+        perror("Failed to open source file");
+        if (fd >= 0){
+            close(fd);
+        }
+        return false;
+    }
+    this->bufferSize = info.st_size;
+
+    if (this->bufferSize >= MMAP_THRESHOLD){
+        // reserve space for the file and a trailing zero page, then map the file over the start of it
+        long pageSize = sysconf(_SC_PAGESIZE);
+        this->mappedSize = alignUpPowerOf2(this->bufferSize, pageSize) + pageSize;
+        
+        void *reserved = mmap(0, this->mappedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void *mapped = MAP_FAILED;
+        if (reserved != MAP_FAILED){
+            mapped = mmap(reserved, this->bufferSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        }
+        
+        if (mapped != MAP_FAILED){
+            close(fd);
+            this->buffer = (char *)mapped;
+            this->isMapped = true;
+            registerSource(this->buffer, this->bufferSize);
+            return true;
+        }
+
+        // fall back to reading the file
+        if (reserved != MAP_FAILED){
+            munmap(reserved, this->mappedSize);
+        }
+    }
+
+    this->buffer = new char[this->bufferSize + SENTINEL_PADDING];
+    
+    size_t bytesRead = 0;
+    while (bytesRead < this->bufferSize){
+        ssize_t n = read(fd, this->buffer + bytesRead, this->bufferSize - bytesRead);
+        if (n <= 0){
+            break;
+        }
+        bytesRead += n;
+    }
+    close(fd);
+    
+    this->bufferSize = bytesRead;
+    memset(this->buffer + this->bufferSize, 0, SENTINEL_PADDING);
+    registerSource(this->buffer, this->bufferSize);
+    return true;
+
+#else
     std::ifstream f(filepath, std::ios::binary);
+    if (!f.is_open()){
+        perror("Failed to open source file");
+        return false;
+    }
     
     f.seekg(0, std::ios::end);
     this->bufferSize = f.tellg();
     f.seekg(0, std::ios::beg);
 
-    this->buffer = new char[this->bufferSize + 1];
+    this->buffer = new char[this->bufferSize + SENTINEL_PADDING];
     
     f.read(this->buffer, this->bufferSize); 
-    this->buffer[this->bufferSize] = 0;
+    memset(this->buffer + this->bufferSize, 0, SENTINEL_PADDING);
 
-    this->cursor = 0;
     f.close();
+    registerSource(this->buffer, this->bufferSize);
+    return true;
+#endif
+}
 
-    strncpy(this->fileName, filepath, min(sizeof(this->fileName), strlen(filepath)));
+
+/*
+    Load source text from memory into the buffer, with name used as the file name in diagnostics.
+*/
+void Tokenizer::loadStringToBuffer(const char *source, size_t size, const char *name){
+    this->bufferSize = size;
+    this->buffer = new char[this->bufferSize + SENTINEL_PADDING];
+    this->isMapped = false;
+    
+    memcpy(this->buffer, source, this->bufferSize);
+    memset(this->buffer + this->bufferSize, 0, SENTINEL_PADDING);
+
+    this->cursor = 0;
+    registerSource(this->buffer, this->bufferSize);
+
+    strncpy(this->fileName, name, min(sizeof(this->fileName), strlen(name)));
+}
+
+
+/*
+    Free or unmap the source buffer.
+*/
+void Tokenizer::destroy(){
+    unregisterSource(this->buffer);
+#if defined(__linux__)
+    if (this->isMapped){
+        munmap(this->buffer, this->mappedSize);
+        this->buffer = 0;
+        return;
+    }
+#endif
+    delete[] this->buffer;
+    this->buffer = 0;
 }
 
 
 bool Tokenizer::checkForComments(){
-    if (!this->isEOF() && this->buffer[this->cursor] == '/'){
+    if (this->buffer[this->cursor] == '/'){
         // check for "//"
-        if ((this->cursor + 1) < this->bufferSize && this->buffer[this->cursor + 1] == '/'){
+        if (this->buffer[this->cursor + 1] == '/'){
             return true;
         }
         // check for "/*"
-        if ((this->cursor + 1) < this->bufferSize && this->buffer[this->cursor + 1] == '*'){
+        if (this->buffer[this->cursor + 1] == '*'){
             return true;
         }
     }
@@ -414,23 +1026,235 @@ char Tokenizer::peekChar(){
 }
 
 char Tokenizer::consumeChar(){
-    if (isEOF()){
-        return 0;
-    }
     char c = this->buffer[this->cursor];
-    if (c == '\n'){
-        this->lineNo++;
-        this->charNo = 1;
-    }
-    else{
-        this->charNo++;
+    if (c == 0 && this->isEOF()){
+        return 0;
     }
     this->cursor++;
     return c;
 }
 
+/*
+    Rewind the tokenizer so that the given checkpoint is the next token returned.
+    In pre-lexed mode, only the token index needs to be reset.
+*/
 void Tokenizer::rewindTo(Token checkpoint){
-    this->charNo = checkpoint.charNo;
-    this->lineNo = checkpoint.lineNo;
+    this->tokenIndex = checkpoint.index;
+    if (this->isPreLexed){
+        return;
+    }
+
     this->cursor = checkpoint.string.data - this->buffer;
-}
\ No newline at end of file
+}
+
+
+
+/*
+    Registry of the loaded source buffers, used to find the line and column of a position in one.
+    The line starts of a buffer are only found on the first lookup into it, most sources never need them.
+*/
+struct SourceLines{
+    const char *start;
+    size_t size;
+    bool isIndexed;
+    // offsets of the first character of each line
+    std::vector<uint32_t> lineStarts;
+};
+
+static std::mutex sourcesLock;
+static std::vector<SourceLines> sources;
+
+
+void registerSource(const char *buffer, size_t size){
+    std::lock_guard<std::mutex> guard(sourcesLock);
+    sources.push_back(SourceLines{.start = buffer, .size = size, .isIndexed = false});
+}
+
+
+void unregisterSource(const char *buffer){
+    std::lock_guard<std::mutex> guard(sourcesLock);
+    for (size_t i=0; i<sources.size(); i++){
+        if (sources[i].start == buffer){
+            sources.erase(sources.begin() + i);
+            return;
+        }
+    }
+}
+
+
+SourceLocation locateInSource(const char *position){
+    std::lock_guard<std::mutex> guard(sourcesLock);
+    for (SourceLines &source : sources){
+        // the end of the buffer is included, for the EOF token
+        if (position < source.start || position > source.start + source.size){
+            continue;
+        }
+
+        if (!source.isIndexed){
+            // sized up front, so that indexing a source is a single allocation
+            source.lineStarts.reserve(std::count(source.start, source.start + source.size, '\n') + 1);
+            source.lineStarts.push_back(0);
+            scanLineStartsSIMD(source.start, 0, source.size, source.lineStarts);
+            source.isIndexed = true;
+        }
+
+        // the line is the last line start at or before the position
+        uint32_t offset = position - source.start;
+        auto line = std::upper_bound(source.lineStarts.begin(), source.lineStarts.end(), offset) - 1;
+        
+        return SourceLocation{
+            .lineNo = (int)(line - source.lineStarts.begin()) + 1,
+            .charNo = (int)(offset - *line) + 1,
+        };
+    }
+    return SourceLocation{0, 0};
+}
+
+
+
+/*
+    Open addressing hash table of the atoms. The interned strings are copied into blocks owned by the table,
+    so that atom names outlive the source buffers they were lexed from.
+*/
+struct AtomTable{
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    // atom in each slot, NO_ATOM if the slot is empty
+    std::vector<Atom> slots;
+    // name and hash of each atom, indexed by the atom
+    std::vector<Splice> names;
+    std::vector<uint32_t> hashes;
+
+    std::vector<char *> blocks;
+    size_t blockUsed;
+
+    std::mutex lock;
+    // only set while several threads may use the table, it is changed with no other thread running
+    bool isShared;
+
+    AtomTable(){
+        this->isShared = false;
+        this->slots.resize(1024, NO_ATOM);
+        this->names.push_back(Splice{.data = "", .len = 0});
+        this->hashes.push_back(0);
+        this->blockUsed = BLOCK_SIZE;
+
+        for (int i=0; i<N_KEYWORDS; i++){
+            Atom atom = this->intern(KEYWORDS[i], strlen(KEYWORDS[i]));
+            assert(atom == (Atom)i + 1);
+        }
+    }
+
+    ~AtomTable(){
+        for (char *block : this->blocks){
+            delete[] block;
+        }
+    }
+
+    // FNV-1a
+    static uint32_t hash(const char *data, size_t len){
+        uint32_t h = 2166136261u;
+        for (size_t i=0; i<len; i++){
+            h = (h ^ (uint8_t)data[i]) * 16777619u;
+        }
+        return h;
+    }
+
+    const char *copyString(const char *data, size_t len){
+        if (len > BLOCK_SIZE){
+            char *str = new char[len];
+            this->blocks.push_back(str);
+            memcpy(str, data, len);
+            return str;
+        }
+        if (this->blockUsed + len > BLOCK_SIZE){
+            this->blocks.push_back(new char[BLOCK_SIZE]);
+            this->blockUsed = 0;
+        }
+        char *str = this->blocks.back() + this->blockUsed;
+        memcpy(str, data, len);
+        this->blockUsed += len;
+        return str;
+    }
+
+    void grow(){
+        std::vector<Atom> slots(this->slots.size() * 2, NO_ATOM);
+        size_t mask = slots.size() - 1;
+        for (Atom atom = 1; atom < this->names.size(); atom++){
+            size_t i = this->hashes[atom] & mask;
+            while (slots[i] != NO_ATOM){
+                i = (i + 1) & mask;
+            }
+            slots[i] = atom;
+        }
+        this->slots = std::move(slots);
+    }
+
+    Atom intern(const char *data, size_t len){
+        uint32_t h = hash(data, len);
+        size_t mask = this->slots.size() - 1;
+        
+        size_t i = h & mask;
+        while (this->slots[i] != NO_ATOM){
+            Atom atom = this->slots[i];
+            if (this->hashes[atom] == h && this->names[atom].len == len && memcmp(this->names[atom].data, data, len) == 0){
+                return atom;
+            }
+            i = (i + 1) & mask;
+        }
+
+        Atom atom = this->names.size();
+        this->names.push_back(Splice{.data = this->copyString(data, len), .len = (uint32_t)len, .atom = atom});
+        this->hashes.push_back(h);
+        this->slots[i] = atom;
+
+        // keep the load factor under a half
+        if (this->names.size() * 2 > this->slots.size()){
+            this->grow();
+        }
+        return atom;
+    }
+};
+
+
+static AtomTable &atomTable(){
+    static AtomTable table;
+    return table;
+}
+
+
+Atom internAtom(const char *data, size_t len){
+    AtomTable &table = atomTable();
+    std::unique_lock<std::mutex> guard(table.lock, std::defer_lock);
+    if (table.isShared){
+        guard.lock();
+    }
+    return table.intern(data, len);
+}
+
+
+Splice atomName(Atom atom){
+    AtomTable &table = atomTable();
+    std::unique_lock<std::mutex> guard(table.lock, std::defer_lock);
+    if (table.isShared){
+        guard.lock();
+    }
+    assert(atom != NO_ATOM && atom < table.names.size());
+    return table.names[atom];
+}
+
+
+size_t atomCount(){
+    AtomTable &table = atomTable();
+    std::unique_lock<std::mutex> guard(table.lock, std::defer_lock);
+    if (table.isShared){
+        guard.lock();
+    }
+    // atom 0 is not an atom
+    return table.names.size() - 1;
+}
+
+
+void shareAtoms(bool isShared){
+    atomTable().isShared = isShared;
+}
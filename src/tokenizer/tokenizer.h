@@ -1,10 +1,83 @@
 #pragma once
 
 #include "fa.h"
+#include "scan.h"
 
 #include "token.h"
+#include "source.h"
+#include "atoms.h"
+
+#include <utils/utils.h>
+
+#include <vector>
+#include <stdint.h>
+
+
+
+/*
+    All the tokens of a translation unit, lexed up front. 
+    Stored as struct of arrays, the token text is given by its start and length in the source buffer it was lexed from.
+    Tokens from different buffers can be mixed in one stream (eg: the output of the preprocessor, see preprocessor.h).
+*/
+struct TokenBuffer{
+    std::vector<int> types;
+    std::vector<const char *> starts;
+    std::vector<uint32_t> lengths;
+    std::vector<Atom> atoms;
+    std::vector<LiteralValue> values;
+
+    size_t count(){
+        return types.size();
+    }
+
+    void reserve(size_t n){
+        types.reserve(n);
+        starts.reserve(n);
+        lengths.reserve(n);
+        atoms.reserve(n);
+        values.reserve(n);
+    }
+
+    void push(const Token &t){
+        types.push_back(t.type);
+        starts.push_back(t.string.data);
+        lengths.push_back(t.string.len);
+        atoms.push_back(t.string.atom);
+        values.push_back(t.value);
+    }
+
+    // append the tokens of other from index from onwards
+    void append(const TokenBuffer &other, size_t from){
+        types.insert(types.end(), other.types.begin() + from, other.types.end());
+        starts.insert(starts.end(), other.starts.begin() + from, other.starts.end());
+        lengths.insert(lengths.end(), other.lengths.begin() + from, other.lengths.end());
+        atoms.insert(atoms.end(), other.atoms.begin() + from, other.atoms.end());
+        values.insert(values.end(), other.values.begin() + from, other.values.end());
+    }
+
+    // hash of the type and text of the tokens in [begin, end), the value of a token follows from them
+    uint64_t hash(uint64_t seed, size_t begin, size_t end) const{
+        uint64_t hash = hashBytes(seed, types.data() + begin, (end - begin) * sizeof(int));
+        hash = hashBytes(hash, lengths.data() + begin, (end - begin) * sizeof(uint32_t));
+        for (size_t i=begin; i<end; i++){
+            hash = hashBytes(hash, starts[i], lengths[i]);
+        }
+        return hash;
+    }
+};
+
+
+// number of zero bytes that always follow the source in the buffer
+static const size_t SENTINEL_PADDING = 64;
 
+// source files of at least this size are memory mapped instead of read
+static const size_t MMAP_THRESHOLD = 64 * 1024;
 
+// smallest chunk of source given to a thread when lexing in parallel
+static const size_t PARALLEL_LEX_MIN_CHUNK = 256 * 1024;
+
+
+struct LexedChunk;
 
 
 struct Tokenizer{
@@ -13,6 +86,12 @@ private:
 
     char* buffer;
     size_t bufferSize;
+    
+    bool isMapped;
+    size_t mappedSize;
+
+    // identifiers are interned as they are lexed, else their atoms are left as NO_ATOM
+    bool internsAtoms;
 
     NumConstDFA numDFA;
     PunctuatorDFA puncDFA;
@@ -29,26 +108,58 @@ private:
 
     bool checkForComments();
     void skipComments();
+    void skipToNextToken();
     
     void skipUntil(char c);
     void skipNonWhitespaces();
     void skipWhitespaces();
     bool isEOF();
+    bool isSentinel();
 
     char peekChar();
     char consumeChar();
 
+    Token lexToken();
+    void logLexError(size_t offset);
+
+    std::vector<size_t> findChunkStarts(size_t nChunks);
+    void lexChunk(LexedChunk *chunk);
+
 
 public:    
 
-    int lineNo;
-    int charNo;
     char fileName[100];
     size_t errors;
+    
+    // use the simd scanning kernels, else the scalar ones
+    bool useSIMD;
+
+    // pre-lexed mode: tokens are served from the token buffer instead of being lexed on demand
+    bool isPreLexed;
+    TokenBuffer tokens;
+    
+    // index of the next token to be returned
+    size_t tokenIndex;
+    // one past the furthest token lexed so far, any token lexed before this is a re-lex
+    size_t lexedUntil;
+    size_t relexedTokens;
+
+    // diagnostics are logged while lexing, else only counted (eg: on parallel lexing workers, or by the preprocessor
+    // which only reports the errors in the groups it keeps, see logLexError)
+    bool reportsErrors;
+    // a block comment was left open at the end of the source
+    bool hasOpenComment;
 
     void init();
-    void loadFileToBuffer(const char *filepath);
+    bool loadFileToBuffer(const char *filepath);
+    void loadStringToBuffer(const char *source, size_t size, const char *name);
+    void destroy();
+    void preLex();
+    void preLexParallel(int nThreads, size_t minChunkSize = PARALLEL_LEX_MIN_CHUNK);
+    void loadTokens(TokenBuffer &&tokens, const char *name);
     Token nextToken();
+    Token bufferedToken(size_t index);
+    void logLexError(Token t);
     
     void rewindTo(Token checkpoint);
 };
@@ -0,0 +1,225 @@
+#include "keywords.h"
+#include "tokenizer.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+
+/*
+    Tokenizer microbenchmarks.
+    Usage: tokenizer_bench.exe [c file to lex]
+    If no file is given, an identifier heavy source and a source heavy in comments, strings and indentation are generated.
+*/
+
+
+static const int N_RUNS = 5;
+
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/*
+    Generate a source made mostly of identifiers, with keywords mixed in, of about given size.
+*/
+static std::string generateIdentifierSource(size_t size){
+    static const char *names[] = {
+        "count", "buffer", "index", "value", "result", "node", "next", "length", "data", "offset",
+        "i", "j", "temp", "sum", "ptr", "total", "width", "height", "flags", "state",
+    };
+    static const char *types[] = {"int", "char", "long", "unsigned", "float", "double", "short"};
+
+    std::string src;
+    src.reserve(size + 128);
+
+    uint32_t seed = 12345;
+    auto random = [&](uint32_t n){
+        seed = seed * 1664525 + 1013904223;
+        return (seed >> 8) % n;
+    };
+
+    while (src.size() < size){
+        src += types[random(ARRAY_COUNT(types))];
+        src += " ";
+        src += names[random(ARRAY_COUNT(names))];
+        src += "_";
+        src += std::to_string(random(1000));
+        src += " = ";
+        for (int i=0; i<4; i++){
+            src += names[random(ARRAY_COUNT(names))];
+            src += (i < 3)? " + " : ";\n";
+        }
+        if (random(4) == 0){
+            src += "if (flags) return state; while (next) continue;\n";
+        }
+    }
+    return src;
+}
+
+
+/*
+    Generate a source with indented code, comments and string literals, of about given size.
+*/
+static std::string generateMixedSource(size_t size){
+    std::string src;
+    src.reserve(size + 512);
+
+    while (src.size() < size){
+        src += "/*\n"
+               "    Some documentation for the function below, spanning a few lines,\n"
+               "    as block comments above functions usually do.\n"
+               "*/\n"
+               "int function(int argument, char *buffer){\n"
+               "        // a single line comment explaining the next statement\n"
+               "        const char *message = \"a fairly long string literal used as a message\\n\";\n"
+               "        if (argument > 10){\n"
+               "                return write(1, message, 40);\n"
+               "        }\n"
+               "        return argument;\n"
+               "}\n\n";
+    }
+    return src;
+}
+
+
+/*
+    Lex the whole buffer, returning the number of tokens.
+*/
+static size_t lexAll(const char *src, size_t size, bool useSIMD){
+    Tokenizer t;
+    t.init();
+    t.useSIMD = useSIMD;
+    t.loadStringToBuffer(src, size, "bench");
+
+    size_t count = 0;
+    while (t.nextToken().type != TOKEN_EOF){
+        count++;
+    }
+    
+    t.destroy();
+    return count;
+}
+
+
+static void benchParallelLexing(const char *name, const std::string &src){
+    for (int threads : {1, 2, 4, 8}){
+        double best = 1e30;
+        size_t tokens = 0;
+        for (int i=0; i<N_RUNS; i++){
+            Tokenizer t;
+            t.init();
+            t.loadStringToBuffer(src.data(), src.size(), "bench");
+            
+            auto start = std::chrono::steady_clock::now();
+            t.preLexParallel(threads);
+            double elapsed = secondsSince(start);
+            best = (elapsed < best)? elapsed : best;
+            
+            tokens = t.tokens.count();
+            t.destroy();
+        }
+
+        double mb = src.size() / (1024.0 * 1024.0);
+        fprintf(stdout, "[Pre-lexing] %-12s %d threads %.2f MB, %zu tokens: %.3f s, %.2f MB/s\n",
+                name, threads, mb, tokens, best, mb / best);
+    }
+}
+
+
+// the keyword lookup used before the perfect hash, kept as the baseline
+static int findKeywordLinear(Splice s){
+    for (int i=0; i<N_KEYWORDS; i++){
+        if (compare(s, KEYWORDS[i])){
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+static void benchLexing(const char *name, const std::string &src){
+    for (bool useSIMD : {false, true}){
+        double best = 1e30;
+        size_t tokens = 0;
+        for (int i=0; i<N_RUNS; i++){
+            auto start = std::chrono::steady_clock::now();
+            tokens = lexAll(src.data(), src.size(), useSIMD);
+            double elapsed = secondsSince(start);
+            best = (elapsed < best)? elapsed : best;
+        }
+
+        double mb = src.size() / (1024.0 * 1024.0);
+        fprintf(stdout, "[Lexing] %-12s %-6s %.2f MB, %zu tokens: %.3f s, %.2f MB/s, %.2f Mtokens/s\n",
+                name, (useSIMD)? "simd" : "scalar", mb, tokens, best, mb / best, tokens / best / 1e6);
+    }
+}
+
+
+static void benchKeywords(const std::string &src){
+    // collect the identifier and keyword strings
+    std::vector<Splice> words;
+    {
+        Tokenizer t;
+        t.init();
+        t.loadStringToBuffer(src.data(), src.size(), "bench");
+
+        Token tok = t.nextToken();
+        while (tok.type != TOKEN_EOF){
+            if (tok.type == TOKEN_IDENTIFIER || (tok.type > TOKEN_KEYWORDS_START && tok.type <= TOKEN_WHILE)){
+                // the splices point into the tokenizer buffer which is never freed
+                words.push_back(tok.string);
+            }
+            tok = t.nextToken();
+        }
+    }
+
+    auto run = [&](const char *name, auto find){
+        double best = 1e30;
+        size_t keywords = 0;
+        for (int i=0; i<N_RUNS; i++){
+            keywords = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (Splice &s : words){
+                keywords += (find(s) >= 0)? 1 : 0;
+            }
+            double elapsed = secondsSince(start);
+            best = (elapsed < best)? elapsed : best;
+        }
+        fprintf(stdout, "[Keywords] %-8s %zu words, %zu keywords: %.2f ns/word\n",
+                name, words.size(), keywords, best * 1e9 / words.size());
+    };
+
+    run("linear", [](Splice s){ return findKeywordLinear(s); });
+    run("hash", [](Splice s){ return findKeyword(s.data, s.len); });
+}
+
+
+int main(int argc, char **argv){
+    std::string src;
+    if (argc >= 2){
+        std::ifstream f(argv[1], std::ios::binary);
+        if (!f.is_open()){
+            fprintf(stderr, "Failed to open file: %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        src.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        
+        benchLexing(argv[1], src);
+        benchParallelLexing(argv[1], src);
+        benchKeywords(src);
+        return 0;
+    }
+
+    src = generateIdentifierSource(16 * 1024 * 1024);
+    benchLexing("identifiers", src);
+    benchKeywords(src);
+
+    src = generateMixedSource(16 * 1024 * 1024);
+    benchLexing("mixed", src);
+    benchParallelLexing("mixed", src);
+    return 0;
+}
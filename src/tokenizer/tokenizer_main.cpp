@@ -1,15 +1,65 @@
 #include "tokenizer.h"
 #include <iostream>
 
+// tiny chunks so that even the small test files are split at many points
+static const int CHECK_THREADS = 16;
+static const size_t CHECK_CHUNK_SIZE = 64;
+
+
+/*
+    Lex the file sequentially and in parallel, returning the number of tokens that differ between the two streams.
+*/
+static int checkParallel(const char *filepath){
+    Tokenizer sequential;
+    sequential.init();
+    Tokenizer parallel;
+    parallel.init();
+    if (!sequential.loadFileToBuffer(filepath) || !parallel.loadFileToBuffer(filepath)){
+        return -1;
+    }
+    parallel.preLexParallel(CHECK_THREADS, CHECK_CHUNK_SIZE);
+
+    int mismatches = 0;
+    while (true){
+        Token a = sequential.nextToken();
+        Token b = parallel.nextToken();
+        SourceLocation la = locateToken(a);
+        SourceLocation lb = locateToken(b);
+
+        if (a.type != b.type || !compare(a.string, b.string) || a.string.atom != b.string.atom || a.value.u64 != b.value.u64
+            || la.lineNo != lb.lineNo || la.charNo != lb.charNo){
+            std::cout<<"[Mismatch] "<<la.lineNo<<":"<<la.charNo<<" "<<a.string<<" ("<<TOKEN_TYPE_STRING[a.type]<<") != "
+                     <<lb.lineNo<<":"<<lb.charNo<<" "<<b.string<<" ("<<TOKEN_TYPE_STRING[b.type]<<")\n";
+            mismatches++;
+        }
+        if (a.type == TOKEN_EOF || b.type == TOKEN_EOF){
+            break;
+        }
+    }
+    
+    if (sequential.errors != parallel.errors){
+        std::cout<<"[Mismatch] "<<sequential.errors<<" != "<<parallel.errors<<" errors\n";
+        mismatches++;
+    }
+    return mismatches;
+}
+
+
 int main(int argc, char ** argv){
     if (argc < 2){
-        std::cout<<"[USAGE] tokenizer.exe <path to c file to tokenize>";
+        std::cout<<"[USAGE] tokenizer.exe <path to c file to tokenize> [-check-parallel]";
         return -1; 
     }
 
+    if (argc >= 3 && strcmp(argv[2], "-check-parallel") == 0){
+        return checkParallel(argv[1]);
+    }
+
     Tokenizer t;
     t.init();
-    t.loadFileToBuffer(argv[1]);
+    if (!t.loadFileToBuffer(argv[1])){
+        return -1;
+    }
 
     // Output to md file
     std::ofstream mdFile("token_output.md");
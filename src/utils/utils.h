@@ -4,6 +4,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <assert.h>
+#include <string.h>
 
 static int max(int a, int b){
     return (a>b)?a:b;
@@ -21,4 +22,25 @@ static bool inRange(int64_t val, int64_t a, int64_t b){
     return (val >= a) && (val <= b);
 }
 
-#define assertFalse(cond) assert((cond) && false)
\ No newline at end of file
+#define assertFalse(cond) assert((cond) && false)
+
+
+// hash of a run of bytes, eight bytes at a time
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size){
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (; size >= 8; bytes += 8, size -= 8){
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    if (size > 0){
+        uint64_t word = 0;
+        memcpy(&word, bytes, size);
+        hash = (hash ^ word ^ (uint64_t)size << 59) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+static const uint64_t HASH_SEED = 0xCBF29CE484222325ull;
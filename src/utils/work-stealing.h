@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+/*
+    Run work(item, worker) for each of the items [0, n) on nWorkers threads, worker 0 being the calling thread.
+
+    Each worker starts with a contiguous run of the items and takes them from its front. A worker whose run is
+    empty steals the back half of the run of another worker, so that items of uneven cost still keep all the
+    workers busy. A run is packed in a single word, [begin, end), so that taking and stealing are each one
+    compare and swap. Returns once every item has been run.
+*/
+template <typename Work>
+void runWorkStealing(size_t n, int nWorkers, Work work){
+    if (nWorkers < 1){
+        nWorkers = 1;
+    }
+    assert(n <= UINT32_MAX);
+
+    auto pack = [](uint64_t begin, uint64_t end){ return begin << 32 | end; };
+    auto begin = [](uint64_t run){ return run >> 32; };
+    auto end = [](uint64_t run){ return run & 0xFFFFFFFFull; };
+
+    std::vector<std::atomic<uint64_t>> runs(nWorkers);
+    for (int w=0; w<nWorkers; w++){
+        runs[w].store(pack(n * w / nWorkers, n * (w + 1) / nWorkers), std::memory_order_relaxed);
+    }
+
+    auto worker = [&](int w){
+        while (true){
+            // take from the front of our own run
+            uint64_t run = runs[w].load(std::memory_order_acquire);
+            while (begin(run) < end(run)){
+                if (runs[w].compare_exchange_weak(run, pack(begin(run) + 1, end(run)), std::memory_order_acq_rel)){
+                    work((size_t)begin(run), w);
+                    run = runs[w].load(std::memory_order_acquire);
+                }
+            }
+
+            // steal the back half of the first run left, the items being stolen are ours once the swap succeeds
+            bool stole = false;
+            for (int i=1; i<nWorkers && !stole; i++){
+                int victim = (w + i) % nWorkers;
+                uint64_t theirs = runs[victim].load(std::memory_order_acquire);
+                while (begin(theirs) < end(theirs)){
+                    uint64_t split = end(theirs) - (end(theirs) - begin(theirs) + 1) / 2;
+                    if (runs[victim].compare_exchange_weak(theirs, pack(begin(theirs), split), std::memory_order_acq_rel)){
+                        runs[w].store(pack(split, end(theirs)), std::memory_order_release);
+                        stole = true;
+                        break;
+                    }
+                }
+            }
+            if (!stole){
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w=1; w<nWorkers; w++){
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+
+    for (auto &t : threads){
+        t.join();
+    }
+}
@@ -17,4 +17,7 @@ $expected_values = @{
     "test_union.c" = 1;
     "test_struct_returns.c" = 33;
     "test_enum.c" = 3;
+    "test_preprocessor.c" = 39;
+    "test_fold.c" = 15;
+    "test_long_initializer.c" = 199;
 } 
\ No newline at end of file
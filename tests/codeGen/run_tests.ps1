@@ -24,7 +24,14 @@ $test_folder = ".\tests\codeGen"
 
 
 . "$test_folder/expected_info.ps1"
-$found_values = $expected_values.Clone()
+$found_values = @{}
+
+# each test is run with each of these options, the optimized and SSA code must give the same results as the unoptimized code
+$option_sets = @(
+    @(),
+    @("-O1"),
+    @("-ssa")
+)
 
 
 $files = Get-ChildItem -Path $test_folder"\*" -Include "*.c" 
@@ -51,52 +58,65 @@ function Convert-WindowsPathToLinux {
 
 $cwd = Get-Item -Path .
 
+# the name of a test run, the file name followed by its options
+function Get-RunName {
+    param ($file, $options)
+    return (@($file.Name) + $options) -join " "
+}
+
 #  ------------ LINUX ---------------
 if ($isLinux){
     $cwdLinux = $cwd
     
-    foreach ($file in $files){  
-        Write-Host "Test: " $file.Name -ForegroundColor Cyan  
-        
-        Write-Host "Generating asm:" -ForegroundColor Yellow  
-        & "$exec_path" $file  
-        
-        Write-Host "Compiling into RV64-ELF.." -ForegroundColor Yellow  
-        & "$riscv_gcc" $cwdLinux/codegen_output.s -o $cwdLinux/codegen_output
-        
-        Write-Host "Running on qemu.." -ForegroundColor Yellow
-        & "$qemu" -L $sysroot $cwdLinux/codegen_output
-        
-        $found_values[$file.Name] = $LASTEXITCODE
-    } 
+    foreach ($options in $option_sets){
+        foreach ($file in $files){  
+            Write-Host "Test: " (Get-RunName $file $options) -ForegroundColor Cyan  
+            
+            Write-Host "Generating asm:" -ForegroundColor Yellow  
+            & "$exec_path" $file -preprocess @options
+            
+            Write-Host "Compiling into RV64-ELF.." -ForegroundColor Yellow  
+            & "$riscv_gcc" $cwdLinux/codegen_output.s -o $cwdLinux/codegen_output
+            
+            Write-Host "Running on qemu.." -ForegroundColor Yellow
+            & "$qemu" -L $sysroot $cwdLinux/codegen_output
+            
+            $found_values[(Get-RunName $file $options)] = $LASTEXITCODE
+        } 
+    }
 }
 #  ------------ WINDOWS ---------------
 elseif ($isWindows){
     $cwdLinux = Convert-WindowsPathToLinux($cwd)
 
-    foreach ($file in $files){  
-        Write-Host "Test: " $file.Name -ForegroundColor Cyan  
-        
-        Write-Host "Generating asm:" -ForegroundColor Yellow  
-        & "$exec_path" $file  
-        
-        Write-Host "Compiling into RV64-ELF.." -ForegroundColor Yellow  
-        & "wsl" --distribution Ubuntu $riscv_gcc $cwdLinux/codegen_output.s -o $cwdLinux/codegen_output
-        
-        Write-Host "Running on qemu.." -ForegroundColor Yellow
-        & "wsl" --distribution Ubuntu $qemu -L $sysroot $cwdLinux/codegen_output
-        
-        $found_values[$file.Name] = $LASTEXITCODE
-    } 
+    foreach ($options in $option_sets){
+        foreach ($file in $files){  
+            Write-Host "Test: " (Get-RunName $file $options) -ForegroundColor Cyan  
+            
+            Write-Host "Generating asm:" -ForegroundColor Yellow  
+            & "$exec_path" $file -preprocess @options
+            
+            Write-Host "Compiling into RV64-ELF.." -ForegroundColor Yellow  
+            & "wsl" --distribution Ubuntu $riscv_gcc $cwdLinux/codegen_output.s -o $cwdLinux/codegen_output
+            
+            Write-Host "Running on qemu.." -ForegroundColor Yellow
+            & "wsl" --distribution Ubuntu $qemu -L $sysroot $cwdLinux/codegen_output
+            
+            $found_values[(Get-RunName $file $options)] = $LASTEXITCODE
+        } 
+    }
 }
 
 
-foreach ($file in $files){    
-    if ($found_values[$file.Name] -eq $expected_values[$file.Name]){
-        Write-Host -NoNewline "Test passed: " $file.Name " " -ForegroundColor Green    
-    }
-    else {
-        Write-Host -NoNewline "Test failed: " $file.Name " " -ForegroundColor Red    
+foreach ($options in $option_sets){
+    foreach ($file in $files){    
+        $run = Get-RunName $file $options
+        if ($found_values[$run] -eq $expected_values[$file.Name]){
+            Write-Host -NoNewline "Test passed: " $run " " -ForegroundColor Green    
+        }
+        else {
+            Write-Host -NoNewline "Test failed: " $run " " -ForegroundColor Red    
+        }
+        Write-Host "Found: "$found_values[$run]"/ Expected: "$expected_values[$file.Name]"."
     }
-    Write-Host "Found: "$found_values[$file.Name]"/ Expected: "$expected_values[$file.Name]"."
 } 
\ No newline at end of file
@@ -0,0 +1,57 @@
+// every check is folded at -O1 and above, and computed at run time at -O0: both must give the same result
+int main(){
+    int passed = 0;
+
+    // unsigned integers wrap at the size of their type
+    unsigned int zero = 0;
+    unsigned int max = (unsigned int)-1;
+    unsigned int below = zero - 1;
+    unsigned int above = max + 2;
+    unsigned int square = max * max;
+    passed += (below == max);
+    passed += (above == 1);
+    passed += (square == 1);
+
+    // signed and unsigned division
+    unsigned int minus8 = (unsigned int)-8;
+    unsigned int minus7 = (unsigned int)-7;
+    passed += (-7 / 2 == -3);
+    passed += (-7 % 2 == -1);
+    passed += (minus8 / 2 == 2147483644);
+    passed += (minus7 % 2 == 1);
+
+    // >> is arithmetic for signed values and logical for unsigned ones
+    unsigned int minus16 = (unsigned int)-16;
+    passed += (-16 >> 2 == -4);
+    passed += (minus16 >> 28 == 15);
+
+    // casts to unsigned int only keep the lower 32 bits
+    passed += ((unsigned int)-8 >> 28 == 15);
+    passed += ((unsigned int)-8 / 16 == 268435455);
+    passed += ((unsigned int)-8 % 16 == 8);
+
+    // floats are computed in their own precision, and truncated when converted to integers
+    float big = 16777216.0f;
+    if (big + 1.0f == big){
+        passed += 1;
+    }
+    passed += ((int)-2.7 == -2);
+
+    // undefined operations and NaN results are left to run
+    int one = 1;
+    int shift = 32;
+    if (zero){
+        passed = one / 0 + (one << shift) + (-2147483647 - 1) / -1;
+    }
+    double nothing = 0.0;
+    double nan = nothing / nothing;
+    if (nan != nan){
+        passed += 1;
+    }
+    if (nan == nan){
+        passed = 0;
+    }
+
+    // 15
+    return passed;
+}
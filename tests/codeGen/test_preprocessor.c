@@ -0,0 +1,38 @@
+#include "test_preprocessor.h"
+#include "test_preprocessor.h"
+
+#define SIZE 4
+#define CAT(a, b) a ## b
+#define SUM(...) sum(__VA_ARGS__)
+#define ADD(a, b) \
+    ((a) + \
+     (b))
+
+#if SIZE > 2 && defined(SQUARE)
+#define OFFSET 10
+#else
+#define OFFSET 1000
+#endif
+
+#ifdef UNDEFINED
+int missing(){
+    return 1000;
+}
+#endif
+
+#if 0
+Skipped groups don't have to lex: this line's apostrophes aren't character literals.
+#endif
+
+
+int sum(int a, int b, int c){
+    return a + b + c;
+}
+
+int main(){
+    int CAT(val, ue) = SIZE;
+    int arr[SIZE];
+    arr[SIZE - 1] = square(value);
+
+    return arr[3] + SUM(1, 2, 3) + OFFSET + HALF(SIZE) + ADD(2, 3);
+}
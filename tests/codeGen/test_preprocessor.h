@@ -0,0 +1,11 @@
+#ifndef TEST_PREPROCESSOR_H
+#define TEST_PREPROCESSOR_H
+
+#define SQUARE(x) ((x) * (x))
+#define HALF(x) ((x) / 2)
+
+int square(int x){
+    return SQUARE(x);
+}
+
+#endif
@@ -18,7 +18,6 @@ $test_folder = ".\tests\stdlib"
 # add the following things to a new path_info.ps1 file
 # the riscv toolchain gcc executable in linux
 # $gcc_toolchain = "~/software/riscv"
-# $riscv_cpp = $gcc_toolchain + "/bin/riscv64-unknown-linux-gnu-cpp"
 # $riscv_gcc = $gcc_toolchain + "/bin/riscv64-unknown-linux-gnu-gcc"
 # $riscv_ld = $gcc_toolchain + "/bin/riscv64-unknown-linux-gnu-ld"
 # $qemu = $gcc_toolchain + "/bin/qemu-riscv64"
@@ -70,11 +69,8 @@ if ($isLinux){
         Write-Host "Test: " $file.Name -ForegroundColor Cyan
 
 
-        Write-Host "Invoking preprocessor.." -ForegroundColor Yellow
-        & $riscv_cpp -I $cwdLinux/stdlib/include -P $linuxPath -o $cwdLinux/preprocessed.i
-        
         Write-Host "Generating asm.." -ForegroundColor Yellow  
-        & "$exec_path"  $cwd/preprocessed.i
+        & "$exec_path" $linuxPath -I $cwdLinux/stdlib/include
         
         if ($whichLib[$file.Name] -eq "own"){
             Write-Host "Compiling into RV64 obj.." -ForegroundColor Yellow  
@@ -105,15 +101,8 @@ elseif ($isWindows) {
 
         Write-Host "Test: " $file.Name -ForegroundColor Cyan
         
-        $linuxPath = Convert-WindowsPathToLinux($file.FullName)
-        Write-Host $linuxPath
-
-
-        Write-Host "Invoking preprocessor.." -ForegroundColor Yellow
-        Start-Process "wsl" -ArgumentList "--distribution", "Ubuntu", "$riscv_cpp -I $cwdLinux/stdlib/include -P $linuxPath -o $cwdLinux/preprocessed.i" -NoNewWindow -Wait
-        
         Write-Host "Generating asm.." -ForegroundColor Yellow  
-        & "$exec_path"  $cwd/preprocessed.i
+        & "$exec_path" $file.FullName -I $cwd/stdlib/include
         
         if ($whichLib[$file.Name] -eq "own"){
             Write-Host "Compiling into RV64 obj.." -ForegroundColor Yellow  
@@ -0,0 +1,33 @@
+Param(
+    [Parameter(Mandatory, HelpMessage = "Usage: <script> <exec>")]
+    [string]$exec_path,
+    [string]$test_name
+
+)
+
+# lexes every test file in the corpus both sequentially and in parallel, 
+# the tokenizer returns the number of tokens that differ between the two
+$test_folder = ".\tests"
+
+$files = Get-ChildItem -Path $test_folder -Recurse -Include "*.c" 
+if ($PSBoundParameters.ContainsKey('test_name')){
+    $files = $files | Where-Object -Property Name -eq $test_name
+}
+
+$mismatches_found = @{}
+
+foreach ($file in $files){  
+    Write-Host "Test: " $file.Name -ForegroundColor Cyan  
+    & "$exec_path" $file -check-parallel
+    $mismatches_found[$file.FullName] = $LASTEXITCODE
+} 
+
+foreach ($file in $files){    
+    if ($mismatches_found[$file.FullName] -eq 0){
+        Write-Host -NoNewline "Test passed: " $file.Name " " -ForegroundColor Green    
+    }
+    else {
+        Write-Host -NoNewline "Test failed: " $file.Name " " -ForegroundColor Red    
+    }
+    Write-Host $mismatches_found[$file.FullName] "tokens differ between sequential and parallel lexing."
+} 